@@ -0,0 +1,216 @@
+﻿// Encodes a corpus of WAV files to AAC through AudioEncoder, feeding each file in 10 ms packets
+// as a capture thread would but without pacing, and prints how much faster than real time
+// the encoder runs. With several streams every file is encoded by that many encoders at once.
+//
+//   audio_encoder_bench [-s streams] [file.wav ...]
+//
+// Without files a 30 second 48 kHz stereo test signal is used. Only PCM (16 bit) and IEEE
+// float (32 bit) WAV files are read.
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "audio_encoder/audio_encoder_factory.h"
+
+namespace {
+
+const int kPacketMs = 10;
+
+struct WavFile {
+    std::string name;
+    int sample_rate;
+    int channels;
+    int bits_per_sample;
+    AudioSampleFormat format;
+    std::vector<uint8_t> data;
+};
+
+uint32_t ReadLe32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+uint16_t ReadLe16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+bool LoadWav(const std::string& name, WavFile& wav) {
+    std::ifstream in(name, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    std::vector<uint8_t> file((std::istreambuf_iterator<char>(in)),
+                              std::istreambuf_iterator<char>());
+    if (file.size() < 12 || memcmp(file.data(), "RIFF", 4) != 0 ||
+        memcmp(file.data() + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+    bool have_format = false;
+    size_t pos = 12;
+    while (pos + 8 <= file.size()) {
+        const uint8_t* chunk = file.data() + pos;
+        const size_t size = ReadLe32(chunk + 4);
+        const size_t body = pos + 8;
+        const size_t avail = size < file.size() - body ? size : file.size() - body;
+        if (memcmp(chunk, "fmt ", 4) == 0 && avail >= 16) {
+            const uint16_t tag = ReadLe16(chunk + 8);
+            wav.channels = ReadLe16(chunk + 10);
+            wav.sample_rate = (int)ReadLe32(chunk + 12);
+            wav.bits_per_sample = ReadLe16(chunk + 22);
+            if (tag == 1 && wav.bits_per_sample == 16) {
+                wav.format = AudioSampleFormat::kS16;
+            } else if (tag == 3 && wav.bits_per_sample == 32) {
+                wav.format = AudioSampleFormat::kF32;
+            } else {
+                return false;
+            }
+            have_format = wav.channels == 1 || wav.channels == 2;
+        } else if (memcmp(chunk, "data", 4) == 0 && have_format) {
+            wav.data.assign(file.begin() + body, file.begin() + body + avail);
+            wav.name = name;
+            return true;
+        }
+        pos = body + size + (size & 1);
+    }
+    return false;
+}
+
+WavFile MakeTestSignal(int seconds) {
+    WavFile wav;
+    wav.name = "test signal";
+    wav.sample_rate = 48000;
+    wav.channels = 2;
+    wav.bits_per_sample = 16;
+    wav.format = AudioSampleFormat::kS16;
+    const size_t samples = (size_t)wav.sample_rate * seconds;
+    wav.data.resize(samples * 4);
+    int16_t* out = (int16_t*)wav.data.data();
+    uint32_t noise = 1;
+    for (size_t i = 0; i < samples; ++i) {
+        const double t = (double)i / wav.sample_rate;
+        // A swept tone with some noise keeps the encoder away from its silent fast path.
+        const double tone = sin(2 * 3.14159265358979 * (220 + 40 * t) * t);
+        noise = noise * 1664525u + 1013904223u;
+        const double hiss = ((int32_t)noise >> 16) / 32768.0;
+        out[2 * i] = (int16_t)(12000 * tone + 2000 * hiss);
+        out[2 * i + 1] = (int16_t)(12000 * tone - 2000 * hiss);
+    }
+    return wav;
+}
+
+struct StreamResult {
+    uint64_t packets;
+    uint64_t bytes;
+    uint64_t stalls; // PushPcm found the pool empty and the feeder waited
+    bool ok;
+};
+
+StreamResult EncodeStream(const WavFile& wav) {
+    StreamResult result = {};
+    std::shared_ptr<AudioEncoder> encoder =
+        AudioEncoderFactory::Instance().CreateEncoder(kAudioEncodeTypeFFmpegAac);
+    if (!encoder || !encoder->Start()) {
+        return result;
+    }
+    AudioPcmFrame pcm;
+    pcm.sample_rate = wav.sample_rate;
+    pcm.channels = wav.channels;
+    pcm.bits_per_sample = wav.bits_per_sample;
+    pcm.format = wav.format;
+    const size_t frame_bytes = (size_t)wav.channels * wav.bits_per_sample / 8;
+    const size_t packet_bytes = frame_bytes * wav.sample_rate * kPacketMs / 1000;
+    for (size_t pos = 0; pos < wav.data.size(); pos += packet_bytes) {
+        const size_t size = packet_bytes < wav.data.size() - pos ? packet_bytes
+                                                                 : wav.data.size() - pos;
+        pcm.data.assign(wav.data.begin() + pos, wav.data.begin() + pos + size);
+        pcm.timestamp_us = (uint64_t)(pos / frame_bytes) * 1000000 / wav.sample_rate;
+        while (!encoder->PushPcm(pcm)) {
+            ++result.stalls;
+            std::this_thread::yield();
+        }
+    }
+    encoder->Stop();
+    const AudioEncoderStats stats = encoder->GetStats();
+    result.packets = stats.packets_encoded;
+    result.bytes = stats.bytes_encoded;
+    result.ok = stats.packets_encoded > 0;
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int streams = 1;
+    std::vector<WavFile> corpus;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            streams = atoi(argv[++i]) > 0 ? atoi(argv[i]) : 1;
+            continue;
+        }
+        WavFile wav;
+        if (!LoadWav(argv[i], wav)) {
+            printf("skipping %s: not a 16 bit PCM or 32 bit float WAV file\n", argv[i]);
+            continue;
+        }
+        corpus.push_back(std::move(wav));
+    }
+    if (corpus.empty()) {
+        corpus.push_back(MakeTestSignal(30));
+    }
+
+    printf("%d stream(s) per file, %d ms capture packets\n", streams, kPacketMs);
+    printf("%-28s %8s %8s %9s %10s %9s %8s\n", "file", "audio s", "packets", "pkt/s",
+           "kbit/s", "realtime", "stalls");
+    int status = 0;
+    double total_audio = 0;
+    double total_wall = 0;
+    for (const WavFile& wav : corpus) {
+        const double seconds = (double)wav.data.size() /
+                               ((double)wav.channels * wav.bits_per_sample / 8 * wav.sample_rate);
+        std::vector<StreamResult> results(streams);
+        const auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (int s = 0; s < streams; ++s) {
+            threads.emplace_back([&results, &wav, s]() { results[s] = EncodeStream(wav); });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        const double wall =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        StreamResult sum = {};
+        sum.ok = true;
+        for (const StreamResult& r : results) {
+            sum.packets += r.packets;
+            sum.bytes += r.bytes;
+            sum.stalls += r.stalls;
+            sum.ok = sum.ok && r.ok;
+        }
+        std::string name = wav.name;
+        if (name.size() > 28) {
+            name = "..." + name.substr(name.size() - 25);
+        }
+        printf("%-28s %8.1f %8llu %9.1f %10.1f %8.1fx %8llu\n", name.c_str(), seconds,
+               (unsigned long long)sum.packets, sum.packets / seconds / streams,
+               sum.bytes * 8 / seconds / streams / 1000, seconds * streams / wall,
+               (unsigned long long)sum.stalls);
+        if (!sum.ok) {
+            printf("    encoder produced no packets\n");
+            status = 2;
+        }
+        total_audio += seconds * streams;
+        total_wall += wall;
+    }
+    if (total_wall > 0) {
+        printf("total: %.1f s of audio in %.2f s, %.1fx real time\n", total_audio, total_wall,
+               total_audio / total_wall);
+    }
+    return status;
+}
\ No newline at end of file
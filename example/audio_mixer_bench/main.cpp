@@ -0,0 +1,258 @@
+﻿// Checks AudioMixer with synthetic tones and times its kernels. A 440 Hz microphone (44.1 kHz
+// mono S16) and a 1 kHz loopback source (48 kHz stereo float) with jittered timestamps and a
+// pause are mixed. The output must come in exact 10 ms blocks, carry both tones at their
+// gains, keep the resampler's images and aliases low, go quiet during the pause and stay
+// below full scale when overdriven. Then each kernel set mixes and soft-clips 10 ms blocks.
+//
+//   audio_mixer_bench [iterations]
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "mixer/audio_mix_kernels.h"
+#include "mixer/audio_mixer.h"
+
+namespace {
+
+const double kPi = 3.14159265358979323846;
+const int kOutRate = 48000;
+
+struct ToneSource {
+    int sample_rate;
+    int channels;
+    AudioSampleFormat format;
+    double frequency;
+    double amplitude;
+    uint64_t pause_start_ms; // no packets in [pause_start_ms, pause_end_ms)
+    uint64_t pause_end_ms;
+    uint64_t next_frame;
+    int source_id;
+};
+
+// The next 10 ms packet of the source, stamped with the time of its first sample plus up to
+// 1 ms of delivery jitter.
+AudioPcmFrame MakePacket(ToneSource& tone, std::mt19937& random, uint64_t& time_ms) {
+    const uint64_t frames = (uint64_t)tone.sample_rate / 100;
+    time_ms = tone.next_frame * 1000 / tone.sample_rate;
+    AudioPcmFrame pcm;
+    pcm.sample_rate = tone.sample_rate;
+    pcm.channels = tone.channels;
+    pcm.format = tone.format;
+    pcm.bits_per_sample = tone.format == AudioSampleFormat::kF32 ? 32 : 16;
+    pcm.timestamp_us = 1000000 + time_ms * 1000 + random() % 1000;
+    pcm.data.resize((size_t)(frames * tone.channels * pcm.bits_per_sample / 8));
+    for (uint64_t i = 0; i < frames; ++i) {
+        const double t = (double)(tone.next_frame + i) / tone.sample_rate;
+        const double value = tone.amplitude * sin(2 * kPi * tone.frequency * t);
+        for (int c = 0; c < tone.channels; ++c) {
+            const size_t index = (size_t)(i * tone.channels + c);
+            if (tone.format == AudioSampleFormat::kF32) {
+                const float sample = (float)value;
+                memcpy(&pcm.data[index * 4], &sample, 4);
+            } else {
+                const int16_t sample = (int16_t)lrint(value * 32767);
+                memcpy(&pcm.data[index * 2], &sample, 2);
+            }
+        }
+    }
+    tone.next_frame += frames;
+    return pcm;
+}
+
+// Amplitude of one frequency in the left channel of samples [begin, end).
+double Goertzel(const std::vector<float>& mix, int channels, size_t begin, size_t end,
+                double frequency) {
+    const double w = 2 * kPi * frequency / kOutRate;
+    const double coeff = 2 * cos(w);
+    double s1 = 0;
+    double s2 = 0;
+    for (size_t i = begin; i < end; ++i) {
+        const double s0 = mix[i * channels] + coeff * s1 - s2;
+        s2 = s1;
+        s1 = s0;
+    }
+    const double power = s1 * s1 + s2 * s2 - coeff * s1 * s2;
+    return 2 * sqrt(power > 0 ? power : 0) / (end - begin);
+}
+
+double ToDb(double ratio) {
+    return 20 * log10(ratio > 1e-12 ? ratio : 1e-12);
+}
+
+struct MixResult {
+    std::vector<float> samples;
+    uint32_t bad_blocks;
+    AudioMixerStats stats;
+};
+
+MixResult RunMix(ToneSource* tones, size_t count, float gain, uint64_t duration_ms) {
+    MixResult result = {};
+    AudioMixer mixer(kOutRate, 2);
+    uint64_t expected_us = 0;
+    bool first = true;
+    mixer.RegisterMixCallback([&](const AudioPcmFrame& frame) {
+        const size_t floats = frame.data.size() / sizeof(float);
+        if (frame.sample_rate != kOutRate || frame.channels != 2 || floats != kOutRate / 100 * 2 ||
+            (!first && frame.timestamp_us != expected_us)) {
+            ++result.bad_blocks;
+        }
+        first = false;
+        expected_us = frame.timestamp_us + 10000;
+        const float* data = (const float*)frame.data.data();
+        result.samples.insert(result.samples.end(), data, data + floats);
+    });
+    std::mt19937 random(7);
+    for (size_t i = 0; i < count; ++i) {
+        tones[i].source_id = mixer.AddSource(gain);
+        tones[i].next_frame = 0;
+    }
+    // Deliver packets in time order, as two capture threads would.
+    while (true) {
+        ToneSource* next = nullptr;
+        uint64_t next_ms = 0;
+        for (size_t i = 0; i < count; ++i) {
+            const uint64_t ms = tones[i].next_frame * 1000 / tones[i].sample_rate;
+            if (ms < duration_ms && (!next || ms < next_ms)) {
+                next = &tones[i];
+                next_ms = ms;
+            }
+        }
+        if (!next) {
+            break;
+        }
+        uint64_t time_ms = 0;
+        AudioPcmFrame pcm = MakePacket(*next, random, time_ms);
+        if (time_ms < next->pause_start_ms || time_ms >= next->pause_end_ms) {
+            mixer.PushPcm(next->source_id, pcm);
+        }
+    }
+    mixer.Flush();
+    result.stats = mixer.GetStats();
+    return result;
+}
+
+bool CheckTones() {
+    ToneSource tones[] = {
+        {44100, 1, AudioSampleFormat::kS16, 440, 0.5, 0, 0, 0, 0},
+        {48000, 2, AudioSampleFormat::kF32, 1000, 0.5, 1000, 1300, 0, 0},
+    };
+    MixResult r = RunMix(tones, 2, 0.5f, 2000);
+    const size_t frames = r.samples.size() / 2;
+    // Steady windows well away from the start and the pause edges.
+    const size_t steady_begin = kOutRate * 300 / 1000;
+    const size_t steady_end = kOutRate * 900 / 1000;
+    const size_t pause_begin = kOutRate * 1050 / 1000;
+    const size_t pause_end = kOutRate * 1250 / 1000;
+    const double mic = Goertzel(r.samples, 2, steady_begin, steady_end, 440);
+    const double loop = Goertzel(r.samples, 2, steady_begin, steady_end, 1000);
+    // 44.1 kHz images of the mic tone fold back to 48000 - (44100 - 440) = 4340 Hz.
+    double spur = Goertzel(r.samples, 2, steady_begin, steady_end, 4340);
+    for (double f = 2000; f <= 20000; f += 500) {
+        const double a = Goertzel(r.samples, 2, steady_begin, steady_end, f);
+        spur = a > spur ? a : spur;
+    }
+    const double paused = Goertzel(r.samples, 2, pause_begin, pause_end, 1000);
+    const double mic_paused = Goertzel(r.samples, 2, pause_begin, pause_end, 440);
+
+    printf("tones: %zu frames in %llu blocks (%u malformed), %llu resyncs\n", frames,
+           (unsigned long long)r.stats.blocks_mixed, r.bad_blocks,
+           (unsigned long long)r.stats.resyncs);
+    printf("  440 Hz mic        %6.3f (expect 0.250)\n", mic);
+    printf("  1 kHz loopback    %6.3f (expect 0.250)\n", loop);
+    printf("  worst spur        %6.1f dB below the tones\n", -ToDb(spur / 0.25));
+    printf("  loopback paused   %6.1f dB, mic meanwhile %6.3f\n", ToDb(paused / 0.25),
+           mic_paused);
+    bool ok = r.bad_blocks == 0 && frames >= (size_t)kOutRate * 2 - kOutRate / 100;
+    ok = ok && fabs(mic - 0.25) < 0.01 && fabs(loop - 0.25) < 0.01;
+    ok = ok && spur < 0.25 / 300 && paused < 0.25 / 300 && fabs(mic_paused - 0.25) < 0.01;
+    return ok;
+}
+
+bool CheckSoftClip() {
+    ToneSource tones[] = {
+        {48000, 2, AudioSampleFormat::kF32, 440, 0.9, 0, 0, 0, 0},
+        {48000, 2, AudioSampleFormat::kF32, 440, 0.9, 0, 0, 0, 0},
+    };
+    MixResult r = RunMix(tones, 2, 1.0f, 500);
+    float peak = 0;
+    for (float s : r.samples) {
+        peak = fabs(s) > peak ? fabs(s) : peak;
+    }
+    printf("overdriven 1.8x: peak %.3f\n", peak);
+    return peak < 1.0f && peak > kAudioSoftClipKnee;
+}
+
+const char* KernelName(AudioMixKernel kernel) {
+    switch (kernel) {
+    case kAudioMixKernelSse:
+        return "sse";
+    case kAudioMixKernelAvx:
+        return "avx";
+    default:
+        return "scalar";
+    }
+}
+
+bool BenchKernels(int iterations) {
+    const size_t samples = kOutRate / 100 * 2;
+    const int sources = 4;
+    std::vector<std::vector<float>> inputs(sources, std::vector<float>(samples));
+    std::mt19937 random(3);
+    for (auto& input : inputs) {
+        for (float& s : input) {
+            s = std::uniform_real_distribution<float>(-0.6f, 0.6f)(random);
+        }
+    }
+    const AudioMixKernel best = GetAudioMixKernel();
+    std::vector<float> reference;
+    bool ok = true;
+    printf("%d sources into 10 ms stereo blocks, %d blocks per kernel\n", sources, iterations);
+    const AudioMixKernel kernels[] = {kAudioMixKernelScalar, kAudioMixKernelSse,
+                                      kAudioMixKernelAvx};
+    for (AudioMixKernel kernel : kernels) {
+        if (!SelectAudioMixKernel(kernel)) {
+            printf("  %-7s unsupported\n", KernelName(kernel));
+            continue;
+        }
+        std::vector<float> mix(samples);
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            std::fill(mix.begin(), mix.end(), 0.0f);
+            for (int s = 0; s < sources; ++s) {
+                AudioMixAdd(mix.data(), inputs[s].data(), 0.7f, samples);
+            }
+            AudioSoftClip(mix.data(), samples);
+        }
+        const double seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (reference.empty()) {
+            reference = mix;
+        }
+        double error = 0;
+        for (size_t i = 0; i < samples; ++i) {
+            error = fabs(mix[i] - reference[i]) > error ? fabs(mix[i] - reference[i]) : error;
+        }
+        ok = ok && error < 1e-5;
+        printf("  %-7s %8.1f ns per block  %8.0f Msamples/s  max diff %.1e\n",
+               KernelName(kernel), seconds * 1e9 / iterations,
+               (double)samples * sources * iterations / seconds / 1e6, error);
+    }
+    SelectAudioMixKernel(best);
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int iterations = argc > 1 && atoi(argv[1]) > 0 ? atoi(argv[1]) : 200000;
+    printf("mixer kernels: %s\n", KernelName(GetAudioMixKernel()));
+    bool ok = CheckTones();
+    ok = CheckSoftClip() && ok;
+    ok = BenchKernels(iterations) && ok;
+    printf("%s\n", ok ? "all checks passed" : "CHECKS FAILED");
+    return ok ? 0 : 2;
+}
\ No newline at end of file
@@ -0,0 +1,219 @@
+﻿// Simulates a long push session to check that audio stays in sync with video. A 44.1 kHz
+// microphone whose crystal runs 150 ppm fast and a 48 kHz loopback device running 80 ppm
+// slow are stamped with jittered capture times and mixed; the mixed blocks are cut into
+// 1024-sample packets stamped the way AudioEncoder does, and merged with 30 fps video by
+// AvInterleaver. The microphone carries a click every 10 s; where it lands in the mix,
+// against when it was captured, is the lip-sync error. The session runs once with drift
+// correction and once without.
+//
+//   av_sync_bench [seconds]
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "av_sync/av_interleaver.h"
+#include "mixer/audio_mixer.h"
+
+namespace {
+
+const int kOutRate = 48000;
+const int kAacFrame = 1024;
+const double kClickEveryS = 10.0;
+
+struct Device {
+    int sample_rate;
+    int channels;
+    AudioSampleFormat format;
+    double drift_ppm; // how fast the crystal runs
+    int source_id;
+    uint64_t next_frame;
+
+    // Media time at which the device captured frame n.
+    double TimeOf(uint64_t n) const {
+        return (double)n / (sample_rate * (1 + drift_ppm * 1e-6));
+    }
+};
+
+struct SessionResult {
+    double max_error_ms;     // worst click offset once the loop had two minutes to lock
+    double final_error_ms;   // offset of the last click
+    uint64_t clicks;
+    uint64_t resyncs;
+    double mic_drift_ppm;
+    double loopback_drift_ppm;
+    uint64_t audio_packets;
+    uint64_t video_packets;
+    uint64_t out_of_order;   // interleaved packets whose timestamp went backwards
+    uint64_t forced;
+    double end_gap_ms;       // last audio minus last video timestamp
+};
+
+AudioPcmFrame MakePacket(Device& device, std::mt19937& random, double jitter_ms) {
+    const uint64_t frames = (uint64_t)device.sample_rate / 100;
+    AudioPcmFrame pcm;
+    pcm.sample_rate = device.sample_rate;
+    pcm.channels = device.channels;
+    pcm.format = device.format;
+    pcm.bits_per_sample = device.format == AudioSampleFormat::kF32 ? 32 : 16;
+    const double jitter = std::uniform_real_distribution<double>(-jitter_ms, jitter_ms)(random);
+    pcm.timestamp_us = (uint64_t)(1e6 + device.TimeOf(device.next_frame) * 1e6 + jitter * 1e3);
+    pcm.data.assign((size_t)(frames * device.channels * pcm.bits_per_sample / 8), 0);
+    if (device.format == AudioSampleFormat::kS16) {
+        // One click at the device frame captured closest to every kClickEveryS of media time.
+        const double rate = device.sample_rate * (1 + device.drift_ppm * 1e-6);
+        const uint64_t click = (uint64_t)(ceil(device.TimeOf(device.next_frame) / kClickEveryS) *
+                                          kClickEveryS * rate + 0.5);
+        if (click >= device.next_frame && click < device.next_frame + frames) {
+            const int16_t value = 16384;
+            memcpy(&pcm.data[(size_t)(click - device.next_frame) * device.channels * 2], &value, 2);
+        }
+    }
+    device.next_frame += frames;
+    return pcm;
+}
+
+SessionResult RunSession(bool correct_drift, double seconds) {
+    SessionResult result = {};
+    Device mic = {44100, 1, AudioSampleFormat::kS16, 150, 0, 0};
+    Device loopback = {48000, 2, AudioSampleFormat::kF32, -80, 0, 0};
+    const double video_interval = 1.0 / 30;
+    uint64_t video_frames = 0;
+
+    AvInterleaver interleaver;
+    bool have_last = false;
+    uint64_t last_us = 0;
+    uint64_t last_audio_us = 0;
+    uint64_t last_video_us = 0;
+    interleaver.RegisterPacketCallback([&](const AvPacket& packet) {
+        if (have_last && packet.timestamp_us < last_us) {
+            ++result.out_of_order;
+        }
+        have_last = true;
+        last_us = packet.timestamp_us;
+        if (packet.stream == kAvStreamAudio) {
+            ++result.audio_packets;
+            last_audio_us = packet.timestamp_us;
+        } else {
+            ++result.video_packets;
+            last_video_us = packet.timestamp_us;
+        }
+    });
+
+    AudioMixer mixer(kOutRate, 2);
+    mixer.SetDriftCorrection(correct_drift);
+    mic.source_id = mixer.AddSource();
+    loopback.source_id = mixer.AddSource();
+    // What AudioEncoder would do with the mix: 1024-sample packets stamped from the first.
+    bool have_first = false;
+    uint64_t first_us = 0;
+    uint64_t mixed_frames = 0;
+    uint64_t packet_frames = 0;
+    std::vector<uint8_t> payload(200, 0x21);
+    mixer.RegisterMixCallback([&](const AudioPcmFrame& frame) {
+        if (!have_first) {
+            first_us = frame.timestamp_us;
+            have_first = true;
+        }
+        const float* samples = (const float*)frame.data.data();
+        const size_t frames = frame.data.size() / (sizeof(float) * 2);
+        for (size_t i = 1; i + 1 < frames; ++i) {
+            const float s = samples[2 * i];
+            if (s > 0.2f && s >= samples[2 * i - 2] && s > samples[2 * i + 2]) {
+                // Parabolic interpolation around the peak of the resampled click.
+                const double a = samples[2 * i - 2];
+                const double c = samples[2 * i + 2];
+                const double offset = 0.5 * (a - c) / (a - 2 * s + c);
+                const double at_s =
+                    (frame.timestamp_us - 1e6) * 1e-6 + (i + offset) / (double)kOutRate;
+                const double expected = floor(at_s / kClickEveryS + 0.5) * kClickEveryS;
+                const double error_ms = (at_s - expected) * 1e3;
+                if (expected >= 120) {
+                    result.max_error_ms = fmax(result.max_error_ms, fabs(error_ms));
+                }
+                result.final_error_ms = error_ms;
+                ++result.clicks;
+            }
+        }
+        packet_frames += frames;
+        mixed_frames += frames;
+        while (packet_frames >= kAacFrame) {
+            packet_frames -= kAacFrame;
+            const uint64_t encoded = mixed_frames - packet_frames - kAacFrame;
+            interleaver.Push(kAvStreamAudio, payload.data(), payload.size(),
+                             first_us + encoded * 1000000 / kOutRate, true);
+        }
+    });
+
+    std::mt19937 random(11);
+    while (true) {
+        const double mic_t = mic.TimeOf(mic.next_frame);
+        const double loop_t = loopback.TimeOf(loopback.next_frame);
+        const double video_t = video_frames * video_interval;
+        if (mic_t >= seconds && loop_t >= seconds && video_t >= seconds) {
+            break;
+        }
+        if (video_t <= mic_t && video_t <= loop_t) {
+            // Stamped as the frame arrives, a few ms after exposure.
+            const double stamp = 1e6 + video_t * 1e6 + 1000 + random() % 3000;
+            interleaver.Push(kAvStreamVideo, payload.data(), payload.size(), (uint64_t)stamp,
+                             video_frames % 60 == 0);
+            ++video_frames;
+        } else if (mic_t <= loop_t) {
+            mixer.PushPcm(mic.source_id, MakePacket(mic, random, 1.0));
+        } else {
+            mixer.PushPcm(loopback.source_id, MakePacket(loopback, random, 1.0));
+        }
+    }
+    mixer.Flush();
+    interleaver.Flush();
+
+    result.resyncs = mixer.GetStats().resyncs;
+    result.mic_drift_ppm = mixer.GetSourceDriftPpm(mic.source_id);
+    result.loopback_drift_ppm = mixer.GetSourceDriftPpm(loopback.source_id);
+    result.forced = interleaver.GetStats().forced_packets;
+    result.end_gap_ms = ((double)last_audio_us - (double)last_video_us) / 1e3;
+    return result;
+}
+
+void Print(const char* name, const SessionResult& r) {
+    printf("%s\n", name);
+    printf("  clicks %llu, worst offset %.2f ms, last %.2f ms, %llu resyncs\n",
+           (unsigned long long)r.clicks, r.max_error_ms, r.final_error_ms,
+           (unsigned long long)r.resyncs);
+    if (r.mic_drift_ppm != 0 || r.loopback_drift_ppm != 0) {
+        printf("  measured drift: mic %+.1f ppm (150), loopback %+.1f ppm (-80)\n",
+               r.mic_drift_ppm, r.loopback_drift_ppm);
+    }
+    printf("  interleaved %llu audio + %llu video, %llu out of order, %llu forced, "
+           "streams end %.1f ms apart\n",
+           (unsigned long long)r.audio_packets, (unsigned long long)r.video_packets,
+           (unsigned long long)r.out_of_order, (unsigned long long)r.forced, r.end_gap_ms);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const double seconds = argc > 1 && atof(argv[1]) > 0 ? atof(argv[1]) : 3600;
+    printf("%.0f s session\n", seconds);
+
+    const auto start = std::chrono::steady_clock::now();
+    const SessionResult corrected = RunSession(true, seconds);
+    const double wall =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    Print("drift correction on", corrected);
+    printf("  simulated in %.1f s, %.0fx real time\n", wall, seconds / wall);
+    const SessionResult uncorrected = RunSession(false, seconds);
+    Print("drift correction off", uncorrected);
+
+    const uint64_t expected_clicks = (uint64_t)(seconds / kClickEveryS);
+    bool ok = corrected.clicks + 1 >= expected_clicks && corrected.max_error_ms < 2.0;
+    ok = ok && corrected.resyncs == 0 && corrected.out_of_order == 0;
+    ok = ok && (seconds < 600 || fabs(corrected.mic_drift_ppm - 150) < 15);
+    ok = ok && uncorrected.out_of_order == 0;
+    printf("%s\n", ok ? "all checks passed" : "CHECKS FAILED");
+    return ok ? 0 : 2;
+}
\ No newline at end of file
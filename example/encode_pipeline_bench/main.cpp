@@ -0,0 +1,186 @@
+﻿// Drives VideoEncodePipeline with stand-in stages: prepare converts a synthetic 1080p I420
+// frame to NV12 in the slot and stamps it, encode checks the stamp and the pixels and
+// spins for a fixed time, as a codec would. Every frame must reach the encode stage once, in
+// order and intact, dropped frames must give their slot back, and Stop must drain. Then the
+// frame rate with frames fed as fast as they are taken, and the latency from the start of
+// prepare to the end of encode at 30 fps, are compared for depths 1 to 3.
+//
+//   encode_pipeline_bench [prepare_ms] [encode_ms]
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "video_encoder/video_encode_pipeline.h"
+
+namespace {
+
+const uint32_t kWidth = 1920;
+const uint32_t kHeight = 1080;
+const uint32_t kFrameSize = kWidth * kHeight * 3 / 2;
+
+using Clock = std::chrono::steady_clock;
+
+void Spin(double ms) {
+    const auto end = Clock::now() + std::chrono::microseconds((int64_t)(ms * 1000));
+    while (Clock::now() < end) {
+    }
+}
+
+double MsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+struct Slot {
+    uint64_t frame;
+    Clock::time_point prepared_at; // start of prepare
+    std::vector<uint8_t> nv12;
+};
+
+struct Run {
+    uint32_t depth;
+    double prepare_ms;
+    double encode_ms;
+    uint32_t frames;
+    uint32_t drop_every; // 0 keeps every frame
+    double interval_ms;  // 0 feeds frames as fast as the pipeline takes them
+};
+
+struct RunResult {
+    double fps;
+    double mean_latency_ms;
+    double max_latency_ms;
+    uint64_t encoded;
+    uint64_t out_of_order;
+    uint64_t corrupt;
+    VideoEncodePipelineStats stats;
+};
+
+RunResult RunPipeline(const Run& run, const std::vector<uint8_t>& i420) {
+    RunResult result = {};
+    std::vector<Slot> slots(run.depth);
+    for (Slot& slot : slots) {
+        slot.nv12.resize(kFrameSize);
+    }
+    uint64_t expected = 0;
+    double latency_sum = 0;
+    VideoEncodePipeline pipeline;
+    pipeline.Start(run.depth, [&](uint32_t index) {
+        Slot& slot = slots[index];
+        // Frames dropped on the caller's side never get here.
+        while (run.drop_every && expected % run.drop_every == run.drop_every - 1) {
+            ++expected;
+        }
+        result.out_of_order += slot.frame != expected;
+        expected = slot.frame + 1;
+        // A stamp in the picture itself tells a slot overwritten while in flight.
+        uint64_t stamp = 0;
+        memcpy(&stamp, slot.nv12.data(), sizeof(stamp));
+        const uint8_t first_v = i420[kWidth * kHeight + kWidth * kHeight / 4];
+        result.corrupt += stamp != slot.frame || slot.nv12[kWidth * kHeight + 1] != first_v;
+        Spin(run.encode_ms);
+        memset(slot.nv12.data(), 0xEE, 64);
+        const double latency = MsSince(slot.prepared_at);
+        latency_sum += latency;
+        if (latency > result.max_latency_ms) {
+            result.max_latency_ms = latency;
+        }
+        ++result.encoded;
+    });
+    const auto start = Clock::now();
+    for (uint32_t frame = 0; frame < run.frames; ++frame) {
+        if (run.interval_ms > 0) {
+            std::this_thread::sleep_until(
+                start + std::chrono::microseconds((int64_t)(frame * run.interval_ms * 1000)));
+        }
+        uint32_t index = 0;
+        if (!pipeline.AcquireSlot(index)) {
+            break;
+        }
+        Slot& slot = slots[index];
+        slot.prepared_at = Clock::now();
+        if (run.drop_every && frame % run.drop_every == run.drop_every - 1) {
+            pipeline.ReleaseSlot(index);
+            continue;
+        }
+        // I420 to NV12: copy luma, interleave chroma.
+        memcpy(slot.nv12.data(), i420.data(), kWidth * kHeight);
+        const uint8_t* u = i420.data() + kWidth * kHeight;
+        const uint8_t* v = u + kWidth * kHeight / 4;
+        uint8_t* uv = slot.nv12.data() + kWidth * kHeight;
+        for (uint32_t i = 0; i < kWidth * kHeight / 4; ++i) {
+            uv[2 * i] = u[i];
+            uv[2 * i + 1] = v[i];
+        }
+        const uint64_t stamp = frame;
+        memcpy(slot.nv12.data(), &stamp, sizeof(stamp));
+        slot.frame = frame;
+        Spin(run.prepare_ms);
+        pipeline.SubmitSlot(index);
+    }
+    pipeline.Stop();
+    const double seconds = MsSince(start) / 1000;
+    result.stats = pipeline.GetStats();
+    result.fps = result.encoded / seconds;
+    result.mean_latency_ms = result.encoded ? latency_sum / result.encoded : 0;
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const double prepare_ms = argc > 1 && atof(argv[1]) > 0 ? atof(argv[1]) : 6;
+    const double encode_ms = argc > 2 && atof(argv[2]) > 0 ? atof(argv[2]) : 10;
+    const unsigned cores = std::thread::hardware_concurrency();
+    std::vector<uint8_t> i420(kFrameSize);
+    for (size_t i = 0; i < i420.size(); ++i) {
+        i420[i] = (uint8_t)(i * 7 + i / kWidth);
+    }
+    bool ok = true;
+
+    // Correctness with drops and a slow encoder, at every depth.
+    for (uint32_t depth = 1; depth <= 4; ++depth) {
+        const Run run = {depth, 0.5, 2, 200, 7, 0};
+        const RunResult r = RunPipeline(run, i420);
+        const uint64_t kept = run.frames - run.frames / run.drop_every;
+        const bool good = r.encoded == kept && r.out_of_order == 0 && r.corrupt == 0 &&
+                          r.stats.frames_submitted == kept && r.stats.frames_encoded == kept;
+        printf("depth %u: %llu of %u frames encoded (%u dropped), %llu out of order, %llu "
+               "corrupt, %llu stalls\n",
+               depth, (unsigned long long)r.encoded, run.frames, run.frames / run.drop_every,
+               (unsigned long long)r.out_of_order, (unsigned long long)r.corrupt,
+               (unsigned long long)r.stats.stalls);
+        ok = ok && good;
+    }
+
+    printf("prepare %.1f ms + encode %.1f ms per frame, %u cores\n", prepare_ms, encode_ms,
+           cores);
+    printf("%6s %10s %14s %14s %10s\n", "depth", "max fps", "latency 30fps", "worst", "stalls");
+    double fps[4] = {};
+    double latency[4] = {};
+    for (uint32_t depth = 1; depth <= 3; ++depth) {
+        const RunResult flat = RunPipeline({depth, prepare_ms, encode_ms, 150, 0, 0}, i420);
+        const RunResult paced =
+            RunPipeline({depth, prepare_ms, encode_ms, 90, 0, 1000.0 / 30}, i420);
+        fps[depth] = flat.fps;
+        latency[depth] = paced.mean_latency_ms;
+        printf("%6u %10.1f %11.2f ms %11.2f ms %10llu\n", depth, flat.fps,
+               paced.mean_latency_ms, paced.max_latency_ms,
+               (unsigned long long)flat.stats.stalls);
+        ok = ok && flat.corrupt == 0 && paced.corrupt == 0 && flat.out_of_order == 0;
+    }
+    // The encode stage bounds the rate once the stages overlap; paced below it, overlap must
+    // not cost more than one stage of latency.
+    const double stage = prepare_ms > encode_ms ? prepare_ms : encode_ms;
+    if (cores >= 2) {
+        ok = ok && fps[2] > fps[1] * 1.3;
+    }
+    ok = ok && latency[2] < latency[1] + stage && latency[3] < latency[1] + stage;
+    printf("depth 2: %.2fx the frame rate of depth 1, %+.2f ms latency\n", fps[2] / fps[1],
+           latency[2] - latency[1]);
+    printf("%s\n", ok ? "all checks passed" : "CHECKS FAILED");
+    return ok ? 0 : 2;
+}
\ No newline at end of file
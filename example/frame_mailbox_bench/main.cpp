@@ -0,0 +1,270 @@
+﻿// Checks FrameMailbox and its drop policies. First without threads: drop-oldest keeps the
+// newest capacity frames, keep-latest only the newest, and the adaptive controller, fed a
+// jittered 30 fps capture and a consumer that needs 50 ms per frame, settles at the rate the
+// consumer sustains, spaces the frames it lets in evenly and climbs back once the consumer
+// is fast again. Then a capture thread at 30 fps feeds a 50 ms consumer for a few seconds
+// through an unbounded queue, a keep-latest and an adaptive mailbox, and the latency from
+// capture to consumption is compared. Close must wake a waiting consumer at once.
+//
+//   frame_mailbox_bench [seconds]
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "frame_mailbox.h"
+#include "media_clock.h"
+
+namespace {
+
+const uint64_t kCaptureIntervalUs = 1000000 / 30;
+
+std::shared_ptr<VideoFrame> MakeFrame(uint64_t timestamp_us) {
+    std::shared_ptr<VideoFrame> frame =
+        std::make_shared<VideoFrame>(64, 36, kFrameTypeI420, false);
+    frame->SetTimestamp(timestamp_us);
+    return frame;
+}
+
+bool CheckQueuePolicies() {
+    FrameDropConfig config;
+    config.policy = kFrameDropOldest;
+    config.capacity = 3;
+    FrameMailbox oldest(config);
+    for (uint64_t i = 1; i <= 10; ++i) {
+        oldest.Push(MakeFrame(i * kCaptureIntervalUs));
+    }
+    std::vector<uint64_t> got;
+    std::shared_ptr<VideoFrame> frame;
+    while (oldest.Pop(frame, 0)) {
+        got.push_back(frame->GetTimestamp() / kCaptureIntervalUs);
+    }
+    const FrameDropStats oldest_stats = oldest.GetStats();
+    bool ok = got.size() == 3 && got[0] == 8 && got[2] == 10 && oldest_stats.dropped_stale == 7;
+
+    FrameMailbox latest;
+    for (uint64_t i = 1; i <= 10; ++i) {
+        latest.Push(MakeFrame(i * kCaptureIntervalUs));
+    }
+    const bool latest_got =
+        latest.Pop(frame, 0) && frame->GetTimestamp() == 10 * kCaptureIntervalUs;
+    const bool latest_empty = !latest.Pop(frame, 0);
+    const FrameDropStats latest_stats = latest.GetStats();
+    ok = ok && latest_got && latest_empty && latest_stats.dropped_stale == 9 &&
+         latest_stats.frames_delivered == 1;
+    printf("drop-oldest, 10 frames into 3: got %zu, the last %llu, %llu dropped\n", got.size(),
+           (unsigned long long)(got.empty() ? 0 : got.back()),
+           (unsigned long long)oldest_stats.dropped_stale);
+    printf("keep-latest, 10 frames: got the newest %s, %llu dropped\n",
+           latest_got ? "yes" : "no", (unsigned long long)latest_stats.dropped_stale);
+    return ok;
+}
+
+// The controller alone, on simulated time: frames every 33 ms with 4 ms of jitter, and a
+// consumer that needs process_us per admitted frame.
+struct Simulation {
+    uint32_t admitted;
+    double fps;
+    double interval_stddev_ms;
+    uint32_t target_fps;
+};
+
+Simulation Simulate(FrameDropController& controller, uint64_t& time_us, uint64_t process_us,
+                    uint32_t frames, std::mt19937& random) {
+    Simulation sim = {};
+    uint64_t first_us = 0;
+    uint64_t last_us = 0;
+    std::vector<double> intervals;
+    for (uint32_t i = 0; i < frames; ++i) {
+        time_us += kCaptureIntervalUs;
+        const uint64_t stamp = time_us + random() % 4000;
+        if (!controller.Admit(stamp)) {
+            continue;
+        }
+        controller.OnFrameProcessed(process_us);
+        if (sim.admitted > 0) {
+            intervals.push_back((stamp - last_us) / 1000.0);
+        } else {
+            first_us = stamp;
+        }
+        last_us = stamp;
+        ++sim.admitted;
+    }
+    if (sim.admitted > 1) {
+        sim.fps = (sim.admitted - 1) * 1e6 / (double)(last_us - first_us);
+        double mean = 0;
+        for (double d : intervals) {
+            mean += d;
+        }
+        mean /= intervals.size();
+        double var = 0;
+        for (double d : intervals) {
+            var += (d - mean) * (d - mean);
+        }
+        sim.interval_stddev_ms = sqrt(var / intervals.size());
+    }
+    sim.target_fps = controller.GetTargetFps();
+    return sim;
+}
+
+bool CheckAdaptive() {
+    FrameDropConfig config;
+    config.policy = kFrameDropAdaptive;
+    config.max_fps = 30;
+    config.min_fps = 5;
+    config.load_target = 0.8f;
+    FrameDropController controller;
+    controller.SetConfig(config);
+    std::mt19937 random(5);
+    uint64_t time_us = 1000000;
+    // 50 ms per frame at 80% load sustains 16 fps.
+    Simulate(controller, time_us, 50000, 150, random);
+    const Simulation slow = Simulate(controller, time_us, 50000, 600, random);
+    // A 5 ms consumer has room for all 30.
+    Simulate(controller, time_us, 5000, 300, random);
+    const Simulation fast = Simulate(controller, time_us, 5000, 300, random);
+    // An overloaded consumer never pushes the rate below min_fps.
+    Simulate(controller, time_us, 500000, 100, random);
+    const Simulation floor = Simulate(controller, time_us, 500000, 300, random);
+    printf("adaptive, 30 fps capture:\n");
+    printf("  50 ms consumer   target %2u fps, admitted %5.1f fps, spacing stddev %4.1f ms\n",
+           slow.target_fps, slow.fps, slow.interval_stddev_ms);
+    printf("  5 ms consumer    target %2u fps, admitted %5.1f fps\n", fast.target_fps, fast.fps);
+    printf("  500 ms consumer  target %2u fps, admitted %5.1f fps\n", floor.target_fps,
+           floor.fps);
+    bool ok = slow.target_fps >= 13 && slow.target_fps <= 16;
+    ok = ok && fabs(slow.fps - slow.target_fps) < 1.5 && slow.interval_stddev_ms < 20;
+    ok = ok && fast.target_fps == 30 && fast.fps > 28;
+    ok = ok && floor.target_fps == 5 && fabs(floor.fps - 5) < 1;
+    return ok;
+}
+
+struct LiveResult {
+    uint64_t consumed;
+    double mean_latency_ms;
+    double last_latency_ms;
+    FrameDropStats stats;
+};
+
+// A 30 fps capture thread and a consumer that takes 50 ms per frame. Without a mailbox the
+// frames go through an unbounded queue, as the demos used to.
+LiveResult RunLive(FrameMailbox* mailbox, double seconds) {
+    LiveResult result = {};
+    std::mutex mutex;
+    std::deque<std::shared_ptr<VideoFrame>> queue;
+    bool done = false;
+    std::thread capture([&]() {
+        const auto start = std::chrono::steady_clock::now();
+        const uint64_t frames = (uint64_t)(seconds * 30);
+        for (uint64_t i = 0; i < frames; ++i) {
+            std::this_thread::sleep_until(start +
+                                          std::chrono::microseconds(i * kCaptureIntervalUs));
+            std::shared_ptr<VideoFrame> frame = MakeFrame(MediaClockNowUs());
+            if (mailbox) {
+                mailbox->Push(frame);
+            } else {
+                std::lock_guard<std::mutex> lock(mutex);
+                queue.push_back(frame);
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+    });
+    double latency_sum = 0;
+    const auto end = std::chrono::steady_clock::now() +
+                     std::chrono::microseconds((int64_t)(seconds * 1e6));
+    while (std::chrono::steady_clock::now() < end) {
+        std::shared_ptr<VideoFrame> frame;
+        if (mailbox) {
+            if (!mailbox->Pop(frame, 50)) {
+                continue;
+            }
+        } else {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (queue.empty()) {
+                if (done) {
+                    break;
+                }
+                continue;
+            }
+            frame = queue.front();
+            queue.pop_front();
+        }
+        const double latency = (MediaClockNowUs() - frame->GetTimestamp()) / 1000.0;
+        latency_sum += latency;
+        result.last_latency_ms = latency;
+        ++result.consumed;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    capture.join();
+    result.mean_latency_ms = result.consumed ? latency_sum / result.consumed : 0;
+    if (mailbox) {
+        result.stats = mailbox->GetStats();
+    }
+    return result;
+}
+
+bool CheckLive(double seconds) {
+    printf("%.0f s of 30 fps capture into a 50 ms consumer:\n", seconds);
+    printf("  %-14s %9s %13s %13s %9s %9s %7s\n", "", "consumed", "mean latency", "last latency",
+           "stale", "rate", "target");
+    const LiveResult queued = RunLive(nullptr, seconds);
+    FrameMailbox latest;
+    const LiveResult kept = RunLive(&latest, seconds);
+    FrameDropConfig config;
+    config.policy = kFrameDropAdaptive;
+    FrameMailbox adaptive(config);
+    const LiveResult paced = RunLive(&adaptive, seconds);
+    const LiveResult* results[] = {&queued, &kept, &paced};
+    const char* names[] = {"unbounded queue", "keep-latest", "adaptive"};
+    for (int i = 0; i < 3; ++i) {
+        const LiveResult& r = *results[i];
+        printf("  %-14s %9llu %10.1f ms %10.1f ms %9llu %9llu %7u\n", names[i],
+               (unsigned long long)r.consumed, r.mean_latency_ms, r.last_latency_ms,
+               (unsigned long long)r.stats.dropped_stale,
+               (unsigned long long)r.stats.dropped_rate, r.stats.target_fps);
+    }
+    // The queue falls further behind every second; the mailboxes stay within about a frame.
+    bool ok = queued.last_latency_ms > 500;
+    ok = ok && kept.mean_latency_ms < 60 && kept.last_latency_ms < 100;
+    ok = ok && paced.mean_latency_ms < 60 && paced.last_latency_ms < 100;
+    ok = ok && paced.stats.dropped_rate > 0 && paced.stats.target_fps < 20;
+    return ok;
+}
+
+bool CheckClose() {
+    FrameMailbox mailbox;
+    const auto start = std::chrono::steady_clock::now();
+    std::thread closer([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        mailbox.Close();
+    });
+    std::shared_ptr<VideoFrame> frame;
+    const bool got = mailbox.Pop(frame, 5000);
+    const double waited_ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    closer.join();
+    const bool refused = !mailbox.Push(MakeFrame(1));
+    mailbox.Open();
+    const bool reopened = mailbox.Push(MakeFrame(2)) && mailbox.Pop(frame, 0);
+    printf("close: consumer woken after %.0f ms, push refused %s, reopened %s\n", waited_ms,
+           refused ? "yes" : "no", reopened ? "yes" : "no");
+    return !got && waited_ms < 1000 && refused && reopened;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const double seconds = argc > 1 && atof(argv[1]) > 0 ? atof(argv[1]) : 3;
+    bool ok = CheckQueuePolicies();
+    ok = CheckAdaptive() && ok;
+    ok = CheckLive(seconds) && ok;
+    ok = CheckClose() && ok;
+    printf("%s\n", ok ? "all checks passed" : "CHECKS FAILED");
+    return ok ? 0 : 2;
+}
\ No newline at end of file
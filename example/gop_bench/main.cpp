@@ -0,0 +1,168 @@
+﻿// Drives GopController through a minute of 30 fps video with bursts of keyframe requests from
+// other threads' point of view (several per burst), scene-cut hints and jittered capture
+// timestamps, and checks its decisions: the first frame is an IDR frame; IDR frames come at
+// least every keyframe interval; requested and scene-cut IDR frames keep the minimum gap;
+// every request is answered within the gap plus a frame, and a burst costs one keyframe.
+// With intra refresh the periodic IDR frames go away and requests are still answered. Then
+// times NextFrame.
+//
+//   gop_bench [iterations]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "video_encoder/gop_controller.h"
+
+namespace {
+
+const uint32_t kFps = 30;
+const uint64_t kFrameUs = 1000000 / kFps;
+
+struct RunResult {
+    GopStats stats;
+    uint64_t longest_gop_us;
+    uint64_t shortest_forced_gap_us; // before a requested or scene-cut IDR frame
+    uint64_t slowest_answer_us;      // from a request to the IDR frame that answered it
+    uint64_t unanswered;
+    uint64_t bursts;
+};
+
+RunResult Run(const GopConfig& config, bool intra_refresh, bool with_timestamps) {
+    RunResult result = {};
+    result.shortest_forced_gap_us = UINT64_MAX;
+    GopController gop;
+    gop.SetConfig(config);
+    std::mt19937 random(9);
+    uint64_t last_idr_us = 0;
+    uint64_t oldest_request_us = 0;
+    bool request_waiting = false;
+    GopStats before = {};
+    for (uint64_t frame = 0; frame < 60 * kFps; ++frame) {
+        const uint64_t now_us = 1000000 + frame * kFrameUs;
+        // A burst of requests, e.g. several viewers joining at once, about every 3 s.
+        if (frame > 0 && random() % (3 * kFps) == 0) {
+            const int count = 1 + (int)(random() % 5);
+            for (int i = 0; i < count; ++i) {
+                gop.RequestKeyframe();
+            }
+            ++result.bursts;
+            if (!request_waiting) {
+                oldest_request_us = now_us;
+                request_waiting = true;
+            }
+        }
+        if (random() % (5 * kFps) == 0) {
+            gop.HintSceneCut();
+        }
+        const uint64_t stamp = with_timestamps ? now_us + random() % 3000 : 0;
+        const bool idr = gop.NextFrame(stamp, kFps, intra_refresh);
+        const GopStats stats = gop.GetStats();
+        if (frame == 0) {
+            if (!idr) {
+                printf("  first frame is not an IDR frame\n");
+                result.unanswered = UINT64_MAX;
+                return result;
+            }
+            last_idr_us = now_us;
+            request_waiting = false;
+            before = stats;
+            continue;
+        }
+        if (idr) {
+            const uint64_t gap = now_us - last_idr_us;
+            if (stats.requested > before.requested || stats.scene_cuts > before.scene_cuts) {
+                result.shortest_forced_gap_us = std::min(result.shortest_forced_gap_us, gap);
+            }
+            result.longest_gop_us = std::max(result.longest_gop_us, gap);
+            if (request_waiting) {
+                result.slowest_answer_us =
+                    std::max(result.slowest_answer_us, now_us - oldest_request_us);
+                request_waiting = false;
+            }
+            last_idr_us = now_us;
+        }
+        before = stats;
+    }
+    result.longest_gop_us = std::max(result.longest_gop_us,
+                                     1000000 + 60 * kFps * kFrameUs - last_idr_us);
+    result.unanswered = request_waiting ? 1 : 0;
+    result.stats = gop.GetStats();
+    return result;
+}
+
+void Print(const char* name, const RunResult& r) {
+    printf("%s: %llu IDR frames in %llu (%llu periodic, %llu requested, %llu scene cuts)\n",
+           name, (unsigned long long)r.stats.idr_frames, (unsigned long long)r.stats.frames,
+           (unsigned long long)r.stats.periodic, (unsigned long long)r.stats.requested,
+           (unsigned long long)r.stats.scene_cuts);
+    printf("  %llu request bursts, %llu requests coalesced, %llu hints ignored\n",
+           (unsigned long long)r.bursts, (unsigned long long)r.stats.requests_coalesced,
+           (unsigned long long)r.stats.scene_cuts_ignored);
+    printf("  longest GOP %.3f s, shortest forced gap %.3f s, slowest answer %.3f s\n",
+           r.longest_gop_us / 1e6,
+           r.shortest_forced_gap_us == UINT64_MAX ? 0 : r.shortest_forced_gap_us / 1e6,
+           r.slowest_answer_us / 1e6);
+}
+
+bool CheckPeriodic(bool with_timestamps) {
+    GopConfig config;
+    config.keyframe_interval_ms = 2000;
+    config.min_keyframe_gap_ms = 1000;
+    const RunResult r = Run(config, false, with_timestamps);
+    Print(with_timestamps ? "periodic, capture timestamps" : "periodic, no timestamps", r);
+    // Timestamps jitter by up to 3 ms, so allow a frame either way.
+    const uint64_t slack = kFrameUs + 3000;
+    return r.unanswered == 0 && r.stats.requested > 0 && r.stats.periodic > 0 &&
+           r.stats.requested < r.bursts + r.stats.requests_coalesced &&
+           r.longest_gop_us <= 2000000 + slack && r.shortest_forced_gap_us + slack >= 1000000 &&
+           r.slowest_answer_us <= 1000000 + slack;
+}
+
+bool CheckIntraRefresh() {
+    GopConfig config;
+    config.keyframe_interval_ms = 2000;
+    config.min_keyframe_gap_ms = 1000;
+    config.scene_cut = false;
+    config.intra_refresh = true;
+    const RunResult r = Run(config, true, true);
+    Print("intra refresh", r);
+    GopController gop;
+    gop.SetConfig(config);
+    const uint32_t cycle = gop.GetIntervalFrames(kFps);
+    printf("  refresh cycle %u frames\n", cycle);
+    return r.unanswered == 0 && r.stats.periodic == 0 && r.stats.scene_cuts == 0 &&
+           r.stats.requested > 0 && cycle == 2 * kFps;
+}
+
+bool Bench(int iterations) {
+    GopController gop;
+    gop.SetConfig(GopConfig());
+    uint64_t idr = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        if (i % 97 == 0) {
+            gop.RequestKeyframe();
+        }
+        idr += gop.NextFrame((uint64_t)i * kFrameUs, kFps, false) ? 1 : 0;
+    }
+    const double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("NextFrame: %.1f ns per frame (%llu IDR frames in %d)\n", seconds * 1e9 / iterations,
+           (unsigned long long)idr, iterations);
+    return idr > 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int iterations = argc > 1 && atoi(argv[1]) > 0 ? atoi(argv[1]) : 1000000;
+    bool ok = CheckPeriodic(true);
+    ok = CheckPeriodic(false) && ok;
+    ok = CheckIntraRefresh() && ok;
+    ok = Bench(iterations) && ok;
+    printf("%s\n", ok ? "all checks passed" : "CHECKS FAILED");
+    return ok ? 0 : 2;
+}
\ No newline at end of file
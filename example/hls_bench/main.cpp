@@ -0,0 +1,727 @@
+﻿// Cuts a synthetic H.264 + AAC stream into HLS through HlsSegmenter, as MPEG-TS and fMP4
+// segments, with and without LL-HLS parts, and audio only. The stream is fed faster than real
+// time while a second thread plays the part of a player behind a static file server: it
+// polls the playlist from the output directory and reads every file the playlist names. The
+// playlist must always be whole, name only files that are complete, keep EXTINF within the
+// target duration and parts within the part target, and never move its media sequence back.
+// Once closed, the segments are checked end to end: TS packet sync, PAT and PMT at every
+// independent start, continuity counters, PES timestamps; fMP4 boxes and decode time
+// continuity; parts that add up to their segment byte for byte; the frames recorded; and
+// that segments and parts that expired have been deleted. The files already in the output
+// directory are deleted first, so the checks only see this run.
+//
+//   hls_bench [seconds] [output directory] [speed]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "muxer/media_muxer_factory.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+namespace {
+
+const int kWidth = 1280;
+const int kHeight = 720;
+const int kFps = 30;
+const int kGopFrames = 60;
+const int kSampleRate = 48000;
+
+class BitWriter {
+public:
+    void Put(uint32_t value, int bits) {
+        for (int i = bits - 1; i >= 0; --i) {
+            current_ = (uint8_t)((current_ << 1) | ((value >> i) & 1));
+            if (++count_ == 8) {
+                bytes_.push_back(current_);
+                current_ = 0;
+                count_ = 0;
+            }
+        }
+    }
+    void PutUe(uint32_t value) {
+        const uint32_t v = value + 1;
+        int bits = 0;
+        while ((v >> bits) > 1) {
+            ++bits;
+        }
+        Put(0, bits);
+        Put(v, bits + 1);
+    }
+    // rbsp_trailing_bits, then emulation prevention.
+    std::vector<uint8_t> Finish() {
+        Put(1, 1);
+        while (count_ != 0) {
+            Put(0, 1);
+        }
+        std::vector<uint8_t> out;
+        int zeros = 0;
+        for (uint8_t b : bytes_) {
+            if (zeros == 2 && b <= 3) {
+                out.push_back(3);
+                zeros = 0;
+            }
+            out.push_back(b);
+            zeros = b == 0 ? zeros + 1 : 0;
+        }
+        return out;
+    }
+
+private:
+    std::vector<uint8_t> bytes_;
+    uint8_t current_ = 0;
+    int count_ = 0;
+};
+
+// Baseline SPS for kWidth x kHeight (ITU-T H.264 7.3.2.1.1), PPS and slices with random
+// payload that holds no zero bytes, so it cannot contain a start code.
+struct StreamMaker {
+    std::vector<uint8_t> sps;
+    std::vector<uint8_t> pps;
+    std::mt19937 random{11};
+
+    StreamMaker() {
+        BitWriter w;
+        w.Put(0x67, 8);
+        w.Put(66, 8); // profile_idc
+        w.Put(0xC0, 8);
+        w.Put(31, 8); // level_idc
+        w.PutUe(0);   // seq_parameter_set_id
+        w.PutUe(0);   // log2_max_frame_num_minus4
+        w.PutUe(2);   // pic_order_cnt_type
+        w.PutUe(1);   // max_num_ref_frames
+        w.Put(0, 1);
+        w.PutUe(kWidth / 16 - 1);
+        w.PutUe(kHeight / 16 - 1);
+        w.Put(1, 1); // frame_mbs_only_flag
+        w.Put(1, 1); // direct_8x8_inference_flag
+        w.Put(0, 1); // frame_cropping_flag
+        w.Put(0, 1); // vui_parameters_present_flag
+        sps = w.Finish();
+        BitWriter p;
+        p.Put(0x68, 8);
+        p.PutUe(0);
+        p.PutUe(0);
+        p.Put(0, 2);
+        p.PutUe(0);
+        p.PutUe(0);
+        p.Put(0, 3);
+        p.PutUe(0);
+        p.PutUe(0);
+        p.PutUe(0);
+        p.Put(0, 3);
+        pps = p.Finish();
+    }
+
+    void AppendNal(std::vector<uint8_t>& out, const std::vector<uint8_t>& nal) {
+        const uint8_t start_code[] = {0, 0, 0, 1};
+        out.insert(out.end(), start_code, start_code + 4);
+        out.insert(out.end(), nal.begin(), nal.end());
+    }
+
+    std::vector<uint8_t> Frame(bool keyframe, size_t size) {
+        std::vector<uint8_t> out;
+        if (keyframe) {
+            AppendNal(out, sps);
+            AppendNal(out, pps);
+        }
+        std::vector<uint8_t> slice(size);
+        slice[0] = keyframe ? 0x65 : 0x41;
+        for (size_t i = 1; i < size; ++i) {
+            slice[i] = (uint8_t)(1 + random() % 255);
+        }
+        AppendNal(out, slice);
+        return out;
+    }
+
+    std::vector<uint8_t> AacFrame(size_t raw_size) {
+        // ADTS header, protection_absent = 1
+        const size_t len = raw_size + 7;
+        std::vector<uint8_t> out = {0xFF, 0xF1, 0x4C, 0x80, 0, 0, 0xFC};
+        out[3] |= (uint8_t)((len >> 11) & 0x03);
+        out[4] = (uint8_t)((len >> 3) & 0xFF);
+        out[5] = (uint8_t)(((len & 0x07) << 5) | 0x1F);
+        for (size_t i = 0; i < raw_size; ++i) {
+            out.push_back((uint8_t)random());
+        }
+        return out;
+    }
+};
+
+std::vector<uint8_t> ReadFile(const std::string& name, bool* found = nullptr) {
+    std::ifstream in(name, std::ios::binary);
+    if (found) {
+        *found = (bool)in;
+    }
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(in)),
+                                std::istreambuf_iterator<char>());
+}
+
+bool FileExists(const std::string& name) {
+    std::ifstream in(name, std::ios::binary);
+    return (bool)in;
+}
+
+// Deletes the files directly in directory; there are no subdirectories in an HLS output.
+void ClearDirectory(const std::string& directory) {
+#ifdef _WIN32
+    WIN32_FIND_DATAA data;
+    HANDLE find = FindFirstFileA((directory + "/*").c_str(), &data);
+    if (find == INVALID_HANDLE_VALUE) {
+        return;
+    }
+    do {
+        if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+            DeleteFileA((directory + "/" + data.cFileName).c_str());
+        }
+    } while (FindNextFileA(find, &data));
+    FindClose(find);
+#else
+    DIR* dir = opendir(directory.c_str());
+    if (!dir) {
+        return;
+    }
+    while (dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] != '.') {
+            remove((directory + "/" + entry->d_name).c_str());
+        }
+    }
+    closedir(dir);
+#endif
+}
+
+uint32_t Be32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+uint64_t Be64(const uint8_t* p) {
+    return ((uint64_t)Be32(p) << 32) | Be32(p + 4);
+}
+
+struct PlaylistPart {
+    std::string uri;
+    double duration;
+    bool independent;
+};
+
+struct PlaylistSegment {
+    std::string uri;
+    double duration;
+    bool discontinuity;
+    std::vector<PlaylistPart> parts;
+};
+
+struct Playlist {
+    int version = 0;
+    int target_duration = 0;
+    double part_target = 0;
+    uint64_t media_sequence = 0;
+    std::string map;
+    std::string preload_hint;
+    bool ended = false;
+    std::vector<PlaylistSegment> segments;
+    std::vector<PlaylistPart> open_parts; // of the segment not finished yet
+};
+
+std::string Attribute(const std::string& line, const std::string& name) {
+    const size_t at = line.find(name + "=");
+    if (at == std::string::npos) {
+        return std::string();
+    }
+    size_t begin = at + name.size() + 1;
+    size_t end;
+    if (line[begin] == '"') {
+        ++begin;
+        end = line.find('"', begin);
+    } else {
+        end = line.find(',', begin);
+    }
+    return line.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+}
+
+bool ParsePlaylist(const std::string& text, Playlist& playlist, std::string& error) {
+    if (text.compare(0, 8, "#EXTM3U\n") != 0 || text.back() != '\n') {
+        error = "torn playlist";
+        return false;
+    }
+    std::istringstream in(text);
+    std::string line;
+    double duration = -1;
+    bool discontinuity = false;
+    std::vector<PlaylistPart> parts;
+    while (std::getline(in, line)) {
+        if (line.compare(0, 15, "#EXT-X-VERSION:") == 0) {
+            playlist.version = atoi(line.c_str() + 15);
+        } else if (line.compare(0, 22, "#EXT-X-TARGETDURATION:") == 0) {
+            playlist.target_duration = atoi(line.c_str() + 22);
+        } else if (line.compare(0, 22, "#EXT-X-MEDIA-SEQUENCE:") == 0) {
+            playlist.media_sequence = strtoull(line.c_str() + 22, nullptr, 10);
+        } else if (line.compare(0, 15, "#EXT-X-PART-INF") == 0) {
+            playlist.part_target = atof(Attribute(line, "PART-TARGET").c_str());
+        } else if (line.compare(0, 11, "#EXT-X-MAP:") == 0) {
+            playlist.map = Attribute(line, "URI");
+        } else if (line.compare(0, 12, "#EXT-X-PART:") == 0) {
+            PlaylistPart part;
+            part.uri = Attribute(line, "URI");
+            part.duration = atof(Attribute(line, "DURATION").c_str());
+            part.independent = Attribute(line, "INDEPENDENT") == "YES";
+            parts.push_back(part);
+        } else if (line.compare(0, 19, "#EXT-X-PRELOAD-HINT") == 0) {
+            playlist.preload_hint = Attribute(line, "URI");
+        } else if (line == "#EXT-X-DISCONTINUITY") {
+            discontinuity = true;
+        } else if (line.compare(0, 8, "#EXTINF:") == 0) {
+            duration = atof(line.c_str() + 8);
+        } else if (line == "#EXT-X-ENDLIST") {
+            playlist.ended = true;
+        } else if (!line.empty() && line[0] != '#') {
+            if (duration < 0) {
+                error = "URI without EXTINF: " + line;
+                return false;
+            }
+            playlist.segments.push_back(PlaylistSegment{line, duration, discontinuity, parts});
+            duration = -1;
+            discontinuity = false;
+            parts.clear();
+        }
+    }
+    playlist.open_parts = parts;
+    if (playlist.target_duration <= 0) {
+        error = "no target duration";
+        return false;
+    }
+    return true;
+}
+
+// Follows the packets of one stream of TS files read in order.
+struct TsStream {
+    std::map<uint16_t, uint8_t> continuity;
+    uint64_t last_video_pts = 0;
+    uint64_t video_pes = 0;
+    uint64_t audio_pes = 0;
+    bool have_pmt = false;
+};
+
+uint64_t ReadPts(const uint8_t* p) {
+    return ((uint64_t)(p[0] & 0x0E) << 29) | ((uint64_t)p[1] << 22) | ((uint64_t)(p[2] >> 1) << 15) |
+           ((uint64_t)p[3] << 7) | (p[4] >> 1);
+}
+
+// Checks one TS file; with a stream, continuity and timestamps carry on from the last file.
+bool CheckTs(const std::vector<uint8_t>& data, bool independent, TsStream* stream,
+             std::string& error) {
+    TsStream local;
+    TsStream& s = stream ? *stream : local;
+    if (data.empty() || data.size() % 188 != 0) {
+        error = "not whole TS packets";
+        return false;
+    }
+    for (size_t pos = 0; pos < data.size(); pos += 188) {
+        const uint8_t* p = &data[pos];
+        const uint16_t pid = (uint16_t)(((p[1] & 0x1F) << 8) | p[2]);
+        if (p[0] != 0x47) {
+            error = "lost sync";
+            return false;
+        }
+        if (pos == 0 && independent && pid != 0) {
+            error = "independent start without PAT";
+            return false;
+        }
+        const uint8_t cc = p[3] & 0x0F;
+        if (stream && s.continuity.count(pid) && ((s.continuity[pid] + 1) & 0x0F) != cc) {
+            error = "continuity counter jump on PID " + std::to_string(pid);
+            return false;
+        }
+        s.continuity[pid] = cc;
+        size_t payload = 4;
+        if (p[3] & 0x20) {
+            payload += 1 + p[4];
+            if (payload > 188) {
+                error = "adaptation field too long";
+                return false;
+            }
+        }
+        if (pid == 0x1000) {
+            s.have_pmt = true;
+        }
+        if (!(p[1] & 0x40) || pid == 0 || pid == 0x1000) {
+            continue;
+        }
+        const uint8_t* pes = p + payload;
+        if (188 - payload < 14 || pes[0] != 0 || pes[1] != 0 || pes[2] != 1 || !(pes[7] & 0x80)) {
+            error = "bad PES header";
+            return false;
+        }
+        const uint64_t pts = ReadPts(pes + 9);
+        if (pid == 0x100) {
+            // Microsecond timestamps land within a tick of the frame grid.
+            const int64_t step = (int64_t)(pts - s.last_video_pts) - 90000 / kFps;
+            if (stream && s.video_pes > 0 && (step < -1 || step > 1)) {
+                error = "video PTS step " + std::to_string((long long)(pts - s.last_video_pts));
+                return false;
+            }
+            s.last_video_pts = pts;
+            ++s.video_pes;
+        } else if (pid == 0x101) {
+            ++s.audio_pes;
+        }
+    }
+    if (independent && !s.have_pmt) {
+        error = "no PMT";
+        return false;
+    }
+    return true;
+}
+
+struct Fmp4Stream {
+    uint64_t next_time[3] = {0, 0, 0};
+    bool have_time[3] = {false, false, false};
+    uint64_t samples[3] = {0, 0, 0};
+};
+
+// Checks an init segment (init) or a media segment or part of moof + mdat pairs.
+bool CheckFmp4(const std::vector<uint8_t>& data, bool init, Fmp4Stream* stream,
+               std::string& error) {
+    Fmp4Stream local;
+    Fmp4Stream& s = stream ? *stream : local;
+    size_t pos = 0;
+    bool expect_mdat = false;
+    while (pos + 8 <= data.size()) {
+        const uint32_t size = Be32(&data[pos]);
+        const char* type = (const char*)&data[pos + 4];
+        if (size < 8 || pos + size > data.size()) {
+            error = "truncated box";
+            return false;
+        }
+        if (init) {
+            if (memcmp(type, pos == 0 ? "ftyp" : "moov", 4) != 0) {
+                error = "init segment is not ftyp + moov";
+                return false;
+            }
+        } else if (expect_mdat != (memcmp(type, "mdat", 4) == 0) ||
+                   (!expect_mdat && memcmp(type, "moof", 4) != 0)) {
+            error = "not moof + mdat pairs";
+            return false;
+        } else if (!expect_mdat) {
+            for (size_t p = pos + 8; p + 8 <= pos + size;) {
+                const uint32_t box = Be32(&data[p]);
+                if (box < 8) {
+                    error = "bad traf";
+                    return false;
+                }
+                if (memcmp(&data[p + 4], "traf", 4) == 0) {
+                    uint32_t track = 0;
+                    uint64_t tfdt = 0;
+                    for (size_t q = p + 8; q + 8 <= p + box;) {
+                        const uint8_t* b = &data[q + 8];
+                        if (memcmp(&data[q + 4], "tfhd", 4) == 0) {
+                            track = Be32(b + 4);
+                        } else if (memcmp(&data[q + 4], "tfdt", 4) == 0) {
+                            tfdt = b[0] == 1 ? Be64(b + 4) : Be32(b + 4);
+                        } else if (memcmp(&data[q + 4], "trun", 4) == 0 && track >= 1 &&
+                                   track <= 2) {
+                            const uint32_t flags = Be32(b) & 0xFFFFFF;
+                            const uint32_t count = Be32(b + 4);
+                            const size_t stride = (flags & 0x400) ? 12 : 8;
+                            uint64_t duration = 0;
+                            for (uint32_t i = 0; i < count; ++i) {
+                                duration += Be32(b + 12 + i * stride);
+                            }
+                            if (stream && s.have_time[track] && tfdt != s.next_time[track]) {
+                                error = "tfdt gap on track " + std::to_string(track);
+                                return false;
+                            }
+                            s.have_time[track] = true;
+                            s.next_time[track] = tfdt + duration;
+                            s.samples[track] += count;
+                        }
+                        q += Be32(&data[q]) < 8 ? 8 : Be32(&data[q]);
+                    }
+                }
+                p += box;
+            }
+        }
+        if (!init) {
+            expect_mdat = !expect_mdat;
+        }
+        pos += size;
+    }
+    if (pos != data.size() || expect_mdat || data.empty()) {
+        error = "trailing bytes or missing mdat";
+        return false;
+    }
+    return true;
+}
+
+struct Scenario {
+    const char* name;
+    MuxerType type;
+    bool video;
+    uint32_t part_ms;
+    uint32_t playlist_size;
+};
+
+struct PollResult {
+    uint64_t polls = 0;
+    uint64_t files_read = 0;
+    std::string error;
+};
+
+// The player: polls the playlist and reads what it names, as it would from a file server.
+void Poll(const std::string& directory, const std::string& playlist_name, bool ts,
+          std::atomic<bool>& stop, PollResult& result) {
+    std::set<std::string> checked;
+    uint64_t last_sequence = 0;
+    size_t last_count = 0;
+    while (!stop.load() && result.error.empty()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        bool found = false;
+        const std::vector<uint8_t> bytes = ReadFile(directory + "/" + playlist_name, &found);
+        if (!found) {
+            continue;
+        }
+        ++result.polls;
+        Playlist playlist;
+        std::string error;
+        if (!ParsePlaylist(std::string(bytes.begin(), bytes.end()), playlist, error)) {
+            result.error = error;
+            break;
+        }
+        const size_t count = playlist.segments.size();
+        if (playlist.media_sequence < last_sequence ||
+            (playlist.media_sequence == last_sequence && count < last_count)) {
+            result.error = "playlist went back";
+            break;
+        }
+        last_sequence = playlist.media_sequence;
+        last_count = count;
+        std::vector<std::pair<std::string, bool>> files; // name, independent start
+        if (!playlist.map.empty()) {
+            files.push_back(std::make_pair(playlist.map, true));
+        }
+        for (const PlaylistSegment& segment : playlist.segments) {
+            if ((int)lround(segment.duration) > playlist.target_duration) {
+                result.error = "EXTINF above the target duration";
+            }
+            double parts = 0;
+            for (const PlaylistPart& part : segment.parts) {
+                parts += part.duration;
+                files.push_back(std::make_pair(part.uri, part.independent));
+            }
+            if (!segment.parts.empty() && fabs(parts - segment.duration) > 0.002 * segment.parts.size()) {
+                result.error = "parts do not add up to " + segment.uri;
+            }
+            files.push_back(std::make_pair(segment.uri, true));
+        }
+        for (const PlaylistPart& part : playlist.open_parts) {
+            files.push_back(std::make_pair(part.uri, part.independent));
+        }
+        for (const PlaylistSegment& segment : playlist.segments) {
+            for (const PlaylistPart& part : segment.parts) {
+                if (part.duration > playlist.part_target + 0.0005) {
+                    result.error = "part above the part target: " + part.uri;
+                }
+            }
+        }
+        for (const auto& file : files) {
+            if (checked.count(file.first) || !result.error.empty()) {
+                continue;
+            }
+            bool exists = false;
+            const std::vector<uint8_t> data = ReadFile(directory + "/" + file.first, &exists);
+            ++result.files_read;
+            if (!exists) {
+                result.error = "listed but missing: " + file.first;
+            } else if (ts ? !CheckTs(data, file.second, nullptr, error)
+                          : !CheckFmp4(data, file.first == playlist.map, nullptr, error)) {
+                result.error = file.first + ": " + error;
+            }
+            checked.insert(file.first);
+        }
+    }
+}
+
+struct Fed {
+    uint64_t video_frames = 0;
+    uint64_t audio_frames = 0;
+};
+
+bool RunScenario(const Scenario& scenario, const std::string& directory, int seconds,
+                 double speed) {
+    printf("%s\n", scenario.name);
+    const std::string playlist_name = std::string(scenario.name) + ".m3u8";
+    const bool ts = scenario.type == kMuxerTypeHlsTs;
+    std::shared_ptr<MediaMuxer> muxer = MediaMuxerFactory::Instance().CreateMuxer(scenario.type);
+    MuxerConfig config;
+    config.has_video = scenario.video;
+    config.sample_rate = kSampleRate;
+    config.segment_ms = 2000;
+    config.part_ms = scenario.part_ms;
+    config.playlist_size = scenario.playlist_size;
+    if (!muxer || !muxer->Open(directory + "/" + playlist_name, config)) {
+        printf("  cannot open\n");
+        return false;
+    }
+
+    std::atomic<bool> stop(false);
+    PollResult poll;
+    std::thread player(Poll, directory, playlist_name, ts, std::ref(stop), std::ref(poll));
+
+    StreamMaker maker;
+    std::mt19937 jitter(5);
+    const uint64_t start_us = 5000000;
+    const uint64_t audio_us = 1024 * 1000000ull / kSampleRate;
+    const uint64_t end_us = start_us + (uint64_t)seconds * 1000000;
+    uint64_t video_index = 0;
+    uint64_t audio_index = 0;
+    uint64_t video_time = scenario.video ? start_us : end_us;
+    uint64_t audio_time = start_us;
+    const auto wall_start = std::chrono::steady_clock::now();
+    while (video_time < end_us || audio_time < end_us) {
+        const uint64_t now = std::min(video_time, audio_time);
+        std::this_thread::sleep_until(
+            wall_start + std::chrono::microseconds((int64_t)((now - start_us) / speed)));
+        if (video_time <= audio_time) {
+            const bool key = video_index % kGopFrames == 0;
+            const std::vector<uint8_t> frame = maker.Frame(key, key ? 40000 : 4000);
+            muxer->WriteVideo(frame.data(), frame.size(), video_time, key);
+            ++video_index;
+            video_time = start_us + video_index * 1000000 / kFps;
+        } else {
+            const std::vector<uint8_t> frame = maker.AacFrame(300 + jitter() % 100);
+            muxer->WriteAudio(frame.data(), frame.size(), audio_time);
+            ++audio_index;
+            audio_time = start_us + audio_index * audio_us;
+        }
+    }
+    muxer->Close();
+    stop = true;
+    player.join();
+    const MediaMuxerStats stats = muxer->GetStats();
+    printf("  player: %llu playlist polls, %llu files read%s%s\n",
+           (unsigned long long)poll.polls, (unsigned long long)poll.files_read,
+           poll.error.empty() ? "" : ", FAILED: ", poll.error.c_str());
+    bool ok = poll.error.empty() && poll.polls > 0;
+
+    // The final playlist, end to end.
+    Playlist playlist;
+    std::string error;
+    const std::vector<uint8_t> bytes = ReadFile(directory + "/" + playlist_name);
+    if (!ParsePlaylist(std::string(bytes.begin(), bytes.end()), playlist, error)) {
+        printf("  final playlist: %s\n", error.c_str());
+        return false;
+    }
+    TsStream ts_stream;
+    Fmp4Stream fmp4_stream;
+    if (!ts && !CheckFmp4(ReadFile(directory + "/" + playlist.map), true, nullptr, error)) {
+        printf("  %s: %s\n", playlist.map.c_str(), error.c_str());
+        ok = false;
+    }
+    double total = 0;
+    int parts_checked = 0;
+    for (const PlaylistSegment& segment : playlist.segments) {
+        const std::vector<uint8_t> data = ReadFile(directory + "/" + segment.uri);
+        const bool segment_ok = ts ? CheckTs(data, true, &ts_stream, error)
+                                   : CheckFmp4(data, false, &fmp4_stream, error);
+        if (!segment_ok) {
+            printf("  %s: %s\n", segment.uri.c_str(), error.c_str());
+            ok = false;
+            break;
+        }
+        total += segment.duration;
+        if (!segment.parts.empty()) {
+            std::vector<uint8_t> joined;
+            for (const PlaylistPart& part : segment.parts) {
+                const std::vector<uint8_t> part_data = ReadFile(directory + "/" + part.uri);
+                joined.insert(joined.end(), part_data.begin(), part_data.end());
+            }
+            if (joined != data) {
+                printf("  parts of %s differ from it\n", segment.uri.c_str());
+                ok = false;
+            }
+            ++parts_checked;
+        }
+    }
+    const uint64_t video_out = ts ? ts_stream.video_pes : fmp4_stream.samples[1];
+    const uint64_t audio_out = ts ? ts_stream.audio_pes
+                                  : fmp4_stream.samples[scenario.video ? 2 : 1];
+    printf("  %zu segments listed from #%llu, %.2f s, target %d s, %d joined from parts\n",
+           playlist.segments.size(), (unsigned long long)playlist.media_sequence, total,
+           playlist.target_duration, parts_checked);
+    printf("  %llu video + %llu audio frames muxed, %llu + %llu in the listed segments; "
+           "%llu bytes written, %llu dropped\n",
+           (unsigned long long)stats.video_frames, (unsigned long long)stats.audio_frames,
+           (unsigned long long)video_out, (unsigned long long)audio_out,
+           (unsigned long long)stats.file.bytes_written,
+           (unsigned long long)stats.file.bytes_dropped);
+    ok = ok && playlist.ended && stats.file.bytes_dropped == 0 && stats.file.write_errors == 0;
+    ok = ok && (scenario.part_ms == 0 || parts_checked > 0);
+
+    // Segment files are named <playlist name><index>.
+    const std::string stem = scenario.name;
+    const std::string extension = ts ? ".ts" : ".m4s";
+    const uint64_t segments_made = playlist.media_sequence + playlist.segments.size();
+    if (scenario.playlist_size == 0) {
+        // All of it is listed, so all of it must be there.
+        ok = ok && playlist.media_sequence == 0 && video_out == stats.video_frames &&
+             audio_out == stats.audio_frames && fabs(total - seconds) < 0.1;
+    } else {
+        // Expired segments stay for one more playlist length, then go.
+        uint64_t kept = 0;
+        for (uint64_t i = 0; i < segments_made; ++i) {
+            if (FileExists(directory + "/" + stem + std::to_string(i) + extension)) {
+                ++kept;
+                ok = ok && i + 2 * scenario.playlist_size >= segments_made;
+            }
+        }
+        printf("  %llu of %llu segment files kept\n", (unsigned long long)kept,
+               (unsigned long long)segments_made);
+    }
+    if (scenario.part_ms > 0 && segments_made > 7) {
+        ok = ok && !FileExists(directory + "/" + stem + "0.0" + extension);
+    }
+    printf("  %s\n", ok ? "ok" : "FAILED");
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int seconds = argc > 1 && atoi(argv[1]) > 0 ? atoi(argv[1]) : 20;
+    const std::string directory = argc > 2 ? argv[2] : "hls_bench_out";
+    const double speed = argc > 3 && atof(argv[3]) > 0 ? atof(argv[3]) : 10;
+    ClearDirectory(directory);
+    const Scenario scenarios[] = {
+        {"ts", kMuxerTypeHlsTs, true, 0, 3},
+        {"ts_ll", kMuxerTypeHlsTs, true, 500, 0},
+        {"fmp4", kMuxerTypeHlsFmp4, true, 0, 3},
+        {"fmp4_ll", kMuxerTypeHlsFmp4, true, 500, 0},
+        {"audio_ll", kMuxerTypeHlsTs, false, 200, 4},
+    };
+    printf("%d s of 1280x720 H.264 at %d fps + AAC, fed at %.0fx real time into %s/\n", seconds,
+           kFps, speed, directory.c_str());
+    bool ok = true;
+    for (const Scenario& scenario : scenarios) {
+        ok = RunScenario(scenario, directory, seconds, speed) && ok;
+    }
+    printf("%s\n", ok ? "all checks passed" : "CHECKS FAILED");
+    return ok ? 0 : 2;
+}
\ No newline at end of file
@@ -0,0 +1,132 @@
+﻿// Checks what the log writer leaves on disk once the process is gone. A child process logs
+// from two threads into 64 KB segments and returns from main without any shutdown call; each
+// segment must then be exactly as long as the lines written into it (no zero-filled tail of
+// the mapping, last byte a newline) and every line must be found. A second child logs the
+// same lines and raises SIGSEGV straight away; the crash handler must have drained what was
+// still in the rings into the open segment.
+//
+//   local_log_bench [dir]
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "local_log.h"
+#include "log_env.h"
+#include "log_utils.h"
+
+namespace {
+
+const char* kLogTag = "LocalLogBench";
+const char kMarker[] = "exit check line ";
+const int kLines = 4000;
+const uint32_t kSegmentSize = 64 * 1024;
+// the crash path never rotates, so all lines have to fit the first segment
+const uint32_t kCrashSegmentSize = 1024 * 1024;
+
+int RunChild(const std::string& dir, bool crash) {
+    SetLocalLogDir(dir);
+    LogEnv::CreateInstance()->SetSingleLogFileSize(crash ? kCrashSegmentSize : kSegmentSize);
+    // an ERROR line is written synchronously, so the segment is open before the burst
+    LOGE(kLogTag) << "start";
+    std::thread other([] {
+        for (int i = 0; i < kLines / 2; ++i) {
+            LOGI(kLogTag) << kMarker << i;
+        }
+    });
+    for (int i = kLines / 2; i < kLines; ++i) {
+        LOGI(kLogTag) << kMarker << i;
+    }
+    other.join();
+    if (crash) {
+        std::raise(SIGSEGV);
+    }
+    return 0;
+}
+
+bool IsLogFile(const std::string& name) {
+    return name.size() > 4 && name.compare(name.size() - 4, 4, ".log") == 0;
+}
+
+bool ReadFile(const std::string& filename, std::string& data) {
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), file)) > 0) {
+        data.append(buf, n);
+    }
+    fclose(file);
+    return true;
+}
+
+// Runs a child that logs into dir and checks the segments it left behind.
+bool Check(const char* self, const std::string& dir, bool crash) {
+    const std::string logs_dir = dir + SEPARATOR + "Logs";
+    for (const auto& name : GetDirFiles(logs_dir)) {
+        RemoveFile(logs_dir + SEPARATOR + name);
+    }
+
+    printf("%s\n", crash ? "crash:" : "exit:");
+    const std::string command =
+        std::string("\"") + self + "\" " + (crash ? "--crash " : "--child ") + dir;
+    if ((std::system(command.c_str()) == 0) == crash) {
+        printf("unexpected child exit status: %s\n", command.c_str());
+        return false;
+    }
+
+    bool ok = true;
+    int segments = 0;
+    int lines = 0;
+    for (const auto& name : GetDirFiles(logs_dir)) {
+        if (!IsLogFile(name)) {
+            continue;
+        }
+        const std::string filename = logs_dir + SEPARATOR + name;
+        std::string data;
+        if (!ReadFile(filename, data)) {
+            printf("%s: can't read\n", name.c_str());
+            ok = false;
+            continue;
+        }
+        ++segments;
+        const uint64_t file_size = GetCurrentFileSize(filename);
+        const size_t written = strnlen(data.data(), data.size());
+        printf("%s: %llu bytes, %llu written\n", name.c_str(), (unsigned long long)file_size,
+               (unsigned long long)written);
+        // a crashed process never closes its segment, so only the trimmed size differs
+        if ((!crash && file_size != written) || written == 0 || data[written - 1] != '\n' ||
+            file_size > (crash ? kCrashSegmentSize : kSegmentSize)) {
+            printf("  segment not trimmed to its lines\n");
+            ok = false;
+        }
+        data.resize(written);
+        for (size_t pos = data.find(kMarker); pos != std::string::npos;
+             pos = data.find(kMarker, pos + 1)) {
+            ++lines;
+        }
+    }
+    printf("%d segments, %d of %d lines\n", segments, lines, kLines);
+    return ok && (crash ? segments == 1 : segments > 1) && lines == kLines;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc >= 3 && strcmp(argv[1], "--child") == 0) {
+        return RunChild(argv[2], false);
+    }
+    if (argc >= 3 && strcmp(argv[1], "--crash") == 0) {
+        return RunChild(argv[2], true);
+    }
+    const std::string dir = argc >= 2 ? argv[1] : "local_log_bench_out";
+    bool ok = Check(argv[0], dir + SEPARATOR + "exit", false);
+    ok = Check(argv[0], dir + SEPARATOR + "crash", true) && ok;
+    printf("%s\n", ok ? "all checks passed" : "CHECKS FAILED");
+    return ok ? 0 : 2;
+}
\ No newline at end of file
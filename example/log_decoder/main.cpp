@@ -0,0 +1,69 @@
+﻿#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "log_flight_recorder.h"
+#include "log_format.h"
+
+// Turns a binary local_log file (.blog) or a flight recorder ring (flight.ring, also after a
+// crash) back into the text log format.
+// usage: log_decoder <input.blog|flight.ring> [output.log]
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <input.blog|flight.ring> [output.log]" << std::endl;
+        return 1;
+    }
+    std::ifstream fin(argv[1], std::ios::binary);
+    if (!fin) {
+        std::cerr << "can't open " << argv[1] << std::endl;
+        return 1;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(fin)),
+                              std::istreambuf_iterator<char>());
+
+    std::ofstream fout;
+    if (argc > 2) {
+        fout.open(argv[2], std::ios::binary | std::ios::out);
+        if (!fout) {
+            std::cerr << "can't create " << argv[2] << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = argc > 2 ? fout : std::cout;
+
+    std::string line;
+    size_t count = 0;
+    auto on_entry = [&](const BinaryLogEntry& entry) {
+        line.clear();
+        AppendTextLogLine(line, entry.time_us, entry.tag->data(), entry.tag->size(), entry.level,
+                          entry.thread_id, entry.file->data(), entry.file->size(), entry.line,
+                          entry.text, entry.text_len);
+        out.write(line.data(), (std::streamsize)line.size());
+        ++count;
+    };
+
+    if (LogFlightRecorder::IsFlightRecorderFile(data.data(), data.size())) {
+        bool ok = LogFlightRecorder::Dump(data.data(), data.size(), on_entry);
+        out.flush();
+        if (!ok) {
+            std::cerr << "corrupt flight recorder header" << std::endl;
+            return 2;
+        }
+        std::cerr << count << " lines" << std::endl;
+        return 0;
+    }
+
+    BinaryLogReader reader;
+    bool ok = reader.Decode(data.data(), data.size(), on_entry);
+    out.flush();
+    // A crash can leave a partly written last entry; everything before it is still decoded.
+    if (!ok) {
+        std::cerr << "stopped after " << count << " lines: " << reader.GetError() << std::endl;
+        return 2;
+    }
+    std::cerr << count << " lines" << std::endl;
+    return 0;
+}
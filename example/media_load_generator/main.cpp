@@ -0,0 +1,204 @@
+﻿// Pushes N synthetic H.264 streams (SPS+PPS+IDR at every GOP start, P slices otherwise, sizes
+// derived from the bitrate) to a MediaServer, or to one running in this process, and reports
+// the throughput actually achieved together with the CPU time it took:
+//
+//   media_load_generator <host|embedded> <port> <streams> <kbps> [fps] [seconds]
+//
+// With "embedded" the server runs in-process with a handler that only touches the frames, so
+// the printed Mbit/s per core is the transport ceiling of one machine, load generator included.
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "transport/framed_socket.h"
+#include "transport/media_server.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+double ProcessCpuSeconds() {
+#ifdef _WIN32
+    FILETIME create_time, exit_time, kernel_time, user_time;
+    GetProcessTimes(GetCurrentProcess(), &create_time, &exit_time, &kernel_time, &user_time);
+    ULARGE_INTEGER kernel, user;
+    kernel.LowPart = kernel_time.dwLowDateTime;
+    kernel.HighPart = kernel_time.dwHighDateTime;
+    user.LowPart = user_time.dwLowDateTime;
+    user.HighPart = user_time.dwHighDateTime;
+    return (kernel.QuadPart + user.QuadPart) / 1e7;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+#endif
+}
+
+std::vector<uint8_t> MakeFrame(bool key_frame, uint32_t size, uint32_t seed) {
+    static const uint8_t kSps[] = {0, 0, 0, 1, 0x67, 0x42, 0xC0, 0x1F, 0xDA, 0x01, 0x40, 0x16,
+                                   0xEC, 0x04, 0x40, 0x00, 0x00, 0x03, 0x00, 0x40, 0x00, 0x00,
+                                   0x0C, 0x83, 0xC6, 0x0C, 0xA8};
+    static const uint8_t kPps[] = {0, 0, 0, 1, 0x68, 0xCE, 0x3C, 0x80};
+    std::vector<uint8_t> frame;
+    if (key_frame) {
+        frame.insert(frame.end(), kSps, kSps + sizeof(kSps));
+        frame.insert(frame.end(), kPps, kPps + sizeof(kPps));
+    }
+    const uint8_t slice[] = {0, 0, 0, 1, (uint8_t)(key_frame ? 0x65 : 0x41)};
+    frame.insert(frame.end(), slice, slice + sizeof(slice));
+    // Payload bytes never form a start code: every byte has its top bit set.
+    uint32_t x = seed * 2654435761u + 1;
+    while (frame.size() < size) {
+        x = x * 1664525u + 1013904223u;
+        frame.push_back((uint8_t)(0x80 | (x >> 24)));
+    }
+    return frame;
+}
+
+struct Stream {
+    FramedSocket socket;
+    std::vector<uint8_t> key_frame;
+    std::vector<uint8_t> delta_frame;
+    bool failed{false};
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 5) {
+        printf("usage: %s <host|embedded> <port> <streams> <kbps> [fps] [seconds]\n", argv[0]);
+        return 1;
+    }
+    std::string host = argv[1];
+    uint16_t port = (uint16_t)atoi(argv[2]);
+    const uint32_t stream_count = (uint32_t)atoi(argv[3]);
+    const uint32_t kbps = (uint32_t)atoi(argv[4]);
+    const uint32_t fps = argc > 5 ? (uint32_t)atoi(argv[5]) : 30;
+    const uint32_t seconds = argc > 6 ? (uint32_t)atoi(argv[6]) : 10;
+    if (stream_count == 0 || kbps == 0 || fps == 0) {
+        printf("streams, kbps and fps must be positive\n");
+        return 1;
+    }
+
+    std::unique_ptr<MediaServer> server;
+    std::atomic<uint64_t> checksum{0};
+    if (host == "embedded") {
+        server.reset(new MediaServer());
+        server->SetFrameHandler([&](uint32_t, const std::shared_ptr<FramePacket>& frame) {
+            checksum += frame->GetData()[frame->GetSize() - 1];
+        });
+        if (!server->Start("127.0.0.1", port)) {
+            printf("embedded server failed to start\n");
+            return 1;
+        }
+        host = "127.0.0.1";
+        port = server->GetPort();
+    }
+
+    // One GOP per second: the key frame weighs as much as four average frames.
+    const uint32_t average = kbps * 1000 / 8 / fps;
+    const uint32_t key_size = average * 4;
+    const uint32_t delta_size =
+        fps > 1 ? (average * fps - key_size) / (fps - 1) : average;
+    std::vector<std::unique_ptr<Stream>> streams;
+    for (uint32_t i = 0; i < stream_count; ++i) {
+        SocketHandle socket = ConnectTcp(host, port);
+        if (socket == kInvalidSocket) {
+            printf("connect %s:%u failed after %u streams\n", host.c_str(), port, i);
+            return 1;
+        }
+        std::unique_ptr<Stream> stream(new Stream());
+        stream->socket.Attach(socket);
+        stream->socket.Tune(true, 1024 * 1024, 0);
+        stream->key_frame = MakeFrame(true, key_size, i);
+        stream->delta_frame = MakeFrame(false, delta_size > 16 ? delta_size : 16, i);
+        streams.push_back(std::move(stream));
+    }
+    printf("%u streams x %u kbit/s at %u fps to %s:%u (key %u B, delta %u B)%s%s\n",
+           stream_count, kbps, fps, host.c_str(), port, key_size, delta_size,
+           server ? ", poller " : "", server ? server->GetPollerName() : "");
+
+    // One thread paces every stream; streams are staggered across the frame interval so the
+    // key frames do not all land at once.
+    typedef std::chrono::steady_clock Clock;
+    const auto interval = std::chrono::microseconds(1000000 / fps);
+    const auto start = Clock::now();
+    const double cpu_start = ProcessCpuSeconds();
+    uint64_t frames_sent = 0;
+    uint64_t bytes_sent = 0;
+    uint64_t late = 0;
+    const uint32_t total_ticks = seconds * fps;
+    for (uint32_t tick = 0; tick < total_ticks; ++tick) {
+        for (uint32_t i = 0; i < stream_count; ++i) {
+            const auto due = start + interval * tick + interval * i / stream_count;
+            if (Clock::now() < due) {
+                std::this_thread::sleep_until(due);
+            } else if (Clock::now() - due > interval) {
+                ++late;
+            }
+            Stream& stream = *streams[i];
+            if (stream.failed) {
+                continue;
+            }
+            const std::vector<uint8_t>& frame =
+                tick % fps == 0 ? stream.key_frame : stream.delta_frame;
+            if (!stream.socket.SendFrame(frame.data(), (uint32_t)frame.size())) {
+                printf("stream %u: send failed %d\n", i, LastSocketError());
+                stream.failed = true;
+                continue;
+            }
+            ++frames_sent;
+            bytes_sent += frame.size();
+        }
+        if ((tick + 1) % fps == 0) {
+            const double elapsed =
+                std::chrono::duration<double>(Clock::now() - start).count();
+            printf("%5.1fs sent %8.1f Mbit/s", elapsed, bytes_sent * 8 / elapsed / 1e6);
+            if (server) {
+                MediaServerStats stats = server->GetStats();
+                printf("  server: %u conns, %llu handled, %llu dropped", stats.connections,
+                       (unsigned long long)stats.frames_handled,
+                       (unsigned long long)stats.frames_dropped);
+            }
+            printf("\n");
+        }
+    }
+    streams.clear();
+    if (server) {
+        // Give the workers a moment to drain before stopping.
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+    const double wall = std::chrono::duration<double>(Clock::now() - start).count();
+    const double cpu = ProcessCpuSeconds() - cpu_start;
+    const double mbps = bytes_sent * 8 / wall / 1e6;
+    printf("sent %llu frames, %.1f Mbit/s in %.1fs, %llu frames late, cpu %.2fs (%.0f%% of a "
+           "core)\n",
+           (unsigned long long)frames_sent, mbps, wall, (unsigned long long)late, cpu,
+           cpu / wall * 100);
+    if (cpu > 0) {
+        printf("capacity estimate: %.0f Mbit/s per core, %.0f streams of %u kbit/s\n",
+               mbps * wall / cpu, mbps * wall / cpu * 1000 / kbps, kbps);
+    }
+    if (server) {
+        MediaServerStats stats = server->GetStats();
+        server->Stop();
+        printf("server received %llu frames (%llu bytes), handled %llu, dropped %llu\n",
+               (unsigned long long)stats.frames_received,
+               (unsigned long long)stats.bytes_received,
+               (unsigned long long)stats.frames_handled,
+               (unsigned long long)stats.frames_dropped);
+    }
+    return 0;
+}
\ No newline at end of file
@@ -21,6 +21,10 @@ MainWindow::MainWindow() {
     screen_capture_handler_.reset(new ScreenCaptureHandler());
     screen_capture_handler_->SetObserver(this);
     screen_capture_engine_->RegisterCaptureHandler(screen_capture_handler_);
+    FrameDropConfig drop_config;
+    drop_config.policy = kFrameDropAdaptive;
+    drop_config.max_fps = 30;
+    encode_mailbox_.SetConfig(drop_config);
     video_encoder_ = VideoEnocderFcatory::Instance().CreateEncoder(kEncodeTypeQSV);
 	encode_fout_.open("../../../encode.h264", std::ios::binary | std::ios::out);
 	video_encoder_->SetOutputSize(1280, 720);
@@ -34,12 +38,12 @@ MainWindow::MainWindow() {
 
 MainWindow::~MainWindow() {
     running_ = false;
-    cv_.notify_all();
+    render_mailbox_.Close();
     if (render_thread_.joinable()) {
         render_thread_.join();
     }
     encode_running_ = false;
-    encode_cv_.notify_all();
+    encode_mailbox_.Close();
     if (encode_work_thread_.joinable()) {
         encode_work_thread_.join();
     }
@@ -195,11 +199,7 @@ bool MainWindow::CloseVideo() {
 }
 
 void MainWindow::OnVideoFrame(std::shared_ptr<VideoFrame> video_frame) {
-    {
-        std::unique_lock<std::mutex> lock(mtx_);
-        frame_queue_.push(video_frame);
-        cv_.notify_all();
-    }
+    render_mailbox_.Push(video_frame);
     if (video_render_) {
         return;
     }
@@ -218,16 +218,8 @@ void MainWindow::OnVideoFrame(std::shared_ptr<VideoFrame> video_frame) {
     render_thread_ = std::thread([&]() {
         while (running_) {
             std::shared_ptr<VideoFrame> frame;
-            {
-                std::unique_lock<std::mutex> lock(mtx_);
-                if (frame_queue_.empty()) {
-                    cv_.wait(lock);
-                }
-                if (!running_) {
-                    return;
-                }
-                frame = frame_queue_.front();
-                frame_queue_.pop();
+            if (!render_mailbox_.Pop(frame, 100)) {
+                continue;
             }
             uint32_t width = frame->GetWidth();
             uint32_t height = frame->GetHeight();
@@ -335,11 +327,7 @@ void MainWindow::OnScreenFrame(std::shared_ptr<VideoFrame> video_frame) {
     if (video_frame->GetFrameType() != kFrameTypeARGB) {
         return;
     }
-    {
-        std::unique_lock<std::mutex> lock(encode_mtx_);
-        screen_frame_queue_.push(video_frame);
-        encode_cv_.notify_all();
-    }
+    encode_mailbox_.Push(video_frame);
     if (encode_running_) {
         return;
     }
@@ -350,18 +338,9 @@ void MainWindow::OnScreenFrame(std::shared_ptr<VideoFrame> video_frame) {
     encode_work_thread_ = std::thread([&]() {
         while (encode_running_) {
             std::shared_ptr<VideoFrame> frame;
-            {
-                std::unique_lock<std::mutex> lock(encode_mtx_);
-                if (screen_frame_queue_.empty()) {
-                    encode_cv_.wait(lock);
-                }
-                if (!encode_running_) {
-                    return;
-                }
-                frame = screen_frame_queue_.front();
-                screen_frame_queue_.pop();
+            if (!encode_mailbox_.Pop(frame, 100)) {
+                continue;
             }
-            
             video_encoder_->EncodeFrame(frame, false);
         }
     });
@@ -11,6 +11,7 @@
 #include "audio_common.h"
 #include "audio_device_window.h"
 #include "audio_engine.h"
+#include "frame_mailbox.h"
 #include "screen_capture_engine.h"
 #include "screen_common.h"
 #include "screen_handler.h"
@@ -68,11 +69,10 @@ private:
     std::vector<VideoDeviceInfo> video_devices_{};
     std::string video_device_id_{};
 
-    std::mutex mtx_;
-    std::queue<std::shared_ptr<VideoFrame>> frame_queue_{};
+    // The preview only ever shows the newest frame.
+    FrameMailbox render_mailbox_{};
     std::thread render_thread_{};
     bool running_{};
-    std::condition_variable cv_{};
     std::shared_ptr<VideoRender> video_render_{};
 
     std::shared_ptr<VideoDeviceWindow> video_device_window_{};
@@ -93,9 +93,8 @@ private:
 
     std::thread encode_work_thread_{};
     bool encode_running_{};
-    std::condition_variable encode_cv_{};
-    std::mutex encode_mtx_;
-    std::queue<std::shared_ptr<VideoFrame>> screen_frame_queue_{};
+    // Screen frames wait here for the encoder, which sheds frame rate when it falls behind.
+    FrameMailbox encode_mailbox_{};
 	std::shared_ptr<SocketClientWindow> socket_client_window_{};
 	HWND socket_client_hwnd_{};
 };
@@ -7,15 +7,17 @@
 #include <string>
 #include <cstdint>
 
+#include "framed_socket.h"
+
 class SocketClient {
 public:
 	SocketClient();
 	~SocketClient();
 
 	bool ConnectServer(const std::string& ip, uint16_t port);
-	bool SendSocketMessage(uint8_t* data, uint32_t size);
+	bool SendSocketMessage(const uint8_t* data, uint32_t size);
 	bool DisconnectServer();
 
 private:
-	SOCKET socket_client_{ INVALID_SOCKET };
+	FramedSocket socket_client_{};
 };
\ No newline at end of file
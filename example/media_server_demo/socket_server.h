@@ -3,10 +3,14 @@
 #include <windows.h>
 #include <winsock2.h>
 #include <ws2tcpip.h>
-#include <thread>
+#include <atomic>
+#include <map>
+#include <mutex>
 #include <fstream>
 #include "video_render.h"
 #include "video_decoder.h"
+#include "media_server.h"
+#include "rtp_receiver.h"
 class SocketServer {
 public:
     SocketServer();
@@ -17,13 +21,19 @@ public:
 	void SetWindow(HWND hwnd);
 
 private:
-    std::thread work_thread_{};
-    bool running_ = false;
+    void OnConnection(uint32_t connection_id, bool connected);
+    void RenderFrame(const std::shared_ptr<VideoFrame>& video_frame);
+
+private:
 	std::shared_ptr<VideoRender> video_render_{};
-	std::shared_ptr<VideoDecoder> video_decoder_{};
-    WSADATA wsa_data_;
-    SOCKET listen_socket_{INVALID_SOCKET};
-    SOCKET client_socket_{INVALID_SOCKET};
+    MediaServer media_server_{};
+    // Every sender gets its own decoder; only the earliest connected one is rendered.
+    std::mutex decoders_mtx_{};
+    std::map<uint32_t, std::shared_ptr<VideoDecoder>> decoders_{};
+    std::atomic<uint32_t> render_connection_{0};
+    // The same port also takes an RTP/UDP stream, rendered while no TCP sender is connected.
+    RtpReceiver rtp_receiver_{};
+    std::shared_ptr<VideoDecoder> rtp_decoder_{};
 	HWND render_window_{};
 
 	uint8_t* y_data_{};
@@ -0,0 +1,461 @@
+﻿// Records a synthetic H.264 + AAC stream to FLV and fragmented MP4 through MediaMuxer and
+// checks the files: FLV tag chaining, sequence headers and timestamps; fMP4 box structure,
+// trun offsets against the mdat, fragment lengths and decode time continuity. The fMP4 file
+// is also read back while the recording is still open, as it would be after a crash, and
+// must parse up to its last fragment. Prints the time the producer spent inside the
+// muxer calls, which stays flat however slow the disk is.
+//
+//   muxer_bench [seconds] [output directory]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "muxer/media_muxer_factory.h"
+
+namespace {
+
+const int kWidth = 1280;
+const int kHeight = 720;
+const int kFps = 30;
+const int kGopFrames = 60;
+const int kSampleRate = 48000;
+const uint32_t kFragmentMs = 1000;
+
+class BitWriter {
+public:
+    void Put(uint32_t value, int bits) {
+        for (int i = bits - 1; i >= 0; --i) {
+            current_ = (uint8_t)((current_ << 1) | ((value >> i) & 1));
+            if (++count_ == 8) {
+                bytes_.push_back(current_);
+                current_ = 0;
+                count_ = 0;
+            }
+        }
+    }
+    void PutUe(uint32_t value) {
+        const uint32_t v = value + 1;
+        int bits = 0;
+        while ((v >> bits) > 1) {
+            ++bits;
+        }
+        Put(0, bits);
+        Put(v, bits + 1);
+    }
+    // rbsp_trailing_bits, then emulation prevention.
+    std::vector<uint8_t> Finish() {
+        Put(1, 1);
+        while (count_ != 0) {
+            Put(0, 1);
+        }
+        std::vector<uint8_t> out;
+        int zeros = 0;
+        for (uint8_t b : bytes_) {
+            if (zeros == 2 && b <= 3) {
+                out.push_back(3);
+                zeros = 0;
+            }
+            out.push_back(b);
+            zeros = b == 0 ? zeros + 1 : 0;
+        }
+        return out;
+    }
+
+private:
+    std::vector<uint8_t> bytes_;
+    uint8_t current_ = 0;
+    int count_ = 0;
+};
+
+// Baseline SPS for kWidth x kHeight (ITU-T H.264 7.3.2.1.1), PPS and slices with random
+// payload that holds no zero bytes, so it cannot contain a start code.
+struct StreamMaker {
+    std::vector<uint8_t> sps;
+    std::vector<uint8_t> pps;
+    std::mt19937 random{11};
+
+    StreamMaker() {
+        BitWriter w;
+        w.Put(0x67, 8);
+        w.Put(66, 8); // profile_idc
+        w.Put(0xC0, 8);
+        w.Put(31, 8); // level_idc
+        w.PutUe(0);   // seq_parameter_set_id
+        w.PutUe(0);   // log2_max_frame_num_minus4
+        w.PutUe(2);   // pic_order_cnt_type
+        w.PutUe(1);   // max_num_ref_frames
+        w.Put(0, 1);
+        w.PutUe(kWidth / 16 - 1);
+        w.PutUe(kHeight / 16 - 1);
+        w.Put(1, 1); // frame_mbs_only_flag
+        w.Put(1, 1); // direct_8x8_inference_flag
+        w.Put(0, 1); // frame_cropping_flag
+        w.Put(0, 1); // vui_parameters_present_flag
+        sps = w.Finish();
+        BitWriter p;
+        p.Put(0x68, 8);
+        p.PutUe(0);
+        p.PutUe(0);
+        p.Put(0, 2);
+        p.PutUe(0);
+        p.PutUe(0);
+        p.Put(0, 3);
+        p.PutUe(0);
+        p.PutUe(0);
+        p.PutUe(0);
+        p.Put(0, 3);
+        pps = p.Finish();
+    }
+
+    void AppendNal(std::vector<uint8_t>& out, const std::vector<uint8_t>& nal) {
+        const uint8_t start_code[] = {0, 0, 0, 1};
+        out.insert(out.end(), start_code, start_code + 4);
+        out.insert(out.end(), nal.begin(), nal.end());
+    }
+
+    std::vector<uint8_t> Frame(bool keyframe, size_t size) {
+        std::vector<uint8_t> out;
+        if (keyframe) {
+            AppendNal(out, sps);
+            AppendNal(out, pps);
+        }
+        std::vector<uint8_t> slice(size);
+        slice[0] = keyframe ? 0x65 : 0x41;
+        for (size_t i = 1; i < size; ++i) {
+            slice[i] = (uint8_t)(1 + random() % 255);
+        }
+        AppendNal(out, slice);
+        return out;
+    }
+
+    std::vector<uint8_t> AacFrame(size_t raw_size) {
+        // ADTS header, protection_absent = 1
+        const size_t len = raw_size + 7;
+        std::vector<uint8_t> out = {0xFF, 0xF1, 0x4C, 0x80, 0, 0, 0xFC};
+        out[3] |= (uint8_t)((len >> 11) & 0x03);
+        out[4] = (uint8_t)((len >> 3) & 0xFF);
+        out[5] = (uint8_t)(((len & 0x07) << 5) | 0x1F);
+        for (size_t i = 0; i < raw_size; ++i) {
+            out.push_back((uint8_t)random());
+        }
+        return out;
+    }
+};
+
+std::vector<uint8_t> ReadFile(const std::string& name) {
+    std::ifstream in(name, std::ios::binary);
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(in)),
+                                std::istreambuf_iterator<char>());
+}
+
+uint32_t Be24(const uint8_t* p) {
+    return ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+}
+
+uint32_t Be32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+uint64_t Be64(const uint8_t* p) {
+    return ((uint64_t)Be32(p) << 32) | Be32(p + 4);
+}
+
+struct Expected {
+    uint64_t video_frames;
+    uint64_t audio_frames;
+};
+
+bool CheckFlv(const std::string& name, const Expected& expected) {
+    const std::vector<uint8_t> file = ReadFile(name);
+    if (file.size() < 13 || memcmp(file.data(), "FLV", 3) != 0 || file[4] != 0x05) {
+        printf("  flv: bad file header\n");
+        return false;
+    }
+    size_t pos = 13;
+    uint64_t video = 0;
+    uint64_t audio = 0;
+    int video_headers = 0;
+    int audio_headers = 0;
+    bool metadata = false;
+    bool first_video_key = false;
+    uint32_t last_ts[2] = {0, 0};
+    bool ok = true;
+    while (pos + 11 <= file.size()) {
+        const uint8_t type = file[pos];
+        const uint32_t size = Be24(&file[pos + 1]);
+        const uint32_t ts = Be24(&file[pos + 4]) | ((uint32_t)file[pos + 7] << 24);
+        if (pos + 11 + size + 4 > file.size()) {
+            printf("  flv: truncated tag at %zu\n", pos);
+            return false;
+        }
+        const uint8_t* body = &file[pos + 11];
+        if (Be32(body + size) != size + 11) {
+            printf("  flv: PreviousTagSize mismatch at %zu\n", pos);
+            return false;
+        }
+        if (type == 0x12) {
+            metadata = true;
+        } else if (type == 0x09) {
+            if (body[1] == 0) {
+                ++video_headers;
+            } else {
+                first_video_key = first_video_key || (video == 0 && body[0] == 0x17);
+                ++video;
+                ok = ok && ts >= last_ts[0];
+                last_ts[0] = ts;
+            }
+        } else if (type == 0x08) {
+            if (body[1] == 0) {
+                ++audio_headers;
+            } else {
+                ++audio;
+                ok = ok && ts >= last_ts[1];
+                last_ts[1] = ts;
+            }
+        }
+        pos += 11 + size + 4;
+    }
+    printf("  flv: %zu bytes, %llu video + %llu audio tags, %d/%d sequence headers\n",
+           file.size(), (unsigned long long)video, (unsigned long long)audio, video_headers,
+           audio_headers);
+    ok = ok && pos == file.size() && metadata && first_video_key && video_headers == 1 &&
+         audio_headers == 1 && video == expected.video_frames && audio == expected.audio_frames;
+    return ok;
+}
+
+struct Fmp4Result {
+    bool ok;
+    int fragments;
+    uint64_t video_samples;
+    uint64_t audio_samples;
+    double longest_fragment_s;
+};
+
+// Walks the boxes of a fragmented MP4 file. With allow_partial the file may end anywhere,
+// e.g. when it is still being written, and only the complete fragments are checked.
+Fmp4Result CheckFmp4(const std::string& name, bool allow_partial) {
+    Fmp4Result result = {};
+    const std::vector<uint8_t> file = ReadFile(name);
+    size_t pos = 0;
+    bool have_ftyp = false;
+    bool have_moov = false;
+    uint64_t next_time[3] = {0, 0, 0}; // per track id
+    bool have_time[3] = {false, false, false};
+    result.ok = true;
+    while (pos + 8 <= file.size()) {
+        const uint32_t size = Be32(&file[pos]);
+        if (size < 8 || pos + size > file.size()) {
+            break;
+        }
+        const char* type = (const char*)&file[pos + 4];
+        if (memcmp(type, "ftyp", 4) == 0) {
+            have_ftyp = pos == 0;
+        } else if (memcmp(type, "moov", 4) == 0) {
+            have_moov = have_ftyp;
+        } else if (memcmp(type, "moof", 4) == 0) {
+            const size_t moof = pos;
+            const size_t mdat = pos + size;
+            if (mdat + 8 > file.size() || Be32(&file[mdat]) + mdat > file.size() ||
+                memcmp(&file[mdat + 4], "mdat", 4) != 0) {
+                break; // fragment not complete yet
+            }
+            const size_t mdat_end = mdat + Be32(&file[mdat]);
+            size_t data_end = mdat + 8;
+            // traf boxes
+            size_t p = moof + 8;
+            while (p + 8 <= mdat) {
+                const uint32_t box = Be32(&file[p]);
+                if (memcmp(&file[p + 4], "traf", 4) == 0) {
+                    uint32_t track = 0;
+                    uint64_t tfdt = 0;
+                    size_t q = p + 8;
+                    while (q + 8 <= p + box) {
+                        const uint32_t inner = Be32(&file[q]);
+                        const uint8_t* b = &file[q + 8];
+                        if (memcmp(&file[q + 4], "tfhd", 4) == 0) {
+                            track = Be32(b + 4);
+                        } else if (memcmp(&file[q + 4], "tfdt", 4) == 0) {
+                            tfdt = b[0] == 1 ? Be64(b + 4) : Be32(b + 4);
+                        } else if (memcmp(&file[q + 4], "trun", 4) == 0) {
+                            const uint32_t flags = Be32(b) & 0xFFFFFF;
+                            const uint32_t count = Be32(b + 4);
+                            const size_t offset = moof + Be32(b + 8);
+                            const size_t stride = (flags & 0x400) ? 12 : 8;
+                            uint64_t duration = 0;
+                            size_t bytes = 0;
+                            for (uint32_t i = 0; i < count; ++i) {
+                                const uint8_t* s = b + 12 + i * stride;
+                                duration += Be32(s);
+                                bytes += Be32(s + 4);
+                                if (i == 0 && track == 1 && (Be32(s + 8) & 0x01000000)) {
+                                    result.ok = false; // video fragment starts on a non-sync
+                                }
+                            }
+                            if (track < 1 || track > 2 || offset != data_end ||
+                                offset + bytes > mdat_end) {
+                                result.ok = false;
+                            }
+                            if (have_time[track] && tfdt != next_time[track]) {
+                                printf("  fmp4: track %u tfdt %llu, expected %llu\n", track,
+                                       (unsigned long long)tfdt,
+                                       (unsigned long long)next_time[track]);
+                                result.ok = false;
+                            }
+                            have_time[track] = true;
+                            next_time[track] = tfdt + duration;
+                            data_end = offset + bytes;
+                            if (track == 1) {
+                                result.video_samples += count;
+                                const double seconds = duration / 90000.0;
+                                result.longest_fragment_s =
+                                    std::max(result.longest_fragment_s, seconds);
+                            } else {
+                                result.audio_samples += count;
+                            }
+                        }
+                        q += inner;
+                    }
+                }
+                p += box;
+            }
+            if (data_end != mdat_end) {
+                result.ok = false;
+            }
+            ++result.fragments;
+            pos = mdat_end;
+            continue;
+        }
+        pos += size;
+    }
+    result.ok = result.ok && have_ftyp && have_moov && (allow_partial || pos == file.size());
+    return result;
+}
+
+struct RecordResult {
+    Expected expected;
+    double max_call_us;
+    double total_call_s;
+    MediaMuxerStats stats;
+    Fmp4Result live; // the fMP4 file read while still open
+};
+
+RecordResult Record(MuxerType type, const std::string& name, int seconds) {
+    RecordResult result = {};
+    std::shared_ptr<MediaMuxer> muxer = MediaMuxerFactory::Instance().CreateMuxer(type);
+    MuxerConfig config;
+    config.sample_rate = kSampleRate;
+    config.channels = 2;
+    config.fragment_ms = kFragmentMs;
+    if (!muxer || !muxer->Open(name, config)) {
+        printf("  cannot open %s\n", name.c_str());
+        return result;
+    }
+    StreamMaker maker;
+    const uint64_t start_us = 5000000; // capture clock, not 0
+    const uint64_t audio_us = 1024 * 1000000ull / kSampleRate;
+    uint64_t video_index = 0;
+    uint64_t audio_index = 0;
+    std::mt19937 jitter(5);
+    auto timed = [&result](const std::function<bool()>& call) {
+        const auto begin = std::chrono::steady_clock::now();
+        const bool ok = call();
+        const double us = std::chrono::duration<double, std::micro>(
+                              std::chrono::steady_clock::now() - begin)
+                              .count();
+        result.max_call_us = std::max(result.max_call_us, us);
+        result.total_call_s += us / 1e6;
+        return ok;
+    };
+    // Audio starts a little before the first keyframe, as it does live; those frames and
+    // the frames before the first keyframe are not recorded.
+    uint64_t audio_time = start_us - 100000;
+    uint64_t video_time = start_us;
+    const uint64_t end_us = start_us + (uint64_t)seconds * 1000000;
+    while (video_time < end_us || audio_time < end_us) {
+        if (video_time <= audio_time && video_time < end_us) {
+            const bool key = video_index % kGopFrames == 0;
+            const std::vector<uint8_t> frame = maker.Frame(key, key ? 60000 : 6000);
+            if (timed([&]() {
+                    return muxer->WriteVideo(frame.data(), frame.size(), video_time, key);
+                })) {
+                ++result.expected.video_frames;
+            }
+            ++video_index;
+            video_time = start_us + video_index * 1000000 / kFps;
+        } else {
+            const std::vector<uint8_t> frame = maker.AacFrame(300 + jitter() % 100);
+            const uint64_t pts = audio_time + jitter() % 1000; // capture jitter
+            if (timed([&]() { return muxer->WriteAudio(frame.data(), frame.size(), pts); })) {
+                ++result.expected.audio_frames;
+            }
+            ++audio_index;
+            audio_time = start_us - 100000 + audio_index * audio_us;
+        }
+    }
+    if (type == kMuxerTypeFmp4) {
+        // Give the write-behind thread its flush interval, then read the open file.
+        std::this_thread::sleep_for(std::chrono::milliseconds(700));
+        result.live = CheckFmp4(name, true);
+    }
+    muxer->Close();
+    result.stats = muxer->GetStats();
+    return result;
+}
+
+void PrintRecord(const RecordResult& r) {
+    printf("  %llu video + %llu audio frames recorded, %llu skipped; %llu bytes written, "
+           "%llu dropped\n",
+           (unsigned long long)r.stats.video_frames, (unsigned long long)r.stats.audio_frames,
+           (unsigned long long)r.stats.frames_skipped,
+           (unsigned long long)r.stats.file.bytes_written,
+           (unsigned long long)r.stats.file.bytes_dropped);
+    printf("  producer time in muxer calls: %.1f ms total, %.1f us worst call\n",
+           r.total_call_s * 1000, r.max_call_us);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int seconds = argc > 1 && atoi(argv[1]) > 0 ? atoi(argv[1]) : 60;
+    const std::string dir = argc > 2 ? std::string(argv[2]) + "/" : std::string();
+    bool ok = true;
+
+    printf("FLV, %d s of %dx%d H.264 at %d fps with 48 kHz AAC\n", seconds, kWidth, kHeight,
+           kFps);
+    const std::string flv = dir + "muxer_bench.flv";
+    const RecordResult f = Record(kMuxerTypeFlv, flv, seconds);
+    PrintRecord(f);
+    bool flv_ok = CheckFlv(flv, f.expected) && f.stats.file.bytes_dropped == 0;
+    printf("  %s\n", flv_ok ? "ok" : "FAILED");
+    ok = ok && flv_ok;
+
+    printf("fragmented MP4, %u ms fragments\n", kFragmentMs);
+    const std::string mp4 = dir + "muxer_bench.mp4";
+    const RecordResult m = Record(kMuxerTypeFmp4, mp4, seconds);
+    PrintRecord(m);
+    const Fmp4Result closed = CheckFmp4(mp4, false);
+    printf("  while open: %d fragments readable; closed: %d fragments, %llu video + %llu audio "
+           "samples, longest %.2f s\n",
+           m.live.fragments, closed.fragments, (unsigned long long)closed.video_samples,
+           (unsigned long long)closed.audio_samples, closed.longest_fragment_s);
+    // Only the fragment still being gathered is missing from the open file.
+    bool mp4_ok = closed.ok && m.live.ok && m.live.fragments == closed.fragments - 1 &&
+                  closed.video_samples == m.expected.video_frames &&
+                  closed.audio_samples == m.expected.audio_frames &&
+                  closed.longest_fragment_s < 2.0 * kGopFrames / kFps &&
+                  m.stats.file.bytes_dropped == 0;
+    printf("  %s\n", mp4_ok ? "ok" : "FAILED");
+    ok = ok && mp4_ok;
+
+    printf("%s\n", ok ? "all checks passed" : "CHECKS FAILED");
+    return ok ? 0 : 2;
+}
\ No newline at end of file
@@ -0,0 +1,281 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+#include <rtmp/EasyRTMPAPI.h>
+#include <rtmp/rtmp_ingest_server.h>
+
+// usage: rtmp_ingest_server_demo [port] [streams] [seconds] [video_kbps] [record_dir] [fanout]
+//   streams == 0: serve until enter is pressed (push with any RTMP publisher)
+//   streams  > 0: publish N synthetic H.264/AAC streams over loopback and print
+//                 throughput, per-packet latency and process CPU usage
+//   fanout   = 1: push one synthetic stream to the N sessions through EasyRTMP_Fanout*
+
+namespace {
+
+// 1280x720 baseline SPS/PPS
+const uint8_t kSps[] = {0x67, 0x42, 0xC0, 0x1F, 0xDA, 0x01, 0x40, 0x16, 0xE4};
+const uint8_t kPps[] = {0x68, 0xCE, 0x3C, 0x80};
+
+const uint32_t kVideoFps = 25;
+const uint32_t kAudioSampleRate = 44100;
+const uint32_t kAudioFrameBytes = 186; // ~64kbps AAC-LC
+
+uint64_t SteadyUs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+uint64_t ProcessCpuUs() {
+#ifdef _WIN32
+    FILETIME create_time, exit_time, kernel_time, user_time;
+    GetProcessTimes(GetCurrentProcess(), &create_time, &exit_time, &kernel_time, &user_time);
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel_time.dwLowDateTime;
+    k.HighPart = kernel_time.dwHighDateTime;
+    u.LowPart = user_time.dwLowDateTime;
+    u.HighPart = user_time.dwHighDateTime;
+    return (k.QuadPart + u.QuadPart) / 10;
+#else
+    return (uint64_t)std::clock() * 1000000ULL / CLOCKS_PER_SEC;
+#endif
+}
+
+void FillTimestamp(EASY_AV_Frame* frame, uint64_t pts_us) {
+    frame->u32PTS = (Easy_U32)(pts_us / 1000ULL);
+    frame->u32TimestampSec = (Easy_U32)(pts_us / 1000000ULL);
+    frame->u32TimestampUsec = (Easy_U32)(pts_us % 1000000ULL);
+}
+
+void FillMediaInfo(EASY_MEDIA_INFO_T* mi) {
+    memset(mi, 0, sizeof(*mi));
+    mi->u32VideoCodec = EASY_SDK_VIDEO_CODEC_H264;
+    mi->u32VideoFps = kVideoFps;
+    mi->u32AudioCodec = EASY_SDK_AUDIO_CODEC_AAC;
+    mi->u32AudioSamplerate = kAudioSampleRate;
+    mi->u32AudioChannel = 2;
+    mi->u32AudioBitsPerSample = 16;
+    mi->u32SpsLength = sizeof(kSps);
+    mi->u32PpsLength = sizeof(kPps);
+    memcpy(mi->u8Sps, kSps, sizeof(kSps));
+    memcpy(mi->u8Pps, kPps, sizeof(kPps));
+}
+
+// Generates paced synthetic frames for `seconds` and hands each one to send().
+template <typename SendFunc>
+void GenerateFrames(uint64_t start_us, uint32_t seconds, uint32_t video_kbps,
+                    std::atomic<uint64_t>* sent_bytes, SendFunc send) {
+    // Synthetic access units: 4-byte start code + NAL header + filler without start codes.
+    uint32_t p_size = video_kbps * 1000 / 8 / kVideoFps;
+    std::vector<uint8_t> idr(p_size * 4 + 5, 0xAA);
+    std::vector<uint8_t> inter(p_size + 5, 0xAA);
+    const uint8_t start_code[4] = {0x00, 0x00, 0x00, 0x01};
+    memcpy(idr.data(), start_code, 4);
+    idr[4] = 0x65;
+    memcpy(inter.data(), start_code, 4);
+    inter[4] = 0x41;
+    std::vector<uint8_t> aac(kAudioFrameBytes, 0x21);
+
+    const uint64_t video_interval_us = 1000000ULL / kVideoFps;
+    const uint64_t audio_interval_us = 1024ULL * 1000000ULL / kAudioSampleRate;
+    uint64_t next_video_us = 0;
+    uint64_t next_audio_us = 0;
+    uint64_t video_index = 0;
+    const uint64_t end_us = (uint64_t)seconds * 1000000ULL;
+    while (true) {
+        uint64_t next_us = (std::min)(next_video_us, next_audio_us);
+        if (next_us >= end_us) {
+            break;
+        }
+        uint64_t now_us = SteadyUs() - start_us;
+        if (now_us < next_us) {
+            std::this_thread::sleep_for(std::chrono::microseconds(next_us - now_us));
+            now_us = SteadyUs() - start_us;
+        }
+        EASY_AV_Frame frame;
+        memset(&frame, 0, sizeof(frame));
+        // Stamp with send time so the server side can derive per-packet latency.
+        FillTimestamp(&frame, now_us);
+        if (next_video_us <= next_audio_us) {
+            bool key = (video_index % (kVideoFps * 2)) == 0;
+            std::vector<uint8_t>& au = key ? idr : inter;
+            frame.u32AVFrameFlag = EASY_SDK_VIDEO_FRAME_FLAG;
+            frame.u32AVFrameType = key ? EASY_SDK_VIDEO_FRAME_I : EASY_SDK_VIDEO_FRAME_P;
+            frame.pBuffer = au.data();
+            frame.u32AVFrameLen = (Easy_U32)au.size();
+            next_video_us += video_interval_us;
+            ++video_index;
+        } else {
+            frame.u32AVFrameFlag = EASY_SDK_AUDIO_FRAME_FLAG;
+            frame.u32AVFrameType = EASY_SDK_AUDIO_CODEC_AAC;
+            frame.pBuffer = aac.data();
+            frame.u32AVFrameLen = (Easy_U32)aac.size();
+            next_audio_us += audio_interval_us;
+        }
+        if (!send(&frame)) {
+            break;
+        }
+        *sent_bytes += frame.u32AVFrameLen;
+    }
+}
+
+void PublishStream(const std::string& url, uint64_t start_us, uint32_t seconds,
+                   uint32_t video_kbps, std::atomic<uint64_t>* sent_bytes) {
+    Easy_Handle h = EasyRTMP_Create();
+    if (!EasyRTMP_Connect(h, url.c_str())) {
+        std::cout << "connect failed: " << url << std::endl;
+        EasyRTMP_Release(h);
+        return;
+    }
+    EASY_MEDIA_INFO_T mi;
+    FillMediaInfo(&mi);
+    EasyRTMP_InitMetadata(h, &mi, 1024);
+    GenerateFrames(start_us, seconds, video_kbps, sent_bytes, [&](EASY_AV_Frame* frame) {
+        if (EasyRTMP_SendPacket(h, frame) == 0) {
+            std::cout << "send failed: " << url << std::endl;
+            return false;
+        }
+        return true;
+    });
+    EasyRTMP_Release(h);
+}
+
+// One encoder feeding all sessions: each frame is converted once and queued per session.
+void PublishFanout(const std::vector<std::string>& urls, uint64_t start_us, uint32_t seconds,
+                   uint32_t video_kbps, std::atomic<uint64_t>* sent_bytes) {
+    Easy_Handle fanout = EasyRTMP_FanoutCreate(0);
+    EASY_MEDIA_INFO_T mi;
+    FillMediaInfo(&mi);
+    EasyRTMP_FanoutInitMetadata(fanout, &mi);
+    std::vector<Easy_Handle> sessions;
+    for (auto& url : urls) {
+        Easy_Handle h = EasyRTMP_Create();
+        if (!EasyRTMP_Connect(h, url.c_str())) {
+            std::cout << "connect failed: " << url << std::endl;
+            EasyRTMP_Release(h);
+            continue;
+        }
+        EasyRTMP_FanoutAddSession(fanout, h);
+        sessions.push_back(h);
+    }
+    GenerateFrames(start_us, seconds, video_kbps, sent_bytes, [&](EASY_AV_Frame* frame) {
+        return EasyRTMP_FanoutSendPacket(fanout, frame) != 0;
+    });
+    // let the I/O threads drain before detaching
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    for (auto h : sessions) {
+        Easy_U32 queued = 0, dropped = 0;
+        EasyRTMP_FanoutGetSessionInfo(fanout, h, &queued, &dropped);
+        std::cout << "fanout session queued: " << queued << " dropped: " << dropped << std::endl;
+        EasyRTMP_FanoutRemoveSession(fanout, h);
+        EasyRTMP_Release(h);
+    }
+    EasyRTMP_FanoutRelease(fanout);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    uint16_t port = argc > 1 ? (uint16_t)atoi(argv[1]) : 1935;
+    uint32_t streams = argc > 2 ? (uint32_t)atoi(argv[2]) : 0;
+    uint32_t seconds = argc > 3 ? (uint32_t)atoi(argv[3]) : 10;
+    uint32_t video_kbps = argc > 4 ? (uint32_t)atoi(argv[4]) : 2000;
+    std::string record_dir = argc > 5 ? argv[5] : "";
+    bool fanout = argc > 6 && atoi(argv[6]) != 0;
+
+    std::atomic<uint64_t> start_us{SteadyUs()};
+    std::atomic<uint64_t> latency_sum_us{0};
+    std::atomic<uint64_t> latency_max_us{0};
+    std::atomic<uint64_t> latency_count{0};
+
+    RtmpIngestServer server;
+    server.SetRecordDir(record_dir);
+    server.SetPacketCallback([&](uint32_t /*conn_id*/, uint8_t tag_type, uint32_t ts_ms,
+                                 const uint8_t* /*data*/, uint32_t /*len*/) {
+        if (tag_type != 8 && tag_type != 9) {
+            return;
+        }
+        uint64_t now_us = SteadyUs() - start_us.load();
+        uint64_t sent_us = (uint64_t)ts_ms * 1000ULL;
+        uint64_t latency = now_us > sent_us ? now_us - sent_us : 0;
+        latency_sum_us += latency;
+        ++latency_count;
+        uint64_t prev = latency_max_us.load();
+        while (latency > prev && !latency_max_us.compare_exchange_weak(prev, latency)) {
+        }
+    });
+    if (!server.Start(port)) {
+        std::cout << "start server failed, port: " << port << std::endl;
+        return -1;
+    }
+    std::cout << "rtmp ingest server listening on " << server.GetPort() << std::endl;
+
+    if (streams == 0) {
+        getchar();
+        server.Stop();
+        return 0;
+    }
+
+    std::atomic<uint64_t> sent_bytes{0};
+    uint64_t cpu_begin_us = ProcessCpuUs();
+    start_us = SteadyUs();
+    std::vector<std::string> urls;
+    for (uint32_t i = 0; i < streams; ++i) {
+        urls.push_back("rtmp://127.0.0.1:" + std::to_string(server.GetPort()) + "/live/stream" +
+                       std::to_string(i));
+    }
+    std::vector<std::thread> publishers;
+    if (fanout) {
+        publishers.emplace_back(PublishFanout, urls, start_us.load(), seconds, video_kbps,
+                                &sent_bytes);
+    } else {
+        for (auto& url : urls) {
+            publishers.emplace_back(PublishStream, url, start_us.load(), seconds, video_kbps,
+                                    &sent_bytes);
+        }
+    }
+    for (auto& t : publishers) {
+        t.join();
+    }
+    double wall_s = (double)(SteadyUs() - start_us.load()) / 1000000.0;
+    uint64_t cpu_us = ProcessCpuUs() - cpu_begin_us;
+    // give the server a moment to drain the sockets
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    server.Stop();
+
+    uint64_t recv_bytes = 0;
+    uint64_t recv_tags = 0;
+    for (auto& stats : server.GetStreamStats()) {
+        recv_bytes += stats.video_bytes + stats.audio_bytes;
+        recv_tags += stats.video_tags + stats.audio_tags;
+        std::cout << "[" << stats.conn_id << "] " << stats.app << "/" << stats.stream_name
+                  << " video: " << stats.video_tags << " audio: " << stats.audio_tags
+                  << " bytes: " << stats.video_bytes + stats.audio_bytes
+                  << " ts: " << stats.first_ts_ms << "-" << stats.last_ts_ms << std::endl;
+    }
+    uint64_t count = latency_count.load();
+    std::cout << "streams: " << streams << ", seconds: " << wall_s << std::endl;
+    std::cout << "sent: " << sent_bytes.load() << " bytes, received: " << recv_bytes
+              << " bytes in " << recv_tags << " tags" << std::endl;
+    std::cout << "throughput: " << (double)recv_bytes * 8.0 / wall_s / 1000000.0 << " Mbps"
+              << std::endl;
+    std::cout << "latency avg: " << (count ? latency_sum_us.load() / count : 0)
+              << " us, max: " << latency_max_us.load() << " us (ms timestamp resolution)"
+              << std::endl;
+    std::cout << "cpu: " << (double)cpu_us / 1000.0 << " ms ("
+              << (double)cpu_us / 10000.0 / wall_s << "% of one core)" << std::endl;
+    return 0;
+}
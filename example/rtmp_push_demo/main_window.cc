@@ -9,9 +9,11 @@
 #include <functional>
 #include <algorithm>
 #include <cstring>
+#include <ctime>
 #include <iostream>
 #include <cwchar>
 
+#include "annexb_scanner.h"
 #include "my_window.h"
 #include "string_utils.h"
 #include "local_log.h"
@@ -23,89 +25,20 @@ static std::atomic<uint64_t> g_rtmp_send_count{0};
 constexpr UINT WM_APP_RTMP_SEND_FAILED = WM_APP + 100;
 }
 
-extern "C" {
-#include "libavcodec/avcodec.h"
-#include "libavutil/audio_fifo.h"
-#include "libavutil/channel_layout.h"
-#include "libavutil/opt.h"
-#include "libavutil/samplefmt.h"
-#include "libswresample/swresample.h"
-}
-
 #pragma comment(lib, "Shcore.lib")
 
 namespace {
 
-uint64_t NowUsSince(const std::chrono::steady_clock::time_point& start) {
-    auto now = std::chrono::steady_clock::now();
-    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(now - start).count();
-}
-
-struct AnnexBNal {
-    const uint8_t* data{nullptr};
-    size_t size{0};
-};
-
-std::vector<AnnexBNal> SplitAnnexB(const uint8_t* data, size_t len) {
-    std::vector<AnnexBNal> out;
-    if (!data || len < 4) {
-        return out;
-    }
-    auto is_start3 = [&](size_t i) {
-        return i + 3 <= len && data[i] == 0x00 && data[i + 1] == 0x00 && data[i + 2] == 0x01;
-    };
-    auto is_start4 = [&](size_t i) {
-        return i + 4 <= len && data[i] == 0x00 && data[i + 1] == 0x00 && data[i + 2] == 0x00 &&
-               data[i + 3] == 0x01;
-    };
-
-    size_t i = 0;
-    while (i + 3 < len) {
-        size_t sc = (size_t)-1;
-        size_t sc_len = 0;
-        for (size_t j = i; j + 3 < len; ++j) {
-            if (is_start4(j)) {
-                sc = j;
-                sc_len = 4;
-                break;
-            }
-            if (is_start3(j)) {
-                sc = j;
-                sc_len = 3;
-                break;
-            }
-        }
-        if (sc == (size_t)-1) {
-            break;
-        }
-        size_t nal_start = sc + sc_len;
-        size_t nal_end = len;
-        for (size_t j = nal_start; j + 3 < len; ++j) {
-            if (is_start4(j) || is_start3(j)) {
-                nal_end = j;
-                break;
-            }
-        }
-        if (nal_end > nal_start) {
-            out.push_back({data + nal_start, nal_end - nal_start});
-        }
-        i = nal_end;
-    }
-    return out;
-}
-
 bool ExtractH264SpsPps(const uint8_t* data,
                        size_t len,
                        std::vector<uint8_t>& sps,
                        std::vector<uint8_t>& pps,
                        bool& has_idr) {
     has_idr = false;
-    auto nals = SplitAnnexB(data, len);
     bool updated = false;
-    for (auto& nal : nals) {
-        if (nal.size < 1) {
-            continue;
-        }
+    AnnexBScanner scanner(data, len);
+    NalUnit nal;
+    while (scanner.Next(nal)) {
         uint8_t nal_type = nal.data[0] & 0x1F;
         if (nal_type == 5) {
             has_idr = true;
@@ -154,226 +87,8 @@ static T* Find(DuiLib::CPaintManagerUI& pm, const char* name) {
     return dynamic_cast<T*>(pm.FindControl(name));
 }
 
-struct AacEncoderFFmpeg {
-    using EncodedCallback =
-        std::function<void(const uint8_t* data, size_t len, uint32_t pts_ms, uint64_t pts_us)>;
-
-    ~AacEncoderFFmpeg() { Uninit(); }
-
-    bool Init(int sample_rate, int channels) {
-        if (inited_) {
-            return true;
-        }
-        avcodec_register_all();
-        codec_ = avcodec_find_encoder(AV_CODEC_ID_AAC);
-        if (!codec_) {
-            std::cout << "[aac] encoder not found" << std::endl;
-            return false;
-        }
-        ctx_ = avcodec_alloc_context3(codec_);
-        if (!ctx_) {
-            return false;
-        }
-        ctx_->sample_rate = sample_rate;
-        ctx_->channels = channels;
-        ctx_->channel_layout = channels == 1 ? AV_CH_LAYOUT_MONO : AV_CH_LAYOUT_STEREO;
-        ctx_->bit_rate = 64000;
-        ctx_->sample_fmt = AV_SAMPLE_FMT_FLTP;
-        if (codec_->sample_fmts) {
-            ctx_->sample_fmt = codec_->sample_fmts[0];
-            for (int i = 0; codec_->sample_fmts[i] != AV_SAMPLE_FMT_NONE; ++i) {
-                if (codec_->sample_fmts[i] == AV_SAMPLE_FMT_FLTP) {
-                    ctx_->sample_fmt = AV_SAMPLE_FMT_FLTP;
-                    break;
-                }
-                if (codec_->sample_fmts[i] == AV_SAMPLE_FMT_S16) {
-                    ctx_->sample_fmt = AV_SAMPLE_FMT_S16;
-                }
-            }
-        }
-
-        AVDictionary* opts = nullptr;
-        av_dict_set(&opts, "profile", "aac_low", 0);
-        int ret = avcodec_open2(ctx_, codec_, &opts);
-        av_dict_free(&opts);
-        if (ret < 0) {
-            std::cout << "[aac] avcodec_open2 failed: " << ret << std::endl;
-            return false;
-        }
-
-        frame_size_ = ctx_->frame_size > 0 ? ctx_->frame_size : 1024;
-        fifo_ = av_audio_fifo_alloc(ctx_->sample_fmt, ctx_->channels, frame_size_ * 4);
-        if (!fifo_) {
-            return false;
-        }
-        inited_ = true;
-        return true;
-    }
-
-    void RegisterCallback(EncodedCallback cb) { cb_ = std::move(cb); }
-
-    bool PushPcm(const AudioPcmFrame& pcm) {
-        if (!inited_) {
-            if (!Init(pcm.sample_rate, pcm.channels)) {
-                return false;
-            }
-        }
-        if (!ctx_ || !fifo_) {
-            return false;
-        }
-
-        AVSampleFormat in_fmt = AV_SAMPLE_FMT_NONE;
-        if (pcm.format == AudioSampleFormat::kS16) {
-            in_fmt = AV_SAMPLE_FMT_S16;
-        } else if (pcm.format == AudioSampleFormat::kF32) {
-            in_fmt = AV_SAMPLE_FMT_FLT;
-        }
-        if (in_fmt == AV_SAMPLE_FMT_NONE) {
-            return true;
-        }
-
-        if (!swr_ || in_fmt != swr_in_fmt_ || pcm.channels != swr_in_channels_ ||
-            pcm.sample_rate != swr_in_rate_) {
-            if (swr_) {
-                swr_free(&swr_);
-            }
-            swr_in_fmt_ = in_fmt;
-            swr_in_channels_ = pcm.channels;
-            swr_in_rate_ = pcm.sample_rate;
-            swr_ = swr_alloc_set_opts(
-                nullptr,
-                (int64_t)ctx_->channel_layout,
-                ctx_->sample_fmt,
-                ctx_->sample_rate,
-                (int64_t)(pcm.channels == 1 ? AV_CH_LAYOUT_MONO : AV_CH_LAYOUT_STEREO),
-                in_fmt,
-                pcm.sample_rate,
-                0,
-                nullptr);
-            if (!swr_ || swr_init(swr_) < 0) {
-                std::cout << "[aac] swr_init failed" << std::endl;
-                return false;
-            }
-        }
-
-        const uint8_t* in_data[1] = {pcm.data.data()};
-        int bytes_per_frame = (pcm.channels * pcm.bits_per_sample) / 8;
-        if (bytes_per_frame <= 0) {
-            return true;
-        }
-        int in_samples = (int)(pcm.data.size() / (size_t)bytes_per_frame);
-        if (in_samples <= 0) {
-            return true;
-        }
-
-        int max_out =
-            av_rescale_rnd(swr_get_delay(swr_, pcm.sample_rate) + in_samples, ctx_->sample_rate,
-                           pcm.sample_rate, AV_ROUND_UP);
-        uint8_t** converted = nullptr;
-        int ret = av_samples_alloc_array_and_samples(&converted, nullptr, ctx_->channels, max_out,
-                                                     ctx_->sample_fmt, 0);
-        if (ret < 0) {
-            return false;
-        }
-        int out_samples = swr_convert(swr_, converted, max_out, in_data, in_samples);
-        if (out_samples < 0) {
-            av_freep(&converted[0]);
-            av_freep(&converted);
-            return false;
-        }
-
-        if (av_audio_fifo_realloc(fifo_, av_audio_fifo_size(fifo_) + out_samples) < 0) {
-            av_freep(&converted[0]);
-            av_freep(&converted);
-            return false;
-        }
-        if (av_audio_fifo_write(fifo_, (void**)converted, out_samples) < out_samples) {
-            av_freep(&converted[0]);
-            av_freep(&converted);
-            return false;
-        }
-
-        av_freep(&converted[0]);
-        av_freep(&converted);
-
-        while (av_audio_fifo_size(fifo_) >= frame_size_) {
-            AVFrame* frame = av_frame_alloc();
-            if (!frame) {
-                return false;
-            }
-            frame->nb_samples = frame_size_;
-            frame->channel_layout = ctx_->channel_layout;
-            frame->format = ctx_->sample_fmt;
-            frame->sample_rate = ctx_->sample_rate;
-            if (av_frame_get_buffer(frame, 0) < 0) {
-                av_frame_free(&frame);
-                return false;
-            }
-            if (av_audio_fifo_read(fifo_, (void**)frame->data, frame_size_) < frame_size_) {
-                av_frame_free(&frame);
-                break;
-            }
-
-            AVPacket pkt;
-            av_init_packet(&pkt);
-            pkt.data = nullptr;
-            pkt.size = 0;
-            int got = 0;
-            int enc_ret = avcodec_encode_audio2(ctx_, &pkt, frame, &got);
-            av_frame_free(&frame);
-            if (enc_ret < 0) {
-                av_packet_unref(&pkt);
-                return false;
-            }
-            if (got && cb_) {
-                uint64_t pts_us =
-                    (audio_samples_sent_ * 1000000ULL) / (uint64_t)ctx_->sample_rate;
-                uint32_t pts_ms = (uint32_t)(pts_us / 1000ULL);
-                cb_(pkt.data, (size_t)pkt.size, pts_ms, pts_us);
-                audio_samples_sent_ += (uint64_t)frame_size_;
-            }
-            av_packet_unref(&pkt);
-        }
-
-        return true;
-    }
-
-    void Uninit() {
-        if (fifo_) {
-            av_audio_fifo_free(fifo_);
-            fifo_ = nullptr;
-        }
-        if (swr_) {
-            swr_free(&swr_);
-        }
-        if (ctx_) {
-            avcodec_close(ctx_);
-            av_free(ctx_);
-            ctx_ = nullptr;
-        }
-        codec_ = nullptr;
-        inited_ = false;
-    }
-
-    bool inited_{false};
-    const AVCodec* codec_{nullptr};
-    AVCodecContext* ctx_{nullptr};
-    SwrContext* swr_{nullptr};
-    AVAudioFifo* fifo_{nullptr};
-    AVSampleFormat swr_in_fmt_{AV_SAMPLE_FMT_NONE};
-    int swr_in_channels_{0};
-    int swr_in_rate_{0};
-    int frame_size_{1024};
-    uint64_t audio_samples_sent_{0};
-    EncodedCallback cb_{};
-};
-
 } // namespace
 
-struct MainWindow::AacEncoderState {
-    AacEncoderFFmpeg enc;
-};
-
 MainWindow::MainWindow() {
     video_capture_engine_.reset(new VideoCaptureEngine());
     audio_engine_.reset(new AudioEngine());
@@ -388,7 +103,9 @@ MainWindow::MainWindow() {
     media_info_.u32VideoFps = (Easy_U32)fps_;
     media_info_.u32AudioCodec = EASY_SDK_AUDIO_CODEC_AAC;
 
-    aac_.reset(new AacEncoderState());
+    audio_encoder_ = AudioEncoderFactory::Instance().CreateEncoder(kAudioEncodeTypeFFmpegAac);
+    mic_source_ = mixer_.AddSource();
+    loopback_source_ = mixer_.AddSource();
 }
 
 MainWindow::~MainWindow() {
@@ -577,8 +294,8 @@ void MainWindow::StartPush() {
         pushing_ = false;
         return;
     }
-    LOGI(kRtmpPushLogTag) << "[StartPush] Check aac_";
-    if (!aac_) {
+    LOGI(kRtmpPushLogTag) << "[StartPush] Check audio_encoder_";
+    if (!audio_encoder_) {
         LOGI(kRtmpPushLogTag) << "[StartPush] AAC encoder is null";
         SetStatus("Audio encoder init failed");
         pushing_ = false;
@@ -714,23 +431,13 @@ void MainWindow::StartPush() {
     // preview render thread (optional)
     LOGI(kRtmpPushLogTag) << "[StartPush] Create render thread";
     render_running_ = true;
+    render_mailbox_.Open();
     render_thread_ = std::thread([this]() {
         LOGI(kRtmpPushLogTag) << "[Render Thread] Started";
         while (render_running_.load()) {
             std::shared_ptr<VideoFrame> frame;
-            {
-                std::unique_lock<std::mutex> lock(render_mu_);
-                if (render_queue_.empty()) {
-                    render_cv_.wait(lock);
-                }
-                if (!render_running_.load()) {
-                    return;
-                }
-                if (render_queue_.empty()) {
-                    continue;
-                }
-                frame = render_queue_.front();
-                render_queue_.pop_front();
+            if (!render_mailbox_.Pop(frame, 100)) {
+                continue;
             }
             if (!frame || !video_render_) {
                 continue;
@@ -766,17 +473,61 @@ void MainWindow::StartPush() {
         LOGW(kRtmpPushLogTag) << "[StartPush] Local preview disabled: renderWindow not found";
     }
 
+    // Audio and video packets are stamped with their capture time on the media clock and
+    // merged in timestamp order; the first packet sent becomes 0 ms.
+    LOGI(kRtmpPushLogTag) << "[StartPush] Setup A/V interleaver";
+    interleaver_.Reset();
+    StartRecording();
+    interleaver_.RegisterPacketCallback([this](const AvPacket& packet) {
+        const uint64_t pts_us = packet.timestamp_us;
+        EASY_AV_Frame f{};
+        memset(&f, 0, sizeof(f));
+        if (packet.stream == kAvStreamVideo) {
+            f.u32AVFrameFlag = EASY_SDK_VIDEO_FRAME_FLAG;
+            f.u32AVFrameType = packet.keyframe ? EASY_SDK_VIDEO_FRAME_I : EASY_SDK_VIDEO_FRAME_P;
+        } else {
+            f.u32AVFrameFlag = EASY_SDK_AUDIO_FRAME_FLAG;
+            f.u32AVFrameType = EASY_SDK_AUDIO_CODEC_AAC;
+        }
+        f.u32PTS = (uint32_t)(pts_us / 1000ULL);
+        f.u32TimestampSec = (Easy_U32)(pts_us / 1000000ULL);
+        f.u32TimestampUsec = (Easy_U32)(pts_us % 1000000ULL);
+
+        QueuedFrame q;
+        q.frame = f;
+        q.buffer.assign(packet.data.begin(), packet.data.end());
+        {
+            std::lock_guard<std::mutex> lock(rtmp_mu_);
+            rtmp_queue_.push_back(std::move(q));
+            static uint64_t queue_log_count = 0;
+            if (++queue_log_count <= 3 || (queue_log_count % 500) == 0) {
+                LOGI(kRtmpPushLogTag) << "[Interleaver] Queued "
+                                      << (packet.stream == kAvStreamVideo ? "video" : "audio")
+                                      << " frame (throttled), len=" << packet.data.size()
+                                      << ", pts_ms=" << f.u32PTS << ", queue size=" << rtmp_queue_.size();
+            }
+        }
+        rtmp_cv_.notify_one();
+        // The recording gets the same packets; the muxer queues them for its own I/O thread.
+        if (recorder_) {
+            if (packet.stream == kAvStreamVideo) {
+                recorder_->WriteVideo(packet.data.data(), packet.data.size(), pts_us,
+                                      packet.keyframe);
+            } else {
+                recorder_->WriteAudio(packet.data.data(), packet.data.size(), pts_us);
+            }
+        }
+    });
+
     // init encoder callback
-    LOGI(kRtmpPushLogTag) << "[StartPush] Setup video encoder callback";
-    auto start_ts = std::chrono::steady_clock::now();
-    auto frame_idx = std::make_shared<std::atomic<uint64_t>>(0);
-    // Video timestamp base (set once when metadata becomes ready) so first sent video frame starts at 0ms.
-    auto video_base_us = std::make_shared<std::atomic<uint64_t>>(UINT64_MAX);
     LOGI(kRtmpPushLogTag) << "[StartPush] Set video encoder output size";
     video_encoder_->SetOutputSize((uint32_t)width_, (uint32_t)height_);
+    // An IDR frame every 2 s; the push starts on one even with the encoder reused.
+    GopConfig gop;
+    gop.keyframe_interval_ms = 2000;
+    video_encoder_->SetGopConfig(gop);
     LOGI(kRtmpPushLogTag) << "[StartPush] Register video encoder callback";
-    video_encoder_->RegisterEncodeCalback([this, start_ts, frame_idx, video_base_us](uint8_t* data,
-                                                                      uint32_t len) mutable {
+    video_encoder_->RegisterEncodeCalback([this](uint8_t* data, uint32_t len) {
         LOGI(kRtmpPushLogTag) << "[Video Encoder Callback] Entry";
         if (!pushing_.load()) {
             return;
@@ -826,43 +577,14 @@ void MainWindow::StartPush() {
             return;
         }
 
-        // IMPORTANT: Use wall-clock elapsed time since StartPush for VIDEO timestamps.
-        // Also apply a base so the first *sent* video frame starts at 0ms.
-        (void)(*frame_idx)++; // keep counter (debug/metrics), but don't base timestamps on it.
-        uint64_t pts_us_raw = NowUsSince(start_ts);
-        uint64_t base = video_base_us->load();
-        if (base == UINT64_MAX) {
-            video_base_us->store(pts_us_raw);
-            base = pts_us_raw;
-        }
-        uint64_t pts_us = (pts_us_raw >= base) ? (pts_us_raw - base) : 0;
-        uint32_t pts_ms = (uint32_t)(pts_us / 1000ULL);
-
-        EASY_AV_Frame f{};
-        memset(&f, 0, sizeof(f));
-        f.u32AVFrameFlag = EASY_SDK_VIDEO_FRAME_FLAG;
-        f.u32AVFrameType = has_idr ? EASY_SDK_VIDEO_FRAME_I : EASY_SDK_VIDEO_FRAME_P;
-        f.u32PTS = pts_ms;
-        f.u32TimestampSec = (Easy_U32)(pts_us / 1000000ULL);
-        f.u32TimestampUsec = (Easy_U32)(pts_us % 1000000ULL);
-
-        QueuedFrame q;
-        q.frame = f;
-        q.buffer.assign(data, data + len);
-        {
-            std::lock_guard<std::mutex> lock(rtmp_mu_);
-            rtmp_queue_.push_back(std::move(q));
-            static uint64_t queue_log_count = 0;
-            if (++queue_log_count <= 3 || (queue_log_count % 500) == 0) {
-                LOGI(kRtmpPushLogTag) << "[Video Encoder Callback] Queued video frame (throttled), len=" << len << ", queue size=" << rtmp_queue_.size();
-            }
-        }
-        rtmp_cv_.notify_one();
+        // The encoders run synchronously with zero latency, so this packet belongs to the frame
+        // whose capture time the observer just recorded.
+        interleaver_.Push(kAvStreamVideo, data, len, video_capture_us_, has_idr);
     });
 
     // audio encoder callback
     LOGI(kRtmpPushLogTag) << "[StartPush] Register audio encoder callback";
-    aac_->enc.RegisterCallback([this](const uint8_t* data, size_t len, uint32_t pts_ms, uint64_t pts_us) {
+    audio_encoder_->RegisterEncodeCallback([this](const uint8_t* data, uint32_t len, uint64_t pts_us) {
         const uint64_t n = ++g_audio_cb_count;
         if (n <= 3 || (n % 200) == 0) {
             LOGI(kRtmpPushLogTag) << "[Audio Encoder Callback] Entry (throttled), count=" << n;
@@ -877,27 +599,11 @@ void MainWindow::StartPush() {
         if (!rtmp_metadata_inited_.load()) {
             return;
         }
-        EASY_AV_Frame f{};
-        memset(&f, 0, sizeof(f));
-        f.u32AVFrameFlag = EASY_SDK_AUDIO_FRAME_FLAG;
-        f.u32AVFrameType = EASY_SDK_AUDIO_CODEC_AAC;
-        f.u32PTS = pts_ms;
-        f.u32TimestampSec = (Easy_U32)(pts_us / 1000000ULL);
-        f.u32TimestampUsec = (Easy_U32)(pts_us % 1000000ULL);
-
-        QueuedFrame q;
-        q.frame = f;
-        q.buffer.assign(data, data + len);
-        {
-            std::lock_guard<std::mutex> lock(rtmp_mu_);
-            rtmp_queue_.push_back(std::move(q));
-            if (n <= 3 || (n % 500) == 0) {
-                LOGI(kRtmpPushLogTag) << "[Audio Encoder Callback] Queued audio frame (throttled), len=" << len
-                                      << ", queue size=" << rtmp_queue_.size();
-            }
-        }
-        rtmp_cv_.notify_one();
+        // pts_us is on the capture clock: the mixer places its blocks by capture time.
+        interleaver_.Push(kAvStreamAudio, data, len, pts_us, true);
     });
+    // Encodes on its own thread; the microphone callback only copies PCM into its queue.
+    audio_encoder_->Start();
 
     // start capture
     LOGI(kRtmpPushLogTag) << "[StartPush] Enumerate video devices";
@@ -950,24 +656,20 @@ void MainWindow::StartPush() {
             }
             // preview
             if (self->video_render_) {
-                std::lock_guard<std::mutex> lock(self->render_mu_);
-                self->render_queue_.push_back(vf);
-                self->render_cv_.notify_all();
+                self->render_mailbox_.Push(vf);
             }
-            // encode (request keyframe about every 2s)
+            // encode; the encoder's GOP controller places the keyframes
             if (!self->video_encoder_) {
                 if (count < 5) {
                     LOGI(kRtmpPushLogTag) << "[FrameObserver] OnVideoFrame: video_encoder_ is null, skipping encode";
                 }
                 return;
             }
-            static std::atomic<uint64_t> idx{0};
-            uint64_t i = idx++;
-            bool key = (self->fps_ > 0) ? (i % (uint64_t)(self->fps_ * 2) == 0) : (i % 50 == 0);
-            if (count < 5 || key) {
-                LOGI(kRtmpPushLogTag) << "[FrameObserver] OnVideoFrame: calling EncodeFrame, key=" << (key ? "true" : "false") << ", encode_idx=" << i;
+            if (count < 5) {
+                LOGI(kRtmpPushLogTag) << "[FrameObserver] OnVideoFrame: calling EncodeFrame, frame_count=" << count;
             }
-            self->video_encoder_->EncodeFrame(vf, key);
+            self->video_capture_us_ = vf->GetTimestamp();
+            self->video_encoder_->EncodeFrame(vf, false);
         }
     };
 
@@ -981,9 +683,9 @@ void MainWindow::StartPush() {
     video_capture_engine_->StartCapture(device_id);
     LOGI(kRtmpPushLogTag) << "[StartPush] Video capture started";
 
-    // start mic
-    LOGI(kRtmpPushLogTag) << "[StartPush] Start microphone capture";
-    if (!mic_.Start("", [this](const AudioPcmFrame& pcm) {
+    // Microphone and system audio are mixed into 10 ms blocks, which feed the encoder.
+    mixer_.Reset();
+    mixer_.RegisterMixCallback([this](const AudioPcmFrame& pcm) {
         LOGI(kRtmpPushLogTag) << "[Audio Capture Callback] Entry";
         if (!pushing_.load()) {
             return;
@@ -1022,16 +724,23 @@ void MainWindow::StartPush() {
         // IMPORTANT: Do not feed PCM into AAC encoder until metadata is ready.
         // Otherwise AAC PTS accumulates while packets are dropped, and the first sent audio timestamp
         // becomes much larger than video, triggering RTMP timestamp underflow and server disconnect.
-        if (rtmp_metadata_inited_.load() && aac_) {
-            (void)aac_->enc.PushPcm(pcm);
+        if (rtmp_metadata_inited_.load()) {
+            (void)audio_encoder_->PushPcm(pcm);
         }
+    });
+
+    // start mic
+    LOGI(kRtmpPushLogTag) << "[StartPush] Start microphone capture";
+    if (!mic_.Start("", [this](const AudioPcmFrame& pcm) {
+        mixer_.PushPcm(mic_source_, pcm);
     })) {
         LOGI(kRtmpPushLogTag) << "[StartPush] Microphone start failed";
         SetStatus("Microphone start failed");
         // Clean up before calling StopPush
         video_capture_engine_->StopCapture();
+        audio_encoder_->Stop();
         render_running_ = false;
-        render_cv_.notify_all();
+        render_mailbox_.Close();
         if (render_thread_.joinable()) {
             render_thread_.join();
         }
@@ -1064,6 +773,12 @@ void MainWindow::StartPush() {
         return;
     }
 
+    // System audio is optional; without a render device the mix is the microphone alone.
+    LOGI(kRtmpPushLogTag) << "[StartPush] Start system audio capture";
+    loopback_.StartLoopback("", [this](const AudioPcmFrame& pcm) {
+        mixer_.PushPcm(loopback_source_, pcm);
+    });
+
     LOGI(kRtmpPushLogTag) << "[StartPush] Set status: pushing";
     SetStatusW(L"\u6B63\u5728\u63A8\u6D41..."); // 正在推流...
     
@@ -1123,6 +838,27 @@ void MainWindow::CreateVideoDeviceChooseWindow() {
     this->ShowWindow(true);
 }
 
+// Records what is pushed to a fragmented MP4 file in the working directory, named after the
+// start time. A failure to create it only costs the recording.
+void MainWindow::StartRecording() {
+    char name[64] = {0};
+    const std::time_t now = std::time(nullptr);
+    std::tm local{};
+    localtime_s(&local, &now);
+    std::strftime(name, sizeof(name), "rtmp_push_%Y%m%d_%H%M%S.mp4", &local);
+    MuxerConfig config;
+    config.video_codec = kMuxerVideoH264;
+    config.sample_rate = mixer_.GetSampleRate();
+    config.channels = mixer_.GetChannels();
+    recorder_ = MediaMuxerFactory::Instance().CreateMuxer(kMuxerTypeFmp4);
+    if (!recorder_ || !recorder_->Open(name, config)) {
+        LOGW(kRtmpPushLogTag) << "[StartRecording] cannot record to " << name;
+        recorder_.reset();
+        return;
+    }
+    LOGI(kRtmpPushLogTag) << "[StartRecording] recording to " << name;
+}
+
 void MainWindow::StopPush() {
     if (!pushing_.exchange(false)) {
         return;
@@ -1133,11 +869,18 @@ void MainWindow::StopPush() {
     // stop capture/audio
     video_capture_engine_->StopCapture();
     mic_.Stop();
+    loopback_.Stop();
+    audio_encoder_->Stop();
     video_frame_observer_.reset();
+    interleaver_.Flush();
+    if (recorder_) {
+        recorder_->Close();
+        recorder_.reset();
+    }
 
     // stop render
     render_running_ = false;
-    render_cv_.notify_all();
+    render_mailbox_.Close();
     if (render_thread_.joinable()) {
         render_thread_.join();
     }
@@ -15,8 +15,13 @@
 #include <rtmp/EasyRTMPAPI.h>
 #include <rtmp/EasyTypes.h>
 
+#include "audio_encoder_factory.h"
 #include "audio_engine.h"
+#include "av_interleaver.h"
 #include "capture/audio_capture.h"
+#include "frame_mailbox.h"
+#include "media_muxer_factory.h"
+#include "mixer/audio_mixer.h"
 #include "video_capture_engine.h"
 #include "video_encoder_factory.h"
 #include "video_render_factory.h"
@@ -44,6 +49,7 @@ private:
 
     void StartPush();
     void StopPush();
+    void StartRecording();
     void SetStatus(const std::string& status);
     void SetStatusW(const std::wstring& status);
     void CreateVideoDeviceChooseWindow();
@@ -72,14 +78,17 @@ private:
     std::shared_ptr<IVideoFrameObserver> video_frame_observer_{};
 
     std::thread render_thread_{};
-    std::mutex render_mu_{};
-    std::condition_variable render_cv_{};
-    std::deque<std::shared_ptr<VideoFrame>> render_queue_{};
+    // The preview only ever shows the newest frame; a slow render must not hold capture back.
+    FrameMailbox render_mailbox_{};
     std::atomic<bool> render_running_{false};
 
     // audio
     std::shared_ptr<AudioEngine> audio_engine_{};
     AudioCapture mic_{};
+    AudioCapture loopback_{};
+    AudioMixer mixer_{};
+    int mic_source_{};
+    int loopback_source_{};
 
     // RTMP
     Easy_Handle rtmp_handle_{nullptr};
@@ -92,6 +101,10 @@ private:
         std::vector<uint8_t> buffer{};
     };
     std::deque<QueuedFrame> rtmp_queue_{};
+    AvInterleaver interleaver_{};
+    // Capture time of the frame being encoded; only touched on the capture thread.
+    uint64_t video_capture_us_{};
+    std::shared_ptr<MediaMuxer> recorder_{};
 
     // cached codec config
     std::vector<uint8_t> sps_{};
@@ -100,9 +113,7 @@ private:
     std::mutex mi_mu_{};
     EASY_MEDIA_INFO_T media_info_{};
 
-    // audio encoder state
-    struct AacEncoderState;
-    std::unique_ptr<AacEncoderState> aac_{};
+    std::shared_ptr<AudioEncoder> audio_encoder_{};
 };
 
 
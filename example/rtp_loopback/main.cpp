@@ -0,0 +1,178 @@
+﻿// Sends a synthetic H.264 stream through RtpSender to an RtpReceiver over 127.0.0.1 with
+// simulated loss, delay and jitter on the receive side, checks every delivered access unit
+// byte for byte against what was sent and prints delivery and latency figures:
+//
+//   rtp_loopback [loss_percent] [delay_ms] [jitter_ms] [latency_ms] [kbps] [fps] [seconds]
+//                [fec]
+//
+// fec is off (the default), adaptive, or the parity percentage for delta frames; key frames
+// get twice as much.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "transport/rtp_receiver.h"
+#include "transport/rtp_sender.h"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// SPS+PPS+IDR or a single P slice, with a payload derived from index so the receiver can
+// rebuild and compare it. Payload bytes keep the top bit set and never form a start code.
+std::vector<uint8_t> MakeFrame(uint32_t index, bool key_frame, uint32_t size) {
+    static const uint8_t kSps[] = {0, 0, 0, 1, 0x67, 0x42, 0xC0, 0x1F, 0xDA, 0x01, 0x40, 0x16,
+                                   0xEC, 0x04, 0x40, 0x00, 0x00, 0x03, 0x00, 0x40, 0x00, 0x00,
+                                   0x0C, 0x83, 0xC6, 0x0C, 0xA8};
+    static const uint8_t kPps[] = {0, 0, 0, 1, 0x68, 0xCE, 0x3C, 0x80};
+    std::vector<uint8_t> frame;
+    if (key_frame) {
+        frame.insert(frame.end(), kSps, kSps + sizeof(kSps));
+        frame.insert(frame.end(), kPps, kPps + sizeof(kPps));
+    }
+    const uint8_t slice[] = {0, 0, 0, 1, (uint8_t)(key_frame ? 0x65 : 0x41)};
+    frame.insert(frame.end(), slice, slice + sizeof(slice));
+    uint32_t x = index * 2654435761u + 7;
+    while (frame.size() < size) {
+        x = x * 1664525u + 1013904223u;
+        frame.push_back((uint8_t)(0x80 | (x >> 24)));
+    }
+    return frame;
+}
+
+struct SentFrame {
+    uint32_t index;
+    bool key_frame;
+    uint32_t size;
+    Clock::time_point send_time;
+};
+
+double Percentile(std::vector<double>& values, double p) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t i = (size_t)(p * (values.size() - 1));
+    return values[i];
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    RtpNetworkSimulation simulation;
+    simulation.loss_percent = argc > 1 ? (uint32_t)atoi(argv[1]) : 1;
+    simulation.delay_ms = argc > 2 ? (uint32_t)atoi(argv[2]) : 20;
+    simulation.jitter_ms = argc > 3 ? (uint32_t)atoi(argv[3]) : 10;
+    const uint32_t latency_ms = argc > 4 ? (uint32_t)atoi(argv[4]) : 60;
+    const uint32_t kbps = argc > 5 ? (uint32_t)atoi(argv[5]) : 4000;
+    const uint32_t fps = argc > 6 && atoi(argv[6]) > 0 ? (uint32_t)atoi(argv[6]) : 30;
+    const uint32_t seconds = argc > 7 ? (uint32_t)atoi(argv[7]) : 10;
+    RtpFecConfig fec = {};
+    if (argc > 8 && strcmp(argv[8], "off") != 0) {
+        fec.enabled = true;
+        fec.adaptive = strcmp(argv[8], "adaptive") == 0;
+        fec.delta_percent = fec.adaptive ? 5 : (uint32_t)atoi(argv[8]);
+        fec.key_percent = fec.delta_percent * 2 < 100 ? fec.delta_percent * 2 : 100;
+        fec.max_percent = fec.adaptive ? 50 : fec.delta_percent;
+    }
+
+    std::mutex mtx;
+    std::map<uint32_t, SentFrame> sent; // by RTP timestamp
+    std::vector<double> latencies;
+    uint32_t delivered = 0;
+    uint32_t corrupted = 0;
+
+    RtpReceiver receiver;
+    receiver.SetLatency(latency_ms);
+    receiver.SetNetworkSimulation(simulation);
+    receiver.SetFrameCallback([&](const RtpFrame& frame) {
+        const Clock::time_point now = Clock::now();
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = sent.find(frame.timestamp);
+        if (it == sent.end() ||
+            frame.data != MakeFrame(it->second.index, it->second.key_frame, it->second.size)) {
+            ++corrupted;
+            return;
+        }
+        ++delivered;
+        latencies.push_back(
+            std::chrono::duration<double, std::milli>(now - it->second.send_time).count());
+    });
+    if (!receiver.Start("127.0.0.1", 0)) {
+        printf("receiver start failed\n");
+        return 1;
+    }
+
+    RtpSender sender;
+    std::atomic<bool> key_frame_requested{false};
+    sender.SetKeyFrameRequestCallback([&]() { key_frame_requested = true; });
+    sender.SetFecConfig(fec);
+    if (!sender.Open("127.0.0.1", receiver.GetPort())) {
+        printf("sender open failed\n");
+        return 1;
+    }
+
+    const uint32_t average = kbps * 1000 / 8 / fps;
+    const uint32_t gop = fps * 2;
+    const auto interval = std::chrono::microseconds(1000000 / fps);
+    const Clock::time_point start = Clock::now();
+    uint32_t key_frames = 0;
+    uint32_t since_key = gop;
+    for (uint32_t i = 0; i < seconds * fps; ++i) {
+        std::this_thread::sleep_until(start + interval * i);
+        const bool key_frame = since_key >= gop || key_frame_requested.exchange(false);
+        since_key = key_frame ? 1 : since_key + 1;
+        key_frames += key_frame ? 1 : 0;
+        const uint32_t size = key_frame ? average * 4 : average;
+        std::vector<uint8_t> frame = MakeFrame(i, key_frame, size);
+        const int64_t timestamp_us = (int64_t)i * 1000000 / fps;
+        const uint32_t rtp_timestamp = (uint32_t)(timestamp_us * 90 / 1000);
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            SentFrame info = {i, key_frame, size, Clock::now()};
+            sent[rtp_timestamp] = info;
+        }
+        sender.SendFrame(frame.data(), (uint32_t)frame.size(), timestamp_us);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(
+        simulation.delay_ms + simulation.jitter_ms + latency_ms + 200));
+    receiver.Stop();
+
+    RtpSenderStats send_stats = sender.GetStats();
+    RtpJitterStats stats = receiver.GetStats();
+    RtpFecStats fec_stats = receiver.GetFecStats();
+    std::lock_guard<std::mutex> lock(mtx);
+    printf("loss %u%%, delay %u ms, jitter %u ms, jitter buffer %u ms, %u kbit/s at %u fps\n",
+           simulation.loss_percent, simulation.delay_ms, simulation.jitter_ms, latency_ms, kbps,
+           fps);
+    printf("sent %llu frames (%u key, %llu on request) in %llu packets\n",
+           (unsigned long long)send_stats.frames_sent, key_frames,
+           (unsigned long long)send_stats.key_frame_requests,
+           (unsigned long long)send_stats.packets_sent);
+    printf("delivered %u frames (%.1f%%), %u corrupted; jitter buffer: %llu packets, %llu lost, "
+           "%llu discarded, %llu frames dropped\n",
+           delivered, 100.0 * delivered / (send_stats.frames_sent ? send_stats.frames_sent : 1),
+           corrupted, (unsigned long long)stats.packets_received,
+           (unsigned long long)stats.packets_lost, (unsigned long long)stats.packets_discarded,
+           (unsigned long long)stats.frames_dropped);
+    if (fec.enabled) {
+        printf("fec: %.1f%% overhead, now %u/%u%%; %llu parity received, %llu packets recovered, "
+               "%llu groups unrecoverable\n",
+               100.0 * send_stats.fec_bytes_sent / (send_stats.bytes_sent ? send_stats.bytes_sent : 1),
+               sender.GetFecDeltaPercent(), sender.GetFecKeyPercent(),
+               (unsigned long long)fec_stats.parity_received,
+               (unsigned long long)fec_stats.recovered,
+               (unsigned long long)fec_stats.unrecoverable);
+    }
+    printf("latency ms: p50 %.1f  p95 %.1f  p99 %.1f  max %.1f\n", Percentile(latencies, 0.5),
+           Percentile(latencies, 0.95), Percentile(latencies, 0.99),
+           Percentile(latencies, 1.0));
+    return corrupted == 0 ? 0 : 2;
+}
\ No newline at end of file
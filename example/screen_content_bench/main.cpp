@@ -0,0 +1,294 @@
+﻿// Checks ScreenContentAnalyzer with synthetic screens and times it. A 1080p page of "text"
+// is compared with itself, with typed characters, a chroma-only highlight, a strided copy and
+// a frame whose size is no multiple of 16: the change map must hold exactly the macroblocks
+// that were touched, the QP offsets must spare them and their neighbours, unchanged frames
+// must be dropped but repeated once per repeat interval, and IDR frames must be kept. Then a
+// minute of a document-sharing session shows how much is left to encode, and Analyze is
+// timed on a static and on a scrolled frame.
+//
+//   screen_content_bench [iterations]
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "video_encoder/screen_content_analyzer.h"
+
+namespace {
+
+const uint32_t kFps = 30;
+const uint64_t kFrameUs = 1000000 / kFps;
+
+struct Picture {
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride; // luma; chroma planes use (stride + 1) / 2
+    std::vector<uint8_t> data;
+
+    uint8_t* Y() { return data.data(); }
+    uint8_t* U() { return data.data() + (size_t)stride * height; }
+    uint8_t* V() { return U() + (size_t)ChromaStride() * ((height + 1) / 2); }
+    uint32_t ChromaStride() const { return (stride + 1) / 2; }
+};
+
+// White page with rows of dark glyph-like strokes, scrolled by offset lines.
+Picture MakePage(uint32_t width, uint32_t height, uint32_t stride, uint32_t offset) {
+    Picture pic = {width, height, stride, {}};
+    const uint32_t chroma_height = (height + 1) / 2;
+    pic.data.assign((size_t)stride * height + 2 * (size_t)pic.ChromaStride() * chroma_height, 128);
+    for (uint32_t y = 0; y < height; ++y) {
+        const uint32_t line = (y + offset) % 24;
+        for (uint32_t x = 0; x < width; ++x) {
+            const uint32_t glyph = ((x / 9) * 2654435761u + ((y + offset) / 24) * 40503u) >> 28;
+            const bool ink = line >= 4 && line < 18 && glyph > 3 && ((x + line * glyph) % 7) < 2;
+            pic.Y()[(size_t)y * stride + x] = ink ? 30 : 235;
+        }
+    }
+    return pic;
+}
+
+// Changes luma in [x0, x1) x [y0, y1).
+void Type(Picture& pic, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1) {
+    for (uint32_t y = y0; y < y1; ++y) {
+        for (uint32_t x = x0; x < x1; ++x) {
+            uint8_t& p = pic.Y()[(size_t)y * pic.stride + x];
+            p = p > 128 ? 40 : 220;
+        }
+    }
+}
+
+bool Analyze(ScreenContentAnalyzer& analyzer, Picture& pic, uint64_t time_us, bool keep) {
+    return analyzer.Analyze(pic.Y(), (int)pic.stride, pic.U(), (int)pic.ChromaStride(), pic.V(),
+                            (int)pic.ChromaStride(), pic.width, pic.height, time_us, kFps, keep);
+}
+
+// Macroblocks covering luma [x0, x1) x [y0, y1) must be the only changed ones, and the
+// QP offsets must be zero exactly one macroblock around them.
+bool CheckMap(ScreenContentAnalyzer& analyzer, uint32_t x0, uint32_t y0, uint32_t x1,
+              uint32_t y1, float offset, const char* name) {
+    const std::vector<uint8_t>& map = analyzer.GetChangeMap();
+    const float* offsets = analyzer.GetQuantOffsets();
+    const int mb_width = (int)analyzer.GetMbWidth();
+    const int mb_height = (int)analyzer.GetMbHeight();
+    // An empty area changes nothing, and then nothing is near a change either.
+    const bool empty = x1 <= x0 || y1 <= y0;
+    const int mx0 = empty ? mb_width + 2 : (int)(x0 / 16);
+    const int my0 = empty ? mb_height + 2 : (int)(y0 / 16);
+    const int mx1 = empty ? mb_width + 2 : (int)((x1 - 1) / 16);
+    const int my1 = empty ? mb_height + 2 : (int)((y1 - 1) / 16);
+    int wrong_map = 0;
+    int wrong_offsets = 0;
+    int changed = 0;
+    for (int my = 0; my < mb_height; ++my) {
+        for (int mx = 0; mx < mb_width; ++mx) {
+            const size_t index = (size_t)my * mb_width + mx;
+            const bool inside = mx >= mx0 && mx <= mx1 && my >= my0 && my <= my1;
+            const bool near = mx >= mx0 - 1 && mx <= mx1 + 1 && my >= my0 - 1 && my <= my1 + 1;
+            wrong_map += (map[index] != 0) != inside;
+            wrong_offsets += offsets[index] != (near ? 0.0f : offset);
+            changed += map[index];
+        }
+    }
+    printf("  %-22s %4d of %5d macroblocks changed, %d misplaced, %d wrong offsets\n", name,
+           changed, mb_width * mb_height, wrong_map, wrong_offsets);
+    return wrong_map == 0 && wrong_offsets == 0;
+}
+
+bool CheckMaps() {
+    ScreenContentConfig config;
+    config.enabled = true;
+    ScreenContentAnalyzer analyzer;
+    analyzer.SetConfig(config);
+    Picture page = MakePage(1920, 1080, 1920, 0);
+    uint64_t time_us = 0;
+    printf("change maps, 1920x1080:\n");
+
+    bool ok = Analyze(analyzer, page, time_us, false);
+    int all = 0;
+    for (uint8_t changed : analyzer.GetChangeMap()) {
+        all += changed;
+    }
+    ok = ok && all == 120 * 68 && analyzer.GetMbWidth() == 120 && analyzer.GetMbHeight() == 68;
+    printf("  first frame            %4d macroblocks changed\n", all);
+
+    time_us += kFrameUs;
+    const bool dropped = !Analyze(analyzer, page, time_us, false);
+    ok = CheckMap(analyzer, 0, 0, 0, 0, config.static_qp_offset, "unchanged") && dropped && ok;
+
+    // A few characters straddling a macroblock corner.
+    Type(page, 250, 200, 270, 214);
+    time_us += kFrameUs;
+    ok = Analyze(analyzer, page, time_us, false) && ok;
+    ok = CheckMap(analyzer, 250, 200, 270, 214, config.static_qp_offset, "typed") && ok;
+
+    // The last pixel of the bottom right macroblock.
+    Type(page, 1919, 1079, 1920, 1080);
+    time_us += kFrameUs;
+    ok = Analyze(analyzer, page, time_us, false) && ok;
+    ok = CheckMap(analyzer, 1919, 1079, 1920, 1080, config.static_qp_offset, "corner pixel") &&
+         ok;
+
+    // A selection highlight tints chroma only: chroma [500, 540) x [300, 310) covers luma
+    // [1000, 1080) x [600, 620).
+    for (uint32_t y = 300; y < 310; ++y) {
+        memset(page.U() + (size_t)y * page.ChromaStride() + 500, 90, 40);
+    }
+    time_us += kFrameUs;
+    ok = Analyze(analyzer, page, time_us, false) && ok;
+    ok = CheckMap(analyzer, 1000, 600, 1080, 620, config.static_qp_offset, "chroma highlight") &&
+         ok;
+
+    // Back to the same pixels in a buffer with padded rows.
+    Picture padded = {1920, 1080, 2048, {}};
+    padded.data.assign((size_t)2048 * 1080 * 3 / 2, 0);
+    for (uint32_t y = 0; y < 1080; ++y) {
+        memcpy(padded.Y() + (size_t)y * 2048, page.Y() + (size_t)y * 1920, 1920);
+    }
+    for (uint32_t y = 0; y < 540; ++y) {
+        memcpy(padded.U() + (size_t)y * 1024, page.U() + (size_t)y * 960, 960);
+        memcpy(padded.V() + (size_t)y * 1024, page.V() + (size_t)y * 960, 960);
+    }
+    memset(padded.Y() + 1920, 77, 128); // padding is not picture
+    time_us += kFrameUs;
+    const bool padded_dropped = !Analyze(analyzer, padded, time_us, false);
+    ok = CheckMap(analyzer, 0, 0, 0, 0, config.static_qp_offset, "strided copy") &&
+         padded_dropped && ok;
+
+    // A size change starts over; then a change in the partial macroblocks at the edge.
+    Picture odd = MakePage(1366, 770, 1366, 0);
+    time_us += kFrameUs;
+    ok = Analyze(analyzer, odd, time_us, false) && analyzer.GetMbWidth() == 86 &&
+         analyzer.GetMbHeight() == 49 && ok;
+    Type(odd, 1360, 765, 1366, 770);
+    time_us += kFrameUs;
+    ok = Analyze(analyzer, odd, time_us, false) && ok;
+    ok = CheckMap(analyzer, 1360, 765, 1366, 770, config.static_qp_offset, "1366x770 edge") && ok;
+    return ok;
+}
+
+bool CheckRepeats() {
+    ScreenContentConfig config;
+    config.enabled = true;
+    config.repeat_interval_ms = 1000;
+    ScreenContentAnalyzer analyzer;
+    analyzer.SetConfig(config);
+    Picture page = MakePage(640, 360, 640, 0);
+    // Ten static seconds, with an IDR frame due at 5 s.
+    uint64_t last_sent = 0;
+    uint64_t worst_gap = 0;
+    int sent = 0;
+    bool idr_kept = true;
+    for (uint64_t frame = 0; frame < 10 * kFps; ++frame) {
+        const uint64_t time_us = 1000000 + frame * kFrameUs;
+        const bool idr = frame == 5 * kFps;
+        const bool keep = Analyze(analyzer, page, time_us, idr);
+        idr_kept = idr_kept && (!idr || keep);
+        if (keep) {
+            if (sent > 0 && time_us - last_sent > worst_gap) {
+                worst_gap = time_us - last_sent;
+            }
+            last_sent = time_us;
+            ++sent;
+        }
+    }
+    // Frames without timestamps are spaced by the frame rate.
+    ScreenContentAnalyzer untimed;
+    untimed.SetConfig(config);
+    int untimed_sent = 0;
+    for (uint32_t frame = 0; frame < 4 * kFps; ++frame) {
+        untimed_sent += Analyze(untimed, page, 0, false) ? 1 : 0;
+    }
+    const ScreenContentStats stats = analyzer.GetStats();
+    printf("static 10 s at %u fps: %d frames sent (%llu repeats), %llu dropped, longest gap "
+           "%llu ms; untimed 4 s: %d sent\n",
+           kFps, sent, (unsigned long long)stats.repeat_frames,
+           (unsigned long long)stats.frames_dropped, (unsigned long long)(worst_gap / 1000),
+           untimed_sent);
+    // The first frame, one repeat per second and the IDR frame, which restarts the count.
+    return idr_kept && sent >= 10 && sent <= 12 && worst_gap <= 1000000 + kFrameUs &&
+           stats.frames_dropped == 10 * kFps - (uint64_t)sent && untimed_sent >= 4 &&
+           untimed_sent <= 5;
+}
+
+// A minute of document sharing: a few characters typed every other frame while typing, a
+// pause every few seconds and a scroll every 15 seconds.
+bool RunSession() {
+    ScreenContentConfig config;
+    config.enabled = true;
+    ScreenContentAnalyzer analyzer;
+    analyzer.SetConfig(config);
+    std::mt19937 random(11);
+    Picture page = MakePage(1920, 1080, 1920, 0);
+    uint32_t scroll = 0;
+    uint32_t cursor_x = 100;
+    uint32_t cursor_y = 100;
+    int sent = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (uint64_t frame = 0; frame < 60 * kFps; ++frame) {
+        const uint64_t second = frame / kFps;
+        if (frame > 0 && frame % (15 * kFps) == 0) {
+            scroll += 240;
+            page = MakePage(1920, 1080, 1920, scroll);
+        } else if (second % 4 != 3 && frame % 2 == 0) {
+            Type(page, cursor_x, cursor_y, cursor_x + 9, cursor_y + 14);
+            cursor_x += 9;
+            if (cursor_x + 9 > 1800) {
+                cursor_x = 100;
+                cursor_y = 100 + (cursor_y + 24 - 100) % 900;
+            }
+        }
+        if (random() % 40 == 0) {
+            // A stray mouse move over the page.
+            Type(page, random() % 1900, random() % 1060, 0, 0);
+        }
+        sent += Analyze(analyzer, page, frame * kFrameUs, false) ? 1 : 0;
+    }
+    const double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const ScreenContentStats stats = analyzer.GetStats();
+    const double changed = (double)stats.changed_macroblocks / (double)stats.macroblocks;
+    printf("document session, 60 s at %u fps: %d of %llu frames sent, %.2f%% of macroblocks "
+           "changed, %.2f ms per frame\n",
+           kFps, sent, (unsigned long long)stats.frames, changed * 100,
+           seconds * 1000 / stats.frames);
+    return sent < (int)(stats.frames * 3 / 4) && changed < 0.02;
+}
+
+void Bench(int iterations) {
+    ScreenContentConfig config;
+    config.enabled = true;
+    ScreenContentAnalyzer analyzer;
+    analyzer.SetConfig(config);
+    Picture a = MakePage(1920, 1080, 1920, 0);
+    Picture b = MakePage(1920, 1080, 1920, 24);
+    Analyze(analyzer, a, 0, false);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        Analyze(analyzer, a, (uint64_t)(i + 1) * kFrameUs, false);
+    }
+    const double still =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        Analyze(analyzer, i % 2 ? a : b, (uint64_t)(iterations + i + 1) * kFrameUs, false);
+    }
+    const double scrolled =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("Analyze 1080p: %.3f ms static, %.3f ms scrolled\n", still * 1000 / iterations,
+           scrolled * 1000 / iterations);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int iterations = argc > 1 && atoi(argv[1]) > 0 ? atoi(argv[1]) : 300;
+    bool ok = CheckMaps();
+    ok = CheckRepeats() && ok;
+    ok = RunSession() && ok;
+    Bench(iterations);
+    printf("%s\n", ok ? "all checks passed" : "CHECKS FAILED");
+    return ok ? 0 : 2;
+}
\ No newline at end of file
@@ -0,0 +1,226 @@
+﻿// Checks the parameter set parsers against SPS/PPS taken from real streams. H.264: x264's 720p
+// High SPS with a BT.709 colour description and fixed 30 fps timing, its 1080p High SPS coded
+// as 1088 lines with a bottom crop, and the CABAC/8x8 PPS that goes with them, each with and
+// without a start code; truncated and wrong-type input must be rejected. H.265: x265's 1080p
+// Main SPS, and the same SPS coded as 1088 lines with a conformance window. Then times the SPS
+// parse.
+//
+//   sps_parser_bench [iterations]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "h264_sps_parser.h"
+#include "h265_sps_parser.h"
+
+namespace {
+
+// x264, 1280x720 High@3.1, VUI: SAR 1:1, BT.709, 1/60 tick at fixed 30 fps, 2 reorder frames
+const uint8_t kH264Sps720p[] = {0x67, 0x64, 0x00, 0x1F, 0xAC, 0xD9, 0x40, 0x50, 0x05, 0xBB,
+                                0x01, 0x6A, 0x02, 0x02, 0x02, 0x80, 0x00, 0x00, 0x03, 0x00,
+                                0x80, 0x00, 0x00, 0x1E, 0x47, 0x8C, 0x18, 0xCB};
+
+// x264, 1920x1080 High@4.0: 120x68 macroblocks cropped by 8 lines, SAR 1:1, 30 fps timing
+const uint8_t kH264Sps1080p[] = {0x67, 0x64, 0x00, 0x28, 0xAC, 0xD9, 0x40, 0x78, 0x02,
+                                 0x27, 0xE5, 0xC0, 0x44, 0x00, 0x00, 0x03, 0x00, 0x04,
+                                 0x00, 0x00, 0x03, 0x00, 0xF0, 0x3C, 0x60, 0xC6, 0x58};
+
+// x264 High PPS: CABAC, 3 L0 refs, weighted prediction, QP 23, chroma offset -2, 8x8 transform
+const uint8_t kH264Pps[] = {0x68, 0xEB, 0xE3, 0xCB, 0x22, 0xC0};
+
+// x265, 1920x1080 Main@4 Main tier, progressive frames, no conformance window
+const uint8_t kH265Sps1080p[] = {0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x90,
+                                 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x78, 0xA0, 0x03,
+                                 0xC0, 0x80, 0x10, 0xE5, 0x96, 0x66, 0x69, 0x24, 0xCA, 0xE0,
+                                 0x10, 0x00, 0x00, 0x03, 0x00, 0x10, 0x00, 0x00, 0x03, 0x01,
+                                 0xE0, 0x80};
+
+// The SPS above as encoders with 16-line alignment write it: 1920x1088 coded, conformance
+// window bottom offset 4 in 2-line chroma units
+const uint8_t kH265Sps1080pCropped[] = {
+    0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x90, 0x00, 0x00, 0x03, 0x00, 0x00,
+    0x03, 0x00, 0x78, 0xA0, 0x03, 0xC0, 0x80, 0x11, 0x07, 0xCB, 0x96, 0x66, 0x69, 0x24, 0xCA,
+    0xE0, 0x10, 0x00, 0x00, 0x03, 0x00, 0x10, 0x00, 0x00, 0x03, 0x01, 0xE0, 0x80};
+
+std::vector<uint8_t> WithStartCode(const uint8_t* nal, size_t size) {
+    std::vector<uint8_t> out = {0x00, 0x00, 0x00, 0x01};
+    out.insert(out.end(), nal, nal + size);
+    return out;
+}
+
+bool Expect(bool condition, const char* what) {
+    if (!condition) {
+        printf("  FAILED: %s\n", what);
+    }
+    return condition;
+}
+
+bool CheckH264Sps720p() {
+    bool ok = true;
+    for (int annexb = 0; annexb < 2; ++annexb) {
+        const std::vector<uint8_t> nal =
+            annexb ? WithStartCode(kH264Sps720p, sizeof(kH264Sps720p))
+                   : std::vector<uint8_t>(kH264Sps720p, kH264Sps720p + sizeof(kH264Sps720p));
+        H264SpsInfo sps;
+        if (!Expect(ParseH264Sps(nal.data(), nal.size(), &sps), "720p SPS parses")) {
+            return false;
+        }
+        ok = Expect(sps.profile_idc == 100 && sps.level_idc == 31, "720p profile/level") && ok;
+        ok = Expect(sps.chroma_format_idc == 1 && sps.bit_depth_luma == 8 &&
+                        sps.bit_depth_chroma == 8,
+                    "720p 8-bit 4:2:0") &&
+             ok;
+        ok = Expect(sps.width == 1280 && sps.height == 720 && sps.frame_mbs_only,
+                    "720p size") &&
+             ok;
+        ok = Expect(sps.max_num_ref_frames == 4, "720p ref frames") && ok;
+        ok = Expect(sps.vui_present && sps.sar_width == 1 && sps.sar_height == 1, "720p SAR") &&
+             ok;
+        ok = Expect(!sps.video_full_range && sps.colour_primaries == 1 &&
+                        sps.transfer_characteristics == 1 && sps.matrix_coefficients == 1,
+                    "720p BT.709 limited range") &&
+             ok;
+        ok = Expect(sps.timing_info_present && sps.num_units_in_tick == 1 &&
+                        sps.time_scale == 60 && sps.fixed_frame_rate && sps.frame_rate == 30.0,
+                    "720p VUI timing") &&
+             ok;
+        ok = Expect(sps.max_num_reorder_frames == 2, "720p reorder frames") && ok;
+    }
+    printf("H.264 720p SPS: %s\n", ok ? "ok" : "FAILED");
+    return ok;
+}
+
+bool CheckH264Sps1080p() {
+    bool ok = true;
+    for (int annexb = 0; annexb < 2; ++annexb) {
+        const std::vector<uint8_t> nal =
+            annexb ? WithStartCode(kH264Sps1080p, sizeof(kH264Sps1080p))
+                   : std::vector<uint8_t>(kH264Sps1080p, kH264Sps1080p + sizeof(kH264Sps1080p));
+        H264SpsInfo sps;
+        if (!Expect(ParseH264Sps(nal.data(), nal.size(), &sps), "1080p SPS parses")) {
+            return false;
+        }
+        ok = Expect(sps.profile_idc == 100 && sps.level_idc == 40, "1080p profile/level") && ok;
+        // 1088 coded lines, frame_crop_bottom_offset 4 in 2-line chroma units
+        ok = Expect(sps.width == 1920 && sps.height == 1080, "1080p cropped size") && ok;
+        ok = Expect(sps.vui_present && sps.sar_width == 1 && sps.sar_height == 1, "1080p SAR") &&
+             ok;
+        ok = Expect(sps.colour_primaries == 2 && sps.matrix_coefficients == 2,
+                    "1080p unspecified colour") &&
+             ok;
+        ok = Expect(sps.timing_info_present && sps.num_units_in_tick == 1 &&
+                        sps.time_scale == 60 && !sps.fixed_frame_rate && sps.frame_rate == 30.0,
+                    "1080p VUI timing") &&
+             ok;
+        ok = Expect(sps.max_num_reorder_frames == 2, "1080p reorder frames") && ok;
+    }
+    printf("H.264 1080p SPS: %s\n", ok ? "ok" : "FAILED");
+    return ok;
+}
+
+bool CheckH264Pps() {
+    H264PpsInfo pps;
+    bool ok = Expect(ParseH264Pps(kH264Pps, sizeof(kH264Pps), 1, &pps), "PPS parses");
+    ok = ok && Expect(pps.pps_id == 0 && pps.sps_id == 0, "PPS ids");
+    ok = ok && Expect(pps.entropy_coding_mode && pps.num_slice_groups == 1, "PPS CABAC");
+    ok = ok && Expect(pps.num_ref_idx_l0_default_active == 3 &&
+                          pps.num_ref_idx_l1_default_active == 1,
+                      "PPS default refs");
+    ok = ok && Expect(pps.weighted_pred && pps.weighted_bipred_idc == 2, "PPS weighted pred");
+    ok = ok && Expect(pps.pic_init_qp == 23 && pps.chroma_qp_index_offset == -2, "PPS QP");
+    // transform_8x8_mode_flag sits behind more_rbsp_data()
+    ok = ok && Expect(pps.deblocking_filter_control_present && pps.transform_8x8_mode,
+                      "PPS 8x8 transform");
+    const std::vector<uint8_t> annexb = WithStartCode(kH264Pps, sizeof(kH264Pps));
+    H264PpsInfo pps2;
+    ok = ok && Expect(ParseH264Pps(annexb.data(), annexb.size(), 1, &pps2) &&
+                          pps2.transform_8x8_mode && pps2.pic_init_qp == 23,
+                      "PPS with start code");
+    printf("H.264 PPS: %s\n", ok ? "ok" : "FAILED");
+    return ok;
+}
+
+bool CheckH265Sps(const char* name, const uint8_t* data, size_t size) {
+    bool ok = true;
+    for (int annexb = 0; annexb < 2; ++annexb) {
+        const std::vector<uint8_t> nal =
+            annexb ? WithStartCode(data, size) : std::vector<uint8_t>(data, data + size);
+        H265SpsInfo sps;
+        if (!Expect(ParseH265Sps(nal.data(), nal.size(), &sps), "HEVC SPS parses")) {
+            return false;
+        }
+        ok = Expect(sps.general_profile_space == 0 && !sps.general_tier_flag &&
+                        sps.general_profile_idc == 1 && sps.general_level_idc == 120,
+                    "HEVC Main@4 Main tier") &&
+             ok;
+        ok = Expect(sps.general_profile_compatibility_flags == 0x60000000,
+                    "HEVC Main/Main10 compatibility") &&
+             ok;
+        // general_progressive_source_flag and general_frame_only_constraint_flag
+        ok = Expect(sps.general_constraint_indicator_flags == 0x900000000000ull,
+                    "HEVC constraint flags") &&
+             ok;
+        ok = Expect(sps.max_sub_layers == 1 && sps.temporal_id_nesting && sps.sps_id == 0,
+                    "HEVC sub-layers") &&
+             ok;
+        ok = Expect(sps.chroma_format_idc == 1 && sps.bit_depth_luma == 8 &&
+                        sps.bit_depth_chroma == 8,
+                    "HEVC 8-bit 4:2:0") &&
+             ok;
+        ok = Expect(sps.width == 1920 && sps.height == 1080, "HEVC output size") && ok;
+    }
+    printf("H.265 %s SPS: %s\n", name, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+bool CheckRejects() {
+    H264SpsInfo sps;
+    H264PpsInfo pps;
+    bool ok = Expect(!ParseH264Sps(kH264Sps1080p, 8, &sps), "truncated SPS rejected");
+    ok = Expect(!ParseH264Sps(kH264Pps, sizeof(kH264Pps), &sps), "PPS as SPS rejected") && ok;
+    ok = Expect(!ParseH264Pps(kH264Sps720p, sizeof(kH264Sps720p), 1, &pps),
+                "SPS as PPS rejected") &&
+         ok;
+    ok = Expect(!ParseH264Pps(kH264Pps, 3, 1, &pps), "truncated PPS rejected") && ok;
+    H265SpsInfo hevc_sps;
+    ok = Expect(!ParseH265Sps(kH265Sps1080pCropped, 20, &hevc_sps),
+                "truncated HEVC SPS rejected") &&
+         ok;
+    ok = Expect(!ParseH265Sps(kH264Sps1080p, sizeof(kH264Sps1080p), &hevc_sps),
+                "H.264 SPS as HEVC SPS rejected") &&
+         ok;
+    printf("malformed input: %s\n", ok ? "ok" : "FAILED");
+    return ok;
+}
+
+bool Bench(int iterations) {
+    H264SpsInfo sps;
+    uint64_t total = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        if (ParseH264Sps(kH264Sps1080p, sizeof(kH264Sps1080p), &sps)) {
+            total += sps.height;
+        }
+    }
+    const double ns =
+        std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start)
+            .count();
+    printf("ParseH264Sps: %.1f ns per 1080p SPS\n", iterations > 0 ? ns / iterations : 0.0);
+    return total == (uint64_t)iterations * 1080;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int iterations = argc > 1 && atoi(argv[1]) > 0 ? atoi(argv[1]) : 1000000;
+    bool ok = CheckH264Sps720p();
+    ok = CheckH264Sps1080p() && ok;
+    ok = CheckH264Pps() && ok;
+    ok = CheckH265Sps("1080p", kH265Sps1080p, sizeof(kH265Sps1080p)) && ok;
+    ok = CheckH265Sps("1080p cropped", kH265Sps1080pCropped, sizeof(kH265Sps1080pCropped)) && ok;
+    ok = CheckRejects() && ok;
+    ok = Bench(iterations) && ok;
+    printf("%s\n", ok ? "all checks passed" : "CHECKS FAILED");
+    return ok ? 0 : 2;
+}
\ No newline at end of file
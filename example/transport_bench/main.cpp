@@ -0,0 +1,167 @@
+﻿// Loopback benchmark for the framed transport. For a few frame sizes it pushes frames from a
+// client thread to a receiving thread over 127.0.0.1, once through FramedSocket and once the
+// way the screen-share demo used to do it (copy into a staging buffer, one send, MSG_WAITALL
+// reads into a fixed buffer), and prints frames/s and MB/s for both.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "transport/framed_socket.h"
+#include "transport/socket_utils.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#else
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#endif
+
+namespace {
+
+const uint32_t kLegacyBufferSize = 1024 * 1024;
+const uint64_t kBytesPerRun = 512ull * 1024 * 1024;
+
+struct RunResult {
+    uint32_t frames;
+    double seconds;
+    bool ok;
+};
+
+bool RecvAll(SocketHandle socket, uint8_t* data, uint32_t size) {
+    while (size > 0) {
+        int n = recv(socket, (char*)data, (int)size, MSG_WAITALL);
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+void LegacyReceiver(SocketHandle socket, uint32_t frames, bool* ok) {
+    std::vector<uint8_t> recvbuf(kLegacyBufferSize);
+    for (uint32_t i = 0; i < frames; ++i) {
+        uint32_t header = 0;
+        if (!RecvAll(socket, (uint8_t*)&header, sizeof(header)) ||
+            !RecvAll(socket, recvbuf.data(), ntohl(header))) {
+            *ok = false;
+            return;
+        }
+    }
+    *ok = true;
+}
+
+void LegacySender(SocketHandle socket, const std::vector<uint8_t>& payload, uint32_t frames) {
+    std::vector<uint8_t> send_buffer(kLegacyBufferSize);
+    const uint32_t size = (uint32_t)payload.size();
+    for (uint32_t i = 0; i < frames; ++i) {
+        *(uint32_t*)send_buffer.data() = htonl(size);
+        memcpy(send_buffer.data() + 4, payload.data(), size);
+        const uint8_t* p = send_buffer.data();
+        uint32_t left = size + 4;
+        while (left > 0) {
+            int n = send(socket, (const char*)p, (int)left, 0);
+            if (n <= 0) {
+                return;
+            }
+            p += n;
+            left -= n;
+        }
+    }
+}
+
+void FramedReceiver(SocketHandle socket, uint32_t frames, bool* ok) {
+    FramedSocket framed(socket);
+    framed.Tune(true, 0, 1024 * 1024);
+    for (uint32_t i = 0; i < frames; ++i) {
+        std::shared_ptr<FramePacket> packet = framed.RecvFrame();
+        if (!packet) {
+            *ok = false;
+            return;
+        }
+    }
+    framed.Detach();
+    *ok = true;
+}
+
+void FramedSender(SocketHandle socket, const std::vector<uint8_t>& payload, uint32_t frames) {
+    FramedSocket framed(socket);
+    framed.Tune(true, 1024 * 1024, 0);
+    for (uint32_t i = 0; i < frames; ++i) {
+        if (!framed.SendFrame(payload.data(), (uint32_t)payload.size())) {
+            break;
+        }
+    }
+    framed.Detach();
+}
+
+RunResult Run(bool framed, uint32_t frame_size) {
+    RunResult result = {0, 0.0, false};
+    SocketHandle listen_socket = ListenTcp("127.0.0.1", 0, 1);
+    if (listen_socket == kInvalidSocket) {
+        return result;
+    }
+    SocketHandle client = ConnectTcp("127.0.0.1", GetLocalPort(listen_socket));
+    SocketHandle server = AcceptTcp(listen_socket);
+    CloseSocket(listen_socket);
+    if (client == kInvalidSocket || server == kInvalidSocket) {
+        CloseSocket(client);
+        CloseSocket(server);
+        return result;
+    }
+
+    std::vector<uint8_t> payload(frame_size, 0x5A);
+    result.frames = (uint32_t)(kBytesPerRun / frame_size);
+    bool ok = false;
+    auto start = std::chrono::steady_clock::now();
+    std::thread receiver(framed ? FramedReceiver : LegacyReceiver, server, result.frames, &ok);
+    if (framed) {
+        FramedSender(client, payload, result.frames);
+    } else {
+        LegacySender(client, payload, result.frames);
+    }
+    receiver.join();
+    result.seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.ok = ok;
+    CloseSocket(client);
+    CloseSocket(server);
+    return result;
+}
+
+void Print(const char* name, uint32_t frame_size, const RunResult& result) {
+    if (!result.ok) {
+        printf("%-8s %9u  failed\n", name, frame_size);
+        return;
+    }
+    printf("%-8s %9u  %10.0f frames/s  %8.1f MB/s\n", name, frame_size,
+           result.frames / result.seconds,
+           (double)result.frames * frame_size / result.seconds / (1024 * 1024));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (!InitSocketLibrary()) {
+        printf("socket init failed\n");
+        return 1;
+    }
+    std::vector<uint32_t> sizes = {1024, 16 * 1024, 200 * 1024, 1000 * 1024, 4 * 1024 * 1024};
+    if (argc > 1) {
+        sizes.assign(1, (uint32_t)atoi(argv[1]));
+    }
+    printf("%-8s %9s\n", "mode", "frame");
+    for (uint32_t size : sizes) {
+        // The old path cannot carry frames that do not fit its fixed 1 MB buffers.
+        if (size + 4 <= kLegacyBufferSize) {
+            Print("legacy", size, Run(false, size));
+        }
+        Print("framed", size, Run(true, size));
+    }
+    return 0;
+}
\ No newline at end of file
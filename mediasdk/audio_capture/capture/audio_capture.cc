@@ -1,15 +1,22 @@
 ﻿#include "audio_capture.h"
+#include "pcm_ring_buffer.h"
 
 #include <Windows.h>
 
 #include <Audioclient.h>
 #include <Mmdeviceapi.h>
 
-#include <chrono>
 #include <cstring>
 
+#include "media_clock.h"
+
 namespace {
 
+// About two seconds of 48 kHz stereo float, in up to 256 WASAPI packets.
+const size_t kRingBytes = 1 << 20;
+const size_t kRingSpans = 256;
+const int64_t kDeliverWaitUs = 100 * 1000;
+
 template <class T>
 static inline void SafeRelease(T*& p) {
     if (p) {
@@ -56,11 +63,6 @@ static void FillDesiredPcm16(WAVEFORMATEXTENSIBLE& out, int sample_rate, int cha
     out.SubFormat = KSDATAFORMAT_SUBTYPE_PCM;
 }
 
-static uint64_t NowSteadyUs() {
-    using namespace std::chrono;
-    return (uint64_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
-}
-
 static std::wstring Utf8ToWide(const std::string& s) {
     if (s.empty()) return std::wstring();
     int len = MultiByteToWideChar(CP_UTF8, 0, s.c_str(), (int)s.size(), nullptr, 0);
@@ -72,40 +74,72 @@ static std::wstring Utf8ToWide(const std::string& s) {
 
 } // namespace
 
-AudioCapture::AudioCapture() = default;
+AudioCapture::AudioCapture() : ring_(new PcmRingBuffer(kRingBytes, kRingSpans)) {}
 
 AudioCapture::~AudioCapture() {
     Stop();
 }
 
 bool AudioCapture::Start(const std::string& device_id, PcmCallback cb) {
+    return StartCapture(device_id, std::move(cb), false);
+}
+
+bool AudioCapture::StartLoopback(const std::string& device_id, PcmCallback cb) {
+    return StartCapture(device_id, std::move(cb), true);
+}
+
+bool AudioCapture::StartCapture(const std::string& device_id, PcmCallback cb, bool loopback) {
     if (!cb) {
         return false;
     }
-    {
-        std::lock_guard<std::mutex> lock(cb_mu_);
-        cb_ = std::move(cb);
-    }
-    bool expected = false;
-    if (!running_.compare_exchange_strong(expected, true)) {
+    if (running_.load()) {
         return true; // already running
     }
-    thread_ = std::thread(&AudioCapture::CaptureThread, this, device_id);
+    // Reaps the threads of a session that ended on a device error. Neither thread runs
+    // after this, so the callback needs no lock.
+    Stop();
+    cb_ = std::move(cb);
+    ring_->Reset();
+    running_ = true;
+    delivering_ = true;
+    deliver_thread_ = std::thread(&AudioCapture::DeliverThread, this);
+    thread_ = std::thread(&AudioCapture::CaptureThread, this, device_id, loopback);
     return true;
 }
 
 void AudioCapture::Stop() {
-    if (!running_.exchange(false)) {
-        return;
-    }
+    running_ = false;
     if (thread_.joinable()) {
         thread_.join();
     }
-    std::lock_guard<std::mutex> lock(cb_mu_);
+    if (deliver_thread_.joinable()) {
+        delivering_ = false;
+        ring_->Wake();
+        deliver_thread_.join();
+    }
     cb_ = nullptr;
 }
 
-void AudioCapture::CaptureThread(std::string device_id) {
+uint64_t AudioCapture::GetOverruns() const {
+    return ring_->GetOverruns();
+}
+
+void AudioCapture::DeliverThread() {
+    AudioPcmFrame frame{};
+    frame.data.reserve(kRingBytes / kRingSpans * 2);
+    while (delivering_.load()) {
+        ring_->Wait(kDeliverWaitUs);
+        while (delivering_.load() && ring_->Read(frame.data, frame.timestamp_us)) {
+            frame.sample_rate = sample_rate_;
+            frame.channels = channels_;
+            frame.bits_per_sample = bits_per_sample_;
+            frame.format = format_;
+            cb_(frame);
+        }
+    }
+}
+
+void AudioCapture::CaptureThread(std::string device_id, bool loopback) {
     HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
     const bool com_inited = SUCCEEDED(hr);
 
@@ -151,7 +185,7 @@ void AudioCapture::CaptureThread(std::string device_id) {
     }
 
     if (device_id.empty()) {
-        hr = enumerator->GetDefaultAudioEndpoint(eCapture, eConsole, &device);
+        hr = enumerator->GetDefaultAudioEndpoint(loopback ? eRender : eCapture, eConsole, &device);
     } else {
         // device_id expected to be IMMDevice::GetId() string. Some callers may pass UTF-8.
         std::wstring wid = Utf8ToWide(device_id);
@@ -203,7 +237,12 @@ void AudioCapture::CaptureThread(std::string device_id) {
         return;
     }
 
-    const DWORD flags = AUDCLNT_STREAMFLAGS_EVENTCALLBACK;
+    DWORD flags = AUDCLNT_STREAMFLAGS_EVENTCALLBACK;
+    if (loopback) {
+        flags |= AUDCLNT_STREAMFLAGS_LOOPBACK;
+    }
+    // Before Windows 10 a loopback client never signals its event, so it is polled as well.
+    const DWORD wait_ms = loopback ? 10 : 2000;
     // 100ms buffer in shared mode.
     const REFERENCE_TIME buffer_duration = 1000000; // 100ms in 100-ns units
     hr = audio_client->Initialize(AUDCLNT_SHAREMODE_SHARED, flags, buffer_duration, 0, fmt, nullptr);
@@ -230,9 +269,6 @@ void AudioCapture::CaptureThread(std::string device_id) {
         return;
     }
 
-    const int sample_rate = (int)fmt->nSamplesPerSec;
-    const int channels = (int)fmt->nChannels;
-    const int bits = (int)fmt->wBitsPerSample;
     const int block_align = (int)fmt->nBlockAlign;
     AudioSampleFormat sample_fmt = AudioSampleFormat::kS16;
     if (IsF32Float(fmt)) {
@@ -243,11 +279,15 @@ void AudioCapture::CaptureThread(std::string device_id) {
         // best-effort: keep kS16 and provide raw bytes; encoder path may ignore.
         sample_fmt = AudioSampleFormat::kS16;
     }
+    sample_rate_ = (int)fmt->nSamplesPerSec;
+    channels_ = (int)fmt->nChannels;
+    bits_per_sample_ = (int)fmt->wBitsPerSample;
+    format_ = sample_fmt;
 
     while (running_.load()) {
-        DWORD wait = WaitForSingleObject(hEvent, 2000);
+        DWORD wait = WaitForSingleObject(hEvent, wait_ms);
         if (!running_.load()) break;
-        if (wait != WAIT_OBJECT_0) {
+        if (wait != WAIT_OBJECT_0 && !loopback) {
             continue;
         }
 
@@ -261,38 +301,29 @@ void AudioCapture::CaptureThread(std::string device_id) {
             BYTE* data = nullptr;
             UINT32 num_frames = 0;
             DWORD buf_flags = 0;
-            hr = capture_client->GetBuffer(&data, &num_frames, &buf_flags, nullptr, nullptr);
+            UINT64 qpc_position = 0;
+            hr = capture_client->GetBuffer(&data, &num_frames, &buf_flags, nullptr, &qpc_position);
             if (FAILED(hr)) {
                 running_.store(false);
                 break;
             }
 
-            AudioPcmFrame frame{};
-            frame.sample_rate = sample_rate;
-            frame.channels = channels;
-            frame.bits_per_sample = bits;
-            frame.format = sample_fmt;
-            frame.timestamp_us = NowSteadyUs();
-
+            // Copy into the ring and move on; a full ring drops the packet and counts it.
             const size_t bytes = (size_t)num_frames * (size_t)block_align;
-            frame.data.resize(bytes);
-            if (buf_flags & AUDCLNT_BUFFERFLAGS_SILENT) {
-                std::memset(frame.data.data(), 0, bytes);
-            } else if (data && bytes > 0) {
-                std::memcpy(frame.data.data(), data, bytes);
+            if (bytes > 0) {
+                const bool silent = (buf_flags & AUDCLNT_BUFFERFLAGS_SILENT) || !data;
+                // Stamp with the time the device recorded the first frame, in 100 ns units
+                // of the media clock. Without it, estimate that from the packet length.
+                uint64_t timestamp_us = qpc_position / 10;
+                if ((buf_flags & AUDCLNT_BUFFERFLAGS_TIMESTAMP_ERROR) || qpc_position == 0) {
+                    const uint64_t duration_us = (uint64_t)num_frames * 1000000 / sample_rate_;
+                    timestamp_us = MediaClockNowUs() - duration_us;
+                }
+                ring_->Write(silent ? nullptr : data, bytes, timestamp_us);
             }
 
             capture_client->ReleaseBuffer(num_frames);
 
-            PcmCallback cb;
-            {
-                std::lock_guard<std::mutex> lock(cb_mu_);
-                cb = cb_;
-            }
-            if (cb) {
-                cb(frame);
-            }
-
             hr = capture_client->GetNextPacketSize(&packet_len);
             if (FAILED(hr)) {
                 running_.store(false);
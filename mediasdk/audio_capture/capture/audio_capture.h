@@ -3,7 +3,7 @@
 #include <atomic>
 #include <cstdint>
 #include <functional>
-#include <mutex>
+#include <memory>
 #include <string>
 #include <thread>
 #include <vector>
@@ -23,10 +23,15 @@ struct AudioPcmFrame {
     // Interleaved PCM bytes.
     std::vector<uint8_t> data{};
 
-    // Timestamp in microseconds (steady clock).
+    // Capture time of the first sample in microseconds, on the media clock (media_clock.h).
     uint64_t timestamp_us{0};
 };
 
+class PcmRingBuffer;
+
+// Captures a WASAPI endpoint on a real-time thread that only copies packets into a
+// preallocated PcmRingBuffer. A second thread reads them back and runs the callback, so work
+// done there (resampling, mixing, encoding) can never make the capture thread miss a packet.
 class AudioCapture {
 public:
     using PcmCallback = std::function<void(const AudioPcmFrame&)>;
@@ -35,18 +40,35 @@ public:
     ~AudioCapture();
 
     // device_id: WASAPI device id (IMMDevice::GetId). If empty, uses default capture device.
+    // cb runs on the delivery thread, and the frame it gets is reused after it returns.
     bool Start(const std::string& device_id, PcmCallback cb);
+    // Captures what a render endpoint plays (system audio) instead. device_id: WASAPI render
+    // device id; if empty, uses the default render device. Nothing is delivered while the
+    // endpoint plays nothing.
+    bool StartLoopback(const std::string& device_id, PcmCallback cb);
     void Stop();
 
     bool IsRunning() const { return running_.load(); }
+    // Packets dropped because the callback fell more than the ring's length behind.
+    uint64_t GetOverruns() const;
 
 private:
-    void CaptureThread(std::string device_id);
+    bool StartCapture(const std::string& device_id, PcmCallback cb, bool loopback);
+    void CaptureThread(std::string device_id, bool loopback);
+    void DeliverThread();
 
 private:
     std::atomic<bool> running_{false};
+    std::atomic<bool> delivering_{false};
     std::thread thread_{};
+    std::thread deliver_thread_{};
+    std::unique_ptr<PcmRingBuffer> ring_{};
+
+    // Written by the capture thread before its first packet; the ring publishes them.
+    int sample_rate_{0};
+    int channels_{0};
+    int bits_per_sample_{0};
+    AudioSampleFormat format_{AudioSampleFormat::kS16};
 
-    std::mutex cb_mu_{};
     PcmCallback cb_{};
 };
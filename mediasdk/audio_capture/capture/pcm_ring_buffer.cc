@@ -0,0 +1,92 @@
+﻿#include "pcm_ring_buffer.h"
+
+#include <cstring>
+
+namespace {
+
+size_t RoundUpToPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+} // namespace
+
+PcmRingBuffer::PcmRingBuffer(size_t capacity, size_t max_spans)
+    : buffer_(RoundUpToPowerOfTwo(capacity)),
+      mask_(buffer_.size() - 1),
+      spans_(RoundUpToPowerOfTwo(max_spans)),
+      span_mask_(spans_.size() - 1) {}
+
+bool PcmRingBuffer::Write(const uint8_t* data, size_t size, uint64_t timestamp_us) {
+    const uint64_t write_pos = write_pos_.load(std::memory_order_relaxed);
+    const uint64_t span_write = span_write_.load(std::memory_order_relaxed);
+    if (size > buffer_.size() - (write_pos - read_pos_.load(std::memory_order_acquire)) ||
+        span_write - span_read_.load(std::memory_order_acquire) == spans_.size()) {
+        overruns_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    const size_t offset = (size_t)(write_pos & mask_);
+    const size_t first = size < buffer_.size() - offset ? size : buffer_.size() - offset;
+    if (data) {
+        memcpy(&buffer_[offset], data, first);
+        memcpy(&buffer_[0], data + first, size - first);
+    } else {
+        memset(&buffer_[offset], 0, first);
+        memset(&buffer_[0], 0, size - first);
+    }
+    Span& span = spans_[span_write & span_mask_];
+    span.timestamp_us = timestamp_us;
+    span.size = (uint32_t)size;
+    write_pos_.store(write_pos + size, std::memory_order_relaxed);
+    // Publishes the bytes and the span together.
+    span_write_.store(span_write + 1, std::memory_order_release);
+    ready_.signal();
+    return true;
+}
+
+bool PcmRingBuffer::Read(std::vector<uint8_t>& data, uint64_t& timestamp_us) {
+    const uint64_t span_read = span_read_.load(std::memory_order_relaxed);
+    if (span_read == span_write_.load(std::memory_order_acquire)) {
+        return false;
+    }
+    const Span& span = spans_[span_read & span_mask_];
+    const uint64_t read_pos = read_pos_.load(std::memory_order_relaxed);
+    const size_t offset = (size_t)(read_pos & mask_);
+    const size_t size = span.size;
+    const size_t first = size < buffer_.size() - offset ? size : buffer_.size() - offset;
+    data.resize(size);
+    memcpy(data.data(), &buffer_[offset], first);
+    memcpy(data.data() + first, &buffer_[0], size - first);
+    timestamp_us = span.timestamp_us;
+    read_pos_.store(read_pos + size, std::memory_order_release);
+    span_read_.store(span_read + 1, std::memory_order_release);
+    return true;
+}
+
+void PcmRingBuffer::Wait(int64_t timeout_us) {
+    ready_.wait(timeout_us);
+}
+
+void PcmRingBuffer::Wake() {
+    ready_.signal();
+}
+
+void PcmRingBuffer::Reset() {
+    write_pos_ = 0;
+    span_write_ = 0;
+    read_pos_ = 0;
+    span_read_ = 0;
+    while (ready_.tryWait()) {
+    }
+}
+
+size_t PcmRingBuffer::GetCapacity() const {
+    return buffer_.size();
+}
+
+uint64_t PcmRingBuffer::GetOverruns() const {
+    return overruns_.load(std::memory_order_relaxed);
+}
\ No newline at end of file
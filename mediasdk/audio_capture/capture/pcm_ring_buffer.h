@@ -0,0 +1,59 @@
+﻿#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "atomicops.h"
+
+// Fixed-size byte ring for PCM between exactly one producer thread and one consumer thread.
+// Every Write stores one span (the bytes of one capture packet and its timestamp) and Read
+// hands spans back in order. Nothing is allocated after construction and neither side ever
+// takes a lock, so the producer can be a real-time audio thread: when the consumer falls
+// behind, a span that does not fit is dropped and counted rather than waited for.
+class PcmRingBuffer {
+public:
+    // capacity is rounded up to a power of two bytes, max_spans to a power of two spans.
+    PcmRingBuffer(size_t capacity, size_t max_spans);
+
+    // Producer side. A null data writes size bytes of silence.
+    bool Write(const uint8_t* data, size_t size, uint64_t timestamp_us);
+
+    // Consumer side. Copies the oldest span into data, which keeps its capacity between
+    // calls, and returns false when the ring is empty.
+    bool Read(std::vector<uint8_t>& data, uint64_t& timestamp_us);
+    // Blocks until a span may be available or timeout_us passes.
+    void Wait(int64_t timeout_us);
+    // Wakes a consumer blocked in Wait, e.g. to shut it down.
+    void Wake();
+
+    // Only while neither side is running.
+    void Reset();
+
+    size_t GetCapacity() const;
+    uint64_t GetOverruns() const;
+
+private:
+    PcmRingBuffer(const PcmRingBuffer&) = delete;
+    PcmRingBuffer& operator=(const PcmRingBuffer&) = delete;
+
+    struct Span {
+        uint64_t timestamp_us;
+        uint32_t size;
+    };
+
+private:
+    std::vector<uint8_t> buffer_{};
+    size_t mask_{};
+    std::vector<Span> spans_{};
+    size_t span_mask_{};
+    moodycamel::spsc_sema::LightweightSemaphore ready_{};
+
+    // Positions only grow; the producer owns the write side and the consumer the read side.
+    // They sit on their own cache lines so the two threads do not invalidate each other.
+    alignas(64) std::atomic<uint64_t> write_pos_{0};
+    std::atomic<uint64_t> span_write_{0};
+    std::atomic<uint64_t> overruns_{0};
+    alignas(64) std::atomic<uint64_t> read_pos_{0};
+    std::atomic<uint64_t> span_read_{0};
+};
\ No newline at end of file
@@ -0,0 +1,215 @@
+﻿#include "audio_mix_kernels.h"
+
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define AUDIO_MIX_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC compiles intrinsics of any instruction set; GCC and Clang need the target per function.
+#if defined(AUDIO_MIX_X86) && !defined(_MSC_VER)
+#define AUDIO_MIX_TARGET_AVX __attribute__((target("avx")))
+#define AUDIO_MIX_TARGET_SSE __attribute__((target("sse2")))
+#else
+#define AUDIO_MIX_TARGET_AVX
+#define AUDIO_MIX_TARGET_SSE
+#endif
+
+namespace {
+
+using MixAddFunction = void (*)(float*, const float*, float, size_t);
+using SoftClipFunction = void (*)(float*, size_t);
+
+const float kKneeRange = 1.0f - kAudioSoftClipKnee;
+
+inline float SoftClipSample(float x) {
+    const float a = std::fabs(x);
+    if (a <= kAudioSoftClipKnee) {
+        return x;
+    }
+    // e / (1 + e) starts with slope 1 at the knee and tends to 1, so the curve is smooth there
+    // and never reaches full scale.
+    const float e = (a - kAudioSoftClipKnee) / kKneeRange;
+    const float y = kAudioSoftClipKnee + kKneeRange * e / (1.0f + e);
+    return x < 0 ? -y : y;
+}
+
+void MixAddScalar(float* dst, const float* src, float gain, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] += src[i] * gain;
+    }
+}
+
+void SoftClipScalar(float* data, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        data[i] = SoftClipSample(data[i]);
+    }
+}
+
+#ifdef AUDIO_MIX_X86
+
+AUDIO_MIX_TARGET_SSE void MixAddSse(float* dst, const float* src, float gain, size_t count) {
+    const __m128 g = _mm_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128 a = _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), g));
+        __m128 b =
+            _mm_add_ps(_mm_loadu_ps(dst + i + 4), _mm_mul_ps(_mm_loadu_ps(src + i + 4), g));
+        _mm_storeu_ps(dst + i, a);
+        _mm_storeu_ps(dst + i + 4, b);
+    }
+    MixAddScalar(dst + i, src + i, gain, count - i);
+}
+
+AUDIO_MIX_TARGET_SSE void SoftClipSse(float* data, size_t count) {
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    const __m128 knee = _mm_set1_ps(kAudioSoftClipKnee);
+    const __m128 range = _mm_set1_ps(kKneeRange);
+    const __m128 inv_range = _mm_set1_ps(1.0f / kKneeRange);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 zero = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 x = _mm_loadu_ps(data + i);
+        const __m128 sign = _mm_and_ps(x, sign_mask);
+        const __m128 a = _mm_andnot_ps(sign_mask, x);
+        const __m128 e = _mm_mul_ps(_mm_max_ps(_mm_sub_ps(a, knee), zero), inv_range);
+        const __m128 bend = _mm_div_ps(_mm_mul_ps(range, e), _mm_add_ps(one, e));
+        const __m128 y = _mm_add_ps(_mm_min_ps(a, knee), bend);
+        _mm_storeu_ps(data + i, _mm_or_ps(y, sign));
+    }
+    SoftClipScalar(data + i, count - i);
+}
+
+AUDIO_MIX_TARGET_AVX void MixAddAvx(float* dst, const float* src, float gain, size_t count) {
+    const __m256 g = _mm256_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256 a =
+            _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_mul_ps(_mm256_loadu_ps(src + i), g));
+        __m256 b = _mm256_add_ps(_mm256_loadu_ps(dst + i + 8),
+                                 _mm256_mul_ps(_mm256_loadu_ps(src + i + 8), g));
+        _mm256_storeu_ps(dst + i, a);
+        _mm256_storeu_ps(dst + i + 8, b);
+    }
+    MixAddScalar(dst + i, src + i, gain, count - i);
+}
+
+AUDIO_MIX_TARGET_AVX void SoftClipAvx(float* data, size_t count) {
+    const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+    const __m256 knee = _mm256_set1_ps(kAudioSoftClipKnee);
+    const __m256 range = _mm256_set1_ps(kKneeRange);
+    const __m256 inv_range = _mm256_set1_ps(1.0f / kKneeRange);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 x = _mm256_loadu_ps(data + i);
+        const __m256 sign = _mm256_and_ps(x, sign_mask);
+        const __m256 a = _mm256_andnot_ps(sign_mask, x);
+        const __m256 e = _mm256_mul_ps(_mm256_max_ps(_mm256_sub_ps(a, knee), zero), inv_range);
+        const __m256 bend = _mm256_div_ps(_mm256_mul_ps(range, e), _mm256_add_ps(one, e));
+        const __m256 y = _mm256_add_ps(_mm256_min_ps(a, knee), bend);
+        _mm256_storeu_ps(data + i, _mm256_or_ps(y, sign));
+    }
+    SoftClipScalar(data + i, count - i);
+}
+
+bool CpuHasAvx() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    // The OS must save the YMM registers on context switches too.
+    return osxsave && avx && (_xgetbv(0) & 6) == 6;
+#else
+    return __builtin_cpu_supports("avx") != 0;
+#endif
+}
+
+#endif // AUDIO_MIX_X86
+
+bool CpuHasKernel(AudioMixKernel kernel) {
+    switch (kernel) {
+    case kAudioMixKernelScalar:
+        return true;
+#ifdef AUDIO_MIX_X86
+    case kAudioMixKernelSse:
+        // Every x64 CPU has SSE2, and so has anything that runs Windows 8 or later.
+        return true;
+    case kAudioMixKernelAvx:
+        return CpuHasAvx();
+#endif
+    default:
+        return false;
+    }
+}
+
+struct KernelTable {
+    KernelTable() {
+        kernel = kAudioMixKernelScalar;
+        if (CpuHasKernel(kAudioMixKernelAvx)) {
+            Select(kAudioMixKernelAvx);
+        } else if (CpuHasKernel(kAudioMixKernelSse)) {
+            Select(kAudioMixKernelSse);
+        } else {
+            Select(kAudioMixKernelScalar);
+        }
+    }
+
+    void Select(AudioMixKernel selected) {
+        kernel = selected;
+        switch (selected) {
+#ifdef AUDIO_MIX_X86
+        case kAudioMixKernelAvx:
+            mix_add = MixAddAvx;
+            soft_clip = SoftClipAvx;
+            break;
+        case kAudioMixKernelSse:
+            mix_add = MixAddSse;
+            soft_clip = SoftClipSse;
+            break;
+#endif
+        default:
+            mix_add = MixAddScalar;
+            soft_clip = SoftClipScalar;
+            break;
+        }
+    }
+
+    AudioMixKernel kernel;
+    MixAddFunction mix_add;
+    SoftClipFunction soft_clip;
+};
+
+KernelTable& Kernels() {
+    static KernelTable table;
+    return table;
+}
+
+} // namespace
+
+void AudioMixAdd(float* dst, const float* src, float gain, size_t count) {
+    Kernels().mix_add(dst, src, gain, count);
+}
+
+void AudioSoftClip(float* data, size_t count) {
+    Kernels().soft_clip(data, count);
+}
+
+bool SelectAudioMixKernel(AudioMixKernel kernel) {
+    if (!CpuHasKernel(kernel)) {
+        return false;
+    }
+    Kernels().Select(kernel);
+    return true;
+}
+
+AudioMixKernel GetAudioMixKernel() {
+    return Kernels().kernel;
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+﻿#pragma once
+#include <cstddef>
+
+enum AudioMixKernel {
+    kAudioMixKernelScalar,
+    kAudioMixKernelSse,
+    kAudioMixKernelAvx,
+};
+
+// Float sample kernels of the mixer. The widest set the CPU supports is picked on first use:
+// AVX, then SSE, then plain C++ on other architectures.
+
+// dst[i] += src[i] * gain
+void AudioMixAdd(float* dst, const float* src, float gain, size_t count);
+
+// Passes samples up to kAudioSoftClipKnee through unchanged and bends larger ones smoothly
+// towards full scale, so overloaded mixes saturate instead of wrapping or clipping hard.
+void AudioSoftClip(float* data, size_t count);
+
+const float kAudioSoftClipKnee = 0.8f;
+
+// For benchmarks: forces a kernel set. Returns false if the CPU lacks it.
+bool SelectAudioMixKernel(AudioMixKernel kernel);
+AudioMixKernel GetAudioMixKernel();
\ No newline at end of file
@@ -0,0 +1,252 @@
+﻿#include "audio_mixer.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "audio_mix_kernels.h"
+
+namespace {
+
+const int64_t kBlockMs = 10;
+const uint32_t kDefaultLatencyMs = 60;
+const int64_t kResyncToleranceMs = 20;
+
+} // namespace
+
+AudioMixer::AudioMixer(int sample_rate, int channels)
+    : sample_rate_(sample_rate),
+      channels_(channels == 1 ? 1 : 2),
+      block_frames_(sample_rate * kBlockMs / 1000) {
+    latency_frames_ = (int64_t)sample_rate_ * kDefaultLatencyMs / 1000;
+    tolerance_frames_ = (int64_t)sample_rate_ * kResyncToleranceMs / 1000;
+    mix_.resize((size_t)(block_frames_ * channels_));
+    output_.sample_rate = sample_rate_;
+    output_.channels = channels_;
+    output_.bits_per_sample = 32;
+    output_.format = AudioSampleFormat::kF32;
+    output_.data.resize(mix_.size() * sizeof(float));
+}
+
+AudioMixer::~AudioMixer() {}
+
+void AudioMixer::RegisterMixCallback(MixCallback callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    callback_ = callback;
+}
+
+void AudioMixer::SetMaxLatency(uint32_t latency_ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    latency_frames_ = (int64_t)sample_rate_ * latency_ms / 1000;
+}
+
+void AudioMixer::SetDriftCorrection(bool enable) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    drift_correction_ = enable;
+}
+
+int AudioMixer::AddSource(float gain) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::unique_ptr<Source> source(new Source());
+    source->gain = gain;
+    const int id = next_source_id_++;
+    sources_[id] = std::move(source);
+    return id;
+}
+
+void AudioMixer::RemoveSource(int source_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sources_.erase(source_id);
+    // The blocks that only waited for it can go now.
+    MixReadyBlocks();
+}
+
+void AudioMixer::SetSourceGain(int source_id, float gain) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = sources_.find(source_id);
+    if (it != sources_.end()) {
+        it->second->gain = gain;
+    }
+}
+
+bool AudioMixer::PushPcm(int source_id, const AudioPcmFrame& pcm) {
+    if (pcm.sample_rate <= 0 || pcm.channels <= 0 || pcm.data.empty()) {
+        return false;
+    }
+    if (!(pcm.format == AudioSampleFormat::kS16 && pcm.bits_per_sample == 16) &&
+        !(pcm.format == AudioSampleFormat::kF32 && pcm.bits_per_sample == 32)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = sources_.find(source_id);
+    if (it == sources_.end()) {
+        return false;
+    }
+    Source& source = *it->second;
+    if (!has_base_) {
+        base_us_ = pcm.timestamp_us;
+        has_base_ = true;
+    }
+    if (!source.resampler.IsConfigured(pcm.sample_rate, pcm.channels)) {
+        source.resampler.Configure(pcm.sample_rate, pcm.channels, sample_rate_, channels_);
+        source.drift.Reset();
+        source.placed = false;
+    }
+    source.packet.clear();
+    const int64_t frames = (int64_t)source.resampler.Process(pcm, source.packet);
+    const int64_t expected =
+        ((int64_t)pcm.timestamp_us - (int64_t)base_us_) * sample_rate_ / 1000000;
+
+    int64_t skip = 0;
+    if (!source.placed) {
+        source.fifo.clear();
+        source.read = 0;
+        source.start = expected;
+        source.placed = true;
+    } else {
+        const int64_t end = source.End(channels_);
+        const int64_t drift = expected - end;
+        if (drift > tolerance_frames_) {
+            // The source paused, e.g. loopback while nothing plays. The gap is silence; once
+            // the mix has passed the end of what the source had, it simply starts over.
+            if (end <= mix_position_) {
+                source.fifo.clear();
+                source.read = 0;
+                source.start = expected;
+            } else {
+                source.fifo.resize(source.fifo.size() + (size_t)(drift * channels_), 0.0f);
+            }
+            ++stats_.resyncs;
+        } else if (drift < -tolerance_frames_) {
+            // More samples than time went by: drop the surplus.
+            skip = -drift < frames ? -drift : frames;
+            ++stats_.resyncs;
+        } else if (drift_correction_) {
+            // Within the tolerance the difference is the device clock running off the media
+            // clock. Stretch the next packets until the sample count follows the timestamps.
+            const double ratio = source.drift.Update((double)drift / sample_rate_,
+                                                     (double)frames / sample_rate_);
+            source.resampler.SetRateAdjust(ratio);
+        }
+    }
+    source.fifo.insert(source.fifo.end(), source.packet.begin() + (size_t)(skip * channels_),
+                       source.packet.end());
+    MixReadyBlocks();
+    return true;
+}
+
+void AudioMixer::Flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (true) {
+        bool pending = false;
+        for (auto& entry : sources_) {
+            const Source& source = *entry.second;
+            pending = pending || (source.placed && source.End(channels_) > mix_position_);
+        }
+        if (!pending) {
+            break;
+        }
+        MixBlock();
+    }
+}
+
+void AudioMixer::Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& entry : sources_) {
+        Source& source = *entry.second;
+        source.resampler.Reset();
+        source.fifo.clear();
+        source.read = 0;
+        source.start = 0;
+        source.placed = false;
+    }
+    has_base_ = false;
+    base_us_ = 0;
+    mix_position_ = 0;
+}
+
+int AudioMixer::GetSampleRate() const {
+    return sample_rate_;
+}
+
+int AudioMixer::GetChannels() const {
+    return channels_;
+}
+
+AudioMixerStats AudioMixer::GetStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+double AudioMixer::GetSourceDriftPpm(int source_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = sources_.find(source_id);
+    return it != sources_.end() ? it->second->drift.GetDriftPpm() : 0.0;
+}
+
+void AudioMixer::MixReadyBlocks() {
+    while (true) {
+        const int64_t block_end = mix_position_ + block_frames_;
+        bool all_ready = !sources_.empty();
+        bool any_placed = false;
+        int64_t horizon = 0;
+        for (auto& entry : sources_) {
+            const Source& source = *entry.second;
+            if (!source.placed) {
+                all_ready = false;
+                continue;
+            }
+            const int64_t end = source.End(channels_);
+            horizon = any_placed && horizon > end ? horizon : end;
+            any_placed = true;
+            all_ready = all_ready && end >= block_end;
+        }
+        if (!any_placed || (!all_ready && horizon < block_end + latency_frames_)) {
+            return;
+        }
+        MixBlock();
+    }
+}
+
+void AudioMixer::MixBlock() {
+    const int64_t block_end = mix_position_ + block_frames_;
+    std::fill(mix_.begin(), mix_.end(), 0.0f);
+    for (auto& entry : sources_) {
+        Source& source = *entry.second;
+        if (!source.placed) {
+            continue;
+        }
+        // Samples that arrived too late for their block are skipped.
+        if (source.start < mix_position_) {
+            const int64_t late = mix_position_ - source.start;
+            const int64_t available = source.Available(channels_);
+            const int64_t dropped = late < available ? late : available;
+            source.read += (size_t)dropped;
+            source.start += late;
+        }
+        const int64_t available = source.Available(channels_);
+        if (available > 0 && source.start < block_end) {
+            const int64_t offset = source.start - mix_position_;
+            const int64_t count =
+                available < block_end - source.start ? available : block_end - source.start;
+            AudioMixAdd(&mix_[(size_t)(offset * channels_)],
+                        &source.fifo[source.read * channels_], source.gain,
+                        (size_t)(count * channels_));
+            source.read += (size_t)count;
+            source.start += count;
+        }
+        // Reclaim the mixed front once it outweighs what is left, so the fifo stops growing.
+        if (source.read > 0 && source.read * 2 >= source.fifo.size() / channels_) {
+            source.fifo.erase(source.fifo.begin(), source.fifo.begin() + source.read * channels_);
+            source.read = 0;
+        }
+    }
+    AudioSoftClip(mix_.data(), mix_.size());
+
+    memcpy(output_.data.data(), mix_.data(), mix_.size() * sizeof(float));
+    output_.timestamp_us = base_us_ + (uint64_t)(mix_position_ * 1000000 / sample_rate_);
+    mix_position_ = block_end;
+    ++stats_.blocks_mixed;
+    if (callback_) {
+        callback_(output_);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,101 @@
+﻿#pragma once
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "audio_resampler.h"
+#include "av_sync/clock_drift_corrector.h"
+#include "capture/audio_capture.h"
+
+struct AudioMixerStats {
+    uint64_t blocks_mixed;
+    uint64_t resyncs; // a source's timestamps jumped away from its sample count
+};
+
+// Mixes several PCM sources, e.g. a microphone and the system audio loopback, into one
+// stream of fixed 10 ms float blocks. Each source has its own cached resampler to the mixer
+// format and is placed on a common timeline by the timestamp_us of its packets, so every
+// source must stamp with the same clock, as AudioCapture does. The slow drift of a device
+// clock against the timestamps is corrected by stretching that source's samples slightly
+// (ClockDriftCorrector), so the output stays on the media clock however long it runs. A
+// source that pauses leaves silence; one whose timestamps jump more than 20 ms from its
+// sample count is realigned.
+//
+// A block is mixed once every source has delivered it, or once the freshest source is the
+// maximum latency past it, so a silent source never holds the mix back for longer than that.
+// Sources may push from different threads; the callback runs on whichever thread completed
+// the block, with the mixer locked, and must not call back into it.
+class AudioMixer {
+public:
+    using MixCallback = std::function<void(const AudioPcmFrame& frame)>;
+
+public:
+    explicit AudioMixer(int sample_rate = 48000, int channels = 2);
+    ~AudioMixer();
+
+    void RegisterMixCallback(MixCallback callback);
+    void SetMaxLatency(uint32_t latency_ms);
+    // On by default. Off, only jumps past the 20 ms tolerance realign a drifting source.
+    void SetDriftCorrection(bool enable);
+
+    int AddSource(float gain = 1.0f);
+    void RemoveSource(int source_id);
+    void SetSourceGain(int source_id, float gain);
+
+    bool PushPcm(int source_id, const AudioPcmFrame& pcm);
+    // Mixes everything still buffered, padding the last block with silence.
+    void Flush();
+    // Drops everything buffered and starts a new timeline with the next packet. Sources and
+    // their gains stay.
+    void Reset();
+
+    int GetSampleRate() const;
+    int GetChannels() const;
+    AudioMixerStats GetStats();
+    // How fast the source's device clock runs against the media clock, in ppm.
+    double GetSourceDriftPpm(int source_id);
+
+private:
+    AudioMixer(const AudioMixer&) = delete;
+    AudioMixer& operator=(const AudioMixer&) = delete;
+
+    struct Source {
+        AudioResampler resampler;
+        ClockDriftCorrector drift;
+        std::vector<float> fifo;   // interleaved mixer-format samples
+        std::vector<float> packet; // resampler output of the packet being pushed
+        size_t read{};             // frames already mixed from the front of fifo
+        int64_t start{};           // timeline frame of fifo frame read
+        bool placed{};
+        float gain{1.0f};
+
+        int64_t Available(int channels) const { return (int64_t)(fifo.size() / channels - read); }
+        int64_t End(int channels) const { return start + Available(channels); }
+    };
+
+    void MixReadyBlocks();
+    void MixBlock();
+
+private:
+    const int sample_rate_;
+    const int channels_;
+    const int64_t block_frames_;
+    int64_t latency_frames_{};
+    int64_t tolerance_frames_{};
+    bool drift_correction_{true};
+
+    std::mutex mutex_{};
+    MixCallback callback_{};
+    std::map<int, std::unique_ptr<Source>> sources_{};
+    int next_source_id_{1};
+
+    bool has_base_{};
+    uint64_t base_us_{};  // timestamp of timeline frame 0
+    int64_t mix_position_{}; // first timeline frame of the next block
+    std::vector<float> mix_{};
+    AudioPcmFrame output_{};
+    AudioMixerStats stats_{};
+};
\ No newline at end of file
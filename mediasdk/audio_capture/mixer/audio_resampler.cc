@@ -0,0 +1,190 @@
+﻿#include "audio_resampler.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+const int kTaps = 16;
+const int kHalfTaps = kTaps / 2;
+const int kPhaseBits = 9;
+const int kPhases = 1 << kPhaseBits;
+const double kPi = 3.14159265358979323846;
+
+double Sinc(double x) {
+    return x == 0 ? 1.0 : sin(kPi * x) / (kPi * x);
+}
+
+// Blackman window over [-kHalfTaps, kHalfTaps].
+double Window(double x) {
+    const double t = (x + kHalfTaps) / kTaps;
+    if (t <= 0 || t >= 1) {
+        return 0;
+    }
+    return 0.42 - 0.5 * cos(2 * kPi * t) + 0.08 * cos(4 * kPi * t);
+}
+
+float ReadSample(const uint8_t* data, AudioSampleFormat format, size_t index) {
+    if (format == AudioSampleFormat::kF32) {
+        float value;
+        memcpy(&value, data + index * 4, 4);
+        return value;
+    }
+    int16_t value;
+    memcpy(&value, data + index * 2, 2);
+    return value * (1.0f / 32768.0f);
+}
+
+} // namespace
+
+AudioResampler::AudioResampler() {}
+
+void AudioResampler::Configure(int in_rate, int in_channels, int out_rate, int out_channels) {
+    if (in_rate == in_rate_ && in_channels == in_channels_ && out_rate == out_rate_ &&
+        out_channels == out_channels_) {
+        return;
+    }
+    in_rate_ = in_rate;
+    in_channels_ = in_channels;
+    out_rate_ = out_rate;
+    out_channels_ = out_channels;
+    passthrough_ = in_rate == out_rate;
+    ratio_ = 1.0;
+    nominal_step_ = ((uint64_t)in_rate << 32) / (uint64_t)out_rate;
+    step_ = nominal_step_;
+    filter_.clear();
+    if (!passthrough_) {
+        BuildFilter();
+    }
+    Reset();
+}
+
+void AudioResampler::SetRateAdjust(double ratio) {
+    if (ratio <= 0 || ratio == ratio_ || nominal_step_ == 0) {
+        return;
+    }
+    ratio_ = ratio;
+    step_ = (uint64_t)((double)nominal_step_ / ratio + 0.5);
+    if (passthrough_) {
+        // input_ already holds the history the filter reaches back to.
+        passthrough_ = false;
+        BuildFilter();
+        position_ = (uint64_t)(kHalfTaps - 1) << 32;
+    }
+}
+
+bool AudioResampler::IsConfigured(int in_rate, int in_channels) const {
+    return in_rate == in_rate_ && in_channels == in_channels_;
+}
+
+void AudioResampler::Reset() {
+    // Silence in front of the first sample, so the filter can centre on it.
+    input_.assign((size_t)(kHalfTaps - 1) * out_channels_, 0.0f);
+    position_ = (uint64_t)(kHalfTaps - 1) << 32;
+}
+
+void AudioResampler::BuildFilter() {
+    // Downsampling moves the cutoff below the new Nyquist frequency.
+    const double cutoff = out_rate_ < in_rate_ ? (double)out_rate_ / in_rate_ : 1.0;
+    filter_.resize((size_t)kPhases * kTaps);
+    for (int phase = 0; phase < kPhases; ++phase) {
+        const double frac = (double)phase / kPhases;
+        double sum = 0;
+        float* row = &filter_[(size_t)phase * kTaps];
+        for (int k = 0; k < kTaps; ++k) {
+            // Tap k weighs input frame floor(position) - kHalfTaps + 1 + k.
+            const double x = k - (kHalfTaps - 1) - frac;
+            const double h = cutoff * Sinc(cutoff * x) * Window(x);
+            row[k] = (float)h;
+            sum += h;
+        }
+        // Unity gain at DC for every phase.
+        for (int k = 0; k < kTaps; ++k) {
+            row[k] = (float)(row[k] / sum);
+        }
+    }
+}
+
+void AudioResampler::AppendInput(const AudioPcmFrame& pcm) {
+    const int bytes_per_sample = pcm.format == AudioSampleFormat::kF32 ? 4 : 2;
+    const size_t frames = pcm.data.size() / ((size_t)bytes_per_sample * in_channels_);
+    const size_t offset = input_.size();
+    input_.resize(offset + frames * out_channels_);
+    float* out = &input_[offset];
+    const uint8_t* data = pcm.data.data();
+    for (size_t i = 0; i < frames; ++i) {
+        const size_t base = i * in_channels_;
+        const float left = ReadSample(data, pcm.format, base);
+        // Anything past the first two channels is left out.
+        const float right = in_channels_ > 1 ? ReadSample(data, pcm.format, base + 1) : left;
+        if (out_channels_ == 1) {
+            out[i] = in_channels_ > 1 ? 0.5f * (left + right) : left;
+        } else {
+            out[2 * i] = left;
+            out[2 * i + 1] = right;
+        }
+    }
+}
+
+size_t AudioResampler::Process(const AudioPcmFrame& pcm, std::vector<float>& out) {
+    if (out_channels_ <= 0 || in_channels_ <= 0) {
+        return 0;
+    }
+    if (passthrough_) {
+        std::vector<float> history;
+        history.swap(input_);
+        const size_t before = out.size();
+        input_.swap(out);
+        AppendInput(pcm);
+        input_.swap(out);
+        // Slide the history along by what was just passed on.
+        const size_t added = out.size() - before;
+        const size_t keep = history.size();
+        if (added >= keep) {
+            history.assign(out.end() - keep, out.end());
+        } else {
+            history.erase(history.begin(), history.begin() + added);
+            history.insert(history.end(), out.end() - added, out.end());
+        }
+        input_.swap(history);
+        return added / out_channels_;
+    }
+
+    AppendInput(pcm);
+    const size_t frames = input_.size() / out_channels_;
+    const size_t before = out.size();
+    while (true) {
+        const size_t index = (size_t)(position_ >> 32);
+        if (index + kHalfTaps >= frames) {
+            break;
+        }
+        const size_t phase = (size_t)((position_ >> (32 - kPhaseBits)) & (kPhases - 1));
+        const float* taps = &filter_[phase * kTaps];
+        const float* in = &input_[(index + 1 - kHalfTaps) * out_channels_];
+        if (out_channels_ == 1) {
+            float sum = 0;
+            for (int k = 0; k < kTaps; ++k) {
+                sum += taps[k] * in[k];
+            }
+            out.push_back(sum);
+        } else {
+            float left = 0;
+            float right = 0;
+            for (int k = 0; k < kTaps; ++k) {
+                left += taps[k] * in[2 * k];
+                right += taps[k] * in[2 * k + 1];
+            }
+            out.push_back(left);
+            out.push_back(right);
+        }
+        position_ += step_;
+    }
+
+    // Keep the frames the next output still reaches back to.
+    const size_t first_needed = (size_t)(position_ >> 32) + 1 - kHalfTaps;
+    if (first_needed > 0) {
+        input_.erase(input_.begin(), input_.begin() + first_needed * out_channels_);
+        position_ -= (uint64_t)first_needed << 32;
+    }
+    return (out.size() - before) / out_channels_;
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+﻿#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "capture/audio_capture.h"
+
+// Converts one PCM stream, S16 or F32 interleaved at any rate, to interleaved float at a
+// fixed rate with one or two channels. Rate conversion is a 16-tap windowed-sinc polyphase
+// filter with 512 phases, which keeps images and aliases about 60 dB down; equal rates skip
+// it until a rate adjustment is set. The filter state carries over between calls, so
+// consecutive packets join seamlessly; output frame n lines up with input frame
+// n * in_rate / out_rate, and the last few input frames wait for the next call.
+class AudioResampler {
+public:
+    AudioResampler();
+
+    // Resets the filter and the rate adjustment whenever the format changes.
+    void Configure(int in_rate, int in_channels, int out_rate, int out_channels);
+    // Stretches the output by ratio from the next call on: 1.0001 makes 0.01% more frames.
+    // Used to follow a device clock that runs off its nominal rate.
+    void SetRateAdjust(double ratio);
+    bool IsConfigured(int in_rate, int in_channels) const;
+    void Reset();
+
+    // Appends the converted samples to out and returns how many frames it added.
+    size_t Process(const AudioPcmFrame& pcm, std::vector<float>& out);
+
+private:
+    // Appends pcm to input_ with the output channel layout.
+    void AppendInput(const AudioPcmFrame& pcm);
+    void BuildFilter();
+
+private:
+    int in_rate_{};
+    int in_channels_{};
+    int out_rate_{};
+    int out_channels_{};
+    bool passthrough_{};
+
+    std::vector<float> filter_{}; // kPhases rows of kTaps coefficients
+    double ratio_{1.0};
+    uint64_t nominal_step_{};     // input frames per output frame, 32.32 fixed point
+    uint64_t step_{};             // nominal_step_ with the rate adjustment applied
+    uint64_t position_{};         // next output frame in input_, 32.32 fixed point
+    // Interleaved, out_channels_ wide. In passthrough it keeps the last frames passed on, so
+    // filtering can take over without a seam.
+    std::vector<float> input_{};
+};
\ No newline at end of file
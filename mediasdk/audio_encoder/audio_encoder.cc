@@ -0,0 +1,108 @@
+﻿#include "audio_encoder.h"
+
+namespace {
+
+// WASAPI delivers 10 ms packets, so this holds a third of a second of capture.
+const size_t kPcmPoolSize = 32;
+// 10 ms of 48 kHz stereo float, rounded up.
+const size_t kPcmReserveBytes = 4096;
+const int64_t kQueueWaitUs = 20 * 1000;
+
+} // namespace
+
+AudioEncoder::AudioEncoder()
+    : pool_(kPcmPoolSize), pcm_queue_(kPcmPoolSize), free_queue_(kPcmPoolSize) {
+    for (AudioPcmFrame& frame : pool_) {
+        frame.data.reserve(kPcmReserveBytes);
+        free_queue_.enqueue(&frame);
+    }
+}
+
+AudioEncoder::~AudioEncoder() {
+
+}
+
+void AudioEncoder::RegisterEncodeCallback(EncodeFrameCallback callback) {
+    callback_ = callback;
+}
+
+void AudioEncoder::SetBitrate(uint32_t bitrate) {
+    bitrate_ = bitrate;
+}
+
+bool AudioEncoder::Start() {
+    if (running_.load()) {
+        return true;
+    }
+    // A frame pushed while the last Stop was joining never reached the encoder thread.
+    AudioPcmFrame* frame = nullptr;
+    while (pcm_queue_.try_dequeue(frame)) {
+        free_queue_.enqueue(frame);
+    }
+    running_ = true;
+    thread_ = std::thread(&AudioEncoder::EncodeThread, this);
+    return true;
+}
+
+void AudioEncoder::Stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+bool AudioEncoder::PushPcm(const AudioPcmFrame& pcm) {
+    if (!running_.load() || pcm.data.empty()) {
+        return false;
+    }
+    AudioPcmFrame* frame = nullptr;
+    if (!free_queue_.try_dequeue(frame)) {
+        ++frames_dropped_;
+        return false;
+    }
+    frame->sample_rate = pcm.sample_rate;
+    frame->channels = pcm.channels;
+    frame->bits_per_sample = pcm.bits_per_sample;
+    frame->format = pcm.format;
+    frame->timestamp_us = pcm.timestamp_us;
+    // Keeps the capacity of earlier frames, so this only allocates while the pool warms up.
+    frame->data.assign(pcm.data.begin(), pcm.data.end());
+    // Cannot fail: the queue holds as many entries as there are frames.
+    pcm_queue_.try_enqueue(frame);
+    ++frames_pushed_;
+    return true;
+}
+
+AudioEncoderStats AudioEncoder::GetStats() const {
+    AudioEncoderStats stats;
+    stats.frames_pushed = frames_pushed_.load();
+    stats.frames_dropped = frames_dropped_.load();
+    stats.packets_encoded = packets_encoded_.load();
+    stats.bytes_encoded = bytes_encoded_.load();
+    return stats;
+}
+
+void AudioEncoder::OnEncodedPacket(const uint8_t* data, uint32_t len, uint64_t pts_us) {
+    ++packets_encoded_;
+    bytes_encoded_ += len;
+    if (callback_) {
+        callback_(data, len, pts_us);
+    }
+}
+
+void AudioEncoder::EncodeThread() {
+    AudioPcmFrame* frame = nullptr;
+    while (true) {
+        if (!pcm_queue_.wait_dequeue_timed(frame, kQueueWaitUs)) {
+            if (!running_.load()) {
+                break;
+            }
+            continue;
+        }
+        EncodePcm(*frame);
+        free_queue_.enqueue(frame);
+    }
+    Flush();
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+﻿#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "capture/audio_capture.h"
+#include "readerwriterqueue.h"
+
+struct AudioEncoderStats {
+    uint64_t frames_pushed;  // PCM frames accepted by PushPcm
+    uint64_t frames_dropped; // PCM frames refused because every pooled frame was in flight
+    uint64_t packets_encoded;
+    uint64_t bytes_encoded;
+};
+
+// Base class of the audio encoders. PCM handed to PushPcm is copied into a frame from a fixed
+// pool and passed to the encoder's own thread over a lock-free single producer, single
+// consumer queue; the frame goes back to the producer over a second one once encoded. After
+// the pool has warmed up a PCM frame costs no heap allocation on either side, and a slow
+// encoder never blocks the capture thread: when the pool runs dry the frame is dropped and
+// counted instead. PushPcm must always be called from the same thread. Implementations call
+// Stop in their destructor, while EncodePcm and Flush can still run.
+class AudioEncoder {
+public:
+    // One encoded access unit, without container framing. pts_us is the timestamp of the
+    // first PCM frame plus the duration of the samples encoded before this packet, so it
+    // stays on the capture clock and advances by exactly one frame per packet.
+    using EncodeFrameCallback =
+        std::function<void(const uint8_t* data, uint32_t len, uint64_t pts_us)>;
+
+public:
+    AudioEncoder();
+    virtual ~AudioEncoder();
+
+    void RegisterEncodeCallback(EncodeFrameCallback callback);
+    void SetBitrate(uint32_t bitrate);
+
+    // Starts the encoder thread. The codec itself is opened on the first PCM frame, whose
+    // sample rate and channel count the stream keeps.
+    bool Start();
+    // Encodes what is still queued, drains the codec and joins the encoder thread.
+    void Stop();
+
+    bool PushPcm(const AudioPcmFrame& pcm);
+
+    AudioEncoderStats GetStats() const;
+
+protected:
+    // Both run on the encoder thread.
+    virtual bool EncodePcm(const AudioPcmFrame& pcm) = 0;
+    virtual void Flush() = 0;
+
+    // Called by the implementations for every packet they produce.
+    void OnEncodedPacket(const uint8_t* data, uint32_t len, uint64_t pts_us);
+
+protected:
+    EncodeFrameCallback callback_{};
+    uint32_t bitrate_{64000};
+
+private:
+    AudioEncoder(const AudioEncoder&) = delete;
+    AudioEncoder& operator=(const AudioEncoder&) = delete;
+
+    void EncodeThread();
+
+private:
+    std::atomic<bool> running_{false};
+    std::thread thread_{};
+    std::vector<AudioPcmFrame> pool_{};
+    moodycamel::BlockingReaderWriterQueue<AudioPcmFrame*> pcm_queue_;
+    moodycamel::ReaderWriterQueue<AudioPcmFrame*> free_queue_;
+
+    std::atomic<uint64_t> frames_pushed_{0};
+    std::atomic<uint64_t> frames_dropped_{0};
+    std::atomic<uint64_t> packets_encoded_{0};
+    std::atomic<uint64_t> bytes_encoded_{0};
+};
\ No newline at end of file
@@ -0,0 +1,27 @@
+﻿#include "audio_encoder_factory.h"
+
+#include "ffmpeg/audio_encoder_ffmpeg.h"
+
+AudioEncoderFactory& AudioEncoderFactory::Instance() {
+    static AudioEncoderFactory instance;
+    return instance;
+}
+
+std::shared_ptr<AudioEncoder> AudioEncoderFactory::CreateEncoder(AudioEncodeType encode_type) {
+    std::shared_ptr<AudioEncoder> audio_encoder = nullptr;
+    switch (encode_type)
+    {
+    case kAudioEncodeTypeFFmpegAac:
+        audio_encoder.reset(new AudioEncoderFFmpeg());
+        break;
+    default:
+        break;
+    }
+    return audio_encoder;
+}
+
+AudioEncoderFactory::AudioEncoderFactory() {
+}
+AudioEncoderFactory::~AudioEncoderFactory() {
+
+}
\ No newline at end of file
@@ -0,0 +1,20 @@
+﻿#pragma once
+#include <memory>
+#include "audio_encoder.h"
+
+enum AudioEncodeType {
+    kAudioEncodeTypeFFmpegAac,
+};
+
+class AudioEncoderFactory {
+public:
+    static AudioEncoderFactory& Instance();
+    std::shared_ptr<AudioEncoder> CreateEncoder(AudioEncodeType encode_type);
+
+private:
+    AudioEncoderFactory();
+    ~AudioEncoderFactory();
+
+    AudioEncoderFactory(const AudioEncoderFactory&) = delete;
+    AudioEncoderFactory operator=(const AudioEncoderFactory&) = delete;
+};
\ No newline at end of file
@@ -0,0 +1,289 @@
+﻿#include "audio_encoder_ffmpeg.h"
+
+#include "local_log.h"
+
+// The send/receive API arrived in libavcodec 57.37; the vendored FFmpeg predates it.
+#define AUDIO_ENCODER_SEND_RECEIVE (LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(57, 37, 100))
+
+namespace {
+
+const char* kAudioEncoderLogTag = "AudioEncoder";
+
+AVSampleFormat ToAVSampleFormat(AudioSampleFormat format) {
+    switch (format) {
+    case AudioSampleFormat::kS16:
+        return AV_SAMPLE_FMT_S16;
+    case AudioSampleFormat::kF32:
+        return AV_SAMPLE_FMT_FLT;
+    default:
+        return AV_SAMPLE_FMT_NONE;
+    }
+}
+
+int64_t ChannelLayout(int channels) {
+    return channels == 1 ? AV_CH_LAYOUT_MONO : AV_CH_LAYOUT_STEREO;
+}
+
+} // namespace
+
+AudioEncoderFFmpeg::AudioEncoderFFmpeg() {}
+
+AudioEncoderFFmpeg::~AudioEncoderFFmpeg() {
+    Stop();
+    Uninit();
+}
+
+bool AudioEncoderFFmpeg::EncodePcm(const AudioPcmFrame& pcm) {
+    const AVSampleFormat in_format = ToAVSampleFormat(pcm.format);
+    const int bytes_per_sample = pcm.channels * pcm.bits_per_sample / 8;
+    if (in_format == AV_SAMPLE_FMT_NONE || bytes_per_sample <= 0 || pcm.sample_rate <= 0) {
+        return false;
+    }
+    if (!init_) {
+        if (!Init(pcm.sample_rate, pcm.channels)) {
+            return false;
+        }
+        first_timestamp_us_ = pcm.timestamp_us;
+    }
+    if (!SetupResampler(in_format, pcm.sample_rate, pcm.channels)) {
+        return false;
+    }
+
+    const int in_samples = (int)(pcm.data.size() / bytes_per_sample);
+    const int max_out = (int)av_rescale_rnd(swr_get_delay(swr_, pcm.sample_rate) + in_samples,
+                                            codec_context_->sample_rate, pcm.sample_rate,
+                                            AV_ROUND_UP);
+    if (!ReserveConverted(max_out)) {
+        return false;
+    }
+    const uint8_t* in_data[1] = {pcm.data.data()};
+    const int out_samples = swr_convert(swr_, converted_, max_out, in_data, in_samples);
+    if (out_samples < 0) {
+        return false;
+    }
+    // The fifo only grows when capture outpaces the encoder.
+    if (av_audio_fifo_write(fifo_, (void**)converted_, out_samples) < out_samples) {
+        return false;
+    }
+
+    while (av_audio_fifo_size(fifo_) >= frame_size_) {
+        if (av_frame_make_writable(frame_) < 0) {
+            return false;
+        }
+        av_audio_fifo_read(fifo_, (void**)frame_->data, frame_size_);
+        frame_->nb_samples = frame_size_;
+        frame_->pts = samples_queued_;
+        samples_queued_ += frame_size_;
+        if (!EncodeFrame(frame_)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void AudioEncoderFFmpeg::Flush() {
+    if (!init_) {
+        return;
+    }
+    const int remaining = av_audio_fifo_size(fifo_);
+    if (remaining > 0 && av_frame_make_writable(frame_) >= 0) {
+        av_samples_set_silence(frame_->data, 0, frame_size_, codec_context_->channels,
+                               codec_context_->sample_fmt);
+        av_audio_fifo_read(fifo_, (void**)frame_->data, remaining);
+        frame_->nb_samples = frame_size_;
+        frame_->pts = samples_queued_;
+        samples_queued_ += frame_size_;
+        EncodeFrame(frame_);
+    }
+    EncodeFrame(nullptr);
+    Uninit();
+}
+
+bool AudioEncoderFFmpeg::Init(int sample_rate, int channels) {
+    avcodec_register_all();
+    codec_ = avcodec_find_encoder(AV_CODEC_ID_AAC);
+    if (!codec_) {
+        LOGE(kAudioEncoderLogTag) << "aac encoder not found";
+        return false;
+    }
+    codec_context_ = avcodec_alloc_context3(codec_);
+    if (!codec_context_) {
+        return false;
+    }
+    codec_context_->sample_rate = sample_rate;
+    codec_context_->channels = channels;
+    codec_context_->channel_layout = ChannelLayout(channels);
+    codec_context_->bit_rate = bitrate_;
+    codec_context_->time_base.num = 1;
+    codec_context_->time_base.den = sample_rate;
+    codec_context_->sample_fmt = AV_SAMPLE_FMT_FLTP;
+    if (codec_->sample_fmts) {
+        codec_context_->sample_fmt = codec_->sample_fmts[0];
+        for (int i = 0; codec_->sample_fmts[i] != AV_SAMPLE_FMT_NONE; ++i) {
+            if (codec_->sample_fmts[i] == AV_SAMPLE_FMT_FLTP) {
+                codec_context_->sample_fmt = AV_SAMPLE_FMT_FLTP;
+                break;
+            }
+            if (codec_->sample_fmts[i] == AV_SAMPLE_FMT_S16) {
+                codec_context_->sample_fmt = AV_SAMPLE_FMT_S16;
+            }
+        }
+    }
+
+    AVDictionary* options = nullptr;
+    av_dict_set(&options, "profile", "aac_low", 0);
+    int ret = avcodec_open2(codec_context_, codec_, &options);
+    av_dict_free(&options);
+    if (ret < 0) {
+        LOGE(kAudioEncoderLogTag) << "avcodec_open2 failed: " << ret;
+        Uninit();
+        return false;
+    }
+    frame_size_ = codec_context_->frame_size > 0 ? codec_context_->frame_size : 1024;
+
+    fifo_ = av_audio_fifo_alloc(codec_context_->sample_fmt, channels, frame_size_ * 4);
+    frame_ = av_frame_alloc();
+#if AUDIO_ENCODER_SEND_RECEIVE
+    packet_ = av_packet_alloc();
+    if (!packet_) {
+        Uninit();
+        return false;
+    }
+#endif
+    if (!fifo_ || !frame_) {
+        Uninit();
+        return false;
+    }
+    frame_->nb_samples = frame_size_;
+    frame_->format = codec_context_->sample_fmt;
+    frame_->channel_layout = codec_context_->channel_layout;
+    frame_->sample_rate = sample_rate;
+    if (av_frame_get_buffer(frame_, 0) < 0) {
+        Uninit();
+        return false;
+    }
+    samples_queued_ = 0;
+    samples_sent_ = 0;
+    init_ = true;
+    LOGI(kAudioEncoderLogTag) << "aac encoder opened, " << sample_rate << " Hz, " << channels
+                              << " channels, " << bitrate_ << " bps";
+    return true;
+}
+
+void AudioEncoderFFmpeg::Uninit() {
+    if (converted_) {
+        av_freep(&converted_[0]);
+        av_freep(&converted_);
+    }
+    converted_capacity_ = 0;
+    if (fifo_) {
+        av_audio_fifo_free(fifo_);
+        fifo_ = nullptr;
+    }
+    if (swr_) {
+        swr_free(&swr_);
+    }
+    swr_in_format_ = AV_SAMPLE_FMT_NONE;
+    if (frame_) {
+        av_frame_free(&frame_);
+    }
+#if AUDIO_ENCODER_SEND_RECEIVE
+    if (packet_) {
+        av_packet_free(&packet_);
+    }
+#endif
+    if (codec_context_) {
+        avcodec_close(codec_context_);
+        av_free(codec_context_);
+        codec_context_ = nullptr;
+    }
+    codec_ = nullptr;
+    init_ = false;
+}
+
+bool AudioEncoderFFmpeg::SetupResampler(AVSampleFormat format, int sample_rate, int channels) {
+    if (swr_ && format == swr_in_format_ && sample_rate == swr_in_rate_ &&
+        channels == swr_in_channels_) {
+        return true;
+    }
+    if (swr_) {
+        swr_free(&swr_);
+    }
+    swr_ = swr_alloc_set_opts(nullptr, codec_context_->channel_layout, codec_context_->sample_fmt,
+                              codec_context_->sample_rate, ChannelLayout(channels), format,
+                              sample_rate, 0, nullptr);
+    if (!swr_ || swr_init(swr_) < 0) {
+        LOGE(kAudioEncoderLogTag) << "swr_init failed";
+        if (swr_) {
+            swr_free(&swr_);
+        }
+        return false;
+    }
+    swr_in_format_ = format;
+    swr_in_rate_ = sample_rate;
+    swr_in_channels_ = channels;
+    return true;
+}
+
+bool AudioEncoderFFmpeg::ReserveConverted(int samples) {
+    if (samples <= converted_capacity_) {
+        return true;
+    }
+    if (converted_) {
+        av_freep(&converted_[0]);
+        av_freep(&converted_);
+    }
+    converted_capacity_ = 0;
+    // Sized for twice the request so that capture packets of varying length settle quickly.
+    const int capacity = samples * 2;
+    if (av_samples_alloc_array_and_samples(&converted_, nullptr, codec_context_->channels, capacity,
+                                           codec_context_->sample_fmt, 0) < 0) {
+        return false;
+    }
+    converted_capacity_ = capacity;
+    return true;
+}
+
+bool AudioEncoderFFmpeg::EncodeFrame(AVFrame* frame) {
+#if AUDIO_ENCODER_SEND_RECEIVE
+    int ret = avcodec_send_frame(codec_context_, frame);
+    if (ret < 0) {
+        return false;
+    }
+    while (true) {
+        ret = avcodec_receive_packet(codec_context_, packet_);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+            return true;
+        }
+        if (ret < 0) {
+            return false;
+        }
+        DeliverPacket(packet_);
+        av_packet_unref(packet_);
+    }
+#else
+    AVPacket packet;
+    av_init_packet(&packet);
+    packet.data = nullptr;
+    packet.size = 0;
+    int got_packet = 0;
+    do {
+        if (avcodec_encode_audio2(codec_context_, &packet, frame, &got_packet) < 0) {
+            return false;
+        }
+        if (got_packet) {
+            DeliverPacket(&packet);
+            av_packet_unref(&packet);
+        }
+        // A null frame drains one delayed packet per call.
+    } while (!frame && got_packet);
+    return true;
+#endif
+}
+
+void AudioEncoderFFmpeg::DeliverPacket(const AVPacket* packet) {
+    const uint64_t pts_us = first_timestamp_us_ +
+                            samples_sent_ * 1000000ULL / (uint64_t)codec_context_->sample_rate;
+    samples_sent_ += (uint64_t)frame_size_;
+    OnEncodedPacket(packet->data, (uint32_t)packet->size, pts_us);
+}
\ No newline at end of file
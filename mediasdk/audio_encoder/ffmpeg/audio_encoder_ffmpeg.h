@@ -0,0 +1,53 @@
+﻿#pragma once
+#include "audio_encoder.h"
+
+extern "C"
+{
+#include "libavcodec/avcodec.h"
+#include "libavutil/audio_fifo.h"
+#include "libavutil/channel_layout.h"
+#include "libavutil/samplefmt.h"
+#include "libswresample/swresample.h"
+};
+
+// AAC-LC through FFmpeg. The resampler output, the sample fifo, the codec frame and the packet
+// are allocated when the codec opens and reused for every frame after that. Uses
+// avcodec_send_frame/avcodec_receive_packet where the linked libavcodec has them and
+// avcodec_encode_audio2 before that.
+class AudioEncoderFFmpeg : public AudioEncoder {
+public:
+    AudioEncoderFFmpeg();
+    ~AudioEncoderFFmpeg();
+
+protected:
+    bool EncodePcm(const AudioPcmFrame& pcm) override;
+    // Pads the last partial frame with silence, drains the codec and closes it.
+    void Flush() override;
+
+private:
+    bool Init(int sample_rate, int channels);
+    void Uninit();
+    bool SetupResampler(AVSampleFormat format, int sample_rate, int channels);
+    bool ReserveConverted(int samples);
+    // Encodes frame_, or drains the codec when frame is null.
+    bool EncodeFrame(AVFrame* frame);
+    void DeliverPacket(const AVPacket* packet);
+
+private:
+    bool init_{};
+    AVCodec* codec_{};
+    AVCodecContext* codec_context_{};
+    SwrContext* swr_{};
+    AVSampleFormat swr_in_format_{AV_SAMPLE_FMT_NONE};
+    int swr_in_rate_{};
+    int swr_in_channels_{};
+    AVAudioFifo* fifo_{};
+    uint8_t** converted_{};
+    int converted_capacity_{};
+    AVFrame* frame_{};
+    AVPacket* packet_{};
+    int frame_size_{1024};
+    int64_t samples_queued_{};
+    uint64_t samples_sent_{};
+    uint64_t first_timestamp_us_{};
+};
\ No newline at end of file
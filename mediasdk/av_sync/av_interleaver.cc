@@ -0,0 +1,138 @@
+﻿#include "av_interleaver.h"
+
+namespace {
+
+// Enough for the audio path (mixer latency plus an AAC frame) to catch up with video.
+const uint32_t kDefaultMaxDelayMs = 500;
+
+} // namespace
+
+AvInterleaver::AvInterleaver() : max_delay_us_(kDefaultMaxDelayMs * 1000ULL) {}
+
+AvInterleaver::~AvInterleaver() {}
+
+void AvInterleaver::RegisterPacketCallback(PacketCallback callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    callback_ = callback;
+}
+
+void AvInterleaver::SetMaxDelay(uint32_t delay_ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    max_delay_us_ = delay_ms * 1000ULL;
+    DeliverReady();
+}
+
+bool AvInterleaver::Push(AvStreamType stream, const uint8_t* data, size_t size,
+                         uint64_t timestamp_us, bool keyframe) {
+    if ((stream != kAvStreamAudio && stream != kAvStreamVideo) || !data || size == 0) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    AvPacket* packet = nullptr;
+    if (!free_.empty()) {
+        packet = free_.back();
+        free_.pop_back();
+    } else {
+        packets_.emplace_back(new AvPacket());
+        packet = packets_.back().get();
+    }
+    packet->stream = stream;
+    packet->keyframe = keyframe;
+    packet->timestamp_us = timestamp_us;
+    // Keeps the capacity of earlier packets.
+    packet->data.assign(data, data + size);
+    queues_[stream].push_back(packet);
+    if (!seen_[stream] || timestamp_us > newest_us_[stream]) {
+        newest_us_[stream] = timestamp_us;
+    }
+    seen_[stream] = true;
+    DeliverReady();
+    return true;
+}
+
+void AvInterleaver::Flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (!queues_[kAvStreamAudio].empty() || !queues_[kAvStreamVideo].empty()) {
+        if (queues_[kAvStreamVideo].empty()) {
+            Deliver(kAvStreamAudio);
+        } else if (queues_[kAvStreamAudio].empty()) {
+            Deliver(kAvStreamVideo);
+        } else {
+            const bool audio_first = queues_[kAvStreamAudio].front()->timestamp_us <=
+                                     queues_[kAvStreamVideo].front()->timestamp_us;
+            Deliver(audio_first ? kAvStreamAudio : kAvStreamVideo);
+        }
+    }
+}
+
+void AvInterleaver::Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int stream = 0; stream < 2; ++stream) {
+        for (AvPacket* packet : queues_[stream]) {
+            free_.push_back(packet);
+        }
+        queues_[stream].clear();
+        seen_[stream] = false;
+        newest_us_[stream] = 0;
+    }
+    has_base_ = false;
+    base_us_ = 0;
+    last_us_ = 0;
+}
+
+AvInterleaverStats AvInterleaver::GetStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void AvInterleaver::DeliverReady() {
+    while (true) {
+        const bool has_audio = !queues_[kAvStreamAudio].empty();
+        const bool has_video = !queues_[kAvStreamVideo].empty();
+        if (has_audio && has_video) {
+            // Audio goes first on a tie.
+            const bool audio_first = queues_[kAvStreamAudio].front()->timestamp_us <=
+                                     queues_[kAvStreamVideo].front()->timestamp_us;
+            Deliver(audio_first ? kAvStreamAudio : kAvStreamVideo);
+            continue;
+        }
+        if (!has_audio && !has_video) {
+            return;
+        }
+        const AvStreamType stream = has_audio ? kAvStreamAudio : kAvStreamVideo;
+        const AvStreamType other = has_audio ? kAvStreamVideo : kAvStreamAudio;
+        const uint64_t head_us = queues_[stream].front()->timestamp_us;
+        // Whatever the other stream pushes next is at least as new as its newest packet.
+        if (seen_[other] && newest_us_[other] >= head_us) {
+            Deliver(stream);
+            continue;
+        }
+        if (newest_us_[stream] >= head_us + max_delay_us_) {
+            ++stats_.forced_packets;
+            Deliver(stream);
+            continue;
+        }
+        return;
+    }
+}
+
+void AvInterleaver::Deliver(AvStreamType stream) {
+    AvPacket* packet = queues_[stream].front();
+    queues_[stream].pop_front();
+    if (!has_base_) {
+        base_us_ = packet->timestamp_us;
+        last_us_ = packet->timestamp_us;
+        has_base_ = true;
+    }
+    if (packet->timestamp_us < last_us_) {
+        ++stats_.late_packets;
+        packet->timestamp_us = last_us_;
+    }
+    last_us_ = packet->timestamp_us;
+    packet->timestamp_us -= base_us_;
+    ++stats_.packets_out;
+    if (callback_) {
+        callback_(*packet);
+    }
+    free_.push_back(packet);
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+﻿#pragma once
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+enum AvStreamType {
+    kAvStreamAudio = 0,
+    kAvStreamVideo = 1,
+};
+
+struct AvPacket {
+    AvStreamType stream{kAvStreamAudio};
+    bool keyframe{};
+    // Pushed: capture time on the media clock. Delivered: time since the first packet.
+    uint64_t timestamp_us{};
+    std::vector<uint8_t> data{};
+};
+
+struct AvInterleaverStats {
+    uint64_t packets_out;
+    uint64_t late_packets;   // older than a packet already delivered; restamped to keep order
+    uint64_t forced_packets; // delivered without the other stream, which had stalled
+};
+
+// Merges the encoded audio and video of one session into a single stream ordered by capture
+// timestamp, which is what a muxer expects. Each stream must be pushed in its own timestamp
+// order. A packet is held until the other stream has pushed something at least as new, so
+// nothing can arrive after it that should go first; if the other stream stalls for longer
+// than the maximum delay, packets go out without it. Delivered timestamps start at 0 with the
+// first packet and never decrease. Packets are pooled, so after warm-up pushing does not
+// allocate. Both streams may push from their own threads; the callback runs on whichever
+// thread made a packet ready, with the interleaver locked, and must not call back into it.
+class AvInterleaver {
+public:
+    using PacketCallback = std::function<void(const AvPacket& packet)>;
+
+public:
+    AvInterleaver();
+    ~AvInterleaver();
+
+    void RegisterPacketCallback(PacketCallback callback);
+    void SetMaxDelay(uint32_t delay_ms);
+
+    bool Push(AvStreamType stream, const uint8_t* data, size_t size, uint64_t timestamp_us,
+              bool keyframe);
+    // Delivers everything still held.
+    void Flush();
+    // Drops everything held and starts a new session with the next packet.
+    void Reset();
+
+    AvInterleaverStats GetStats();
+
+private:
+    AvInterleaver(const AvInterleaver&) = delete;
+    AvInterleaver& operator=(const AvInterleaver&) = delete;
+
+    void DeliverReady();
+    void Deliver(AvStreamType stream);
+
+private:
+    std::mutex mutex_{};
+    PacketCallback callback_{};
+    uint64_t max_delay_us_{};
+
+    std::deque<AvPacket*> queues_[2]{};
+    bool seen_[2]{};
+    uint64_t newest_us_[2]{}; // newest timestamp pushed on each stream
+    std::vector<std::unique_ptr<AvPacket>> packets_{};
+    std::vector<AvPacket*> free_{};
+
+    bool has_base_{};
+    uint64_t base_us_{};
+    uint64_t last_us_{}; // last timestamp delivered, before rebasing
+    AvInterleaverStats stats_{};
+};
\ No newline at end of file
@@ -0,0 +1,54 @@
+﻿#include "clock_drift_corrector.h"
+
+namespace {
+
+// The loop settles over about two minutes with a damping of 0.7, slow enough that timestamp
+// jitter left after smoothing moves the ratio by a few ppm only. A 100 ppm device keeps its
+// phase error within about a millisecond while the loop locks.
+const double kLoopPeriodS = 120.0;
+const double kPi = 3.14159265358979323846;
+const double kNaturalFrequency = 2 * kPi / kLoopPeriodS;
+const double kProportionalGain = 2 * 0.7 * kNaturalFrequency;
+const double kIntegralGain = kNaturalFrequency * kNaturalFrequency;
+const double kErrorSmoothingS = 2.0;
+const double kMaxAdjust = 1000e-6;
+
+double Clamp(double value, double limit) {
+    return value > limit ? limit : (value < -limit ? -limit : value);
+}
+
+} // namespace
+
+ClockDriftCorrector::ClockDriftCorrector() {}
+
+void ClockDriftCorrector::Reset() {
+    primed_ = false;
+    error_s_ = 0;
+    integral_ = 0;
+    ratio_ = 1.0;
+}
+
+double ClockDriftCorrector::Update(double error_s, double duration_s) {
+    if (duration_s <= 0) {
+        return ratio_;
+    }
+    if (!primed_) {
+        error_s_ = error_s;
+        primed_ = true;
+    } else {
+        const double weight = duration_s < kErrorSmoothingS ? duration_s / kErrorSmoothingS : 1.0;
+        error_s_ += (error_s - error_s_) * weight;
+    }
+    integral_ = Clamp(integral_ + kIntegralGain * error_s_ * duration_s, kMaxAdjust);
+    ratio_ = 1.0 + Clamp(kProportionalGain * error_s_ + integral_, kMaxAdjust);
+    return ratio_;
+}
+
+double ClockDriftCorrector::GetRatio() const {
+    return ratio_;
+}
+
+double ClockDriftCorrector::GetDriftPpm() const {
+    // Locked, the stretch makes up for the device exactly.
+    return -integral_ * 1e6;
+}
\ No newline at end of file
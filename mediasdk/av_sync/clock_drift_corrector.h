@@ -0,0 +1,31 @@
+﻿#pragma once
+#include <cstdint>
+
+// Locks a device's sample clock to the media clock. A sound card runs off its own crystal
+// and delivers slightly more or fewer samples per second than its nominal rate, typically
+// within 100 ppm; counted as time, an hour of them ends up a third of a second away from the
+// video. For every packet the owner reports how far its timestamp is from where counting
+// samples put it. That phase error is smoothed against timestamp jitter and drives a PI loop
+// whose output is the ratio to stretch the device's samples by, so that their count follows
+// the timestamps. The ratio stays within 1000 ppm, too little to hear as a change of pitch.
+class ClockDriftCorrector {
+public:
+    ClockDriftCorrector();
+
+    void Reset();
+
+    // error_s: timestamp of the packet minus the time its first sample was counted at, in
+    // seconds; positive when the device delivers too few samples. duration_s: length of the
+    // packet. Returns the ratio to stretch the following samples by.
+    double Update(double error_s, double duration_s);
+
+    double GetRatio() const;
+    // Device sample rate relative to nominal as measured against the media clock, in ppm.
+    double GetDriftPpm() const;
+
+private:
+    bool primed_{};
+    double error_s_{};  // smoothed phase error
+    double integral_{}; // frequency offset estimate
+    double ratio_{1.0};
+};
\ No newline at end of file
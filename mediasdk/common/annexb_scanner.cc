@@ -0,0 +1,258 @@
+﻿#include "annexb_scanner.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// End of the NAL unit that starts at begin and is followed by the start code at next: zero
+// bytes in front of a start code are its leading zero_byte or trailing_zero_8bits.
+const uint8_t* TrimTrailingZeros(const uint8_t* begin, const uint8_t* next) {
+    while (next > begin && next[-1] == 0) {
+        --next;
+    }
+    return next;
+}
+
+} // namespace
+
+const uint8_t* FindAnnexBStartCode(const uint8_t* begin, const uint8_t* end) {
+    if (end - begin < 3) {
+        return end;
+    }
+    const uint8_t* p = begin + 2;
+    while (p < end) {
+        p = (const uint8_t*)memchr(p, 1, end - p);
+        if (!p) {
+            return end;
+        }
+        if (p[-1] == 0 && p[-2] == 0) {
+            return p - 2;
+        }
+        // The next 01 that ends a start code has two zero bytes after this one.
+        p += 3;
+    }
+    return end;
+}
+
+AnnexBScanner::AnnexBScanner(const uint8_t* data, size_t size)
+    : data_(data), end_(data + size), pos_(FindAnnexBStartCode(data, data + size)) {}
+
+bool AnnexBScanner::Next(NalUnit& nal) {
+    while (pos_ < end_) {
+        const uint8_t* start_code = pos_;
+        const uint8_t* begin = start_code + 3;
+        pos_ = FindAnnexBStartCode(begin, end_);
+        const uint8_t* end = TrimTrailingZeros(begin, pos_);
+        if (end > begin) {
+            nal.start_code_size = start_code > data_ && start_code[-1] == 0 ? 4 : 3;
+            nal.data = begin;
+            nal.size = end - begin;
+            nal.offset = (begin - data_) - nal.start_code_size;
+            return true;
+        }
+    }
+    return false;
+}
+
+AnnexBFileScanner::AnnexBFileScanner(size_t window_size) : window_size_(window_size) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    granularity_ = info.dwAllocationGranularity;
+#else
+    granularity_ = (size_t)sysconf(_SC_PAGESIZE);
+#endif
+    if (window_size_ < granularity_) {
+        window_size_ = granularity_;
+    }
+}
+
+AnnexBFileScanner::~AnnexBFileScanner() {
+    Close();
+}
+
+#ifdef _WIN32
+
+bool AnnexBFileScanner::Open(const std::string& filename) {
+    Close();
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return false;
+    }
+    file_ = file;
+    file_size_ = (uint64_t)size.QuadPart;
+    position_ = 0;
+    if (file_size_ == 0) {
+        // An empty file cannot be mapped; there is nothing to scan either.
+        return true;
+    }
+    mapping_ = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping_) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void AnnexBFileScanner::Close() {
+    Unmap();
+    if (mapping_) {
+        CloseHandle((HANDLE)mapping_);
+        mapping_ = nullptr;
+    }
+    if (file_) {
+        CloseHandle((HANDLE)file_);
+        file_ = nullptr;
+    }
+    file_size_ = 0;
+    position_ = 0;
+}
+
+bool AnnexBFileScanner::MapWindow(uint64_t offset, size_t size) {
+    Unmap();
+    const uint64_t aligned = offset - offset % granularity_;
+    uint64_t length = size + (offset - aligned);
+    length = length < file_size_ - aligned ? length : file_size_ - aligned;
+    void* view = MapViewOfFile((HANDLE)mapping_, FILE_MAP_READ, (DWORD)(aligned >> 32),
+                               (DWORD)(aligned & 0xFFFFFFFF), (SIZE_T)length);
+    if (!view) {
+        return false;
+    }
+    view_ = (const uint8_t*)view;
+    view_offset_ = aligned;
+    view_size_ = (size_t)length;
+    return true;
+}
+
+void AnnexBFileScanner::Unmap() {
+    if (view_) {
+        UnmapViewOfFile(view_);
+        view_ = nullptr;
+        view_size_ = 0;
+    }
+}
+
+#else
+
+bool AnnexBFileScanner::Open(const std::string& filename) {
+    Close();
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    fd_ = fd;
+    file_size_ = (uint64_t)st.st_size;
+    position_ = 0;
+    return true;
+}
+
+void AnnexBFileScanner::Close() {
+    Unmap();
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+    file_size_ = 0;
+    position_ = 0;
+}
+
+bool AnnexBFileScanner::MapWindow(uint64_t offset, size_t size) {
+    Unmap();
+    const uint64_t aligned = offset - offset % granularity_;
+    uint64_t length = size + (offset - aligned);
+    length = length < file_size_ - aligned ? length : file_size_ - aligned;
+    void* view = mmap(nullptr, (size_t)length, PROT_READ, MAP_PRIVATE, fd_, (off_t)aligned);
+    if (view == MAP_FAILED) {
+        return false;
+    }
+    madvise(view, (size_t)length, MADV_SEQUENTIAL);
+    view_ = (const uint8_t*)view;
+    view_offset_ = aligned;
+    view_size_ = (size_t)length;
+    return true;
+}
+
+void AnnexBFileScanner::Unmap() {
+    if (view_) {
+        munmap((void*)view_, view_size_);
+        view_ = nullptr;
+        view_size_ = 0;
+    }
+}
+
+#endif
+
+bool AnnexBFileScanner::Next(NalUnit& nal) {
+    size_t window = window_size_;
+    while (position_ + 3 <= file_size_) {
+        // Keep the byte before position_ in view to tell four-byte start codes apart.
+        const uint64_t from = position_ > 0 ? position_ - 1 : 0;
+        if (!view_ || from < view_offset_ || position_ + 3 > view_offset_ + view_size_) {
+            if (!MapWindow(from, window)) {
+                return false;
+            }
+        }
+        const uint8_t* view_end = view_ + view_size_;
+        const bool view_at_end = view_offset_ + view_size_ == file_size_;
+        const uint8_t* start_code =
+            FindAnnexBStartCode(view_ + (position_ - view_offset_), view_end);
+        if (start_code == view_end) {
+            if (view_at_end) {
+                position_ = file_size_;
+                return false;
+            }
+            // A start code may straddle the edge of the window.
+            position_ = view_offset_ + view_size_ - 2;
+            continue;
+        }
+        position_ = view_offset_ + (start_code - view_);
+        const uint8_t* begin = start_code + 3;
+        const uint8_t* next = FindAnnexBStartCode(begin, view_end);
+        if (next == view_end && !view_at_end) {
+            // The NAL unit runs past the window. Map again from its start code, and widen
+            // the window if it started there already.
+            const uint64_t nal_from = position_ > 0 ? position_ - 1 : 0;
+            if (nal_from - nal_from % granularity_ == view_offset_) {
+                window = view_size_ * 2;
+            }
+            if (!MapWindow(nal_from, window)) {
+                return false;
+            }
+            continue;
+        }
+        position_ = view_offset_ + (next - view_);
+        const uint8_t* end = TrimTrailingZeros(begin, next);
+        if (end > begin) {
+            nal.start_code_size = start_code > view_ && start_code[-1] == 0 ? 4 : 3;
+            nal.data = begin;
+            nal.size = end - begin;
+            nal.offset = view_offset_ + (begin - view_) - nal.start_code_size;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t AnnexBFileScanner::GetFileSize() const {
+    return file_size_;
+}
\ No newline at end of file
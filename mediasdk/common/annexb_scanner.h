@@ -0,0 +1,72 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// One NAL unit of an Annex-B byte stream, viewed in place: data points at the NAL header
+// byte, past the start code, and size excludes the zero bytes in front of the next start
+// code. offset is the position of the start code in the stream.
+struct NalUnit {
+    const uint8_t* data;
+    size_t size;
+    uint64_t offset;
+    uint32_t start_code_size; // 3 or 4
+};
+
+// Returns the first 00 00 01 in [begin, end), or end. The search runs on memchr for the 01,
+// which the C runtime vectorizes, so long slices are crossed at memory bandwidth.
+const uint8_t* FindAnnexBStartCode(const uint8_t* begin, const uint8_t* end);
+
+// Walks the NAL units of an Annex-B buffer without copying them. Bytes in front of the first
+// start code are skipped, and so are empty NAL units.
+class AnnexBScanner {
+public:
+    AnnexBScanner(const uint8_t* data, size_t size);
+
+    bool Next(NalUnit& nal);
+
+private:
+    const uint8_t* data_{};
+    const uint8_t* end_{};
+    const uint8_t* pos_{}; // next start code, or end_
+};
+
+// Walks the NAL units of an Annex-B file through a read-only memory mapping that slides over
+// it, so files of any size are scanned in bounded address space and at the speed of the page
+// cache. A NalUnit stays valid until the next call to Next; a NAL unit larger than the
+// mapping window widens it.
+class AnnexBFileScanner {
+public:
+    explicit AnnexBFileScanner(size_t window_size = 64 * 1024 * 1024);
+    ~AnnexBFileScanner();
+    AnnexBFileScanner(const AnnexBFileScanner&) = delete;
+    AnnexBFileScanner& operator=(const AnnexBFileScanner&) = delete;
+
+    bool Open(const std::string& filename);
+    void Close();
+
+    bool Next(NalUnit& nal);
+
+    uint64_t GetFileSize() const;
+
+private:
+    // Maps the window that starts at or just before offset.
+    bool MapWindow(uint64_t offset, size_t size);
+    void Unmap();
+
+private:
+    size_t window_size_{};
+    size_t granularity_{}; // mapping offsets must be a multiple of this
+    uint64_t file_size_{};
+    uint64_t position_{}; // where the search for the next start code begins
+
+    const uint8_t* view_{};
+    uint64_t view_offset_{};
+    size_t view_size_{};
+#ifdef _WIN32
+    void* file_{};
+    void* mapping_{};
+#else
+    int fd_{-1};
+#endif
+};
\ No newline at end of file
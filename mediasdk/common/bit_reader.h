@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// MSB-first bit reader over an H.264/H.265 NAL unit payload (EBSP).
+// Emulation prevention bytes (00 00 03) are skipped on the fly, so parameter sets can be
+// parsed in place without an EBSP->RBSP copy. Reading past the end yields zero bits and
+// sets the overrun flag; callers check IsOverrun() once after parsing.
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+    uint32_t ReadBit() {
+        if (bit_ == 0 && !LoadByte()) {
+            overrun_ = true;
+            return 0;
+        }
+        --bit_;
+        return (cur_ >> bit_) & 0x01;
+    }
+
+    // n <= 32
+    uint32_t ReadBits(int n) {
+        uint32_t v = 0;
+        for (int i = 0; i < n; ++i) {
+            v = (v << 1) | ReadBit();
+        }
+        return v;
+    }
+
+    void SkipBits(int n) {
+        for (int i = 0; i < n; ++i) {
+            ReadBit();
+        }
+    }
+
+    // ue(v)
+    uint32_t ReadUE() {
+        int leading_zeros = 0;
+        while (ReadBit() == 0) {
+            if (overrun_ || ++leading_zeros > 31) {
+                overrun_ = true;
+                return 0;
+            }
+        }
+        if (leading_zeros == 0) {
+            return 0;
+        }
+        return (uint32_t)((1ull << leading_zeros) - 1 + ReadBits(leading_zeros));
+    }
+
+    // se(v)
+    int32_t ReadSE() {
+        uint32_t k = ReadUE();
+        return (k & 0x01) ? (int32_t)((k + 1) / 2) : -(int32_t)(k / 2);
+    }
+
+    // more_rbsp_data(): true while anything other than the rbsp_stop_one_bit and its
+    // trailing zero bits is left.
+    bool MoreRbspData() const {
+        BitReader probe = *this;
+        if (probe.ReadBit() == 1 && !probe.overrun_) {
+            // the bit just read is the stop bit if only zero bits follow
+            while (true) {
+                uint32_t bit = probe.ReadBit();
+                if (probe.overrun_) {
+                    return false;
+                }
+                if (bit) {
+                    return true;
+                }
+            }
+        }
+        return !probe.overrun_;
+    }
+
+    bool IsOverrun() const { return overrun_; }
+
+private:
+    bool LoadByte() {
+        if (pos_ >= size_) {
+            return false;
+        }
+        uint8_t byte = data_[pos_++];
+        if (zeros_ >= 2 && byte == 0x03) {
+            zeros_ = 0;
+            if (pos_ >= size_) {
+                return false;
+            }
+            byte = data_[pos_++];
+        }
+        zeros_ = (byte == 0) ? zeros_ + 1 : 0;
+        cur_ = byte;
+        bit_ = 8;
+        return true;
+    }
+
+private:
+    const uint8_t* data_{};
+    size_t size_{};
+    size_t pos_{};
+    int zeros_{};
+    uint32_t cur_{};
+    int bit_{};
+    bool overrun_{false};
+};
@@ -0,0 +1,161 @@
+﻿#include "codec_config.h"
+
+#include "annexb_scanner.h"
+#include "h264_sps_parser.h"
+#include "h265_sps_parser.h"
+
+namespace {
+
+const uint8_t kH264NalSps = 7;
+const uint8_t kH264NalPps = 8;
+const uint8_t kH264NalAud = 9;
+
+} // namespace
+
+bool BuildAvcDecoderConfig(const uint8_t* sps, size_t sps_len, const uint8_t* pps,
+                           size_t pps_len, std::vector<uint8_t>& out) {
+    if (!sps || sps_len < 4 || sps_len > 0xFFFF || !pps || pps_len == 0 || pps_len > 0xFFFF) {
+        return false;
+    }
+    out.push_back(0x01);   // configurationVersion
+    out.push_back(sps[1]); // AVCProfileIndication
+    out.push_back(sps[2]); // profile_compatibility
+    out.push_back(sps[3]); // AVCLevelIndication
+    out.push_back(0xFF);   // 6 bits reserved + 2 bits lengthSizeMinusOne (3 => 4 bytes)
+    out.push_back(0xE1);   // 3 bits reserved + 5 bits numOfSPS (1)
+    out.push_back((uint8_t)((sps_len >> 8) & 0xFF));
+    out.push_back((uint8_t)(sps_len & 0xFF));
+    out.insert(out.end(), sps, sps + sps_len);
+    out.push_back(0x01); // numOfPPS
+    out.push_back((uint8_t)((pps_len >> 8) & 0xFF));
+    out.push_back((uint8_t)(pps_len & 0xFF));
+    out.insert(out.end(), pps, pps + pps_len);
+    // ISO/IEC 14496-15 5.3.3.1: High profiles carry chroma format and bit depths.
+    H264SpsInfo sps_info;
+    if (ParseH264Sps(sps, sps_len, &sps_info) &&
+        (sps_info.profile_idc == 100 || sps_info.profile_idc == 110 ||
+         sps_info.profile_idc == 122 || sps_info.profile_idc == 144)) {
+        out.push_back((uint8_t)(0xFC | (sps_info.chroma_format_idc & 0x03)));
+        out.push_back((uint8_t)(0xF8 | ((sps_info.bit_depth_luma - 8) & 0x07)));
+        out.push_back((uint8_t)(0xF8 | ((sps_info.bit_depth_chroma - 8) & 0x07)));
+        out.push_back(0x00); // numOfSequenceParameterSetExt
+    }
+    return true;
+}
+
+bool BuildHevcDecoderConfig(const uint8_t* vps, size_t vps_len, const uint8_t* sps,
+                            size_t sps_len, const uint8_t* pps, size_t pps_len,
+                            std::vector<uint8_t>& out) {
+    H265SpsInfo info;
+    if (!vps || !pps || vps_len > 0xFFFF || sps_len > 0xFFFF || pps_len > 0xFFFF ||
+        !ParseH265Sps(sps, sps_len, &info)) {
+        return false;
+    }
+    out.push_back(0x01); // configurationVersion
+    out.push_back((uint8_t)((info.general_profile_space << 6) | (info.general_tier_flag ? 0x20 : 0) |
+                            (info.general_profile_idc & 0x1F)));
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back((uint8_t)(info.general_profile_compatibility_flags >> shift));
+    }
+    for (int shift = 40; shift >= 0; shift -= 8) {
+        out.push_back((uint8_t)(info.general_constraint_indicator_flags >> shift));
+    }
+    out.push_back(info.general_level_idc);
+    out.push_back(0xF0); // reserved(4) + min_spatial_segmentation_idc(12) = 0
+    out.push_back(0x00);
+    out.push_back(0xFC); // reserved(6) + parallelismType(2) = 0 (unknown)
+    out.push_back((uint8_t)(0xFC | (info.chroma_format_idc & 0x03)));
+    out.push_back((uint8_t)(0xF8 | ((info.bit_depth_luma - 8) & 0x07)));
+    out.push_back((uint8_t)(0xF8 | ((info.bit_depth_chroma - 8) & 0x07)));
+    out.push_back(0x00); // avgFrameRate(16) = 0 (unspecified)
+    out.push_back(0x00);
+    // constantFrameRate(2)=0, numTemporalLayers(3), temporalIdNested(1), lengthSizeMinusOne(2)=3
+    out.push_back((uint8_t)(((info.max_sub_layers & 0x07) << 3) |
+                            (info.temporal_id_nesting ? 0x04 : 0) | 0x03));
+    out.push_back(3); // numOfArrays
+
+    struct {
+        uint8_t type;
+        const uint8_t* nal;
+        size_t len;
+    } arrays[3] = {{kH265NalVps, vps, vps_len}, {kH265NalSps, sps, sps_len},
+                   {kH265NalPps, pps, pps_len}};
+    for (auto& array : arrays) {
+        out.push_back((uint8_t)(0x80 | array.type)); // array_completeness=1
+        out.push_back(0x00); // numNalus = 1
+        out.push_back(0x01);
+        out.push_back((uint8_t)((array.len >> 8) & 0xFF));
+        out.push_back((uint8_t)(array.len & 0xFF));
+        out.insert(out.end(), array.nal, array.nal + array.len);
+    }
+    return true;
+}
+
+int AacSampleRateIndex(int sample_rate) {
+    static const int rates[] = {96000, 88200, 64000, 48000, 44100, 32000, 24000,
+                                22050, 16000, 12000, 11025, 8000,  7350};
+    for (int i = 0; i < (int)(sizeof(rates) / sizeof(rates[0])); ++i) {
+        if (rates[i] == sample_rate) {
+            return i;
+        }
+    }
+    return 4;
+}
+
+void BuildAacAudioSpecificConfig(int sample_rate, int channels, std::vector<uint8_t>& out) {
+    const int profile = 2; // AAC LC (Audio Object Type)
+    const int channel_config = channels <= 0 ? 1 : channels;
+    const uint16_t config = (uint16_t)((profile << 11) | (AacSampleRateIndex(sample_rate) << 7) |
+                                       (channel_config << 3));
+    out.push_back((uint8_t)((config >> 8) & 0xFF));
+    out.push_back((uint8_t)(config & 0xFF));
+}
+
+size_t AacAdtsHeaderSize(const uint8_t* aac, size_t len) {
+    // ADTS syncword 0xFFF (12 bits)
+    if (len < 7 || aac[0] != 0xFF || (aac[1] & 0xF0) != 0xF0) {
+        return 0;
+    }
+    const size_t header_len = (aac[1] & 0x01) ? 7 : 9; // protection_absent
+    return len > header_len ? header_len : 0;
+}
+
+void BuildAacAdtsHeader(int sample_rate, int channels, size_t raw_len, std::vector<uint8_t>& out) {
+    const size_t frame_len = raw_len + 7;
+    const int profile = 1; // AAC LC, as profile_ObjectType = Audio Object Type - 1
+    const int channel_config = channels <= 0 ? 1 : channels;
+    out.push_back(0xFF);
+    out.push_back(0xF1); // MPEG-4, layer 0, protection_absent
+    out.push_back((uint8_t)((profile << 6) | (AacSampleRateIndex(sample_rate) << 2) |
+                            ((channel_config >> 2) & 0x01)));
+    out.push_back((uint8_t)(((channel_config & 0x03) << 6) | ((frame_len >> 11) & 0x03)));
+    out.push_back((uint8_t)((frame_len >> 3) & 0xFF));
+    out.push_back((uint8_t)(((frame_len & 0x07) << 5) | 0x1F)); // buffer fullness 0x7FF (VBR)
+    out.push_back(0xFC); // one raw data block
+}
+
+void AnnexBToLengthPrefixed(const uint8_t* data, size_t size, bool hevc,
+                            std::vector<uint8_t>& out) {
+    AnnexBScanner scanner(data, size);
+    NalUnit nal;
+    while (scanner.Next(nal)) {
+        if (hevc) {
+            const uint8_t type = H265NalType(nal.data);
+            if (nal.size < 2 || type == kH265NalVps || type == kH265NalSps ||
+                type == kH265NalPps || type == kH265NalAud) {
+                continue;
+            }
+        } else {
+            const uint8_t type = nal.data[0] & 0x1F;
+            if (type == kH264NalSps || type == kH264NalPps || type == kH264NalAud) {
+                continue;
+            }
+        }
+        const uint32_t len = (uint32_t)nal.size;
+        out.push_back((uint8_t)(len >> 24));
+        out.push_back((uint8_t)(len >> 16));
+        out.push_back((uint8_t)(len >> 8));
+        out.push_back((uint8_t)len);
+        out.insert(out.end(), nal.data, nal.data + nal.size);
+    }
+}
\ No newline at end of file
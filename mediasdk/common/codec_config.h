@@ -0,0 +1,36 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Decoder configuration records carried by FLV and MP4 (ISO/IEC 14496-15) and the AAC
+// AudioSpecificConfig (ISO/IEC 14496-3 1.6.2.1). Parameter sets are single NAL units
+// without start codes. Every builder appends to out, so it can follow a container header.
+
+// AVCDecoderConfigurationRecord ('avcC') with 4-byte NAL unit lengths.
+bool BuildAvcDecoderConfig(const uint8_t* sps, size_t sps_len, const uint8_t* pps,
+                           size_t pps_len, std::vector<uint8_t>& out);
+
+// HEVCDecoderConfigurationRecord ('hvcC') with 4-byte NAL unit lengths. Fails if the SPS
+// does not parse.
+bool BuildHevcDecoderConfig(const uint8_t* vps, size_t vps_len, const uint8_t* sps,
+                            size_t sps_len, const uint8_t* pps, size_t pps_len,
+                            std::vector<uint8_t>& out);
+
+// sampling_frequency_index of a rate; rates without an index map to 44.1 kHz.
+int AacSampleRateIndex(int sample_rate);
+
+// Two-byte AAC-LC AudioSpecificConfig.
+void BuildAacAudioSpecificConfig(int sample_rate, int channels, std::vector<uint8_t>& out);
+
+// Size of the ADTS header in front of a raw AAC frame, 0 if there is none.
+size_t AacAdtsHeaderSize(const uint8_t* aac, size_t len);
+
+// Seven-byte AAC-LC ADTS header (ISO/IEC 13818-7 6.2) for a raw frame of raw_len bytes.
+void BuildAacAdtsHeader(int sample_rate, int channels, size_t raw_len, std::vector<uint8_t>& out);
+
+// Appends the NAL units of an Annex-B access unit with 4-byte lengths, as MP4 and FLV carry
+// them. Parameter sets and access unit delimiters are left out; they belong in the decoder
+// configuration record.
+void AnnexBToLengthPrefixed(const uint8_t* data, size_t size, bool hevc,
+                            std::vector<uint8_t>& out);
\ No newline at end of file
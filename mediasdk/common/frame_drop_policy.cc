@@ -0,0 +1,91 @@
+﻿#include "frame_drop_policy.h"
+
+namespace {
+
+// Weight of a new measurement in the smoothed processing time, as a shift: 1/8.
+const int kProcessSmoothingShift = 3;
+// The frame rate only goes up when one more frame per second fits with this much to spare.
+const double kRaiseMargin = 1.2;
+
+} // namespace
+
+FrameDropController::FrameDropController() {
+    Reset();
+}
+
+void FrameDropController::SetConfig(const FrameDropConfig& config) {
+    config_ = config;
+    if (config_.max_fps == 0) {
+        config_.max_fps = 1;
+    }
+    if (config_.min_fps == 0) {
+        config_.min_fps = 1;
+    }
+    if (config_.min_fps > config_.max_fps) {
+        config_.min_fps = config_.max_fps;
+    }
+    if (config_.capacity == 0) {
+        config_.capacity = 1;
+    }
+    if (config_.load_target <= 0.0f || config_.load_target > 1.0f) {
+        config_.load_target = 1.0f;
+    }
+    Reset();
+}
+
+FrameDropConfig FrameDropController::GetConfig() const {
+    return config_;
+}
+
+void FrameDropController::Reset() {
+    target_fps_ = config_.max_fps;
+    process_us_ = 0;
+    has_due_ = false;
+    next_due_us_ = 0;
+}
+
+bool FrameDropController::Admit(uint64_t timestamp_us) {
+    if (config_.policy != kFrameDropAdaptive) {
+        return true;
+    }
+    const uint64_t interval_us = 1000000 / target_fps_;
+    // Start over after a pause, or if the clock went back.
+    if (!has_due_ || timestamp_us > next_due_us_ + interval_us ||
+        timestamp_us + 2 * interval_us < next_due_us_) {
+        has_due_ = true;
+        next_due_us_ = timestamp_us;
+    }
+    // A quarter interval of slack keeps capture jitter from costing frames.
+    if (timestamp_us + interval_us / 4 < next_due_us_) {
+        return false;
+    }
+    next_due_us_ += interval_us;
+    return true;
+}
+
+void FrameDropController::OnFrameProcessed(uint64_t process_us) {
+    if (process_us_ == 0) {
+        process_us_ = process_us > 0 ? process_us : 1;
+    } else if (process_us >= process_us_) {
+        process_us_ += (process_us - process_us_) >> kProcessSmoothingShift;
+    } else {
+        process_us_ -= (process_us_ - process_us) >> kProcessSmoothingShift;
+    }
+    if (config_.policy != kFrameDropAdaptive) {
+        return;
+    }
+    const double sustainable = config_.load_target * 1000000.0 / (double)process_us_;
+    if (sustainable < target_fps_) {
+        target_fps_ = sustainable > config_.min_fps ? (uint32_t)sustainable : config_.min_fps;
+    } else if (sustainable >= (target_fps_ + 1) * kRaiseMargin && target_fps_ < config_.max_fps) {
+        ++target_fps_;
+    }
+}
+
+uint32_t FrameDropController::GetTargetFps() const {
+    return target_fps_;
+}
+
+uint32_t FrameDropController::GetProcessUs() const {
+    return (uint32_t)process_us_;
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+﻿#pragma once
+#include <cstdint>
+
+enum FrameDropPolicy {
+    // Up to capacity frames wait; one arriving at a full mailbox pushes out the oldest.
+    kFrameDropOldest = 0,
+    // Only the newest frame waits, replacing any the consumer has not taken yet.
+    kFrameKeepLatest = 1,
+    // Keep-latest, and frames are also turned away on arrival to bring the frame rate down
+    // to what the consumer sustains, measured from how long it takes per frame.
+    kFrameDropAdaptive = 2,
+};
+
+struct FrameDropConfig {
+    FrameDropPolicy policy{kFrameKeepLatest};
+    // Frames that may wait with kFrameDropOldest.
+    uint32_t capacity{3};
+    // kFrameDropAdaptive keeps the frame rate within these.
+    uint32_t max_fps{30};
+    uint32_t min_fps{5};
+    // Share of the frame interval the consumer may spend on a frame; the rest absorbs spikes.
+    float load_target{0.8f};
+};
+
+struct FrameDropStats {
+    uint64_t frames_pushed;
+    uint64_t frames_delivered;
+    uint64_t dropped_stale; // replaced or pushed out before the consumer took them
+    uint64_t dropped_rate;  // turned away by the adaptive frame rate
+    uint32_t target_fps;    // adaptive frame rate now, max_fps with the other policies
+    uint32_t process_us;    // smoothed time the consumer spends per frame
+};
+
+// The drop-policy engine behind FrameMailbox. It learns how long the consumer takes per frame
+// and, with kFrameDropAdaptive, derives the frame rate the consumer can keep up with. The
+// rate drops at once when frames take longer than the budget, and climbs back by 1 fps per
+// frame once there is clear room again. Admit then spaces frames evenly at that rate by their
+// capture timestamps, so the consumer gets a steady lower rate instead of bursts and gaps.
+// Not thread safe; the mailbox calls it under its lock.
+class FrameDropController {
+public:
+    FrameDropController();
+
+    void SetConfig(const FrameDropConfig& config);
+    FrameDropConfig GetConfig() const;
+    // Forgets the measurements and goes back to max_fps.
+    void Reset();
+
+    // Whether a frame captured at timestamp_us goes in. Only kFrameDropAdaptive turns any
+    // away.
+    bool Admit(uint64_t timestamp_us);
+    // The consumer spent process_us on a frame.
+    void OnFrameProcessed(uint64_t process_us);
+
+    uint32_t GetTargetFps() const;
+    uint32_t GetProcessUs() const;
+
+private:
+    FrameDropConfig config_{};
+    uint32_t target_fps_{};
+    uint64_t process_us_{};
+    bool has_due_{};
+    uint64_t next_due_us_{};
+};
\ No newline at end of file
@@ -0,0 +1,104 @@
+﻿#include "frame_mailbox.h"
+
+#include <chrono>
+
+#include "media_clock.h"
+
+FrameMailbox::FrameMailbox(const FrameDropConfig& config) {
+    controller_.SetConfig(config);
+}
+
+FrameMailbox::~FrameMailbox() {
+
+}
+
+void FrameMailbox::SetConfig(const FrameDropConfig& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.dropped_stale += frames_.size();
+    frames_.clear();
+    controller_.SetConfig(config);
+    consumer_busy_ = false;
+}
+
+bool FrameMailbox::Push(std::shared_ptr<VideoFrame> frame) {
+    if (!frame) {
+        return false;
+    }
+    uint64_t timestamp_us = frame->GetTimestamp();
+    if (timestamp_us == 0) {
+        timestamp_us = MediaClockNowUs();
+    }
+    std::shared_ptr<VideoFrame> stale;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closed_) {
+            return false;
+        }
+        ++stats_.frames_pushed;
+        if (!controller_.Admit(timestamp_us)) {
+            ++stats_.dropped_rate;
+            return false;
+        }
+        const FrameDropConfig& config = controller_.GetConfig();
+        const size_t capacity = config.policy == kFrameDropOldest ? config.capacity : 1;
+        while (frames_.size() >= capacity) {
+            // Released outside the lock; the last reference may hand a buffer back to its pool.
+            stale = std::move(frames_.front());
+            frames_.pop_front();
+            ++stats_.dropped_stale;
+        }
+        frames_.push_back(std::move(frame));
+    }
+    cv_.notify_one();
+    return true;
+}
+
+bool FrameMailbox::Pop(std::shared_ptr<VideoFrame>& frame, uint32_t timeout_ms) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (consumer_busy_) {
+        consumer_busy_ = false;
+        controller_.OnFrameProcessed(MediaClockNowUs() - popped_us_);
+    }
+    cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                 [this]() { return closed_ || !frames_.empty(); });
+    if (closed_ || frames_.empty()) {
+        return false;
+    }
+    frame = std::move(frames_.front());
+    frames_.pop_front();
+    ++stats_.frames_delivered;
+    consumer_busy_ = true;
+    popped_us_ = MediaClockNowUs();
+    return true;
+}
+
+void FrameMailbox::Close() {
+    std::deque<std::shared_ptr<VideoFrame>> stale;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        stats_.dropped_stale += frames_.size();
+        stale.swap(frames_);
+        consumer_busy_ = false;
+    }
+    cv_.notify_all();
+}
+
+void FrameMailbox::Open() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = false;
+    controller_.Reset();
+}
+
+FrameDropStats FrameMailbox::GetStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    FrameDropStats stats = stats_;
+    stats.target_fps = controller_.GetTargetFps();
+    stats.process_us = controller_.GetProcessUs();
+    return stats;
+}
+
+uint32_t FrameMailbox::GetTargetFps() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return controller_.GetTargetFps();
+}
\ No newline at end of file
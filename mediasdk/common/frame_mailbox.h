@@ -0,0 +1,52 @@
+﻿#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+#include "frame_drop_policy.h"
+#include "video_frame.h"
+
+// Hands video frames from a producer, such as a capture callback, to one consumer thread,
+// such as an encoder or a renderer, without letting them pile up when the consumer falls
+// behind. Push never blocks; the policy decides which frames are dropped instead (see
+// FrameDropPolicy), so what the consumer takes is as fresh as possible. The time the consumer
+// spends per frame is measured from one Pop returning a frame to the next Pop, which is what
+// kFrameDropAdaptive lowers the frame rate by. Interactive video wants freshness rather than
+// completeness; a recording that must keep every frame should not go through here.
+class FrameMailbox {
+public:
+    explicit FrameMailbox(const FrameDropConfig& config = FrameDropConfig());
+    ~FrameMailbox();
+
+    // Drops what is waiting and starts over with the new policy.
+    void SetConfig(const FrameDropConfig& config);
+
+    // False if the frame was turned away or the mailbox is closed.
+    bool Push(std::shared_ptr<VideoFrame> frame);
+    // Waits up to timeout_ms for a frame, oldest first. False on timeout or once closed.
+    bool Pop(std::shared_ptr<VideoFrame>& frame, uint32_t timeout_ms);
+
+    // Drops what is waiting and wakes the consumer; Push and Pop fail until Open.
+    void Close();
+    void Open();
+
+    FrameDropStats GetStats();
+    // The frame rate the consumer keeps up with, for a producer that can capture less.
+    uint32_t GetTargetFps();
+
+private:
+    FrameMailbox(const FrameMailbox&) = delete;
+    FrameMailbox& operator=(const FrameMailbox&) = delete;
+
+private:
+    std::mutex mutex_{};
+    std::condition_variable cv_{};
+    std::deque<std::shared_ptr<VideoFrame>> frames_{};
+    FrameDropController controller_{};
+    bool closed_{};
+    bool consumer_busy_{}; // a frame was popped and the consumer has not come back yet
+    uint64_t popped_us_{};
+    FrameDropStats stats_{};
+};
\ No newline at end of file
@@ -0,0 +1,300 @@
+#include "h264_sps_parser.h"
+
+#include "bit_reader.h"
+
+namespace {
+
+const uint32_t kExtendedSar = 255;
+
+// Table E-1 sample aspect ratios for aspect_ratio_idc 1..16
+const uint8_t kSarTable[17][2] = {{0, 0},   {1, 1},   {12, 11}, {10, 11}, {16, 11}, {40, 33},
+                                  {24, 11}, {20, 11}, {32, 11}, {80, 33}, {18, 11}, {15, 11},
+                                  {64, 33}, {160, 99}, {4, 3},  {3, 2},   {2, 1}};
+
+const uint8_t* SkipStartCode(const uint8_t* data, size_t* size) {
+    if (*size >= 4 && data[0] == 0 && data[1] == 0 && data[2] == 0 && data[3] == 1) {
+        *size -= 4;
+        return data + 4;
+    }
+    if (*size >= 3 && data[0] == 0 && data[1] == 0 && data[2] == 1) {
+        *size -= 3;
+        return data + 3;
+    }
+    return data;
+}
+
+void SkipScalingList(BitReader& br, int size_of_scaling_list) {
+    int last_scale = 8;
+    int next_scale = 8;
+    for (int j = 0; j < size_of_scaling_list; ++j) {
+        if (next_scale != 0) {
+            int delta_scale = br.ReadSE();
+            next_scale = (last_scale + delta_scale + 256) % 256;
+        }
+        last_scale = (next_scale == 0) ? last_scale : next_scale;
+    }
+}
+
+void SkipHrdParameters(BitReader& br) {
+    uint32_t cpb_cnt_minus1 = br.ReadUE();
+    br.SkipBits(4 + 4); // bit_rate_scale, cpb_size_scale
+    for (uint32_t i = 0; i <= cpb_cnt_minus1 && i < 32; ++i) {
+        br.ReadUE(); // bit_rate_value_minus1
+        br.ReadUE(); // cpb_size_value_minus1
+        br.ReadBit(); // cbr_flag
+    }
+    // initial_cpb_removal_delay_length_minus1, cpb_removal_delay_length_minus1,
+    // dpb_output_delay_length_minus1, time_offset_length
+    br.SkipBits(5 * 4);
+}
+
+void ParseVuiParameters(BitReader& br, H264SpsInfo* info) {
+    info->vui_present = true;
+    if (br.ReadBit()) { // aspect_ratio_info_present_flag
+        uint32_t aspect_ratio_idc = br.ReadBits(8);
+        if (aspect_ratio_idc == kExtendedSar) {
+            info->sar_width = br.ReadBits(16);
+            info->sar_height = br.ReadBits(16);
+        } else if (aspect_ratio_idc < 17) {
+            info->sar_width = kSarTable[aspect_ratio_idc][0];
+            info->sar_height = kSarTable[aspect_ratio_idc][1];
+        }
+    }
+    if (br.ReadBit()) { // overscan_info_present_flag
+        br.ReadBit(); // overscan_appropriate_flag
+    }
+    if (br.ReadBit()) { // video_signal_type_present_flag
+        br.SkipBits(3); // video_format
+        info->video_full_range = br.ReadBit() != 0;
+        if (br.ReadBit()) { // colour_description_present_flag
+            info->colour_primaries = (uint8_t)br.ReadBits(8);
+            info->transfer_characteristics = (uint8_t)br.ReadBits(8);
+            info->matrix_coefficients = (uint8_t)br.ReadBits(8);
+        }
+    }
+    if (br.ReadBit()) { // chroma_loc_info_present_flag
+        br.ReadUE(); // chroma_sample_loc_type_top_field
+        br.ReadUE(); // chroma_sample_loc_type_bottom_field
+    }
+    info->timing_info_present = br.ReadBit() != 0;
+    if (info->timing_info_present) {
+        info->num_units_in_tick = br.ReadBits(32);
+        info->time_scale = br.ReadBits(32);
+        info->fixed_frame_rate = br.ReadBit() != 0;
+        if (info->num_units_in_tick > 0 && info->time_scale > 0) {
+            // one frame is two field ticks
+            info->frame_rate = (double)info->time_scale / (2.0 * info->num_units_in_tick);
+        }
+    }
+    uint32_t nal_hrd_parameters_present_flag = br.ReadBit();
+    if (nal_hrd_parameters_present_flag) {
+        SkipHrdParameters(br);
+    }
+    uint32_t vcl_hrd_parameters_present_flag = br.ReadBit();
+    if (vcl_hrd_parameters_present_flag) {
+        SkipHrdParameters(br);
+    }
+    if (nal_hrd_parameters_present_flag || vcl_hrd_parameters_present_flag) {
+        br.ReadBit(); // low_delay_hrd_flag
+    }
+    br.ReadBit(); // pic_struct_present_flag
+    if (br.ReadBit()) { // bitstream_restriction_flag
+        br.ReadBit(); // motion_vectors_over_pic_boundaries_flag
+        br.ReadUE(); // max_bytes_per_pic_denom
+        br.ReadUE(); // max_bits_per_mb_denom
+        br.ReadUE(); // log2_max_mv_length_horizontal
+        br.ReadUE(); // log2_max_mv_length_vertical
+        info->max_num_reorder_frames = br.ReadUE();
+        br.ReadUE(); // max_dec_frame_buffering
+    }
+}
+
+} // namespace
+
+bool ParseH264Sps(const uint8_t* data, size_t size, H264SpsInfo* info) {
+    if (!data || !info) {
+        return false;
+    }
+    data = SkipStartCode(data, &size);
+    if (size < 4 || (data[0] & 0x1F) != 7) {
+        return false;
+    }
+
+    H264SpsInfo sps;
+    BitReader br(data + 1, size - 1);
+    sps.profile_idc = (uint8_t)br.ReadBits(8);
+    sps.constraint_flags = (uint8_t)br.ReadBits(8);
+    sps.level_idc = (uint8_t)br.ReadBits(8);
+    sps.sps_id = br.ReadUE();
+    if (sps.sps_id > 31) {
+        return false;
+    }
+
+    uint32_t separate_colour_plane_flag = 0;
+    const uint8_t profile = sps.profile_idc;
+    if (profile == 100 || profile == 110 || profile == 122 || profile == 244 || profile == 44 ||
+        profile == 83 || profile == 86 || profile == 118 || profile == 128 || profile == 138 ||
+        profile == 139 || profile == 134 || profile == 135) {
+        sps.chroma_format_idc = br.ReadUE();
+        if (sps.chroma_format_idc > 3) {
+            return false;
+        }
+        if (sps.chroma_format_idc == 3) {
+            separate_colour_plane_flag = br.ReadBit();
+        }
+        sps.bit_depth_luma = br.ReadUE() + 8;
+        sps.bit_depth_chroma = br.ReadUE() + 8;
+        br.ReadBit(); // qpprime_y_zero_transform_bypass_flag
+        if (br.ReadBit()) { // seq_scaling_matrix_present_flag
+            int lists = (sps.chroma_format_idc != 3) ? 8 : 12;
+            for (int i = 0; i < lists; ++i) {
+                if (br.ReadBit()) { // seq_scaling_list_present_flag[i]
+                    SkipScalingList(br, i < 6 ? 16 : 64);
+                }
+            }
+        }
+    }
+
+    br.ReadUE(); // log2_max_frame_num_minus4
+    uint32_t pic_order_cnt_type = br.ReadUE();
+    if (pic_order_cnt_type == 0) {
+        br.ReadUE(); // log2_max_pic_order_cnt_lsb_minus4
+    } else if (pic_order_cnt_type == 1) {
+        br.ReadBit(); // delta_pic_order_always_zero_flag
+        br.ReadSE(); // offset_for_non_ref_pic
+        br.ReadSE(); // offset_for_top_to_bottom_field
+        uint32_t num_ref_frames_in_pic_order_cnt_cycle = br.ReadUE();
+        if (num_ref_frames_in_pic_order_cnt_cycle > 255) {
+            return false;
+        }
+        for (uint32_t i = 0; i < num_ref_frames_in_pic_order_cnt_cycle; ++i) {
+            br.ReadSE(); // offset_for_ref_frame[i]
+        }
+    } else if (pic_order_cnt_type > 2) {
+        return false;
+    }
+    sps.max_num_ref_frames = br.ReadUE();
+    br.ReadBit(); // gaps_in_frame_num_value_allowed_flag
+    uint32_t pic_width_in_mbs = br.ReadUE() + 1;
+    uint32_t pic_height_in_map_units = br.ReadUE() + 1;
+    sps.frame_mbs_only = br.ReadBit() != 0;
+    if (!sps.frame_mbs_only) {
+        br.ReadBit(); // mb_adaptive_frame_field_flag
+    }
+    br.ReadBit(); // direct_8x8_inference_flag
+
+    uint32_t crop_left = 0, crop_right = 0, crop_top = 0, crop_bottom = 0;
+    if (br.ReadBit()) { // frame_cropping_flag
+        crop_left = br.ReadUE();
+        crop_right = br.ReadUE();
+        crop_top = br.ReadUE();
+        crop_bottom = br.ReadUE();
+    }
+    if (br.ReadBit()) { // vui_parameters_present_flag
+        ParseVuiParameters(br, &sps);
+    }
+    if (br.IsOverrun()) {
+        return false;
+    }
+
+    // 7.4.2.1.1: crop offsets are in chroma sample units
+    const uint32_t frame_height_in_mbs = (sps.frame_mbs_only ? 1 : 2) * pic_height_in_map_units;
+    const uint32_t chroma_array_type = separate_colour_plane_flag ? 0 : sps.chroma_format_idc;
+    uint32_t crop_unit_x = 1;
+    uint32_t crop_unit_y = sps.frame_mbs_only ? 1 : 2;
+    if (chroma_array_type != 0) {
+        const uint32_t sub_width_c = (chroma_array_type == 3) ? 1 : 2;
+        const uint32_t sub_height_c = (chroma_array_type == 1) ? 2 : 1;
+        crop_unit_x = sub_width_c;
+        crop_unit_y *= sub_height_c;
+    }
+    const uint32_t full_width = pic_width_in_mbs * 16;
+    const uint32_t full_height = frame_height_in_mbs * 16;
+    const uint32_t crop_x = crop_unit_x * (crop_left + crop_right);
+    const uint32_t crop_y = crop_unit_y * (crop_top + crop_bottom);
+    if (crop_x >= full_width || crop_y >= full_height) {
+        return false;
+    }
+    sps.width = full_width - crop_x;
+    sps.height = full_height - crop_y;
+
+    *info = sps;
+    return true;
+}
+
+bool ParseH264Pps(const uint8_t* data, size_t size, uint32_t chroma_format_idc, H264PpsInfo* info) {
+    if (!data || !info) {
+        return false;
+    }
+    data = SkipStartCode(data, &size);
+    if (size < 2 || (data[0] & 0x1F) != 8) {
+        return false;
+    }
+
+    H264PpsInfo pps;
+    BitReader br(data + 1, size - 1);
+    pps.pps_id = br.ReadUE();
+    pps.sps_id = br.ReadUE();
+    if (pps.pps_id > 255 || pps.sps_id > 31) {
+        return false;
+    }
+    pps.entropy_coding_mode = br.ReadBit() != 0;
+    pps.bottom_field_pic_order_in_frame_present = br.ReadBit() != 0;
+    pps.num_slice_groups = br.ReadUE() + 1;
+    if (pps.num_slice_groups > 8) {
+        return false;
+    }
+    if (pps.num_slice_groups > 1) {
+        uint32_t slice_group_map_type = br.ReadUE();
+        if (slice_group_map_type == 0) {
+            for (uint32_t i = 0; i < pps.num_slice_groups; ++i) {
+                br.ReadUE(); // run_length_minus1
+            }
+        } else if (slice_group_map_type == 2) {
+            for (uint32_t i = 0; i + 1 < pps.num_slice_groups; ++i) {
+                br.ReadUE(); // top_left
+                br.ReadUE(); // bottom_right
+            }
+        } else if (slice_group_map_type >= 3 && slice_group_map_type <= 5) {
+            br.ReadBit(); // slice_group_change_direction_flag
+            br.ReadUE(); // slice_group_change_rate_minus1
+        } else if (slice_group_map_type == 6) {
+            uint32_t pic_size_in_map_units = br.ReadUE() + 1;
+            int id_bits = 0;
+            while ((1u << id_bits) < pps.num_slice_groups) {
+                ++id_bits;
+            }
+            for (uint32_t i = 0; i < pic_size_in_map_units && !br.IsOverrun(); ++i) {
+                br.SkipBits(id_bits); // slice_group_id
+            }
+        }
+    }
+    pps.num_ref_idx_l0_default_active = br.ReadUE() + 1;
+    pps.num_ref_idx_l1_default_active = br.ReadUE() + 1;
+    pps.weighted_pred = br.ReadBit() != 0;
+    pps.weighted_bipred_idc = br.ReadBits(2);
+    pps.pic_init_qp = 26 + br.ReadSE();
+    br.ReadSE(); // pic_init_qs_minus26
+    pps.chroma_qp_index_offset = br.ReadSE();
+    pps.deblocking_filter_control_present = br.ReadBit() != 0;
+    pps.constrained_intra_pred = br.ReadBit() != 0;
+    br.ReadBit(); // redundant_pic_cnt_present_flag
+    if (br.MoreRbspData()) {
+        pps.transform_8x8_mode = br.ReadBit() != 0;
+        if (br.ReadBit()) { // pic_scaling_matrix_present_flag
+            int lists = 6 + ((chroma_format_idc != 3) ? 2 : 6) * (pps.transform_8x8_mode ? 1 : 0);
+            for (int i = 0; i < lists; ++i) {
+                if (br.ReadBit()) { // pic_scaling_list_present_flag[i]
+                    SkipScalingList(br, i < 6 ? 16 : 64);
+                }
+            }
+        }
+        br.ReadSE(); // second_chroma_qp_index_offset
+    }
+    if (br.IsOverrun()) {
+        return false;
+    }
+
+    *info = pps;
+    return true;
+}
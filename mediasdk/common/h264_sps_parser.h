@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// H.264 SPS/PPS parsing (ITU-T H.264 7.3.2.1 / 7.3.2.2 / E.1.1), based on the field-by-field
+// dump in example/h264_analyzer but without allocations or console output.
+// Input is one NAL unit including its 1-byte header; a leading start code is skipped.
+
+struct H264SpsInfo {
+    uint8_t profile_idc{};
+    uint8_t constraint_flags{}; // constraint_set0..5 flags + reserved_zero_2bits, as in the SPS
+    uint8_t level_idc{};
+    uint32_t sps_id{};
+    uint32_t chroma_format_idc{1};
+    uint32_t bit_depth_luma{8};
+    uint32_t bit_depth_chroma{8};
+    uint32_t max_num_ref_frames{};
+    bool frame_mbs_only{true};
+
+    // cropped output size in pixels
+    uint32_t width{};
+    uint32_t height{};
+
+    // VUI
+    bool vui_present{};
+    uint32_t sar_width{};
+    uint32_t sar_height{};
+    bool video_full_range{};
+    uint8_t colour_primaries{2};
+    uint8_t transfer_characteristics{2};
+    uint8_t matrix_coefficients{2};
+    bool timing_info_present{};
+    uint32_t num_units_in_tick{};
+    uint32_t time_scale{};
+    bool fixed_frame_rate{};
+    // time_scale / (2 * num_units_in_tick); 0 when the VUI carries no timing info
+    double frame_rate{};
+    uint32_t max_num_reorder_frames{};
+};
+
+struct H264PpsInfo {
+    uint32_t pps_id{};
+    uint32_t sps_id{};
+    bool entropy_coding_mode{};
+    bool bottom_field_pic_order_in_frame_present{};
+    uint32_t num_slice_groups{1};
+    uint32_t num_ref_idx_l0_default_active{1};
+    uint32_t num_ref_idx_l1_default_active{1};
+    bool weighted_pred{};
+    uint32_t weighted_bipred_idc{};
+    int32_t pic_init_qp{26};
+    int32_t chroma_qp_index_offset{};
+    bool deblocking_filter_control_present{};
+    bool constrained_intra_pred{};
+    bool transform_8x8_mode{};
+};
+
+bool ParseH264Sps(const uint8_t* data, size_t size, H264SpsInfo* info);
+
+// chroma_format_idc comes from the referenced SPS (needed for the 8x8 scaling lists).
+bool ParseH264Pps(const uint8_t* data, size_t size, uint32_t chroma_format_idc, H264PpsInfo* info);
@@ -0,0 +1,115 @@
+#include "h265_sps_parser.h"
+
+#include "bit_reader.h"
+
+namespace {
+
+const uint8_t* SkipStartCode(const uint8_t* data, size_t* size) {
+    if (*size >= 4 && data[0] == 0 && data[1] == 0 && data[2] == 0 && data[3] == 1) {
+        *size -= 4;
+        return data + 4;
+    }
+    if (*size >= 3 && data[0] == 0 && data[1] == 0 && data[2] == 1) {
+        *size -= 3;
+        return data + 3;
+    }
+    return data;
+}
+
+// profile_tier_level(1, sps_max_sub_layers_minus1), 7.3.3
+void ParseProfileTierLevel(BitReader& br, uint32_t max_sub_layers_minus1, H265SpsInfo* info) {
+    info->general_profile_space = (uint8_t)br.ReadBits(2);
+    info->general_tier_flag = br.ReadBit() != 0;
+    info->general_profile_idc = (uint8_t)br.ReadBits(5);
+    info->general_profile_compatibility_flags = br.ReadBits(32);
+    // progressive/interlaced/non_packed/frame_only flags + 43 reserved/constraint bits + 1 bit
+    uint64_t constraint = (uint64_t)br.ReadBits(16) << 32;
+    constraint |= br.ReadBits(32);
+    info->general_constraint_indicator_flags = constraint;
+    info->general_level_idc = (uint8_t)br.ReadBits(8);
+
+    bool sub_layer_profile_present[8] = {};
+    bool sub_layer_level_present[8] = {};
+    for (uint32_t i = 0; i < max_sub_layers_minus1; ++i) {
+        sub_layer_profile_present[i] = br.ReadBit() != 0;
+        sub_layer_level_present[i] = br.ReadBit() != 0;
+    }
+    if (max_sub_layers_minus1 > 0) {
+        for (uint32_t i = max_sub_layers_minus1; i < 8; ++i) {
+            br.SkipBits(2); // reserved_zero_2bits
+        }
+    }
+    for (uint32_t i = 0; i < max_sub_layers_minus1; ++i) {
+        if (sub_layer_profile_present[i]) {
+            br.SkipBits(2 + 1 + 5 + 32 + 48); // profile space/tier/idc, compat, constraints
+        }
+        if (sub_layer_level_present[i]) {
+            br.SkipBits(8); // sub_layer_level_idc
+        }
+    }
+}
+
+} // namespace
+
+bool ParseH265Sps(const uint8_t* data, size_t size, H265SpsInfo* info) {
+    if (!data || !info) {
+        return false;
+    }
+    data = SkipStartCode(data, &size);
+    if (size < 16 || H265NalType(data) != kH265NalSps) {
+        return false;
+    }
+
+    H265SpsInfo sps;
+    BitReader br(data + 2, size - 2);
+    br.SkipBits(4); // sps_video_parameter_set_id
+    uint32_t max_sub_layers_minus1 = br.ReadBits(3);
+    if (max_sub_layers_minus1 > 6) {
+        return false;
+    }
+    sps.max_sub_layers = max_sub_layers_minus1 + 1;
+    sps.temporal_id_nesting = br.ReadBit() != 0;
+    ParseProfileTierLevel(br, max_sub_layers_minus1, &sps);
+
+    sps.sps_id = br.ReadUE();
+    if (sps.sps_id > 15) {
+        return false;
+    }
+    sps.chroma_format_idc = br.ReadUE();
+    if (sps.chroma_format_idc > 3) {
+        return false;
+    }
+    uint32_t separate_colour_plane_flag = 0;
+    if (sps.chroma_format_idc == 3) {
+        separate_colour_plane_flag = br.ReadBit();
+    }
+    uint32_t pic_width = br.ReadUE();
+    uint32_t pic_height = br.ReadUE();
+    uint32_t conf_left = 0, conf_right = 0, conf_top = 0, conf_bottom = 0;
+    if (br.ReadBit()) { // conformance_window_flag
+        conf_left = br.ReadUE();
+        conf_right = br.ReadUE();
+        conf_top = br.ReadUE();
+        conf_bottom = br.ReadUE();
+    }
+    sps.bit_depth_luma = br.ReadUE() + 8;
+    sps.bit_depth_chroma = br.ReadUE() + 8;
+    if (br.IsOverrun() || pic_width == 0 || pic_height == 0) {
+        return false;
+    }
+
+    // Table 6-1: conformance window offsets are in chroma sample units
+    const uint32_t chroma_array_type = separate_colour_plane_flag ? 0 : sps.chroma_format_idc;
+    const uint32_t sub_width_c = (chroma_array_type == 1 || chroma_array_type == 2) ? 2 : 1;
+    const uint32_t sub_height_c = (chroma_array_type == 1) ? 2 : 1;
+    const uint32_t crop_x = sub_width_c * (conf_left + conf_right);
+    const uint32_t crop_y = sub_height_c * (conf_top + conf_bottom);
+    if (crop_x >= pic_width || crop_y >= pic_height) {
+        return false;
+    }
+    sps.width = pic_width - crop_x;
+    sps.height = pic_height - crop_y;
+
+    *info = sps;
+    return true;
+}
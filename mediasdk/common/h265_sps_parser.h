@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// H.265 SPS parsing up to the bit depths (ITU-T H.265 7.3.2.2 / 7.3.3): enough for
+// HEVCDecoderConfigurationRecord and stream metadata. Input is one NAL unit including its
+// 2-byte header; a leading start code is skipped.
+
+struct H265SpsInfo {
+    uint8_t general_profile_space{};
+    bool general_tier_flag{};
+    uint8_t general_profile_idc{};
+    uint32_t general_profile_compatibility_flags{};
+    // 48 bits starting at general_progressive_source_flag
+    uint64_t general_constraint_indicator_flags{};
+    uint8_t general_level_idc{};
+    uint32_t max_sub_layers{1};
+    bool temporal_id_nesting{};
+    uint32_t sps_id{};
+    uint32_t chroma_format_idc{1};
+    uint32_t bit_depth_luma{8};
+    uint32_t bit_depth_chroma{8};
+
+    // output size in pixels after the conformance window
+    uint32_t width{};
+    uint32_t height{};
+};
+
+enum H265NalType {
+    kH265NalIdrWRadl = 19,
+    kH265NalIdrNLp = 20,
+    kH265NalCraNut = 21,
+    kH265NalVps = 32,
+    kH265NalSps = 33,
+    kH265NalPps = 34,
+    kH265NalAud = 35,
+    kH265NalPrefixSei = 39,
+};
+
+inline uint8_t H265NalType(const uint8_t* nal) { return (nal[0] >> 1) & 0x3F; }
+
+bool ParseH265Sps(const uint8_t* data, size_t size, H265SpsInfo* info);
@@ -0,0 +1,38 @@
+﻿#include "media_clock.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <chrono>
+#endif
+
+#ifdef _WIN32
+
+namespace {
+
+int64_t QpcFrequency() {
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    return frequency.QuadPart;
+}
+
+} // namespace
+
+uint64_t MediaClockNowUs() {
+    static const int64_t frequency = QpcFrequency();
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    // Split so the multiplication cannot overflow however long the machine has been up.
+    const int64_t seconds = counter.QuadPart / frequency;
+    const int64_t remainder = counter.QuadPart % frequency;
+    return (uint64_t)(seconds * 1000000 + remainder * 1000000 / frequency);
+}
+
+#else
+
+uint64_t MediaClockNowUs() {
+    using namespace std::chrono;
+    return (uint64_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,7 @@
+﻿#pragma once
+#include <cstdint>
+
+// The clock every captured frame is stamped with, in microseconds. On Windows it is the
+// performance counter, the same clock WASAPI reports packet positions on (in 100 ns units),
+// so audio and video stamps compare directly. Elsewhere it is std::chrono::steady_clock.
+uint64_t MediaClockNowUs();
\ No newline at end of file
@@ -1,10 +1,12 @@
 ﻿#include "video_frame.h"
 
 #include "common/buffer_pool.h"
+#include "common/media_clock.h"
 #include <iostream>
 
 VideoFrame::VideoFrame(uint32_t width, uint32_t height, FrameType frame_type, bool use_pool)
-    : width_(width), height_(height), frame_type_(frame_type), use_pool_(use_pool) {
+    : width_(width), height_(height), frame_type_(frame_type), use_pool_(use_pool),
+      timestamp_us_(MediaClockNowUs()) {
     switch (frame_type) {
     case kFrameTypeARGB:
         size_ = width * height * 4;
@@ -84,4 +86,12 @@ uint8_t* VideoFrame::GetData() {
 
 FrameType VideoFrame::GetFrameType() {
     return frame_type_;
+}
+
+void VideoFrame::SetTimestamp(uint64_t timestamp_us) {
+    timestamp_us_ = timestamp_us;
+}
+
+uint64_t VideoFrame::GetTimestamp() const {
+    return timestamp_us_;
 }
\ No newline at end of file
@@ -22,6 +22,11 @@ public:
     uint8_t* GetData();
     FrameType GetFrameType();
 
+    // Capture time on the media clock (media_clock.h). A new frame is stamped when it is
+    // constructed, which for the capture sources is as soon as the frame arrives.
+    void SetTimestamp(uint64_t timestamp_us);
+    uint64_t GetTimestamp() const;
+
 private:
     uint32_t width_{};
     uint32_t height_{};
@@ -31,4 +36,5 @@ private:
     std::shared_ptr<Buffer> buffer_{};
     uint32_t size_{};
     bool use_pool_{false};
+    uint64_t timestamp_us_{};
 };
\ No newline at end of file
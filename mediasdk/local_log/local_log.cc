@@ -1,27 +1,86 @@
 ﻿#include "local_log.h"
 
+#include <cstdio>
+#include <cstring>
 #include <iostream>
 
 #include "log_env.h"
 #include "log_writer.h"
 
-LocalLog::LocalLog(LocalLogLevel log_level, const std::string& log_tag,
-                   const std::string& log_filename, uint32_t log_line_num)
-    : log_level_(log_level), log_tag_(log_tag), log_filename_(log_filename),
+LocalLog::LocalLog(LocalLogLevel log_level, const char* log_tag, const char* log_filename,
+                   uint32_t log_line_num)
+    : log_level_(log_level), log_tag_(log_tag ? log_tag : ""),
+      log_tag_len_(log_tag ? strlen(log_tag) : 0), log_filename_(log_filename),
       log_line_num_(log_line_num) {}
 
+LocalLog::LocalLog(LocalLogLevel log_level, const std::string& log_tag,
+                   const char* log_filename, uint32_t log_line_num)
+    : log_level_(log_level), log_tag_(log_tag.data()), log_tag_len_(log_tag.size()),
+      log_filename_(log_filename), log_line_num_(log_line_num) {}
+
 LocalLog::~LocalLog() {
     this->Write();
 }
 
-void LocalLog::Write() {
-    if (log_level_ < LogEnv::CreateInstance()->GetLogLevel()) {
-        return;
+LocalLog& LocalLog::operator<<(const char* t) {
+    // if pointer of char is NULL
+    if (t == nullptr) {
+        return *this;
+    }
+    return Append(t, strlen(t));
+}
+
+LocalLog& LocalLog::operator<<(double t) {
+    // same as the ostream default (precision 6, %g)
+    char buf[32];
+    int n = snprintf(buf, sizeof(buf), "%g", t);
+    return Append(buf, n > 0 ? (size_t)n : 0);
+}
+
+LocalLog& LocalLog::operator<<(const void* t) {
+    char buf[32];
+    int n = snprintf(buf, sizeof(buf), "%p", t);
+    return Append(buf, n > 0 ? (size_t)n : 0);
+}
+
+LocalLog& LocalLog::Append(const char* data, size_t size) {
+    if (overflow_.empty() && inline_len_ + size <= kInlineSize) {
+        memcpy(inline_buf_ + inline_len_, data, size);
+        inline_len_ += size;
+        return *this;
+    }
+    if (overflow_.empty()) {
+        overflow_.reserve(inline_len_ + size + kInlineSize);
+        overflow_.assign(inline_buf_, inline_len_);
     }
-    auto pos = log_filename_.rfind("\\");
-    log_filename_ = log_filename_.substr(pos + 1, log_filename_.length() - pos - 1);
-    LogWriter::CreateInstance()->WriteLog(log_level_, log_tag_, log_filename_, log_line_num_,
-                                          oss_.str());
+    overflow_.append(data, size);
+    return *this;
+}
+
+LocalLog& LocalLog::AppendInt(long long v) {
+    if (v >= 0) {
+        return AppendUInt((unsigned long long)v);
+    }
+    char c = '-';
+    Append(&c, 1);
+    return AppendUInt(0ull - (unsigned long long)v);
+}
+
+LocalLog& LocalLog::AppendUInt(unsigned long long v) {
+    char buf[24];
+    char* p = buf + sizeof(buf);
+    do {
+        *--p = (char)('0' + v % 10);
+        v /= 10;
+    } while (v != 0);
+    return Append(p, buf + sizeof(buf) - p);
+}
+
+void LocalLog::Write() {
+    const bool inline_text = overflow_.empty();
+    LogWriter::CreateInstance()->WriteLog(
+        log_level_, log_tag_, log_tag_len_, log_filename_, log_line_num_,
+        inline_text ? inline_buf_ : overflow_.data(), inline_text ? inline_len_ : overflow_.size());
 }
 
 void SetLocalLogLevel(LocalLogLevel log_level) {
@@ -30,4 +89,13 @@ void SetLocalLogLevel(LocalLogLevel log_level) {
 
 void SetLocalLogDir(const std::string& log_dir) {
     LogEnv::CreateInstance()->SetLogDir(log_dir);
+}
+
+void SetLocalLogFormat(LocalLogFormat log_format) {
+    LogEnv::CreateInstance()->SetLogFormat(log_format);
+    LogWriter::CreateInstance()->SaveFile();
+}
+
+bool EnableLocalLogFlightRecorder(uint32_t ring_size, LocalLogLevel file_level) {
+    return LogWriter::CreateInstance()->EnableFlightRecorder(ring_size, file_level);
 }
\ No newline at end of file
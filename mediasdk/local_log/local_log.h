@@ -1,46 +1,116 @@
 ﻿#pragma once
 #include "log_common.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <sstream>
 #include <string>
+#include <type_traits>
+
+// Levels below LOCAL_LOG_MIN_LEVEL are compiled out: the macros fold to a constant-false
+// branch and their arguments are never evaluated. Define it per target, e.g.
+// -DLOCAL_LOG_MIN_LEVEL=kLocalLogLevelInfo for release builds.
+#ifndef LOCAL_LOG_MIN_LEVEL
+#define LOCAL_LOG_MIN_LEVEL kLocalLogLevelDebug
+#endif
+
+// Runtime level, owned by LogEnv. Kept as a plain atomic so the check inlines into each macro.
+extern std::atomic<int> g_local_log_level;
+
+inline bool LocalLogEnabled(LocalLogLevel log_level) {
+    return log_level >= LOCAL_LOG_MIN_LEVEL &&
+           log_level >= g_local_log_level.load(std::memory_order_relaxed);
+}
+
+// Offset of the file name in a path, usable in constant expressions (C++11 form).
+constexpr size_t LocalLogBasenameOffset(const char* path, size_t i = 0, size_t last = 0) {
+    return path[i] == '\0'
+               ? last
+               : LocalLogBasenameOffset(path, i + 1,
+                                        (path[i] == '/' || path[i] == '\\') ? i + 1 : last);
+}
 
 class LocalLog {
 public:
-    LocalLog(LocalLogLevel log_level, const std::string& log_tag, const std::string& log_filename,
+    LocalLog(LocalLogLevel log_level, const char* log_tag, const char* log_filename,
+             uint32_t log_line_num);
+    LocalLog(LocalLogLevel log_level, const std::string& log_tag, const char* log_filename,
              uint32_t log_line_num);
 
     ~LocalLog();
 
-    template <typename T> LocalLog& operator<<(const T& t) {
-        oss_ << t;
-        return *this;
+    // Common types are formatted straight into an inline buffer; anything else goes through
+    // its ostream operator<<.
+    LocalLog& operator<<(const char* t);
+    LocalLog& operator<<(char* t) { return *this << (const char*)t; }
+    LocalLog& operator<<(const std::string& t) { return Append(t.data(), t.size()); }
+    LocalLog& operator<<(char t) { return Append(&t, 1); }
+    LocalLog& operator<<(signed char t) { return *this << (char)t; }
+    LocalLog& operator<<(unsigned char t) { return *this << (char)t; }
+    LocalLog& operator<<(bool t) { return Append(t ? "1" : "0", 1); }
+    LocalLog& operator<<(double t);
+    LocalLog& operator<<(long double t) { return *this << (double)t; }
+    LocalLog& operator<<(const void* t);
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value, LocalLog&>::type operator<<(T t) {
+        return std::is_signed<T>::value ? AppendInt((long long)t)
+                                        : AppendUInt((unsigned long long)t);
     }
 
-    // if pointer of char is NULL
-    template <typename T> LocalLog& operator<<(T* t) {
-        if (t == nullptr) {
-            oss_ << "";
-        } else {
-            oss_ << t;
-        }
-        return *this;
+    template <typename T>
+    typename std::enable_if<!std::is_arithmetic<T>::value, LocalLog&>::type
+    operator<<(const T& t) {
+        std::ostringstream oss;
+        oss << t;
+        return *this << oss.str();
     }
 
 private:
+    LocalLog& Append(const char* data, size_t size);
+    LocalLog& AppendInt(long long v);
+    LocalLog& AppendUInt(unsigned long long v);
     void Write();
 
 private:
+    static const size_t kInlineSize = 256;
+
     LocalLogLevel log_level_{};
-    std::string log_tag_{};
-    std::string log_filename_{};
+    const char* log_tag_{};
+    size_t log_tag_len_{};
+    const char* log_filename_{};
     uint32_t log_line_num_{};
-    std::ostringstream oss_;
+    char inline_buf_[kInlineSize];
+    size_t inline_len_{};
+    // takes over once a line outgrows inline_buf_
+    std::string overflow_{};
+};
+
+// Lets the macros below be a single expression, so they are safe inside if/else without braces.
+struct LocalLogVoidify {
+    void operator&(const LocalLog&) {}
 };
 
-#define LOGD(log_tag) LocalLog(kLocalLogLevelDebug, log_tag, __FILE__, __LINE__)
-#define LOGI(log_tag) LocalLog(kLocalLogLevelInfo, log_tag, __FILE__, __LINE__)
-#define LOGW(log_tag) LocalLog(kLocalLogLevelWarning, log_tag, __FILE__, __LINE__)
-#define LOGE(log_tag) LocalLog(kLocalLogLevelError, log_tag, __FILE__, __LINE__)
-#define LOGN(log_tag) LocalLog(kLocalLogLevelNone, log_tag, __FILE__, __LINE__)
+#define LOCAL_LOG_FILE                                                                             \
+    (__FILE__ + std::integral_constant<size_t, LocalLogBasenameOffset(__FILE__)>::value)
+
+#define LOCAL_LOG(log_level, log_tag)                                                              \
+    !LocalLogEnabled(log_level)                                                                    \
+        ? (void)0                                                                                  \
+        : LocalLogVoidify() & LocalLog(log_level, log_tag, LOCAL_LOG_FILE, __LINE__)
+
+#define LOGD(log_tag) LOCAL_LOG(kLocalLogLevelDebug, log_tag)
+#define LOGI(log_tag) LOCAL_LOG(kLocalLogLevelInfo, log_tag)
+#define LOGW(log_tag) LOCAL_LOG(kLocalLogLevelWarning, log_tag)
+#define LOGE(log_tag) LOCAL_LOG(kLocalLogLevelError, log_tag)
+#define LOGN(log_tag) LOCAL_LOG(kLocalLogLevelNone, log_tag)
 
 void SetLocalLogLevel(LocalLogLevel log_level);
-void SetLocalLogDir(const std::string& log_dir);
\ No newline at end of file
+void SetLocalLogDir(const std::string& log_dir);
+// Closes the current file; the next line starts a new file in the requested format.
+void SetLocalLogFormat(LocalLogFormat log_format);
+// Keeps every line that passes the runtime level in a fixed-size memory-mapped ring
+// (Logs/flight.ring) that can be read with log_decoder after a crash; only lines at or above
+// file_level still reach the log file. Pair with SetLocalLogLevel(kLocalLogLevelDebug) to keep
+// DEBUG detail in the ring only.
+bool EnableLocalLogFlightRecorder(uint32_t ring_size, LocalLogLevel file_level);
\ No newline at end of file
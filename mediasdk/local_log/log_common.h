@@ -6,4 +6,10 @@ enum LocalLogLevel {
     kLocalLogLevelWarning,
     kLocalLogLevelError,
     kLocalLogLevelNone
+};
+
+enum LocalLogFormat {
+    kLocalLogFormatText,
+    // compact .blog files, turned back into text by the log_decoder tool
+    kLocalLogFormatBinary
 };
\ No newline at end of file
@@ -1,11 +1,14 @@
 ﻿#include "log_env.h"
 
+#include "local_log.h"
 #include "log_utils.h"
 
 const uint32_t kDefaultFileSize = 10 * 1024 * 1024;         // 4MB
 const uint64_t kDefaultMaxLogSize = 1 * 1024 * 1024 * 1024; // 1GB
 const uint32_t kDefaultExpiredTime = 7;                     // 7day
 
+std::atomic<int> g_local_log_level{kLocalLogLevelInfo};
+
 LogEnv* LogEnv::CreateInstance() {
     static LogEnv* instance = new LogEnv();
     return instance;
@@ -51,14 +54,22 @@ std::string LogEnv::GetLogDir() {
     return log_dir_;
 }
 
-void LogEnv::SetLogLevel(LocalLogLevel log_level_) {
+void LogEnv::SetLogFormat(LocalLogFormat log_format) {
     std::unique_lock<std::mutex> lock(mtx_);
-    log_level_ = log_level_;
+    log_format_ = log_format;
 }
 
-LocalLogLevel LogEnv::GetLogLevel() {
+LocalLogFormat LogEnv::GetLogFormat() {
     std::unique_lock<std::mutex> lock(mtx_);
-    return log_level_;
+    return log_format_;
+}
+
+void LogEnv::SetLogLevel(LocalLogLevel log_level) {
+    g_local_log_level.store(log_level, std::memory_order_relaxed);
+}
+
+LocalLogLevel LogEnv::GetLogLevel() {
+    return (LocalLogLevel)g_local_log_level.load(std::memory_order_relaxed);
 }
 
 LogEnv::LogEnv() {
@@ -21,7 +21,10 @@ public:
     void SetLogDir(const std::string& log_dir);
     std::string GetLogDir();
 
-    void SetLogLevel(LocalLogLevel log_level_);
+    void SetLogFormat(LocalLogFormat log_format);
+    LocalLogFormat GetLogFormat();
+
+    void SetLogLevel(LocalLogLevel log_level);
     LocalLogLevel GetLogLevel();
 
 private:
@@ -36,5 +39,5 @@ private:
     uint64_t max_log_size_{};
     uint32_t expired_time_{};
     std::string log_dir_{};
-    LocalLogLevel log_level_{kLocalLogLevelInfo};
+    LocalLogFormat log_format_{kLocalLogFormatText};
 };
\ No newline at end of file
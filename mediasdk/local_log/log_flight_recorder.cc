@@ -0,0 +1,177 @@
+﻿#include "log_flight_recorder.h"
+
+#include <cstring>
+#include <new>
+#include <vector>
+
+namespace {
+
+const char kFlightMagic[8] = {'M', 'S', 'D', 'K', 'R', 'I', 'N', 'G'};
+const uint32_t kFlightVersion = 1;
+const uint32_t kFlightHeaderSize = 64;
+// written into a record's pos field until the record is complete
+const uint64_t kIncompletePos = ~0ull;
+
+struct FlightRecorderHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t capacity;
+    uint64_t write_pos; // accessed as std::atomic<uint64_t> by the writers
+};
+
+struct FlightRecord {
+    uint64_t pos; // logical ring position of this record, stored last
+    int64_t time_us;
+    uint32_t size; // whole record, 8-byte aligned
+    uint32_t line;
+    uint32_t thread_id;
+    uint32_t text_len;
+    uint16_t tag_len;
+    uint16_t file_len;
+    uint8_t level;
+    uint8_t reserved[3];
+};
+
+static_assert(sizeof(FlightRecorderHeader) <= kFlightHeaderSize, "header too large");
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "atomic must be lock-free");
+
+void CopyOut(const uint8_t* ring, uint64_t capacity, uint64_t pos, void* dst, size_t len) {
+    const uint64_t offset = pos % capacity;
+    const size_t first = (size_t)(capacity - offset < len ? capacity - offset : len);
+    memcpy(dst, ring + offset, first);
+    memcpy((uint8_t*)dst + first, ring, len - first);
+}
+
+} // namespace
+
+LogFlightRecorder::LogFlightRecorder() {}
+
+LogFlightRecorder::~LogFlightRecorder() {}
+
+bool LogFlightRecorder::Open(const std::string& filename, uint32_t capacity) {
+    capacity = (capacity + 7) & ~7u;
+    if (capacity < 4096 || !file_.Open(filename, kFlightHeaderSize + capacity)) {
+        return false;
+    }
+    char* base = file_.Append(kFlightHeaderSize + capacity);
+    FlightRecorderHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kFlightMagic, sizeof(kFlightMagic));
+    header.version = kFlightVersion;
+    header.header_size = kFlightHeaderSize;
+    header.capacity = capacity;
+    memcpy(base, &header, sizeof(header));
+    write_pos_ = new (base + offsetof(FlightRecorderHeader, write_pos)) std::atomic<uint64_t>(0);
+    ring_ = base + kFlightHeaderSize;
+    capacity_ = capacity;
+    return true;
+}
+
+bool LogFlightRecorder::IsOpen() const {
+    return ring_ != nullptr;
+}
+
+void LogFlightRecorder::Append(LocalLogLevel level, int64_t time_us, uint32_t thread_id,
+                               const char* tag, size_t tag_len, const char* file,
+                               size_t file_len, uint32_t line, const char* text,
+                               size_t text_len) {
+    tag_len = tag_len > 0xFFFF ? 0xFFFF : tag_len;
+    file_len = file_len > 0xFFFF ? 0xFFFF : file_len;
+    // keep a single record well below the ring size so it never laps itself
+    const size_t max_text = (size_t)(capacity_ / 4);
+    text_len = text_len > max_text ? max_text : text_len;
+    const uint32_t size =
+        (uint32_t)((sizeof(FlightRecord) + tag_len + file_len + text_len + 7) & ~(size_t)7);
+
+    const uint64_t pos = write_pos_->fetch_add(size, std::memory_order_relaxed);
+    FlightRecord record;
+    record.pos = kIncompletePos;
+    record.time_us = time_us;
+    record.size = size;
+    record.line = line;
+    record.thread_id = thread_id;
+    record.text_len = (uint32_t)text_len;
+    record.tag_len = (uint16_t)tag_len;
+    record.file_len = (uint16_t)file_len;
+    record.level = (uint8_t)level;
+    memset(record.reserved, 0, sizeof(record.reserved));
+    CopyIn(pos, &record, sizeof(record));
+    uint64_t at = pos + sizeof(record);
+    CopyIn(at, tag, tag_len);
+    at += tag_len;
+    CopyIn(at, file, file_len);
+    at += file_len;
+    CopyIn(at, text, text_len);
+    // Publishing the position marks the record complete. Records are 8-byte aligned, so the
+    // field never straddles the end of the ring.
+    reinterpret_cast<std::atomic<uint64_t>*>(ring_ + pos % capacity_)
+        ->store(pos, std::memory_order_release);
+}
+
+void LogFlightRecorder::CopyIn(uint64_t pos, const void* src, size_t len) {
+    const uint64_t offset = pos % capacity_;
+    const size_t first = (size_t)(capacity_ - offset < len ? capacity_ - offset : len);
+    memcpy(ring_ + offset, src, first);
+    memcpy(ring_, (const char*)src + first, len - first);
+}
+
+bool LogFlightRecorder::IsFlightRecorderFile(const uint8_t* data, size_t size) {
+    return size >= kFlightHeaderSize && memcmp(data, kFlightMagic, sizeof(kFlightMagic)) == 0;
+}
+
+bool LogFlightRecorder::Dump(const uint8_t* data, size_t size,
+                             const std::function<void(const BinaryLogEntry& entry)>& on_entry) {
+    if (!IsFlightRecorderFile(data, size)) {
+        return false;
+    }
+    FlightRecorderHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (header.version != kFlightVersion || header.capacity == 0 ||
+        header.header_size + header.capacity > size) {
+        return false;
+    }
+    const uint8_t* ring = data + header.header_size;
+    const uint64_t capacity = header.capacity;
+    const uint64_t end = header.write_pos;
+    uint64_t pos = end > capacity ? end - capacity : 0;
+    pos = (pos + 7) & ~7ull;
+
+    std::string tag, file;
+    std::vector<char> text;
+    while (pos + sizeof(FlightRecord) <= end) {
+        FlightRecord record;
+        CopyOut(ring, capacity, pos, &record, sizeof(record));
+        const bool valid = record.pos == pos && record.size >= sizeof(FlightRecord) &&
+                           record.size % 8 == 0 && pos + record.size <= end &&
+                           sizeof(FlightRecord) + record.tag_len + record.file_len +
+                                   record.text_len <= record.size;
+        if (!valid) {
+            // overwritten by a newer lap or never completed: resync on the next 8 bytes
+            pos += 8;
+            continue;
+        }
+        uint64_t at = pos + sizeof(record);
+        tag.resize(record.tag_len);
+        CopyOut(ring, capacity, at, &tag[0], record.tag_len);
+        at += record.tag_len;
+        file.resize(record.file_len);
+        CopyOut(ring, capacity, at, &file[0], record.file_len);
+        at += record.file_len;
+        text.resize(record.text_len + 1);
+        CopyOut(ring, capacity, at, text.data(), record.text_len);
+
+        BinaryLogEntry entry;
+        entry.time_us = record.time_us;
+        entry.thread_id = record.thread_id;
+        entry.level = record.level;
+        entry.line = record.line;
+        entry.tag = &tag;
+        entry.file = &file;
+        entry.text = text.data();
+        entry.text_len = record.text_len;
+        on_entry(entry);
+        pos += record.size;
+    }
+    return true;
+}
@@ -0,0 +1,46 @@
+﻿#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "log_common.h"
+#include "log_format.h"
+#include "log_mmap_file.h"
+
+// Fixed-size ring of log records in a memory-mapped file. Any thread appends with one atomic
+// reservation and a memcpy - no lock and no syscall - and because the pages belong to the file,
+// the last capacity bytes of logging can still be read after the process dies.
+//
+// Layout: FlightRecorderHeader, then the ring. Records are 8-byte aligned and carry their own
+// logical position, which lets a reader find the first intact record after the ring wrapped
+// or a writer died halfway through a record.
+class LogFlightRecorder {
+public:
+    LogFlightRecorder();
+    ~LogFlightRecorder();
+    LogFlightRecorder(const LogFlightRecorder&) = delete;
+    LogFlightRecorder& operator=(const LogFlightRecorder&) = delete;
+
+    bool Open(const std::string& filename, uint32_t capacity);
+    bool IsOpen() const;
+
+    void Append(LocalLogLevel level, int64_t time_us, uint32_t thread_id, const char* tag,
+                size_t tag_len, const char* file, size_t file_len, uint32_t line,
+                const char* text, size_t text_len);
+
+    // Reads a ring file left by a (possibly crashed) process, oldest record first.
+    static bool Dump(const uint8_t* data, size_t size,
+                     const std::function<void(const BinaryLogEntry& entry)>& on_entry);
+    static bool IsFlightRecorderFile(const uint8_t* data, size_t size);
+
+private:
+    void CopyIn(uint64_t pos, const void* src, size_t len);
+
+private:
+    MappedLogFile file_{};
+    std::atomic<uint64_t>* write_pos_{};
+    char* ring_{};
+    uint64_t capacity_{};
+};
@@ -0,0 +1,166 @@
+﻿#include "log_format.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "log_utils.h"
+
+namespace {
+
+const char* const kLevelNames[] = {"D", "I", "W", "E", "N"};
+
+bool ReadVarint(const uint8_t*& p, const uint8_t* end, uint64_t* v) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+        uint8_t b = *p++;
+        result |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            *v = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ReadString(const uint8_t*& p, const uint8_t* end, std::string* s) {
+    uint64_t len = 0;
+    if (!ReadVarint(p, end, &len) || len > (uint64_t)(end - p)) {
+        return false;
+    }
+    s->assign((const char*)p, (size_t)len);
+    p += len;
+    return true;
+}
+
+} // namespace
+
+void AppendTextLogLine(std::string& out, int64_t time_us, const char* tag, size_t tag_len,
+                       uint8_t level, uint32_t thread_id, const char* file, size_t file_len,
+                       uint32_t line, const char* text, size_t text_len) {
+    // Lines arrive in bursts from the same second, so the local time conversion is cached.
+    static thread_local int64_t cached_sec = -1;
+    static thread_local std::string cached_str;
+    const int64_t sec = time_us / 1000000;
+    if (sec != cached_sec) {
+        cached_sec = sec;
+        cached_str = GetLocalTimeStr(sec);
+    }
+    char ms[8];
+    snprintf(ms, sizeof(ms), ".%03d", (int)(time_us / 1000 % 1000));
+
+    out += cached_str;
+    out += ms;
+    out += "[";
+    out.append(tag, tag_len);
+    out += "][";
+    out += level <= kLocalLogLevelNone ? kLevelNames[level] : "?";
+    out += "][";
+    out += std::to_string(thread_id);
+    out += "](";
+    out.append(file, file_len);
+    out += ":";
+    out += std::to_string(line);
+    out += "): ";
+    out.append(text, text_len);
+    // Guard empty content to avoid out-of-bounds access.
+    if (text_len == 0 || text[text_len - 1] != '\n') {
+        out += "\n";
+    }
+}
+
+void AppendBinaryLogHeader(std::string& out, int64_t base_time_us) {
+    out.append(kBinaryLogMagic, sizeof(kBinaryLogMagic));
+    out += (char)kBinaryLogVersion;
+    for (int i = 0; i < 8; ++i) {
+        out += (char)(((uint64_t)base_time_us >> (8 * i)) & 0xFF);
+    }
+}
+
+void AppendVarint(std::string& out, uint64_t v) {
+    while (v >= 0x80) {
+        out += (char)((v & 0x7F) | 0x80);
+        v >>= 7;
+    }
+    out += (char)v;
+}
+
+void AppendZigzag(std::string& out, int64_t v) {
+    AppendVarint(out, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+bool BinaryLogReader::Decode(const uint8_t* data, size_t size, const EntryCallback& on_entry) {
+    sites_.clear();
+    error_.clear();
+    if (size < kBinaryLogHeaderSize || memcmp(data, kBinaryLogMagic, sizeof(kBinaryLogMagic))) {
+        return Fail("not a binary log file");
+    }
+    if (data[sizeof(kBinaryLogMagic)] != kBinaryLogVersion) {
+        return Fail("unsupported binary log version");
+    }
+    uint64_t base = 0;
+    for (int i = 0; i < 8; ++i) {
+        base |= (uint64_t)data[sizeof(kBinaryLogMagic) + 1 + i] << (8 * i);
+    }
+
+    int64_t time_us = (int64_t)base;
+    const uint8_t* p = data + kBinaryLogHeaderSize;
+    const uint8_t* end = data + size;
+    while (p < end) {
+        const uint8_t type = *p++;
+        if (type == 0) {
+            // zero-filled tail of a segment that was never trimmed (process crashed)
+            break;
+        }
+        if (type == kBinaryLogSite) {
+            uint64_t id = 0, line = 0;
+            Site site;
+            if (!ReadVarint(p, end, &id) || !ReadVarint(p, end, &line) ||
+                !ReadString(p, end, &site.tag) || !ReadString(p, end, &site.file)) {
+                return Fail("truncated site entry");
+            }
+            if (id != sites_.size()) {
+                return Fail("site ids out of order");
+            }
+            site.line = (uint32_t)line;
+            sites_.push_back(site);
+        } else if (type == kBinaryLogRecord) {
+            uint64_t delta = 0, thread_id = 0, site = 0, text_len = 0;
+            if (!ReadVarint(p, end, &delta) || !ReadVarint(p, end, &thread_id) || p >= end) {
+                return Fail("truncated record");
+            }
+            const uint8_t level = *p++;
+            if (!ReadVarint(p, end, &site) || !ReadVarint(p, end, &text_len) ||
+                text_len > (uint64_t)(end - p)) {
+                return Fail("truncated record");
+            }
+            if (site >= sites_.size()) {
+                return Fail("record refers to an unknown site");
+            }
+            time_us += (int64_t)(delta >> 1) ^ -(int64_t)(delta & 1);
+
+            BinaryLogEntry entry;
+            entry.time_us = time_us;
+            entry.thread_id = (uint32_t)thread_id;
+            entry.level = level;
+            entry.line = sites_[(size_t)site].line;
+            entry.tag = &sites_[(size_t)site].tag;
+            entry.file = &sites_[(size_t)site].file;
+            entry.text = (const char*)p;
+            entry.text_len = (size_t)text_len;
+            on_entry(entry);
+            p += text_len;
+        } else {
+            return Fail("unknown entry type");
+        }
+    }
+    return true;
+}
+
+const std::string& BinaryLogReader::GetError() const {
+    return error_;
+}
+
+bool BinaryLogReader::Fail(const char* error) {
+    error_ = error;
+    return false;
+}
@@ -0,0 +1,64 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "log_common.h"
+
+// Line layout shared by the text writer and the binary log decoder:
+//   HH:MM:SS.mmm[tag][L][thread](file:line): text
+void AppendTextLogLine(std::string& out, int64_t time_us, const char* tag, size_t tag_len,
+                       uint8_t level, uint32_t thread_id, const char* file, size_t file_len,
+                       uint32_t line, const char* text, size_t text_len);
+
+// Binary log file (.blog), integers little-endian, varint = unsigned LEB128:
+//   header  "MSDKBLOG" | u8 version | i64 base time (us since the Unix epoch)
+//   entries, each introduced by a type byte:
+//   kBinaryLogSite    varint site | varint line | varint tag_len | tag | varint file_len | file
+//   kBinaryLogRecord  zigzag varint time delta (us, from the previous record or base time) |
+//                     varint thread | u8 level | varint site | varint text_len | text
+// Sites (tag, file, line) are written once per file; records only carry the site id.
+const char kBinaryLogMagic[8] = {'M', 'S', 'D', 'K', 'B', 'L', 'O', 'G'};
+const uint8_t kBinaryLogVersion = 1;
+const size_t kBinaryLogHeaderSize = sizeof(kBinaryLogMagic) + 1 + 8;
+const uint8_t kBinaryLogSite = 1;
+const uint8_t kBinaryLogRecord = 2;
+
+void AppendBinaryLogHeader(std::string& out, int64_t base_time_us);
+void AppendVarint(std::string& out, uint64_t v);
+void AppendZigzag(std::string& out, int64_t v);
+
+struct BinaryLogEntry {
+    int64_t time_us{};
+    uint32_t thread_id{};
+    uint8_t level{};
+    uint32_t line{};
+    const std::string* tag{};
+    const std::string* file{};
+    const char* text{};
+    size_t text_len{};
+};
+
+// Decodes a whole .blog file, calling on_entry for every record in order.
+class BinaryLogReader {
+public:
+    using EntryCallback = std::function<void(const BinaryLogEntry& entry)>;
+
+    bool Decode(const uint8_t* data, size_t size, const EntryCallback& on_entry);
+    const std::string& GetError() const;
+
+private:
+    struct Site {
+        uint32_t line{};
+        std::string tag{};
+        std::string file{};
+    };
+
+    bool Fail(const char* error);
+
+private:
+    std::vector<Site> sites_{};
+    std::string error_{};
+};
@@ -0,0 +1,157 @@
+﻿#include "log_mmap_file.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+MappedLogFile::MappedLogFile() {}
+
+MappedLogFile::~MappedLogFile() {
+    Close();
+}
+
+#ifdef _WIN32
+
+bool MappedLogFile::Open(const std::string& filename, size_t capacity) {
+    Close();
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ,
+                              NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    const uint64_t size = capacity;
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, (DWORD)(size >> 32),
+                                        (DWORD)(size & 0xFFFFFFFF), NULL);
+    if (!mapping) {
+        CloseHandle(file);
+        return false;
+    }
+    void* data = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, capacity);
+    if (!data) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    file_ = file;
+    mapping_ = mapping;
+    data_ = (char*)data;
+    capacity_ = capacity;
+    size_ = 0;
+    filename_ = filename;
+    return true;
+}
+
+void MappedLogFile::Flush(bool sync) {
+    if (!data_) {
+        return;
+    }
+    FlushViewOfFile(data_, size_);
+    if (sync) {
+        FlushFileBuffers((HANDLE)file_);
+    }
+}
+
+void MappedLogFile::Close() {
+    if (!data_) {
+        return;
+    }
+    UnmapViewOfFile(data_);
+    CloseHandle((HANDLE)mapping_);
+    LARGE_INTEGER end;
+    end.QuadPart = (LONGLONG)size_;
+    SetFilePointerEx((HANDLE)file_, end, NULL, FILE_BEGIN);
+    SetEndOfFile((HANDLE)file_);
+    CloseHandle((HANDLE)file_);
+    file_ = nullptr;
+    mapping_ = nullptr;
+    data_ = nullptr;
+    capacity_ = 0;
+}
+
+#else
+
+bool MappedLogFile::Open(const std::string& filename, size_t capacity) {
+    Close();
+    int fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    if (ftruncate(fd, (off_t)capacity) != 0) {
+        close(fd);
+        return false;
+    }
+    void* data = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    fd_ = fd;
+    data_ = (char*)data;
+    capacity_ = capacity;
+    size_ = 0;
+    filename_ = filename;
+    return true;
+}
+
+void MappedLogFile::Flush(bool sync) {
+    if (!data_) {
+        return;
+    }
+    msync(data_, size_, sync ? MS_SYNC : MS_ASYNC);
+}
+
+void MappedLogFile::Close() {
+    if (!data_) {
+        return;
+    }
+    munmap(data_, capacity_);
+    if (ftruncate(fd_, (off_t)size_) != 0) {
+        // the tail stays zero-filled; readers stop at the first NUL
+    }
+    close(fd_);
+    fd_ = -1;
+    data_ = nullptr;
+    capacity_ = 0;
+}
+
+#endif
+
+bool MappedLogFile::Write(const char* data, size_t size) {
+    char* p = Append(size);
+    if (!p) {
+        return false;
+    }
+    memcpy(p, data, size);
+    return true;
+}
+
+char* MappedLogFile::Append(size_t size) {
+    if (!data_ || size > Remaining()) {
+        return nullptr;
+    }
+    char* p = data_ + size_;
+    size_ += size;
+    return p;
+}
+
+bool MappedLogFile::IsOpen() const {
+    return data_ != nullptr;
+}
+
+size_t MappedLogFile::Size() const {
+    return size_;
+}
+
+size_t MappedLogFile::Remaining() const {
+    return capacity_ - size_;
+}
+
+const std::string& MappedLogFile::GetFilename() const {
+    return filename_;
+}
@@ -0,0 +1,42 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Log file backed by a pre-sized memory mapping. Writes are plain memcpy into the mapping, so
+// everything written survives a crash of the process without any flush; Flush only matters
+// for an OS crash or power loss. Close trims the file to the bytes actually written.
+class MappedLogFile {
+public:
+    MappedLogFile();
+    ~MappedLogFile();
+    MappedLogFile(const MappedLogFile&) = delete;
+    MappedLogFile& operator=(const MappedLogFile&) = delete;
+
+    bool Open(const std::string& filename, size_t capacity);
+    // Copies all of data, or nothing and returns false if it doesn't fit.
+    bool Write(const char* data, size_t size);
+    // Marks the next size bytes as written and returns them for the caller to fill in place;
+    // nullptr if they don't fit.
+    char* Append(size_t size);
+    // Starts writing dirty pages back to disk; sync waits for it.
+    void Flush(bool sync);
+    void Close();
+
+    bool IsOpen() const;
+    size_t Size() const;
+    size_t Remaining() const;
+    const std::string& GetFilename() const;
+
+private:
+    std::string filename_{};
+    char* data_{};
+    size_t capacity_{};
+    size_t size_{};
+#ifdef _WIN32
+    void* file_{};
+    void* mapping_{};
+#else
+    int fd_{-1};
+#endif
+};
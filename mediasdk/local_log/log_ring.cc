@@ -0,0 +1,79 @@
+﻿#include "log_ring.h"
+
+namespace {
+
+uint32_t RoundUpPow2(uint32_t v) {
+    uint32_t n = 1024;
+    while (n < v) {
+        n <<= 1;
+    }
+    return n;
+}
+
+} // namespace
+
+LogRing::LogRing(uint32_t capacity) {
+    buf_.resize(RoundUpPow2(capacity));
+    mask_ = (uint32_t)buf_.size() - 1;
+}
+
+bool LogRing::Push(LocalLogLevel level, int64_t time_us, const char* tag, size_t tag_len,
+                   const char* file, size_t file_len, uint32_t line, const char* text,
+                   size_t text_len) {
+    tag_len = tag_len > 0xFFFF ? 0xFFFF : tag_len;
+    file_len = file_len > 0xFFFF ? 0xFFFF : file_len;
+    const uint64_t raw_size = sizeof(LogRecordHeader) + tag_len + file_len + text_len;
+    const uint32_t capacity = Capacity();
+    if (raw_size > capacity / 2) {
+        return false;
+    }
+    const uint32_t size = (uint32_t)((raw_size + 7) & ~7ull);
+
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    uint32_t offset = (uint32_t)(head & mask_);
+    const uint32_t contiguous = capacity - offset;
+    // A record never wraps; the tail end of the buffer is skipped with a padding marker.
+    const uint64_t need = size + (contiguous < size ? contiguous : 0);
+    if (head + need - cached_tail_ > capacity) {
+        cached_tail_ = tail_.load(std::memory_order_acquire);
+        if (head + need - cached_tail_ > capacity) {
+            return false;
+        }
+    }
+    if (contiguous < size) {
+        const uint32_t padding = contiguous | kPaddingFlag;
+        memcpy(buf_.data() + offset, &padding, sizeof(padding));
+        head += contiguous;
+        offset = 0;
+    }
+
+    uint8_t* p = buf_.data() + offset;
+    LogRecordHeader hdr;
+    hdr.size = size;
+    hdr.line = line;
+    hdr.time_us = time_us;
+    hdr.text_len = (uint32_t)text_len;
+    hdr.tag_len = (uint16_t)tag_len;
+    hdr.file_len = (uint16_t)file_len;
+    hdr.level = (uint8_t)level;
+    memcpy(p, &hdr, sizeof(hdr));
+    p += sizeof(hdr);
+    memcpy(p, tag, tag_len);
+    memcpy(p + tag_len, file, file_len);
+    memcpy(p + tag_len + file_len, text, text_len);
+    head_.store(head + size, std::memory_order_release);
+    return true;
+}
+
+bool LogRing::Empty() const {
+    return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+}
+
+bool LogRing::IsHighWater() const {
+    return head_.load(std::memory_order_relaxed) - tail_.load(std::memory_order_relaxed) >
+           Capacity() / 2;
+}
+
+uint32_t LogRing::Capacity() const {
+    return mask_ + 1;
+}
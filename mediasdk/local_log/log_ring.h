@@ -0,0 +1,75 @@
+﻿#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "log_common.h"
+
+// Fixed header in front of every record in a LogRing; tag, file and text bytes follow it.
+struct LogRecordHeader {
+    uint32_t size;     // whole record including header, 8-byte aligned
+    uint32_t line;
+    int64_t time_us;   // microseconds since the Unix epoch
+    uint32_t text_len;
+    uint16_t tag_len;
+    uint16_t file_len;
+    uint8_t level;
+};
+
+// Single-producer/single-consumer byte ring for variable-size log records. Every logging
+// thread owns one; whoever holds the LogWriter lock is the only consumer.
+class LogRing {
+public:
+    explicit LogRing(uint32_t capacity);
+
+    // Returns false when the record does not fit; nothing is written in that case.
+    bool Push(LocalLogLevel level, int64_t time_us, const char* tag, size_t tag_len,
+              const char* file, size_t file_len, uint32_t line, const char* text,
+              size_t text_len);
+
+    // Calls fn(header, tag, file, text) for every record pushed so far and releases the space.
+    template <typename Fn> size_t Drain(Fn&& fn);
+
+    bool Empty() const;
+    // True once more than half of the ring is in use.
+    bool IsHighWater() const;
+    uint32_t Capacity() const;
+
+    uint32_t thread_id{};
+    std::atomic<bool> retired{false};
+
+private:
+    static const uint32_t kPaddingFlag = 0x80000000u;
+
+    std::vector<uint8_t> buf_{};
+    uint32_t mask_{};
+    alignas(64) std::atomic<uint64_t> head_{0};
+    uint64_t cached_tail_{0}; // producer's last view of tail_
+    alignas(64) std::atomic<uint64_t> tail_{0};
+};
+
+template <typename Fn> size_t LogRing::Drain(Fn&& fn) {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    size_t count = 0;
+    while (tail < head) {
+        const uint8_t* p = buf_.data() + (tail & mask_);
+        uint32_t size;
+        memcpy(&size, p, sizeof(size));
+        if (size & kPaddingFlag) {
+            tail += size & ~kPaddingFlag;
+            continue;
+        }
+        LogRecordHeader hdr;
+        memcpy(&hdr, p, sizeof(hdr));
+        const char* tag = (const char*)p + sizeof(hdr);
+        const char* file = tag + hdr.tag_len;
+        const char* text = file + hdr.file_len;
+        fn(hdr, tag, file, text);
+        tail += hdr.size;
+        ++count;
+    }
+    tail_.store(tail, std::memory_order_release);
+    return count;
+}
@@ -1,4 +1,6 @@
 ﻿#include "log_utils.h"
+
+#ifdef _WIN32
 #include <algorithm>
 #include <atlstr.h>
 #include <io.h>
@@ -39,6 +41,16 @@ std::string GetCurrentTimeStr() {
     return ss.str();
 }
 
+std::string GetLocalTimeStr(int64_t unix_sec) {
+    time_t t = (time_t)unix_sec;
+    struct tm tm_local {};
+    localtime_s(&tm_local, &t);
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%02d:%02d:%02d", tm_local.tm_hour, tm_local.tm_min,
+             tm_local.tm_sec);
+    return buf;
+}
+
 bool IsDirExist(const std::string& dirname) {
     struct _stat dir_stat {};
     if (_stat(dirname.c_str(), &dir_stat) == 0 && dir_stat.st_mode & _S_IFDIR) {
@@ -47,6 +59,11 @@ bool IsDirExist(const std::string& dirname) {
     return false;
 }
 
+bool IsFileExist(const std::string& filename) {
+    struct _stat file_stat {};
+    return _stat(filename.c_str(), &file_stat) == 0;
+}
+
 bool Mkdirs(const std::string& dirname) {
     const char* strDirPath = dirname.c_str();
     int ipathLength = strlen(strDirPath);
@@ -85,18 +102,26 @@ bool IsDigits(const std::string& str) {
     return std::all_of(str.begin(), str.end(), ::isdigit);
 }
 
-DWORD PlatformThreadId() {
+uint32_t PlatformThreadId() {
     return GetCurrentThreadId();
 }
 
-DWORD GetCurrentFileSize(const std::string& filename) {
-    struct stat info;
-    if (stat(filename.c_str(), &info) != 0) {
+uint64_t GetCurrentFileSize(const std::string& filename) {
+    struct _stat64 info;
+    if (_stat64(filename.c_str(), &info) != 0) {
         return 0;
     }
     return info.st_size;
 }
 
+int64_t GetFileModifyTime(const std::string& filename) {
+    struct _stat64 info;
+    if (_stat64(filename.c_str(), &info) != 0) {
+        return 0;
+    }
+    return info.st_mtime;
+}
+
 std::vector<std::string> GetDirFiles(const std::string& path) {
     std::vector<std::string> files_name;
     WIN32_FIND_DATAA ffd;
@@ -113,4 +138,6 @@ std::vector<std::string> GetDirFiles(const std::string& path) {
     }
     FindClose(handle);
     return files_name;
-}
\ No newline at end of file
+}
+
+#endif // _WIN32
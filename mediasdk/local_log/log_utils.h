@@ -1,18 +1,31 @@
 ﻿#pragma once
+#ifdef _WIN32
 #include <Windows.h>
+#endif
+#include <cstdint>
 #include <string>
 #include <vector>
 
+#ifdef _WIN32
 #define SEPARATOR "\\"
+#else
+#define SEPARATOR "/"
+#endif
 
+// Implemented in log_utils.cc (Windows) and log_utils_posix.cc.
 std::string GetPlatfromDefaultDir();
 std::string GenLogFilename();
 std::string GetCurrentTimeStr();
+// "HH:MM:SS" in local time for seconds since the Unix epoch
+std::string GetLocalTimeStr(int64_t unix_sec);
 bool IsDirExist(const std::string& dirname);
+bool IsFileExist(const std::string& filename);
 bool Mkdirs(const std::string& dirname);
 bool Mkdir(const std::string& dirname);
 bool RemoveFile(const std::string& filename);
 bool IsDigits(const std::string& str);
-DWORD PlatformThreadId();
-DWORD GetCurrentFileSize(const std::string& filename);
+uint32_t PlatformThreadId();
+uint64_t GetCurrentFileSize(const std::string& filename);
+// last modification time in seconds since the Unix epoch, 0 if the file is missing
+int64_t GetFileModifyTime(const std::string& filename);
 std::vector<std::string> GetDirFiles(const std::string& path);
\ No newline at end of file
@@ -0,0 +1,144 @@
+﻿#include "log_utils.h"
+
+#ifndef _WIN32
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#elif defined(__APPLE__)
+#include <pthread.h>
+#endif
+
+std::string GetPlatfromDefaultDir() {
+    const char* home = getenv("HOME");
+    std::string root_path = home ? home : "/tmp";
+    root_path += "/.MediaSDK/LocalLog/";
+    return root_path;
+}
+
+std::string GenLogFilename() {
+    time_t now = time(nullptr);
+    struct tm wtm {};
+    localtime_r(&now, &wtm);
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%d-%02d-%02d_%02d%02d%02d", wtm.tm_year + 1900, wtm.tm_mon + 1,
+             wtm.tm_mday, wtm.tm_hour, wtm.tm_min, wtm.tm_sec);
+    return buf;
+}
+
+std::string GetCurrentTimeStr() {
+    struct timeval tv {};
+    gettimeofday(&tv, nullptr);
+    time_t sec = tv.tv_sec;
+    struct tm wtm {};
+    localtime_r(&sec, &wtm);
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%02d:%02d:%02d.%03d", wtm.tm_hour, wtm.tm_min, wtm.tm_sec,
+             (int)(tv.tv_usec / 1000));
+    return buf;
+}
+
+std::string GetLocalTimeStr(int64_t unix_sec) {
+    time_t t = (time_t)unix_sec;
+    struct tm tm_local {};
+    localtime_r(&t, &tm_local);
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%02d:%02d:%02d", tm_local.tm_hour, tm_local.tm_min,
+             tm_local.tm_sec);
+    return buf;
+}
+
+bool IsDirExist(const std::string& dirname) {
+    struct stat dir_stat {};
+    return stat(dirname.c_str(), &dir_stat) == 0 && S_ISDIR(dir_stat.st_mode);
+}
+
+bool IsFileExist(const std::string& filename) {
+    struct stat file_stat {};
+    return stat(filename.c_str(), &file_stat) == 0;
+}
+
+bool Mkdirs(const std::string& dirname) {
+    bool result = false;
+    for (size_t pos = dirname.find('/', 1); pos != std::string::npos;
+         pos = dirname.find('/', pos + 1)) {
+        result = Mkdir(dirname.substr(0, pos));
+    }
+    if (!dirname.empty() && dirname[dirname.size() - 1] != '/') {
+        result = Mkdir(dirname);
+    }
+    return result;
+}
+
+bool Mkdir(const std::string& dirname) {
+    if (IsDirExist(dirname)) {
+        return true;
+    }
+    return mkdir(dirname.c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+bool RemoveFile(const std::string& filename) {
+    return std::remove(filename.c_str()) == 0;
+}
+
+bool IsDigits(const std::string& str) {
+    return std::all_of(str.begin(), str.end(), ::isdigit);
+}
+
+uint32_t PlatformThreadId() {
+#if defined(__linux__)
+    return (uint32_t)syscall(SYS_gettid);
+#elif defined(__APPLE__)
+    uint64_t tid = 0;
+    pthread_threadid_np(nullptr, &tid);
+    return (uint32_t)tid;
+#else
+    return (uint32_t)getpid();
+#endif
+}
+
+uint64_t GetCurrentFileSize(const std::string& filename) {
+    struct stat info {};
+    if (stat(filename.c_str(), &info) != 0) {
+        return 0;
+    }
+    return (uint64_t)info.st_size;
+}
+
+int64_t GetFileModifyTime(const std::string& filename) {
+    struct stat info {};
+    if (stat(filename.c_str(), &info) != 0) {
+        return 0;
+    }
+    return (int64_t)info.st_mtime;
+}
+
+std::vector<std::string> GetDirFiles(const std::string& path) {
+    std::vector<std::string> files_name;
+    DIR* dir = opendir(path.c_str());
+    if (!dir) {
+        return files_name;
+    }
+    while (struct dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        std::string name = entry->d_name;
+        struct stat info {};
+        if (stat((path + "/" + name).c_str(), &info) != 0 || S_ISDIR(info.st_mode)) {
+            continue;
+        }
+        files_name.push_back(name);
+    }
+    closedir(dir);
+    return files_name;
+}
+
+#endif // _WIN32
@@ -1,69 +1,166 @@
 ﻿#include "log_writer.h"
 
 #include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 
 #include "log_env.h"
+#include "log_format.h"
 #include "log_utils.h"
 
+namespace {
+
+const uint32_t kRingBytes = 64 * 1024;
+const std::chrono::milliseconds kDrainInterval(10);
+const int64_t kFlushIntervalUs = 200 * 1000;
+// What encoding adds to a ring record at most: the text prefix or the binary site and record.
+const size_t kLineOverhead = 256;
+const size_t kInitialSites = 1024;
+
+int64_t NowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+// Unregisters the thread's ring when the thread exits; the writer frees it once drained.
+struct ThreadRingHolder {
+    std::shared_ptr<LogRing> ring{};
+    ~ThreadRingHolder() {
+        if (ring) {
+            ring->retired = true;
+        }
+    }
+};
+
+void CrashSignalHandler(int sig) {
+    LogWriter::CreateInstance()->FlushOnCrash();
+    std::signal(sig, SIG_DFL);
+    std::raise(sig);
+}
+
+#ifdef _WIN32
+LPTOP_LEVEL_EXCEPTION_FILTER g_prev_exception_filter = nullptr;
+
+LONG WINAPI CrashExceptionFilter(EXCEPTION_POINTERS* info) {
+    LogWriter::CreateInstance()->FlushOnCrash();
+    return g_prev_exception_filter ? g_prev_exception_filter(info) : EXCEPTION_CONTINUE_SEARCH;
+}
+#endif
+
+void InstallCrashHandlers() {
+    std::signal(SIGSEGV, CrashSignalHandler);
+    std::signal(SIGABRT, CrashSignalHandler);
+    std::signal(SIGFPE, CrashSignalHandler);
+    std::signal(SIGILL, CrashSignalHandler);
+#ifdef _WIN32
+    g_prev_exception_filter = SetUnhandledExceptionFilter(CrashExceptionFilter);
+#endif
+    // The writer is never destroyed, so this is where the open segment gets trimmed on exit.
+    std::atexit([] { LogWriter::CreateInstance()->SaveFile(); });
+}
+
+} // namespace
+
 LogWriter* LogWriter::CreateInstance() {
-    static LogWriter* instance = new LogWriter();
+    static LogWriter* instance = [] {
+        LogWriter* writer = new LogWriter();
+        InstallCrashHandlers();
+        return writer;
+    }();
     return instance;
 }
 
 LogWriter::LogWriter() {
-    log_map_[kLocalLogLevelDebug] = "D";
-    log_map_[kLocalLogLevelInfo] = "I";
-    log_map_[kLocalLogLevelWarning] = "W";
-    log_map_[kLocalLogLevelError] = "E";
-    log_map_[kLocalLogLevelNone] = "N";
+    for (auto& slot : crash_rings_) {
+        slot.store(nullptr, std::memory_order_relaxed);
+    }
+    // Every ring record fits, so encoding on the crash path doesn't need the allocator.
+    line_.reserve(kRingBytes + kLineOverhead);
+    sites_.resize(kInitialSites);
+    last_flush_us_ = NowUs();
+    thread_ = std::thread(&LogWriter::WriterThread, this);
 }
 
 LogWriter::~LogWriter() {
-    if (fout_.is_open()) {
-        fout_.close();
+    stop_ = true;
+    wake_cv_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
     }
+    std::unique_lock<std::mutex> lock(mtx_);
+    DrainRings();
+    CloseFile();
     HandleExpiredLog();
 }
 
-void LogWriter::WriteLog(LocalLogLevel log_level, const std::string& log_tag,
-                         const std::string& log_filename, uint32_t log_line_num,
-                         const std::string& log_content) {
-    std::unique_lock<std::mutex> lock(mtx_);
-    if (dirname_.empty()) {
-        dirname_ = LogEnv::CreateInstance()->GetLogDir() + SEPARATOR + "Logs";
-        if (!IsDirExist(dirname_)) {
-            Mkdirs(dirname_);
+void LogWriter::WriteLog(LocalLogLevel log_level, const char* log_tag, size_t log_tag_len,
+                         const char* log_filename, uint32_t log_line_num,
+                         const char* log_content, size_t log_content_len) {
+    const int64_t time_us = NowUs();
+    const size_t filename_len = strlen(log_filename);
+    LogRing* ring = GetThreadRing();
+    if (recorder_enabled_.load(std::memory_order_acquire)) {
+        recorder_.Append(log_level, time_us, ring->thread_id, log_tag, log_tag_len, log_filename,
+                         filename_len, log_line_num, log_content, log_content_len);
+        if (log_level < file_level_.load(std::memory_order_relaxed)) {
+            return;
         }
     }
-    if (!fout_ || !fout_.is_open()) {
-        std::string filename = dirname_ + SEPARATOR + GenLogFilename() + ".log";
-        NewFile(filename);
+    if (!ring->Push(log_level, time_us, log_tag, log_tag_len, log_filename, filename_len,
+                    log_line_num, log_content, log_content_len)) {
+        // Ring full or line too long: write it here, after this thread's earlier lines.
+        std::unique_lock<std::mutex> lock(mtx_);
+        DrainRings();
+        LogRecordHeader hdr{};
+        hdr.line = log_line_num;
+        hdr.time_us = time_us;
+        hdr.text_len = (uint32_t)log_content_len;
+        hdr.tag_len = (uint16_t)std::min<size_t>(log_tag_len, 0xFFFF);
+        hdr.file_len = (uint16_t)std::min<size_t>(filename_len, 0xFFFF);
+        hdr.level = (uint8_t)log_level;
+        AppendLine(hdr, ring->thread_id, log_tag, log_filename, log_content);
+        return;
+    }
+    if (log_level >= kLocalLogLevelError) {
+        Flush();
+    } else if (ring->IsHighWater()) {
+        wake_cv_.notify_one();
     }
-    /*size_t filesize = (size_t)fout_.tellp();
-    if (filesize + log_content.length() > LogEnv::CreateInstance()->GetSingleLogFileSize()) {
-        std::string filename = dirname_ + SEPARATOR + GenLogFilename() + ".log";
-        NewFile(filename);
-    }*/
+}
+
+void LogWriter::Flush() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    DrainRings();
+    FlushFile();
+}
 
-    std::stringstream ss;
-    fout_ << GetCurrentTimeStr() << "[" << log_tag << "][" << log_map_[log_level] << "]["
-          << PlatformThreadId() << "](" << log_filename << ":" << log_line_num << "): ";
-    fout_ << log_content;
-    // Guard empty content to avoid out-of-bounds access.
-    if (log_content.empty() || log_content[log_content.length() - 1] != '\n') {
-        fout_ << "\n";
+void LogWriter::FlushOnCrash() {
+    // The crashing thread may be the one holding mtx_ or rings_mtx_, so never block on them.
+    for (int i = 0; i < 100; ++i) {
+        if (mtx_.try_lock()) {
+            if (rings_mtx_.try_lock()) {
+                // Once copied into the mapping the lines outlive the process.
+                DrainRingsOnCrash();
+                rings_mtx_.unlock();
+                mtx_.unlock();
+                return;
+            }
+            mtx_.unlock();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
     }
-    // Flush every log line so logs are not truncated if the process crashes.
-    fout_.flush();
 }
 
 void LogWriter::SaveFile() {
     std::unique_lock<std::mutex> lock(mtx_);
-    if (fout_.is_open()) {
-        fout_.close();
-    }
+    DrainRings();
+    CloseFile();
 }
 
 void LogWriter::SetLocalLogSetting(uint32_t expired_time, uint64_t max_log_size) {
@@ -72,32 +169,366 @@ void LogWriter::SetLocalLogSetting(uint32_t expired_time, uint64_t max_log_size)
     max_log_size_ = max_log_size;
 }
 
-void LogWriter::NewFile(const std::string& filename) {
-    HandOversizeLog();
-    if (fout_.is_open()) {
-        fout_.close();
+bool LogWriter::EnableFlightRecorder(uint32_t ring_size, LocalLogLevel file_level) {
+    std::unique_lock<std::mutex> lock(mtx_);
+    file_level_ = file_level;
+    if (recorder_enabled_) {
+        return true;
+    }
+    EnsureLogDir();
+    const std::string filename = dirname_ + SEPARATOR + "flight.ring";
+    const std::string prev_filename = dirname_ + SEPARATOR + "flight.prev.ring";
+    if (IsFileExist(filename)) {
+        RemoveFile(prev_filename);
+        std::rename(filename.c_str(), prev_filename.c_str());
+    }
+    if (!recorder_.Open(filename, ring_size)) {
+        return false;
+    }
+    recorder_enabled_.store(true, std::memory_order_release);
+    return true;
+}
+
+LogRing* LogWriter::GetThreadRing() {
+    thread_local ThreadRingHolder holder;
+    if (!holder.ring) {
+        holder.ring = std::make_shared<LogRing>(kRingBytes);
+        holder.ring->thread_id = (uint32_t)PlatformThreadId();
+        std::unique_lock<std::mutex> lock(rings_mtx_);
+        rings_.push_back(holder.ring);
+        // Beyond kMaxCrashRings threads the extra rings are only drained outside crashes.
+        for (auto& slot : crash_rings_) {
+            if (!slot.load(std::memory_order_relaxed)) {
+                slot.store(holder.ring.get(), std::memory_order_release);
+                break;
+            }
+        }
+    }
+    return holder.ring.get();
+}
+
+void LogWriter::WriterThread() {
+    while (!stop_) {
+        {
+            std::unique_lock<std::mutex> lock(wake_mtx_);
+            wake_cv_.wait_for(lock, kDrainInterval);
+        }
+        std::unique_lock<std::mutex> lock(mtx_);
+        DrainRings();
+        if (NowUs() - last_flush_us_ >= kFlushIntervalUs) {
+            FlushFile();
+        }
+    }
+}
+
+void LogWriter::DrainRings() {
+    std::vector<std::shared_ptr<LogRing>> rings;
+    {
+        std::unique_lock<std::mutex> lock(rings_mtx_);
+        rings = rings_;
+    }
+    for (auto& ring : rings) {
+        const uint32_t thread_id = ring->thread_id;
+        ring->Drain([&](const LogRecordHeader& hdr, const char* tag, const char* file,
+                        const char* text) { AppendLine(hdr, thread_id, tag, file, text); });
+    }
+
+    // Rings of exited threads are dropped once empty; a retired ring never gets new records.
+    std::unique_lock<std::mutex> lock(rings_mtx_);
+    for (auto& slot : crash_rings_) {
+        LogRing* ring = slot.load(std::memory_order_relaxed);
+        if (ring && ring->retired && ring->Empty()) {
+            slot.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+    rings_.erase(std::remove_if(rings_.begin(), rings_.end(),
+                                [](const std::shared_ptr<LogRing>& ring) {
+                                    return ring->retired && ring->Empty();
+                                }),
+                 rings_.end());
+}
+
+void LogWriter::DrainRingsOnCrash() {
+    if (!file_.IsOpen()) {
+        return;
+    }
+    for (auto& slot : crash_rings_) {
+        LogRing* ring = slot.load(std::memory_order_acquire);
+        if (!ring) {
+            continue;
+        }
+        const uint32_t thread_id = ring->thread_id;
+        ring->Drain([&](const LogRecordHeader& hdr, const char* tag, const char* file,
+                        const char* text) {
+            // No rotation and no growing the site table here: what doesn't fit is dropped.
+            if (EncodeLine(hdr, thread_id, tag, file, text) &&
+                file_.Write(line_.data(), line_.size())) {
+                CommitLine();
+            }
+        });
+    }
+}
+
+void LogWriter::AppendLine(const LogRecordHeader& hdr, uint32_t thread_id, const char* tag,
+                           const char* file, const char* text) {
+    if (!file_.IsOpen() && !OpenNewFile()) {
+        return;
+    }
+    if (binary_ && (site_count_ + 1) * 4 > sites_.size() * 3) {
+        GrowSites();
+    }
+    LogRecordHeader part = hdr;
+    bool fresh = false;
+    EncodeLine(part, thread_id, tag, file, text);
+    while (line_.size() > file_.Remaining()) {
+        if (fresh) {
+            // Longer than a whole segment: the text is split into records that each fill one,
+            // so every record stays whole and nothing is cut off. The +1 covers the newline a
+            // text line gains when the piece no longer ends with one.
+            const size_t excess = line_.size() - file_.Remaining() + 1;
+            if (excess >= part.text_len) {
+                return; // the segment can't even hold the prefix
+            }
+            part.text_len -= (uint32_t)excess;
+            EncodeLine(part, thread_id, tag, file, text);
+            if (!file_.Write(line_.data(), line_.size())) {
+                return;
+            }
+            CommitLine();
+            text += part.text_len;
+            part.text_len = (uint32_t)excess;
+        }
+        // O(1) rotation: the next segment is opened and the line re-encoded for it, so a
+        // binary file never references sites defined in another file.
+        CloseFile();
+        if (!OpenNewFile()) {
+            return;
+        }
+        fresh = true;
+        EncodeLine(part, thread_id, tag, file, text);
+    }
+    if (file_.Write(line_.data(), line_.size())) {
+        CommitLine();
+    }
+}
+
+bool LogWriter::EncodeLine(const LogRecordHeader& hdr, uint32_t thread_id, const char* tag,
+                           const char* file, const char* text) {
+    line_.clear();
+    if (!binary_) {
+        AppendTextLogLine(line_, hdr.time_us, tag, hdr.tag_len, hdr.level, thread_id, file,
+                          hdr.file_len, hdr.line, text, hdr.text_len);
+        return true;
+    }
+
+    // FNV-1a over tag, file and line, with a separator so that moving bytes between tag and
+    // file changes the hash.
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](const char* p, size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            hash = (hash ^ (uint8_t)p[i]) * 1099511628211ull;
+        }
+    };
+    const char separator = '\0';
+    mix(tag, hdr.tag_len);
+    mix(&separator, 1);
+    mix(file, hdr.file_len);
+    mix(&separator, 1);
+    mix((const char*)&hdr.line, sizeof(hdr.line));
+    if (hash == 0) {
+        hash = 1;
+    }
+    const size_t mask = sites_.size() - 1;
+    size_t slot = (size_t)hash & mask;
+    while (sites_[slot].hash != 0 && sites_[slot].hash != hash) {
+        slot = (slot + 1) & mask;
+    }
+    pending_site_ = sites_[slot].hash == 0;
+    uint32_t id = sites_[slot].id;
+    if (pending_site_) {
+        if ((site_count_ + 1) * 4 > sites_.size() * 3) {
+            return false;
+        }
+        id = (uint32_t)site_count_;
+        pending_slot_ = slot;
+        pending_hash_ = hash;
+        line_ += (char)kBinaryLogSite;
+        AppendVarint(line_, id);
+        AppendVarint(line_, hdr.line);
+        AppendVarint(line_, hdr.tag_len);
+        line_.append(tag, hdr.tag_len);
+        AppendVarint(line_, hdr.file_len);
+        line_.append(file, hdr.file_len);
+    }
+    line_ += (char)kBinaryLogRecord;
+    // Rings are drained one thread at a time, so the delta may be negative.
+    AppendZigzag(line_, hdr.time_us - last_time_us_);
+    pending_time_us_ = hdr.time_us;
+    AppendVarint(line_, thread_id);
+    line_ += (char)hdr.level;
+    AppendVarint(line_, id);
+    AppendVarint(line_, hdr.text_len);
+    line_.append(text, hdr.text_len);
+    return true;
+}
+
+void LogWriter::CommitLine() {
+    if (!binary_) {
+        return;
     }
-    fout_.open(filename, std::ios::binary | std::ios::out);
+    if (pending_site_) {
+        sites_[pending_slot_].hash = pending_hash_;
+        sites_[pending_slot_].id = (uint32_t)site_count_++;
+        pending_site_ = false;
+    }
+    last_time_us_ = pending_time_us_;
 }
 
-void LogWriter::HandleExpiredLog() {}
+void LogWriter::ResetSites() {
+    for (LogSite& site : sites_) {
+        site.hash = 0;
+    }
+    site_count_ = 0;
+    pending_site_ = false;
+}
 
-void LogWriter::HandOversizeLog() {
-    if (dirname_.empty() || !IsDirExist(dirname_)) {
+void LogWriter::GrowSites() {
+    std::vector<LogSite> old(sites_.size() * 2, LogSite{0, 0});
+    old.swap(sites_);
+    const size_t mask = sites_.size() - 1;
+    for (const LogSite& site : old) {
+        if (site.hash == 0) {
+            continue;
+        }
+        size_t slot = (size_t)site.hash & mask;
+        while (sites_[slot].hash != 0) {
+            slot = (slot + 1) & mask;
+        }
+        sites_[slot] = site;
+    }
+}
+
+void LogWriter::EnsureLogDir() {
+    if (dirname_.empty()) {
+        LogEnv* env = LogEnv::CreateInstance();
+        dirname_ = env->GetLogDir() + SEPARATOR + "Logs";
+        if (!IsDirExist(dirname_)) {
+            Mkdirs(dirname_);
+        }
+        if (max_log_size_ == 0) {
+            max_log_size_ = env->GetMaxLogSize();
+        }
+        if (expired_time_ == 0) {
+            expired_time_ = env->GetLogExpiredTime();
+        }
+        LoadFileIndex();
+    }
+}
+
+bool LogWriter::OpenNewFile() {
+    EnsureLogDir();
+    binary_ = LogEnv::CreateInstance()->GetLogFormat() == kLocalLogFormatBinary;
+    const char* ext = binary_ ? ".blog" : ".log";
+    std::string basename = GenLogFilename();
+    std::string filename = basename + ext;
+    // several segments can fill up within one second
+    for (int i = 1; IsFileExist(dirname_ + SEPARATOR + filename); ++i) {
+        char suffix[16];
+        snprintf(suffix, sizeof(suffix), "_%03d", i);
+        filename = basename + suffix + ext;
+    }
+    if (!NewFile(filename)) {
+        return false;
+    }
+    if (binary_) {
+        // every binary file is self-contained: new header and site table
+        ResetSites();
+        last_time_us_ = NowUs();
+        line_.clear();
+        AppendBinaryLogHeader(line_, last_time_us_);
+        file_.Write(line_.data(), line_.size());
+    }
+    return true;
+}
+
+void LogWriter::CloseFile() {
+    if (!file_.IsOpen()) {
         return;
     }
+    file_.Close();
+    // the index entry was added with the reserved size; account for the trimmed size
+    LogFileInfo& info = files_.back();
+    total_bytes_ -= info.size;
+    info.size = file_.Size();
+    info.modify_time = NowUs() / 1000000;
+    total_bytes_ += info.size;
+}
+
+void LogWriter::FlushFile() {
+    last_flush_us_ = NowUs();
+    file_.Flush(false);
+}
+
+bool LogWriter::NewFile(const std::string& filename) {
+    const size_t segment_size = LogEnv::CreateInstance()->GetSingleLogFileSize();
+    HandOversizeLog(segment_size);
+    HandleExpiredLog();
+    if (!file_.Open(dirname_ + SEPARATOR + filename, segment_size)) {
+        return false;
+    }
+    LogFileInfo info;
+    info.name = filename;
+    info.size = segment_size;
+    info.modify_time = NowUs() / 1000000;
+    files_.push_back(info);
+    total_bytes_ += info.size;
+    return true;
+}
+
+void LogWriter::LoadFileIndex() {
+    // The only directory scan; afterwards the index is maintained as files come and go.
     std::vector<std::string> files = GetDirFiles(dirname_);
-    std::sort(files.begin(), files.end(),
-              [](const std::string& str1, const std::string& str2) { return str1 > str2; });
-    size_t i = 0;
-    uint32_t total_filesize = 0;
-    for (; i < files.size(); ++i) {
-        total_filesize += GetCurrentFileSize(dirname_ + SEPARATOR + files[i]);
-        if (total_filesize > LogEnv::CreateInstance()->GetMaxLogSize()) {
-            break;
+    std::sort(files.begin(), files.end());
+    for (const auto& name : files) {
+        const bool is_log = (name.size() > 4 && name.compare(name.size() - 4, 4, ".log") == 0) ||
+                            (name.size() > 5 && name.compare(name.size() - 5, 5, ".blog") == 0);
+        if (!is_log) {
+            continue;
         }
+        LogFileInfo info;
+        info.name = name;
+        info.size = GetCurrentFileSize(dirname_ + SEPARATOR + name);
+        info.modify_time = GetFileModifyTime(dirname_ + SEPARATOR + name);
+        files_.push_back(info);
+        total_bytes_ += info.size;
+    }
+}
+
+void LogWriter::HandleExpiredLog() {
+    if (expired_time_ == 0) {
+        return;
+    }
+    const int64_t deadline = NowUs() / 1000000 - (int64_t)expired_time_ * 24 * 3600;
+    // oldest first; the open segment (always the newest) is never removed
+    const size_t keep = file_.IsOpen() ? 1 : 0;
+    while (files_.size() > keep && files_.front().modify_time < deadline) {
+        RemoveOldestFile();
     }
-    for (; i < files.size(); ++i) {
-        RemoveFile(dirname_ + SEPARATOR + files[i]);
+}
+
+void LogWriter::HandOversizeLog(uint64_t incoming_size) {
+    if (max_log_size_ == 0) {
+        return;
+    }
+    const size_t keep = file_.IsOpen() ? 1 : 0;
+    while (files_.size() > keep && total_bytes_ + incoming_size > max_log_size_) {
+        RemoveOldestFile();
     }
-}
\ No newline at end of file
+}
+
+void LogWriter::RemoveOldestFile() {
+    const LogFileInfo& oldest = files_.front();
+    RemoveFile(dirname_ + SEPARATOR + oldest.name);
+    total_bytes_ -= oldest.size;
+    files_.pop_front();
+}
@@ -1,37 +1,123 @@
 ﻿#pragma once
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
-#include <fstream>
+#include <deque>
+#include <memory>
 #include <mutex>
 #include <string>
-#include <unordered_map>
+#include <thread>
+#include <vector>
 
 #include "log_common.h"
+#include "log_flight_recorder.h"
+#include "log_mmap_file.h"
+#include "log_ring.h"
 
+// Asynchronous log backend. Callers copy each line into a per-thread LogRing without taking a
+// lock; a background thread drains the rings and formats the lines into a memory-mapped file
+// segment, rotating to a new segment when it fills. ERROR lines, a full ring and crashes drain
+// synchronously so nothing is lost.
 class LogWriter {
 public:
     static LogWriter* CreateInstance();
 
     LogWriter();
     ~LogWriter();
-    LogWriter(const LogWriter&) = default;
-    LogWriter& operator=(const LogWriter&) = default;
+    LogWriter(const LogWriter&) = delete;
+    LogWriter& operator=(const LogWriter&) = delete;
 
-    void WriteLog(LocalLogLevel log_level, const std::string& log_tag,
-                  const std::string& log_filename, uint32_t log_line_num,
-                  const std::string& log_content);
+    void WriteLog(LocalLogLevel log_level, const char* log_tag, size_t log_tag_len,
+                  const char* log_filename, uint32_t log_line_num, const char* log_content,
+                  size_t log_content_len);
+    // Writes everything logged so far and flushes the file before returning.
+    void Flush();
+    // Best-effort Flush for crash handlers: gives up if the locks can't be taken quickly, and
+    // only writes into the segment that is already mapped, never opening or rotating files.
+    void FlushOnCrash();
     void SaveFile();
     void SetLocalLogSetting(uint32_t expired_time, uint64_t max_log_size);
+    // Sends every line to a crash-survivable ring (Logs/flight.ring) and only lines at or
+    // above file_level on to the log file. A ring left by the previous run is kept as
+    // flight.prev.ring.
+    bool EnableFlightRecorder(uint32_t ring_size, LocalLogLevel file_level);
 
 private:
-    void NewFile(const std::string& filename);
+    LogRing* GetThreadRing();
+    void WriterThread();
+    // The methods below require mtx_.
+    void DrainRings();
+    // DrainRings for FlushOnCrash; also requires rings_mtx_.
+    void DrainRingsOnCrash();
+    void AppendLine(const LogRecordHeader& hdr, uint32_t thread_id, const char* tag,
+                    const char* file, const char* text);
+    // Encodes into line_ without touching the binary format state; false if the line needs
+    // a new site and the site table is full. CommitLine records the state once line_ is
+    // written, so a line that is dropped leaves no trace in the file or in the state.
+    bool EncodeLine(const LogRecordHeader& hdr, uint32_t thread_id, const char* tag,
+                    const char* file, const char* text);
+    void CommitLine();
+    void ResetSites();
+    void GrowSites();
+    void EnsureLogDir();
+    bool OpenNewFile();
+    void CloseFile();
+    void FlushFile();
+    bool NewFile(const std::string& filename);
+    void LoadFileIndex();
     void HandleExpiredLog();
-    void HandOversizeLog();
+    void HandOversizeLog(uint64_t incoming_size);
+    void RemoveOldestFile();
 
 private:
-    std::unordered_map<LocalLogLevel, std::string> log_map_{};
-    std::ofstream fout_{};
     std::mutex mtx_{};
+    struct LogFileInfo {
+        std::string name{};
+        uint64_t size{};
+        int64_t modify_time{}; // seconds since the Unix epoch
+    };
+
+    MappedLogFile file_{};
     uint32_t expired_time_{};
     uint64_t max_log_size_{};
     std::string dirname_{};
+    // retained log files, oldest first; the open segment is the last entry
+    std::deque<LogFileInfo> files_{};
+    uint64_t total_bytes_{};
+    // encode buffer for the current line
+    std::string line_{};
+    int64_t last_flush_us_{};
+
+    LogFlightRecorder recorder_{};
+    std::atomic<bool> recorder_enabled_{false};
+    std::atomic<int> file_level_{kLocalLogLevelDebug};
+    // binary format state, reset with every new file
+    bool binary_{false};
+    // Open-addressed table of the sites written so far, keyed by a 64-bit hash of tag, file
+    // and line; hash 0 marks a free slot. It only grows outside the crash path, so finding
+    // and adding sites never allocates there.
+    struct LogSite {
+        uint64_t hash;
+        uint32_t id;
+    };
+    std::vector<LogSite> sites_{};
+    size_t site_count_{};
+    int64_t last_time_us_{};
+    // what CommitLine records for the line in line_
+    bool pending_site_{};
+    size_t pending_slot_{};
+    uint64_t pending_hash_{};
+    int64_t pending_time_us_{};
+
+    static const size_t kMaxCrashRings = 256;
+    std::mutex rings_mtx_{};
+    std::vector<std::shared_ptr<LogRing>> rings_{};
+    // The same rings as plain pointers in fixed slots, so the crash path walks them without
+    // copying rings_. Slots are set and cleared together with rings_, under rings_mtx_.
+    std::atomic<LogRing*> crash_rings_[kMaxCrashRings];
+
+    std::mutex wake_mtx_{};
+    std::condition_variable wake_cv_{};
+    std::atomic<bool> stop_{false};
+    std::thread thread_{};
 };
\ No newline at end of file
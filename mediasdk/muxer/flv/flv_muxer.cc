@@ -0,0 +1,224 @@
+﻿#include "flv_muxer.h"
+
+#include <cstring>
+
+#include "codec_config.h"
+
+namespace {
+
+const uint8_t kFlvTagAudio = 0x08;
+const uint8_t kFlvTagVideo = 0x09;
+const uint8_t kFlvTagScript = 0x12;
+const size_t kFlvTagHeaderSize = 11;
+
+// Enhanced RTMP video tag header: IsExHeader(1) | FrameType(3) | PacketType(4), then FourCC.
+const uint32_t kFourCcHvc1 = ('h' << 24) | ('v' << 16) | ('c' << 8) | '1';
+const uint8_t kExHeaderFlag = 0x80;
+const uint8_t kExPacketSequenceStart = 0;
+const uint8_t kExPacketCodedFramesX = 3; // coded frames, composition time implied 0
+
+void PutBE16(std::vector<uint8_t>& out, uint16_t v) {
+    out.push_back((uint8_t)(v >> 8));
+    out.push_back((uint8_t)v);
+}
+
+void PutBE32(std::vector<uint8_t>& out, uint32_t v) {
+    out.push_back((uint8_t)(v >> 24));
+    out.push_back((uint8_t)(v >> 16));
+    out.push_back((uint8_t)(v >> 8));
+    out.push_back((uint8_t)v);
+}
+
+// AMF0 (Adobe AMF0 specification 2.2 - 2.4, 2.10)
+void PutAmfKey(std::vector<uint8_t>& out, const char* key) {
+    const size_t len = strlen(key);
+    PutBE16(out, (uint16_t)len);
+    out.insert(out.end(), key, key + len);
+}
+
+void PutAmfNumber(std::vector<uint8_t>& out, const char* key, double value) {
+    PutAmfKey(out, key);
+    out.push_back(0x00);
+    uint64_t bits = 0;
+    memcpy(&bits, &value, sizeof(bits));
+    PutBE32(out, (uint32_t)(bits >> 32));
+    PutBE32(out, (uint32_t)bits);
+}
+
+void PutAmfBool(std::vector<uint8_t>& out, const char* key, bool value) {
+    PutAmfKey(out, key);
+    out.push_back(0x01);
+    out.push_back(value ? 1 : 0);
+}
+
+void PutAmfString(std::vector<uint8_t>& out, const char* key, const char* value) {
+    PutAmfKey(out, key);
+    out.push_back(0x02);
+    PutAmfKey(out, value);
+}
+
+} // namespace
+
+FlvMuxer::FlvMuxer() {}
+
+FlvMuxer::~FlvMuxer() {
+    Close();
+}
+
+bool FlvMuxer::WriteHeader() {
+    buffer_.clear();
+    const uint8_t header[] = {'F', 'L', 'V', 0x01, 0x00, 0x00, 0x00, 0x00, 0x09};
+    buffer_.insert(buffer_.end(), header, header + sizeof(header));
+    buffer_[4] = (uint8_t)((config_.has_audio ? 0x04 : 0) | (config_.has_video ? 0x01 : 0));
+    PutBE32(buffer_, 0); // PreviousTagSize0
+    AppendMetaData();
+    video_config_.clear();
+    if (config_.has_video && !AppendVideoSequenceHeader(0)) {
+        return false;
+    }
+    if (config_.has_audio) {
+        const uint8_t sound_rate = config_.sample_rate <= 11025   ? 1
+                                   : config_.sample_rate <= 22050 ? 2
+                                                                  : 3;
+        const uint8_t sound_type = config_.channels >= 2 ? 1 : 0;
+        // SoundFormat(10=AAC) | SoundRate | SoundSize(16 bit) | SoundType
+        sound_header_ = (uint8_t)((10 << 4) | (sound_rate << 2) | (1 << 1) | sound_type);
+        AppendAudioSequenceHeader(0);
+    }
+    return writer_.Write(buffer_.data(), buffer_.size());
+}
+
+bool FlvMuxer::MuxVideo(const uint8_t* data, size_t size, uint64_t pts_us, bool keyframe,
+                        bool /*parameter_sets_changed*/) {
+    const uint32_t ts_ms = (uint32_t)(pts_us / 1000);
+    buffer_.clear();
+    // Only writes a sequence header if the record differs from the last one written.
+    if (keyframe && !AppendVideoSequenceHeader(ts_ms)) {
+        return false;
+    }
+    const size_t start = BeginTag(kFlvTagVideo, ts_ms);
+    if (IsHevc()) {
+        buffer_.push_back((uint8_t)(kExHeaderFlag | (keyframe ? 0x10 : 0x20) |
+                                    kExPacketCodedFramesX));
+        PutBE32(buffer_, kFourCcHvc1);
+    } else {
+        buffer_.push_back(keyframe ? 0x17 : 0x27);
+        PutBE32(buffer_, 0x01000000); // AVC NALU, composition time 0
+    }
+    const size_t header_end = buffer_.size();
+    AnnexBToLengthPrefixed(data, size, IsHevc(), buffer_);
+    if (buffer_.size() == header_end) {
+        return false;
+    }
+    EndTag(start);
+    if (!writer_.Write(buffer_.data(), buffer_.size())) {
+        // The sequence header may have been lost with the frame; repeat it at the next keyframe.
+        video_config_.clear();
+        return false;
+    }
+    return true;
+}
+
+bool FlvMuxer::MuxAudio(const uint8_t* aac, size_t size, uint64_t pts_us) {
+    const size_t skip = AacAdtsHeaderSize(aac, size);
+    if (size <= skip) {
+        return false;
+    }
+    buffer_.clear();
+    const size_t start = BeginTag(kFlvTagAudio, (uint32_t)(pts_us / 1000));
+    buffer_.push_back(sound_header_);
+    buffer_.push_back(0x01); // AAC raw
+    buffer_.insert(buffer_.end(), aac + skip, aac + size);
+    EndTag(start);
+    return writer_.Write(buffer_.data(), buffer_.size());
+}
+
+void FlvMuxer::Finish() {}
+
+void FlvMuxer::AppendMetaData() {
+    const size_t start = BeginTag(kFlvTagScript, 0);
+    buffer_.push_back(0x02); // string
+    PutAmfKey(buffer_, "onMetaData");
+    buffer_.push_back(0x08); // ECMA array
+    const size_t count_pos = buffer_.size();
+    PutBE32(buffer_, 0);
+    uint32_t count = 0;
+    PutAmfNumber(buffer_, "duration", 0);
+    ++count;
+    if (config_.has_video) {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        GetVideoSize(width, height);
+        PutAmfNumber(buffer_, "width", width);
+        PutAmfNumber(buffer_, "height", height);
+        PutAmfNumber(buffer_, "videocodecid", IsHevc() ? (double)kFourCcHvc1 : 7.0);
+        count += 3;
+    }
+    if (config_.has_audio) {
+        PutAmfNumber(buffer_, "audiocodecid", 10.0);
+        PutAmfNumber(buffer_, "audiosamplerate", config_.sample_rate);
+        PutAmfNumber(buffer_, "audiosamplesize", 16.0);
+        PutAmfBool(buffer_, "stereo", config_.channels >= 2);
+        count += 4;
+    }
+    PutAmfString(buffer_, "encoder", "WindowsMediaSDK");
+    ++count;
+    buffer_[count_pos] = (uint8_t)(count >> 24);
+    buffer_[count_pos + 1] = (uint8_t)(count >> 16);
+    buffer_[count_pos + 2] = (uint8_t)(count >> 8);
+    buffer_[count_pos + 3] = (uint8_t)count;
+    PutBE16(buffer_, 0); // object end marker
+    buffer_.push_back(0x09);
+    EndTag(start);
+}
+
+bool FlvMuxer::AppendVideoSequenceHeader(uint32_t ts_ms) {
+    std::vector<uint8_t> record;
+    if (!BuildVideoDecoderConfig(record)) {
+        return false;
+    }
+    if (record == video_config_) {
+        return true;
+    }
+    const size_t start = BeginTag(kFlvTagVideo, ts_ms);
+    if (IsHevc()) {
+        buffer_.push_back((uint8_t)(kExHeaderFlag | 0x10 | kExPacketSequenceStart));
+        PutBE32(buffer_, kFourCcHvc1);
+    } else {
+        buffer_.push_back(0x17);
+        PutBE32(buffer_, 0); // AVC sequence header, composition time 0
+    }
+    buffer_.insert(buffer_.end(), record.begin(), record.end());
+    EndTag(start);
+    video_config_.swap(record);
+    return true;
+}
+
+void FlvMuxer::AppendAudioSequenceHeader(uint32_t ts_ms) {
+    const size_t start = BeginTag(kFlvTagAudio, ts_ms);
+    buffer_.push_back(sound_header_);
+    buffer_.push_back(0x00); // AAC sequence header
+    BuildAacAudioSpecificConfig(config_.sample_rate, config_.channels, buffer_);
+    EndTag(start);
+}
+
+size_t FlvMuxer::BeginTag(uint8_t tag_type, uint32_t ts_ms) {
+    // TagType(1) DataSize(3, filled in by EndTag) Timestamp(3) TimestampExt(1) StreamID(3=0)
+    const size_t start = buffer_.size();
+    buffer_.push_back(tag_type);
+    buffer_.insert(buffer_.end(), 3, 0);
+    buffer_.push_back((uint8_t)(ts_ms >> 16));
+    buffer_.push_back((uint8_t)(ts_ms >> 8));
+    buffer_.push_back((uint8_t)ts_ms);
+    buffer_.push_back((uint8_t)(ts_ms >> 24));
+    buffer_.insert(buffer_.end(), 3, 0);
+    return start;
+}
+
+void FlvMuxer::EndTag(size_t start) {
+    const uint32_t payload_len = (uint32_t)(buffer_.size() - start - kFlvTagHeaderSize);
+    buffer_[start + 1] = (uint8_t)(payload_len >> 16);
+    buffer_[start + 2] = (uint8_t)(payload_len >> 8);
+    buffer_[start + 3] = (uint8_t)payload_len;
+    PutBE32(buffer_, payload_len + (uint32_t)kFlvTagHeaderSize); // PreviousTagSize
+}
\ No newline at end of file
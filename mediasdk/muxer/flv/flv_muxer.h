@@ -0,0 +1,34 @@
+﻿#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "media_muxer.h"
+
+// Records to FLV: the same tags the RTMP path sends, H.265 as enhanced-RTMP 'hvc1'. Every tag
+// is queued whole, so the file is valid up to the last tag written, and a new sequence
+// header goes out whenever the encoder changes its parameter sets. Nothing is rewritten at
+// the end, so onMetaData carries no duration; players take it from the last tag.
+class FlvMuxer : public MediaMuxer {
+public:
+    FlvMuxer();
+    ~FlvMuxer() override;
+
+protected:
+    bool WriteHeader() override;
+    bool MuxVideo(const uint8_t* data, size_t size, uint64_t pts_us, bool keyframe,
+                  bool parameter_sets_changed) override;
+    bool MuxAudio(const uint8_t* aac, size_t size, uint64_t pts_us) override;
+    void Finish() override;
+
+private:
+    void AppendMetaData();
+    bool AppendVideoSequenceHeader(uint32_t ts_ms);
+    void AppendAudioSequenceHeader(uint32_t ts_ms);
+    size_t BeginTag(uint8_t tag_type, uint32_t ts_ms);
+    void EndTag(size_t start);
+
+private:
+    std::vector<uint8_t> buffer_{};       // tags queued with one Write
+    std::vector<uint8_t> video_config_{}; // record in the last video sequence header
+    uint8_t sound_header_{};
+};
\ No newline at end of file
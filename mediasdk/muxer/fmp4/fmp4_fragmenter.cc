@@ -0,0 +1,440 @@
+﻿#include "fmp4_fragmenter.h"
+
+#include <cstring>
+
+#include "codec_config.h"
+
+namespace {
+
+const uint32_t kVideoTimescale = 90000;
+const uint32_t kAacFrameSamples = 1024;
+// Until two video frames have been seen, the last one of a fragment is given 30 fps.
+const uint32_t kDefaultVideoDuration = kVideoTimescale / 30;
+
+// ISO/IEC 14496-12 8.8.3.1 sample flags
+const uint32_t kSampleFlagsSync = 0x02000000;    // sample_depends_on = 2 (no other)
+const uint32_t kSampleFlagsNonSync = 0x01010000; // depends on others, is non-sync
+
+const uint32_t kTrunDataOffset = 0x000001;
+const uint32_t kTrunSampleDuration = 0x000100;
+const uint32_t kTrunSampleSize = 0x000200;
+const uint32_t kTrunSampleFlags = 0x000400;
+const uint32_t kTfhdDefaultBaseIsMoof = 0x020000;
+
+const uint32_t kUnityMatrix[9] = {0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000};
+
+void PutBE16(std::vector<uint8_t>& out, uint16_t v) {
+    out.push_back((uint8_t)(v >> 8));
+    out.push_back((uint8_t)v);
+}
+
+void PutBE32(std::vector<uint8_t>& out, uint32_t v) {
+    out.push_back((uint8_t)(v >> 24));
+    out.push_back((uint8_t)(v >> 16));
+    out.push_back((uint8_t)(v >> 8));
+    out.push_back((uint8_t)v);
+}
+
+void PutBE64(std::vector<uint8_t>& out, uint64_t v) {
+    PutBE32(out, (uint32_t)(v >> 32));
+    PutBE32(out, (uint32_t)v);
+}
+
+void PatchBE32(std::vector<uint8_t>& out, size_t pos, uint32_t v) {
+    out[pos] = (uint8_t)(v >> 24);
+    out[pos + 1] = (uint8_t)(v >> 16);
+    out[pos + 2] = (uint8_t)(v >> 8);
+    out[pos + 3] = (uint8_t)v;
+}
+
+void PutZeros(std::vector<uint8_t>& out, size_t count) {
+    out.insert(out.end(), count, 0);
+}
+
+void PutFourCc(std::vector<uint8_t>& out, const char* type) {
+    out.insert(out.end(), type, type + 4);
+}
+
+// Box size is patched by EndBox.
+size_t BeginBox(std::vector<uint8_t>& out, const char* type) {
+    const size_t start = out.size();
+    PutBE32(out, 0);
+    PutFourCc(out, type);
+    return start;
+}
+
+size_t BeginFullBox(std::vector<uint8_t>& out, const char* type, uint8_t version,
+                    uint32_t flags) {
+    const size_t start = BeginBox(out, type);
+    PutBE32(out, ((uint32_t)version << 24) | (flags & 0xFFFFFF));
+    return start;
+}
+
+void EndBox(std::vector<uint8_t>& out, size_t start) {
+    PatchBE32(out, start, (uint32_t)(out.size() - start));
+}
+
+// MPEG-4 descriptor header (ISO/IEC 14496-1 8.3.3) with a one-byte size.
+void PutDescriptor(std::vector<uint8_t>& out, uint8_t tag, size_t size) {
+    out.push_back(tag);
+    out.push_back((uint8_t)size);
+}
+
+uint64_t ToTimescale(uint64_t us, uint32_t timescale) {
+    return us / 1000000 * timescale + us % 1000000 * timescale / 1000000;
+}
+
+} // namespace
+
+Fmp4Fragmenter::Fmp4Fragmenter() {}
+
+void Fmp4Fragmenter::Reset(const MuxerConfig& config, const std::vector<uint8_t>& video_config,
+                           uint32_t width, uint32_t height) {
+    config_ = config;
+    video_config_ = video_config;
+    width_ = width;
+    height_ = height;
+    uint32_t next_track_id = 1;
+    video_ = Track{};
+    audio_ = Track{};
+    if (config_.has_video) {
+        video_.track_id = next_track_id++;
+        video_.timescale = kVideoTimescale;
+        video_.last_duration = kDefaultVideoDuration;
+    }
+    if (config_.has_audio) {
+        audio_.track_id = next_track_id++;
+        audio_.timescale = (uint32_t)config_.sample_rate;
+        audio_.last_duration = kAacFrameSamples;
+    }
+    sequence_number_ = 0;
+    has_samples_ = false;
+    start_us_ = 0;
+}
+
+void Fmp4Fragmenter::AppendInitSegment(std::vector<uint8_t>& out) const {
+    const bool hevc = config_.video_codec == kMuxerVideoH265;
+    size_t box = BeginBox(out, "ftyp");
+    PutFourCc(out, "isom");
+    PutBE32(out, 0x200); // minor_version
+    PutFourCc(out, "isom");
+    PutFourCc(out, "iso6");
+    PutFourCc(out, "mp41");
+    if (config_.has_video) {
+        PutFourCc(out, hevc ? "hvc1" : "avc1");
+    }
+    EndBox(out, box);
+
+    const size_t moov = BeginBox(out, "moov");
+    box = BeginFullBox(out, "mvhd", 0, 0);
+    PutBE32(out, 0);    // creation_time
+    PutBE32(out, 0);    // modification_time
+    PutBE32(out, 1000); // timescale
+    PutBE32(out, 0);    // duration: in the fragments
+    PutBE32(out, 0x00010000); // rate 1.0
+    PutBE16(out, 0x0100);     // volume 1.0
+    PutZeros(out, 10);
+    for (uint32_t v : kUnityMatrix) {
+        PutBE32(out, v);
+    }
+    PutZeros(out, 24); // pre_defined
+    PutBE32(out, (config_.has_video ? 1 : 0) + (config_.has_audio ? 1 : 0) + 1);
+    EndBox(out, box);
+    if (config_.has_video) {
+        AppendTrack(video_, true, out);
+    }
+    if (config_.has_audio) {
+        AppendTrack(audio_, false, out);
+    }
+    const size_t mvex = BeginBox(out, "mvex");
+    const Track* tracks[2] = {config_.has_video ? &video_ : nullptr,
+                              config_.has_audio ? &audio_ : nullptr};
+    for (const Track* track : tracks) {
+        if (!track) {
+            continue;
+        }
+        box = BeginFullBox(out, "trex", 0, 0);
+        PutBE32(out, track->track_id);
+        PutBE32(out, 1); // default_sample_description_index
+        PutBE32(out, 0); // default_sample_duration
+        PutBE32(out, 0); // default_sample_size
+        PutBE32(out, track == &video_ ? kSampleFlagsNonSync : kSampleFlagsSync);
+        EndBox(out, box);
+    }
+    EndBox(out, mvex);
+    EndBox(out, moov);
+}
+
+bool Fmp4Fragmenter::AddVideo(const uint8_t* data, size_t size, uint64_t pts_us,
+                              bool keyframe) {
+    const size_t old_size = video_.data.size();
+    AnnexBToLengthPrefixed(data, size, config_.video_codec == kMuxerVideoH265, video_.data);
+    if (video_.data.size() == old_size) {
+        return false;
+    }
+    if (!has_samples_) {
+        has_samples_ = true;
+        start_us_ = pts_us;
+    }
+    Sample sample;
+    sample.decode_time = ToTimescale(pts_us, video_.timescale);
+    sample.size = (uint32_t)(video_.data.size() - old_size);
+    sample.keyframe = keyframe;
+    video_.samples.push_back(sample);
+    return true;
+}
+
+bool Fmp4Fragmenter::AddAudio(const uint8_t* aac, size_t size, uint64_t pts_us) {
+    const size_t skip = AacAdtsHeaderSize(aac, size);
+    if (size <= skip) {
+        return false;
+    }
+    if (!has_samples_) {
+        has_samples_ = true;
+        start_us_ = pts_us;
+    }
+    // AAC frames follow each other without gaps, so decode times are counted in frames rather
+    // than taken from the timestamps, whose jitter would otherwise leave gaps and overlaps.
+    // The count restarts from the timestamp at a fragment boundary when the two have parted
+    // by more than two frames, e.g. after the encoder dropped audio.
+    const uint64_t time = ToTimescale(pts_us, audio_.timescale);
+    if (audio_.samples.empty()) {
+        const uint64_t gap = time > audio_.next_decode_time ? time - audio_.next_decode_time
+                                                            : audio_.next_decode_time - time;
+        if (!audio_.started || gap > 2 * kAacFrameSamples) {
+            audio_.next_decode_time = time;
+            audio_.started = true;
+        }
+    }
+    Sample sample;
+    sample.decode_time = audio_.next_decode_time;
+    sample.size = (uint32_t)(size - skip);
+    sample.keyframe = true;
+    audio_.samples.push_back(sample);
+    audio_.data.insert(audio_.data.end(), aac + skip, aac + size);
+    audio_.next_decode_time += kAacFrameSamples;
+    return true;
+}
+
+bool Fmp4Fragmenter::HasSamples() const {
+    return has_samples_;
+}
+
+uint64_t Fmp4Fragmenter::GetStartUs() const {
+    return start_us_;
+}
+
+size_t Fmp4Fragmenter::GetBufferedBytes() const {
+    return video_.data.size() + audio_.data.size();
+}
+
+void Fmp4Fragmenter::AppendFragment(uint64_t end_us, std::vector<uint8_t>& out) {
+    const size_t moof = BeginBox(out, "moof");
+    size_t box = BeginFullBox(out, "mfhd", 0, 0);
+    PutBE32(out, ++sequence_number_);
+    EndBox(out, box);
+    size_t video_offset_pos = 0;
+    size_t audio_offset_pos = 0;
+    if (!video_.samples.empty()) {
+        AppendTraf(video_, true, end_us ? ToTimescale(end_us, video_.timescale) : 0,
+                   video_offset_pos, out);
+    }
+    if (!audio_.samples.empty()) {
+        AppendTraf(audio_, false, 0, audio_offset_pos, out);
+    }
+    EndBox(out, moof);
+
+    // Data offsets count from the start of the moof (default-base-is-moof).
+    const size_t mdat_header = 8;
+    const size_t moof_size = out.size() - moof;
+    if (video_offset_pos) {
+        PatchBE32(out, video_offset_pos, (uint32_t)(moof_size + mdat_header));
+    }
+    if (audio_offset_pos) {
+        PatchBE32(out, audio_offset_pos,
+                  (uint32_t)(moof_size + mdat_header + video_.data.size()));
+    }
+    box = BeginBox(out, "mdat");
+    out.insert(out.end(), video_.data.begin(), video_.data.end());
+    out.insert(out.end(), audio_.data.begin(), audio_.data.end());
+    EndBox(out, box);
+    DropSamples();
+}
+
+void Fmp4Fragmenter::DropSamples() {
+    video_.samples.clear();
+    video_.data.clear();
+    audio_.samples.clear();
+    audio_.data.clear();
+    has_samples_ = false;
+}
+
+void Fmp4Fragmenter::AppendTraf(Track& track, bool video, uint64_t end_time,
+                                size_t& data_offset_pos, std::vector<uint8_t>& out) {
+    const size_t traf = BeginBox(out, "traf");
+    size_t box = BeginFullBox(out, "tfhd", 0, kTfhdDefaultBaseIsMoof);
+    PutBE32(out, track.track_id);
+    EndBox(out, box);
+    box = BeginFullBox(out, "tfdt", 1, 0);
+    PutBE64(out, track.samples.front().decode_time);
+    EndBox(out, box);
+
+    uint32_t flags = kTrunDataOffset | kTrunSampleDuration | kTrunSampleSize;
+    if (video) {
+        flags |= kTrunSampleFlags;
+    }
+    box = BeginFullBox(out, "trun", 0, flags);
+    PutBE32(out, (uint32_t)track.samples.size());
+    data_offset_pos = out.size();
+    PutBE32(out, 0);
+    uint32_t last_duration = track.last_duration;
+    for (size_t i = 0; i < track.samples.size(); ++i) {
+        const Sample& sample = track.samples[i];
+        uint32_t duration = video ? last_duration : kAacFrameSamples;
+        const uint64_t next = i + 1 < track.samples.size() ? track.samples[i + 1].decode_time
+                                                           : end_time;
+        if (video && next > sample.decode_time) {
+            duration = (uint32_t)(next - sample.decode_time);
+        }
+        last_duration = duration;
+        PutBE32(out, duration);
+        PutBE32(out, sample.size);
+        if (video) {
+            PutBE32(out, sample.keyframe ? kSampleFlagsSync : kSampleFlagsNonSync);
+        }
+    }
+    EndBox(out, box);
+    EndBox(out, traf);
+    track.last_duration = last_duration;
+}
+
+void Fmp4Fragmenter::AppendTrack(const Track& track, bool video,
+                                 std::vector<uint8_t>& out) const {
+    const size_t trak = BeginBox(out, "trak");
+    size_t box = BeginFullBox(out, "tkhd", 0, 0x000003); // enabled, in movie
+    PutBE32(out, 0); // creation_time
+    PutBE32(out, 0); // modification_time
+    PutBE32(out, track.track_id);
+    PutBE32(out, 0); // reserved
+    PutBE32(out, 0); // duration
+    PutZeros(out, 8);
+    PutBE16(out, 0); // layer
+    PutBE16(out, 0); // alternate_group
+    PutBE16(out, video ? 0 : 0x0100); // volume
+    PutBE16(out, 0);
+    for (uint32_t v : kUnityMatrix) {
+        PutBE32(out, v);
+    }
+    PutBE32(out, video ? width_ << 16 : 0);
+    PutBE32(out, video ? height_ << 16 : 0);
+    EndBox(out, box);
+
+    const size_t mdia = BeginBox(out, "mdia");
+    box = BeginFullBox(out, "mdhd", 0, 0);
+    PutBE32(out, 0);
+    PutBE32(out, 0);
+    PutBE32(out, track.timescale);
+    PutBE32(out, 0);
+    PutBE16(out, 0x55C4); // language 'und'
+    PutBE16(out, 0);
+    EndBox(out, box);
+    box = BeginFullBox(out, "hdlr", 0, 0);
+    PutBE32(out, 0); // pre_defined
+    PutFourCc(out, video ? "vide" : "soun");
+    PutZeros(out, 12);
+    const char* name = video ? "VideoHandler" : "SoundHandler";
+    out.insert(out.end(), name, name + strlen(name) + 1);
+    EndBox(out, box);
+
+    const size_t minf = BeginBox(out, "minf");
+    if (video) {
+        box = BeginFullBox(out, "vmhd", 0, 1);
+        PutZeros(out, 8); // graphicsmode, opcolor
+    } else {
+        box = BeginFullBox(out, "smhd", 0, 0);
+        PutZeros(out, 4); // balance, reserved
+    }
+    EndBox(out, box);
+    const size_t dinf = BeginBox(out, "dinf");
+    const size_t dref = BeginFullBox(out, "dref", 0, 0);
+    PutBE32(out, 1);
+    box = BeginFullBox(out, "url ", 0, 1); // media data in this file
+    EndBox(out, box);
+    EndBox(out, dref);
+    EndBox(out, dinf);
+
+    // The sample tables are empty; the samples are described by the fragments.
+    const size_t stbl = BeginBox(out, "stbl");
+    const size_t stsd = BeginFullBox(out, "stsd", 0, 0);
+    PutBE32(out, 1);
+    AppendSampleEntry(video, out);
+    EndBox(out, stsd);
+    const char* empty_tables[] = {"stts", "stsc", "stco"};
+    for (const char* type : empty_tables) {
+        box = BeginFullBox(out, type, 0, 0);
+        PutBE32(out, 0);
+        EndBox(out, box);
+    }
+    box = BeginFullBox(out, "stsz", 0, 0);
+    PutBE32(out, 0); // sample_size
+    PutBE32(out, 0); // sample_count
+    EndBox(out, box);
+    EndBox(out, stbl);
+    EndBox(out, minf);
+    EndBox(out, mdia);
+    EndBox(out, trak);
+}
+
+void Fmp4Fragmenter::AppendSampleEntry(bool video, std::vector<uint8_t>& out) const {
+    if (video) {
+        const bool hevc = config_.video_codec == kMuxerVideoH265;
+        const size_t entry = BeginBox(out, hevc ? "hvc1" : "avc1");
+        PutZeros(out, 6);
+        PutBE16(out, 1);   // data_reference_index
+        PutZeros(out, 16); // pre_defined, reserved
+        PutBE16(out, (uint16_t)width_);
+        PutBE16(out, (uint16_t)height_);
+        PutBE32(out, 0x00480000); // 72 dpi
+        PutBE32(out, 0x00480000);
+        PutBE32(out, 0);
+        PutBE16(out, 1);   // frame_count
+        PutZeros(out, 32); // compressorname
+        PutBE16(out, 0x0018);
+        PutBE16(out, 0xFFFF); // pre_defined = -1
+        const size_t config = BeginBox(out, hevc ? "hvcC" : "avcC");
+        out.insert(out.end(), video_config_.begin(), video_config_.end());
+        EndBox(out, config);
+        EndBox(out, entry);
+        return;
+    }
+    const size_t entry = BeginBox(out, "mp4a");
+    PutZeros(out, 6);
+    PutBE16(out, 1); // data_reference_index
+    PutZeros(out, 8);
+    PutBE16(out, (uint16_t)config_.channels);
+    PutBE16(out, 16); // samplesize
+    PutZeros(out, 4);
+    PutBE32(out, (uint32_t)config_.sample_rate << 16);
+
+    std::vector<uint8_t> asc;
+    BuildAacAudioSpecificConfig(config_.sample_rate, config_.channels, asc);
+    const size_t decoder_specific = 2 + asc.size();
+    const size_t decoder_config = 13 + decoder_specific;
+    const size_t es = 3 + 2 + decoder_config + 2 + 1;
+    const size_t esds = BeginFullBox(out, "esds", 0, 0);
+    PutDescriptor(out, 0x03, es); // ES_Descriptor
+    PutBE16(out, 0);              // ES_ID
+    out.push_back(0);             // flags
+    PutDescriptor(out, 0x04, decoder_config); // DecoderConfigDescriptor
+    out.push_back(0x40); // objectTypeIndication: MPEG-4 audio
+    out.push_back(0x15); // streamType audio, upStream 0, reserved 1
+    PutZeros(out, 3);    // bufferSizeDB
+    PutBE32(out, 0);     // maxBitrate
+    PutBE32(out, 0);     // avgBitrate
+    PutDescriptor(out, 0x05, asc.size()); // DecoderSpecificInfo
+    out.insert(out.end(), asc.begin(), asc.end());
+    PutDescriptor(out, 0x06, 1); // SLConfigDescriptor
+    out.push_back(0x02);         // predefined: MP4
+    EndBox(out, esds);
+    EndBox(out, entry);
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+﻿#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "media_muxer.h"
+
+// Builds fragmented MP4 (ISO/IEC 14496-12 8.8) in memory: the initialization segment (ftyp and
+// an empty moov) and moof + mdat fragments of the samples added since the last one. Video runs
+// on a 90 kHz timescale and audio on its sample rate; decode times come from the timestamps
+// for video and are counted in 1024-sample frames for audio. Does no I/O and holds no lock;
+// Fmp4Muxer and the HLS segmenter decide where fragments are cut and where they go.
+class Fmp4Fragmenter {
+public:
+    Fmp4Fragmenter();
+
+    // video_config is the 'avcC' or 'hvcC' record, width and height the coded size.
+    void Reset(const MuxerConfig& config, const std::vector<uint8_t>& video_config,
+               uint32_t width, uint32_t height);
+    void AppendInitSegment(std::vector<uint8_t>& out) const;
+
+    // Takes an Annex-B access unit; false if it held no picture data.
+    bool AddVideo(const uint8_t* data, size_t size, uint64_t pts_us, bool keyframe);
+    // Takes a raw or ADTS AAC frame.
+    bool AddAudio(const uint8_t* aac, size_t size, uint64_t pts_us);
+
+    bool HasSamples() const;
+    // Timestamp of the first sample added since the last fragment.
+    uint64_t GetStartUs() const;
+    size_t GetBufferedBytes() const;
+
+    // Appends moof + mdat of the samples gathered and starts over. end_us is the time of the
+    // frame that will start the next fragment and ends the last video sample; 0 if unknown.
+    void AppendFragment(uint64_t end_us, std::vector<uint8_t>& out);
+    // Drops the samples gathered without writing them.
+    void DropSamples();
+
+private:
+    struct Sample {
+        uint64_t decode_time; // in the track's timescale
+        uint32_t size;
+        bool keyframe;
+    };
+
+    struct Track {
+        uint32_t track_id{};
+        uint32_t timescale{};
+        std::vector<Sample> samples{};
+        std::vector<uint8_t> data{}; // mdat payload of the fragment being gathered
+        uint64_t next_decode_time{};
+        uint32_t last_duration{};
+        bool started{};
+    };
+
+    void AppendTrack(const Track& track, bool video, std::vector<uint8_t>& out) const;
+    void AppendSampleEntry(bool video, std::vector<uint8_t>& out) const;
+    void AppendTraf(Track& track, bool video, uint64_t end_time, size_t& data_offset_pos,
+                    std::vector<uint8_t>& out);
+
+private:
+    MuxerConfig config_{};
+    std::vector<uint8_t> video_config_{};
+    uint32_t width_{};
+    uint32_t height_{};
+    Track video_{};
+    Track audio_{};
+    uint32_t sequence_number_{};
+    bool has_samples_{};
+    uint64_t start_us_{};
+};
\ No newline at end of file
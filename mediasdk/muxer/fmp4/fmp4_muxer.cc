@@ -0,0 +1,88 @@
+﻿#include "fmp4_muxer.h"
+
+#include "local_log.h"
+
+namespace {
+
+const char* kFmp4MuxerLogTag = "Fmp4Muxer";
+
+} // namespace
+
+Fmp4Muxer::Fmp4Muxer() {}
+
+Fmp4Muxer::~Fmp4Muxer() {
+    Close();
+}
+
+bool Fmp4Muxer::WriteHeader() {
+    std::vector<uint8_t> video_config;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    if (config_.has_video) {
+        if (!BuildVideoDecoderConfig(video_config)) {
+            LOGE(kFmp4MuxerLogTag) << "[WriteHeader] invalid parameter sets";
+            return false;
+        }
+        GetVideoSize(width, height);
+    }
+    fragmenter_.Reset(config_, video_config, width, height);
+    header_written_ = false;
+    warned_parameter_sets_ = false;
+    buffer_.clear();
+    fragmenter_.AppendInitSegment(buffer_);
+    if (!writer_.Write(buffer_.data(), buffer_.size())) {
+        return false;
+    }
+    writer_.Flush();
+    header_written_ = true;
+    return true;
+}
+
+bool Fmp4Muxer::MuxVideo(const uint8_t* data, size_t size, uint64_t pts_us, bool keyframe,
+                         bool parameter_sets_changed) {
+    if (parameter_sets_changed && header_written_ && fragmenter_.HasSamples() &&
+        !warned_parameter_sets_) {
+        LOGW(kFmp4MuxerLogTag) << "[MuxVideo] parameter sets changed, keeping the first ones";
+        warned_parameter_sets_ = true;
+    }
+    bool written = true;
+    if (fragmenter_.HasSamples()) {
+        const uint64_t start_us = fragmenter_.GetStartUs();
+        const uint64_t elapsed_us = pts_us > start_us ? pts_us - start_us : 0;
+        // A stream without keyframes must not grow a fragment beyond what the writer can hold.
+        const bool full = fragmenter_.GetBufferedBytes() + size > config_.max_buffered_bytes / 2;
+        if ((keyframe && elapsed_us >= (uint64_t)config_.fragment_ms * 1000) || full) {
+            written = WriteFragment(pts_us);
+        }
+    }
+    if (!written && !keyframe) {
+        // The lost fragment held what this frame refers to.
+        return false;
+    }
+    return fragmenter_.AddVideo(data, size, pts_us, keyframe);
+}
+
+bool Fmp4Muxer::MuxAudio(const uint8_t* aac, size_t size, uint64_t pts_us) {
+    if (!config_.has_video && fragmenter_.HasSamples() && pts_us > fragmenter_.GetStartUs() &&
+        pts_us - fragmenter_.GetStartUs() >= (uint64_t)config_.fragment_ms * 1000) {
+        WriteFragment(pts_us);
+    }
+    return fragmenter_.AddAudio(aac, size, pts_us);
+}
+
+void Fmp4Muxer::Finish() {
+    if (fragmenter_.HasSamples()) {
+        WriteFragment(0);
+    }
+}
+
+bool Fmp4Muxer::WriteFragment(uint64_t end_us) {
+    buffer_.clear();
+    fragmenter_.AppendFragment(end_us, buffer_);
+    if (!writer_.Write(buffer_.data(), buffer_.size())) {
+        return false;
+    }
+    // A fragment is the unit a crash may lose; put it on its way to the disk now.
+    writer_.Flush();
+    return true;
+}
\ No newline at end of file
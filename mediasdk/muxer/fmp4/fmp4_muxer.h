@@ -0,0 +1,35 @@
+﻿#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "fmp4_fragmenter.h"
+#include "media_muxer.h"
+
+// Records to fragmented MP4: ftyp and an empty moov go out at the first keyframe, then one
+// moof + mdat per fragment. Fragments are cut at a keyframe once MuxerConfig::fragment_ms has
+// passed, queued whole and flushed, so after a crash the file plays up to the last complete
+// fragment and needs no repair. The sample description is fixed by the first keyframe;
+// parameter sets that change later are not followed.
+class Fmp4Muxer : public MediaMuxer {
+public:
+    Fmp4Muxer();
+    ~Fmp4Muxer() override;
+
+protected:
+    bool WriteHeader() override;
+    bool MuxVideo(const uint8_t* data, size_t size, uint64_t pts_us, bool keyframe,
+                  bool parameter_sets_changed) override;
+    bool MuxAudio(const uint8_t* aac, size_t size, uint64_t pts_us) override;
+    void Finish() override;
+
+private:
+    // Writes the samples gathered so far as one fragment. end_us is the time of the frame that
+    // starts the next fragment; 0 at the end of the file.
+    bool WriteFragment(uint64_t end_us);
+
+private:
+    Fmp4Fragmenter fragmenter_{};
+    std::vector<uint8_t> buffer_{};
+    bool header_written_{};
+    bool warned_parameter_sets_{};
+};
\ No newline at end of file
@@ -0,0 +1,399 @@
+﻿#include "hls_segmenter.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+#include "local_log.h"
+
+namespace {
+
+const char* kHlsSegmenterLogTag = "HlsSegmenter";
+// LL-HLS lists the parts of roughly the last three target durations; their files stay as
+// long again for the clients that loaded an older playlist.
+const size_t kListedPartSegments = 3;
+const double kPartHoldBackParts = 3.0;
+const uint64_t kAacFrameSamples = 1024;
+
+} // namespace
+
+HlsSegmenter::HlsSegmenter(HlsSegmentFormat format) : format_(format) {}
+
+HlsSegmenter::~HlsSegmenter() {
+    Close();
+}
+
+bool HlsSegmenter::WriteHeader() {
+    segments_.clear();
+    expired_.clear();
+    current_ = Segment{};
+    part_data_.clear();
+    segment_data_.clear();
+    file_index_ = 0;
+    next_sequence_ = 0;
+    discontinuity_sequence_ = 0;
+    discontinuity_next_ = false;
+    target_duration_ = (int)((config_.segment_ms + 999) / 1000);
+    segment_start_us_ = 0;
+    part_start_us_ = 0;
+    part_open_ = false;
+    last_video_us_ = 0;
+    video_frame_us_ = 0;
+    end_us_ = 0;
+    warned_parameter_sets_ = false;
+    if (format_ == kHlsSegmentTs) {
+        ts_.Reset(config_);
+        return true;
+    }
+
+    std::vector<uint8_t> video_config;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    if (config_.has_video) {
+        if (!BuildVideoDecoderConfig(video_config)) {
+            LOGE(kHlsSegmenterLogTag) << "[WriteHeader] invalid parameter sets";
+            return false;
+        }
+        GetVideoSize(width, height);
+    }
+    fragmenter_.Reset(config_, video_config, width, height);
+    std::vector<uint8_t> init;
+    fragmenter_.AppendInitSegment(init);
+    if (!files_.WriteFile(stem_ + "_init.mp4", init)) {
+        LOGE(kHlsSegmenterLogTag) << "[WriteHeader] cannot queue the init segment";
+        return false;
+    }
+    return true;
+}
+
+bool HlsSegmenter::MuxVideo(const uint8_t* data, size_t size, uint64_t pts_us, bool keyframe,
+                            bool parameter_sets_changed) {
+    if (parameter_sets_changed && format_ == kHlsSegmentFmp4 && part_open_ &&
+        !warned_parameter_sets_) {
+        LOGW(kHlsSegmenterLogTag) << "[MuxVideo] parameter sets changed, keeping the first ones";
+        warned_parameter_sets_ = true;
+    }
+    if (pts_us > last_video_us_) {
+        video_frame_us_ = pts_us - last_video_us_;
+    }
+    CutBefore(pts_us, video_frame_us_, keyframe);
+    if (!part_open_) {
+        BeginPart(pts_us, keyframe);
+    }
+    last_video_us_ = pts_us;
+    if (pts_us + video_frame_us_ > end_us_) {
+        end_us_ = pts_us + video_frame_us_;
+    }
+    if (format_ == kHlsSegmentTs) {
+        ts_.AppendVideo(data, size, pts_us, keyframe, part_data_);
+        return true;
+    }
+    return fragmenter_.AddVideo(data, size, pts_us, keyframe);
+}
+
+bool HlsSegmenter::MuxAudio(const uint8_t* aac, size_t size, uint64_t pts_us) {
+    const uint64_t frame_us = kAacFrameSamples * 1000000 / config_.sample_rate;
+    if (!config_.has_video) {
+        CutBefore(pts_us, frame_us, true);
+    }
+    if (!part_open_) {
+        BeginPart(pts_us, !config_.has_video);
+    }
+    // With video the timeline is the video's; audio runs over the end of a part as it must.
+    if (!config_.has_video && pts_us + frame_us > end_us_) {
+        end_us_ = pts_us + frame_us;
+    }
+    if (format_ == kHlsSegmentTs) {
+        ts_.AppendAudio(aac, size, pts_us, part_data_);
+        return true;
+    }
+    return fragmenter_.AddAudio(aac, size, pts_us);
+}
+
+void HlsSegmenter::Finish() {
+    if (part_open_ || !segment_data_.empty()) {
+        CloseSegment(end_us_);
+    }
+    WritePlaylist(true);
+}
+
+bool HlsSegmenter::OpenOutput(const std::string& filename) {
+    const size_t slash = filename.find_last_of("/\\");
+    const std::string directory = slash == std::string::npos ? "." : filename.substr(0, slash);
+    playlist_name_ = slash == std::string::npos ? filename : filename.substr(slash + 1);
+    stem_ = playlist_name_.substr(0, playlist_name_.rfind('.'));
+    if (stem_.empty()) {
+        LOGE(kHlsSegmenterLogTag) << "[OpenOutput] no playlist name in " << filename;
+        return false;
+    }
+    // Done before the I/O thread starts, so nothing new is queued behind the old files.
+    RemoveOldOutput(directory);
+    // A segment and the parts of the next one are what is normally in flight.
+    return files_.Open(directory, config_.max_buffered_bytes);
+}
+
+void HlsSegmenter::RemoveOldOutput(const std::string& directory) {
+    std::ifstream in(directory + "/" + playlist_name_);
+    if (!in) {
+        return;
+    }
+    // An ended playlist from the last run would stay up until the first new segment lands,
+    // and its media sequence is ahead of the one this run starts at, so it goes first, and
+    // then the files it names. Only names of this stem in this directory are touched.
+    const std::string playlist = directory + "/" + playlist_name_;
+    std::vector<std::string> names;
+    uint64_t first_index = 0;
+    bool have_first = false;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        std::string name;
+        if (line.empty()) {
+            continue;
+        } else if (line[0] != '#') {
+            name = line;
+        } else {
+            const size_t uri = line.find("URI=\"");
+            const size_t end = uri == std::string::npos ? uri : line.find('"', uri + 5);
+            if (end == std::string::npos) {
+                continue;
+            }
+            name = line.substr(uri + 5, end - uri - 5);
+        }
+        if (name.compare(0, stem_.size(), stem_) != 0 ||
+            name.find_first_of("/\\") != std::string::npos) {
+            continue;
+        }
+        if (line[0] != '#' && !have_first) {
+            first_index = strtoull(name.c_str() + stem_.size(), nullptr, 10);
+            have_first = true;
+        }
+        names.push_back(name);
+    }
+    in.close();
+    std::remove(playlist.c_str());
+    for (const std::string& name : names) {
+        std::remove((directory + "/" + name).c_str());
+    }
+    // Expired segments are kept for a while after they leave the playlist; they are the ones
+    // just before the first listed.
+    while (have_first && first_index > 0) {
+        if (std::remove((directory + "/" + SegmentName(--first_index)).c_str()) != 0) {
+            break;
+        }
+    }
+}
+
+void HlsSegmenter::CloseOutput() {
+    files_.Close();
+}
+
+RecordFileWriterStats HlsSegmenter::GetOutputStats() {
+    return files_.GetStats();
+}
+
+bool HlsSegmenter::IsLowLatency() const {
+    return config_.part_ms > 0;
+}
+
+void HlsSegmenter::CutBefore(uint64_t pts_us, uint64_t frame_us, bool keyframe) {
+    if (!part_open_ || pts_us <= part_start_us_) {
+        return;
+    }
+    const bool segment_due =
+        keyframe && pts_us - segment_start_us_ >= (uint64_t)config_.segment_ms * 1000;
+    // A part ends before the frame that would take it past the part target.
+    const bool part_due =
+        IsLowLatency() && pts_us - part_start_us_ + frame_us > (uint64_t)config_.part_ms * 1000;
+    if (segment_due) {
+        CloseSegment(pts_us);
+    } else if (part_due) {
+        ClosePart(pts_us);
+    } else {
+        return;
+    }
+    WritePlaylist(false);
+}
+
+void HlsSegmenter::BeginPart(uint64_t pts_us, bool independent) {
+    part_open_ = true;
+    part_start_us_ = pts_us;
+    part_independent_ = independent;
+    if (format_ == kHlsSegmentTs && independent) {
+        ts_.AppendTables(part_data_);
+    }
+}
+
+void HlsSegmenter::ClosePart(uint64_t end_us) {
+    if (!part_open_) {
+        return;
+    }
+    part_open_ = false;
+    if (format_ == kHlsSegmentFmp4 && fragmenter_.HasSamples()) {
+        fragmenter_.AppendFragment(end_us, part_data_);
+    }
+    if (!IsLowLatency()) {
+        if (segment_data_.empty()) {
+            segment_data_.swap(part_data_);
+        } else {
+            segment_data_.insert(segment_data_.end(), part_data_.begin(), part_data_.end());
+        }
+        part_data_.clear();
+        return;
+    }
+    Part part;
+    part.duration = (end_us - part_start_us_) / 1e6;
+    part.uri = PartName(file_index_, current_.parts.size());
+    part.independent = part_independent_;
+    segment_data_.insert(segment_data_.end(), part_data_.begin(), part_data_.end());
+    if (current_.parts_listed && !files_.WriteFile(part.uri, part_data_)) {
+        // Parts before this one were listed already; the segment itself may still make it.
+        LOGW(kHlsSegmenterLogTag) << "[ClosePart] writer full, dropping " << part.uri;
+        current_.parts_listed = false;
+    }
+    part_data_.clear();
+    current_.parts.push_back(part);
+}
+
+void HlsSegmenter::CloseSegment(uint64_t end_us) {
+    ClosePart(end_us);
+    current_.duration = (end_us - segment_start_us_) / 1e6;
+    current_.uri = SegmentName(file_index_);
+    if (files_.WriteFile(current_.uri, segment_data_)) {
+        current_.sequence = next_sequence_++;
+        current_.discontinuity = discontinuity_next_;
+        discontinuity_next_ = false;
+        // Segments end on keyframes, so one may run past the target; the target follows, as
+        // EXTINF must not exceed it once rounded.
+        const int rounded = (int)(current_.duration + 0.5);
+        if (rounded > target_duration_) {
+            LOGW(kHlsSegmenterLogTag) << "[CloseSegment] " << current_.uri << " lasts "
+                                      << current_.duration << " s, raising the target duration";
+            target_duration_ = rounded;
+        }
+        segments_.push_back(std::move(current_));
+    } else {
+        LOGW(kHlsSegmenterLogTag) << "[CloseSegment] writer full, dropping " << current_.uri;
+        RemovePartFiles(current_);
+        discontinuity_next_ = true;
+    }
+    segment_data_.clear();
+    current_ = Segment{};
+    ++file_index_;
+    segment_start_us_ = end_us;
+    RemoveExpired();
+}
+
+void HlsSegmenter::RemoveExpired() {
+    if (IsLowLatency()) {
+        const size_t count = segments_.size();
+        if (count > kListedPartSegments) {
+            segments_[count - 1 - kListedPartSegments].parts_listed = false;
+        }
+        if (count > 2 * kListedPartSegments) {
+            RemovePartFiles(segments_[count - 1 - 2 * kListedPartSegments]);
+        }
+    }
+    if (config_.playlist_size == 0) {
+        return;
+    }
+    while (segments_.size() > config_.playlist_size) {
+        if (segments_.front().discontinuity) {
+            ++discontinuity_sequence_;
+        }
+        expired_.push_back(std::move(segments_.front()));
+        segments_.pop_front();
+    }
+    while (expired_.size() > config_.playlist_size) {
+        RemovePartFiles(expired_.front());
+        files_.RemoveFile(expired_.front().uri);
+        expired_.pop_front();
+    }
+}
+
+void HlsSegmenter::RemovePartFiles(Segment& segment) {
+    for (const Part& part : segment.parts) {
+        files_.RemoveFile(part.uri);
+    }
+    segment.parts.clear();
+    segment.parts_listed = false;
+}
+
+void HlsSegmenter::WritePlaylist(bool ended) {
+    const bool low_latency = IsLowLatency();
+    char line[512];
+    std::string text = "#EXTM3U\n";
+    snprintf(line, sizeof(line), "#EXT-X-VERSION:%d\n#EXT-X-TARGETDURATION:%d\n",
+             format_ == kHlsSegmentFmp4 ? 7 : (low_latency ? 6 : 3), target_duration_);
+    text += line;
+    if (config_.playlist_size == 0) {
+        text += "#EXT-X-PLAYLIST-TYPE:EVENT\n";
+    }
+    if (low_latency) {
+        const double part_target = config_.part_ms / 1000.0;
+        snprintf(line, sizeof(line),
+                 "#EXT-X-SERVER-CONTROL:PART-HOLD-BACK=%.3f\n#EXT-X-PART-INF:PART-TARGET=%.3f\n",
+                 part_target * kPartHoldBackParts, part_target);
+        text += line;
+    }
+    snprintf(line, sizeof(line), "#EXT-X-MEDIA-SEQUENCE:%llu\n",
+             (unsigned long long)(segments_.empty() ? next_sequence_
+                                                    : segments_.front().sequence));
+    text += line;
+    if (discontinuity_sequence_ > 0) {
+        snprintf(line, sizeof(line), "#EXT-X-DISCONTINUITY-SEQUENCE:%llu\n",
+                 (unsigned long long)discontinuity_sequence_);
+        text += line;
+    }
+    text += "#EXT-X-INDEPENDENT-SEGMENTS\n";
+    if (format_ == kHlsSegmentFmp4) {
+        text += "#EXT-X-MAP:URI=\"" + stem_ + "_init.mp4\"\n";
+    }
+
+    auto append_parts = [&](const Segment& segment) {
+        for (const Part& part : segment.parts) {
+            snprintf(line, sizeof(line), "#EXT-X-PART:DURATION=%.3f,URI=\"%s\"%s\n", part.duration,
+                     part.uri.c_str(), part.independent ? ",INDEPENDENT=YES" : "");
+            text += line;
+        }
+    };
+    for (const Segment& segment : segments_) {
+        if (segment.discontinuity) {
+            text += "#EXT-X-DISCONTINUITY\n";
+        }
+        if (low_latency && segment.parts_listed) {
+            append_parts(segment);
+        }
+        snprintf(line, sizeof(line), "#EXTINF:%.3f,\n%s\n", segment.duration,
+                 segment.uri.c_str());
+        text += line;
+    }
+    if (ended) {
+        text += "#EXT-X-ENDLIST\n";
+    } else if (low_latency && current_.parts_listed) {
+        // The segment being built, as far as its parts go, and the part that comes next.
+        if (discontinuity_next_ && !current_.parts.empty()) {
+            text += "#EXT-X-DISCONTINUITY\n";
+        }
+        append_parts(current_);
+        text += "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"" +
+                PartName(file_index_, current_.parts.size()) + "\"\n";
+    }
+    files_.ReplaceFile(playlist_name_, text);
+}
+
+std::string HlsSegmenter::SegmentName(uint64_t index) const {
+    char name[32];
+    snprintf(name, sizeof(name), "%llu%s", (unsigned long long)index,
+             format_ == kHlsSegmentFmp4 ? ".m4s" : ".ts");
+    return stem_ + name;
+}
+
+std::string HlsSegmenter::PartName(uint64_t index, size_t part) const {
+    char name[48];
+    snprintf(name, sizeof(name), "%llu.%u%s", (unsigned long long)index, (unsigned)part,
+             format_ == kHlsSegmentFmp4 ? ".m4s" : ".ts");
+    return stem_ + name;
+}
\ No newline at end of file
@@ -0,0 +1,105 @@
+﻿#pragma once
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "fmp4/fmp4_fragmenter.h"
+#include "media_muxer.h"
+#include "segment_file_writer.h"
+#include "ts/ts_writer.h"
+
+enum HlsSegmentFormat {
+    kHlsSegmentTs,
+    kHlsSegmentFmp4,
+};
+
+// Cuts the stream into HLS media segments (RFC 8216) in a directory and keeps a playlist over
+// them, for any static file server to hand out. Open takes the path of the playlist; the
+// segments go next to it, named after it. A segment is closed at the first keyframe once
+// MuxerConfig::segment_ms has passed, so every segment starts with one. With part_ms set the
+// playlist is LL-HLS: each segment is also written as parts no longer than part_ms, listed
+// as they complete, and the next part is announced with a preload hint. Blocking playlist
+// reload needs a server that understands it and is not advertised.
+//
+// Files are written by a SegmentFileWriter, so the encoder threads never wait for the disk.
+// Segments that leave the playlist are deleted a playlist's length later, which gives the
+// clients that still hold an older playlist time to fetch them. A segment the writer could
+// not take is left out of the playlist, and the one after it is marked as a discontinuity.
+class HlsSegmenter : public MediaMuxer {
+public:
+    explicit HlsSegmenter(HlsSegmentFormat format);
+    ~HlsSegmenter() override;
+
+protected:
+    bool WriteHeader() override;
+    bool MuxVideo(const uint8_t* data, size_t size, uint64_t pts_us, bool keyframe,
+                  bool parameter_sets_changed) override;
+    bool MuxAudio(const uint8_t* aac, size_t size, uint64_t pts_us) override;
+    void Finish() override;
+
+    bool OpenOutput(const std::string& filename) override;
+    void CloseOutput() override;
+    RecordFileWriterStats GetOutputStats() override;
+
+private:
+    struct Part {
+        double duration;
+        std::string uri;
+        bool independent;
+    };
+
+    struct Segment {
+        uint64_t sequence{};
+        double duration{};
+        std::string uri{};
+        std::vector<Part> parts{};
+        bool discontinuity{};
+        bool parts_listed{true};
+    };
+
+    bool IsLowLatency() const;
+    // Closes the part and the segment when the frame at pts_us should start new ones, and
+    // publishes what was closed. frame_us is how long the frame lasts.
+    void CutBefore(uint64_t pts_us, uint64_t frame_us, bool keyframe);
+    // Starts a part, with PAT and PMT in front of it if a player may begin there.
+    void BeginPart(uint64_t pts_us, bool independent);
+    void ClosePart(uint64_t end_us);
+    void CloseSegment(uint64_t end_us);
+    void RemoveExpired();
+    void RemovePartFiles(Segment& segment);
+    void WritePlaylist(bool ended);
+    // Removes the playlist a previous run left in directory and the files it names.
+    void RemoveOldOutput(const std::string& directory);
+
+    std::string SegmentName(uint64_t index) const;
+    std::string PartName(uint64_t index, size_t part) const;
+
+private:
+    const HlsSegmentFormat format_;
+    SegmentFileWriter files_{};
+    std::string playlist_name_{};
+    std::string stem_{};
+    TsWriter ts_{};
+    Fmp4Fragmenter fragmenter_{};
+    bool warned_parameter_sets_{};
+
+    std::vector<uint8_t> part_data_{};
+    std::vector<uint8_t> segment_data_{};
+    std::deque<Segment> segments_{}; // listed in the playlist
+    std::deque<Segment> expired_{};  // out of it, files not deleted yet
+    Segment current_{};
+    uint64_t file_index_{};
+    uint64_t next_sequence_{};
+    uint64_t discontinuity_sequence_{};
+    bool discontinuity_next_{};
+    int target_duration_{};
+
+    uint64_t segment_start_us_{};
+    uint64_t part_start_us_{};
+    bool part_open_{};
+    bool part_independent_{};
+    uint64_t last_video_us_{};
+    uint64_t video_frame_us_{};
+    uint64_t end_us_{}; // end of the last frame muxed
+};
\ No newline at end of file
@@ -0,0 +1,190 @@
+﻿#include "segment_file_writer.h"
+
+#include <cstdio>
+
+#include "local_log.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace {
+
+const char* kSegmentFileWriterLogTag = "SegmentFileWriter";
+// Buffers kept for reuse: a segment and the parts in flight while the next one is built.
+const size_t kMaxSpareBuffers = 4;
+
+bool MakeDirectory(const std::string& directory) {
+#ifdef _WIN32
+    return CreateDirectoryA(directory.c_str(), NULL) || GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+    struct stat st;
+    return mkdir(directory.c_str(), 0755) == 0 ||
+           (stat(directory.c_str(), &st) == 0 && S_ISDIR(st.st_mode));
+#endif
+}
+
+bool ReplaceExisting(const std::string& from, const std::string& to) {
+#ifdef _WIN32
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+} // namespace
+
+SegmentFileWriter::SegmentFileWriter() {}
+
+SegmentFileWriter::~SegmentFileWriter() {
+    Close();
+}
+
+bool SegmentFileWriter::Open(const std::string& directory, size_t max_buffered_bytes) {
+    Close();
+    if (!MakeDirectory(directory)) {
+        LOGE(kSegmentFileWriterLogTag) << "[Open] cannot create " << directory;
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    directory_ = directory;
+    max_buffered_bytes_ = max_buffered_bytes;
+    buffered_bytes_ = 0;
+    stats_ = RecordFileWriterStats{};
+    stopping_ = false;
+    open_ = true;
+    thread_ = std::thread(&SegmentFileWriter::WriteThread, this);
+    return true;
+}
+
+bool SegmentFileWriter::WriteFile(const std::string& name, std::vector<uint8_t>& data) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!open_ || stopping_) {
+        return false;
+    }
+    if (buffered_bytes_ + data.size() > max_buffered_bytes_) {
+        stats_.bytes_dropped += data.size();
+        return false;
+    }
+    buffered_bytes_ += data.size();
+    stats_.bytes_queued += data.size();
+    jobs_.push_back(Job{kJobWrite, name, std::vector<uint8_t>()});
+    jobs_.back().data.swap(data);
+    if (!spare_.empty()) {
+        data.swap(spare_.back());
+        spare_.pop_back();
+    }
+    wake_.notify_one();
+    return true;
+}
+
+void SegmentFileWriter::ReplaceFile(const std::string& name, const std::string& text) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!open_ || stopping_) {
+        return;
+    }
+    jobs_.push_back(Job{kJobReplace, name, std::vector<uint8_t>(text.begin(), text.end())});
+    wake_.notify_one();
+}
+
+void SegmentFileWriter::RemoveFile(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!open_ || stopping_) {
+        return;
+    }
+    jobs_.push_back(Job{kJobRemove, name, std::vector<uint8_t>()});
+    wake_.notify_one();
+}
+
+void SegmentFileWriter::Close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!open_) {
+            return;
+        }
+        stopping_ = true;
+        wake_.notify_one();
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    open_ = false;
+}
+
+bool SegmentFileWriter::IsOpen() const {
+    return open_;
+}
+
+RecordFileWriterStats SegmentFileWriter::GetStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void SegmentFileWriter::WriteThread() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [this]() { return stopping_ || !jobs_.empty(); });
+        if (jobs_.empty()) {
+            break;
+        }
+        Job job = std::move(jobs_.front());
+        jobs_.pop_front();
+        lock.unlock();
+        const bool ok = RunJob(job);
+        lock.lock();
+        if (job.type != kJobWrite) {
+            continue;
+        }
+        buffered_bytes_ -= job.data.size();
+        if (ok) {
+            stats_.bytes_written += job.data.size();
+        } else {
+            ++stats_.write_errors;
+        }
+        if (spare_.size() < kMaxSpareBuffers) {
+            job.data.clear();
+            spare_.push_back(std::move(job.data));
+        }
+    }
+}
+
+bool SegmentFileWriter::RunJob(const Job& job) {
+    const std::string path = directory_ + "/" + job.name;
+    switch (job.type)
+    {
+    case kJobWrite:
+        return SaveFile(path, job.data.data(), job.data.size());
+    case kJobReplace: {
+        const std::string temporary = path + ".tmp";
+        if (!SaveFile(temporary, job.data.data(), job.data.size())) {
+            return false;
+        }
+        if (!ReplaceExisting(temporary, path)) {
+            LOGE(kSegmentFileWriterLogTag) << "[RunJob] cannot replace " << path;
+            return false;
+        }
+        return true;
+    }
+    case kJobRemove:
+        return std::remove(path.c_str()) == 0;
+    default:
+        return false;
+    }
+}
+
+bool SegmentFileWriter::SaveFile(const std::string& path, const uint8_t* data, size_t size) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) {
+        LOGE(kSegmentFileWriterLogTag) << "[SaveFile] cannot create " << path;
+        return false;
+    }
+    const bool ok = fwrite(data, 1, size, file) == size;
+    if (fclose(file) != 0 || !ok) {
+        LOGE(kSegmentFileWriterLogTag) << "[SaveFile] write failed " << path;
+        return false;
+    }
+    return true;
+}
\ No newline at end of file
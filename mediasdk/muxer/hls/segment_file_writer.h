@@ -0,0 +1,70 @@
+﻿#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "record_file_writer.h"
+
+// Writes whole files into one directory from a thread of its own, for the HLS segmenter:
+// segments and parts, playlists, and the removal of what has expired. Jobs run in the order
+// they were queued, so a playlist is only replaced once the files it names are on disk, and
+// playlists are written under a temporary name and renamed over the old one, so a file
+// server never hands out half of one. Media files queued and not yet written are bounded
+// like RecordFileWriter's buffer; a file that does not fit is refused and counted.
+class SegmentFileWriter {
+public:
+    SegmentFileWriter();
+    ~SegmentFileWriter();
+
+    // Creates the directory if its parent exists.
+    bool Open(const std::string& directory, size_t max_buffered_bytes);
+    // On success data is swapped for an empty buffer kept from an earlier file, so a steady
+    // stream of segments stops allocating; on failure it is left as it was.
+    bool WriteFile(const std::string& name, std::vector<uint8_t>& data);
+    // Playlists are small and must not be lost, so they do not count against the bound.
+    void ReplaceFile(const std::string& name, const std::string& text);
+    void RemoveFile(const std::string& name);
+    // Runs everything queued and stops the I/O thread.
+    void Close();
+    bool IsOpen() const;
+
+    RecordFileWriterStats GetStats();
+
+private:
+    SegmentFileWriter(const SegmentFileWriter&) = delete;
+    SegmentFileWriter& operator=(const SegmentFileWriter&) = delete;
+
+    enum JobType {
+        kJobWrite,
+        kJobReplace,
+        kJobRemove,
+    };
+
+    struct Job {
+        JobType type;
+        std::string name;
+        std::vector<uint8_t> data;
+    };
+
+    void WriteThread();
+    // Called on the I/O thread only.
+    bool RunJob(const Job& job);
+    bool SaveFile(const std::string& path, const uint8_t* data, size_t size);
+
+private:
+    std::mutex mutex_{};
+    std::condition_variable wake_{};
+    std::deque<Job> jobs_{};
+    std::vector<std::vector<uint8_t>> spare_{};
+    std::string directory_{};
+    size_t max_buffered_bytes_{};
+    size_t buffered_bytes_{};
+    bool open_{};
+    bool stopping_{};
+    std::thread thread_{};
+    RecordFileWriterStats stats_{};
+};
\ No newline at end of file
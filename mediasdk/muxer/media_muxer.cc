@@ -0,0 +1,218 @@
+﻿#include "media_muxer.h"
+
+#include <cstring>
+
+#include "annexb_scanner.h"
+#include "codec_config.h"
+#include "h264_sps_parser.h"
+#include "h265_sps_parser.h"
+#include "local_log.h"
+
+namespace {
+
+const char* kMediaMuxerLogTag = "MediaMuxer";
+
+const uint8_t kH264NalSps = 7;
+const uint8_t kH264NalPps = 8;
+
+bool StoreParameterSet(std::vector<uint8_t>& held, const NalUnit& nal) {
+    if (held.size() == nal.size && memcmp(held.data(), nal.data, nal.size) == 0) {
+        return false;
+    }
+    held.assign(nal.data, nal.data + nal.size);
+    return true;
+}
+
+} // namespace
+
+MediaMuxer::MediaMuxer() {}
+
+MediaMuxer::~MediaMuxer() {}
+
+bool MediaMuxer::Open(const std::string& filename, const MuxerConfig& config) {
+    Close();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!config.has_video && !config.has_audio) {
+        return false;
+    }
+    config_ = config;
+    if (!OpenOutput(filename)) {
+        return false;
+    }
+    open_ = true;
+    started_ = false;
+    wait_keyframe_ = false;
+    base_us_ = 0;
+    vps_.clear();
+    sps_.clear();
+    pps_.clear();
+    stats_ = MediaMuxerStats{};
+    LOGI(kMediaMuxerLogTag) << "[Open] " << filename;
+    return true;
+}
+
+bool MediaMuxer::WriteVideo(const uint8_t* data, size_t size, uint64_t pts_us, bool keyframe) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!open_ || !config_.has_video || !data || size == 0) {
+        return false;
+    }
+    // Parameter sets come with the keyframes; the encoders repeat them on every one.
+    const bool changed = keyframe && UpdateParameterSets(data, size);
+    if (!started_) {
+        if (!keyframe || !HasParameterSets()) {
+            ++stats_.frames_skipped;
+            return false;
+        }
+        base_us_ = pts_us;
+        if (!WriteHeader()) {
+            ++stats_.frames_skipped;
+            return false;
+        }
+        started_ = true;
+    }
+    if (pts_us < base_us_ || (wait_keyframe_ && !keyframe)) {
+        ++stats_.frames_skipped;
+        return false;
+    }
+    if (!MuxVideo(data, size, pts_us - base_us_, keyframe, changed)) {
+        // Frames after a lost one cannot be decoded until the next keyframe.
+        wait_keyframe_ = true;
+        ++stats_.frames_skipped;
+        return false;
+    }
+    wait_keyframe_ = false;
+    ++stats_.video_frames;
+    return true;
+}
+
+bool MediaMuxer::WriteAudio(const uint8_t* data, size_t size, uint64_t pts_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!open_ || !config_.has_audio || !data || size == 0) {
+        return false;
+    }
+    if (!started_ && !config_.has_video) {
+        base_us_ = pts_us;
+        if (!WriteHeader()) {
+            ++stats_.frames_skipped;
+            return false;
+        }
+        started_ = true;
+    }
+    if (!started_ || pts_us < base_us_) {
+        ++stats_.frames_skipped;
+        return false;
+    }
+    if (!MuxAudio(data, size, pts_us - base_us_)) {
+        ++stats_.frames_skipped;
+        return false;
+    }
+    ++stats_.audio_frames;
+    return true;
+}
+
+void MediaMuxer::Close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!open_) {
+        return;
+    }
+    if (started_) {
+        Finish();
+    }
+    CloseOutput();
+    open_ = false;
+    stats_.file = GetOutputStats();
+    LOGI(kMediaMuxerLogTag) << "[Close] video=" << stats_.video_frames
+                            << " audio=" << stats_.audio_frames
+                            << " skipped=" << stats_.frames_skipped
+                            << " bytes=" << stats_.file.bytes_written
+                            << " dropped=" << stats_.file.bytes_dropped;
+}
+
+bool MediaMuxer::IsOpen() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return open_;
+}
+
+MediaMuxerStats MediaMuxer::GetStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (open_) {
+        stats_.file = GetOutputStats();
+    }
+    return stats_;
+}
+
+bool MediaMuxer::OpenOutput(const std::string& filename) {
+    return writer_.Open(filename, config_.extent_bytes, config_.max_buffered_bytes);
+}
+
+void MediaMuxer::CloseOutput() {
+    writer_.Close();
+}
+
+RecordFileWriterStats MediaMuxer::GetOutputStats() {
+    return writer_.GetStats();
+}
+
+bool MediaMuxer::IsHevc() const {
+    return config_.video_codec == kMuxerVideoH265;
+}
+
+void MediaMuxer::GetVideoSize(uint32_t& width, uint32_t& height) const {
+    width = 0;
+    height = 0;
+    if (IsHevc()) {
+        H265SpsInfo info;
+        if (ParseH265Sps(sps_.data(), sps_.size(), &info)) {
+            width = info.width;
+            height = info.height;
+        }
+    } else {
+        H264SpsInfo info;
+        if (ParseH264Sps(sps_.data(), sps_.size(), &info)) {
+            width = info.width;
+            height = info.height;
+        }
+    }
+}
+
+bool MediaMuxer::BuildVideoDecoderConfig(std::vector<uint8_t>& out) const {
+    if (IsHevc()) {
+        return BuildHevcDecoderConfig(vps_.data(), vps_.size(), sps_.data(), sps_.size(),
+                                      pps_.data(), pps_.size(), out);
+    }
+    return BuildAvcDecoderConfig(sps_.data(), sps_.size(), pps_.data(), pps_.size(), out);
+}
+
+bool MediaMuxer::UpdateParameterSets(const uint8_t* data, size_t size) {
+    const bool hevc = IsHevc();
+    bool changed = false;
+    AnnexBScanner scanner(data, size);
+    NalUnit nal;
+    while (scanner.Next(nal)) {
+        if (hevc) {
+            if (nal.size < 2) {
+                continue;
+            }
+            const uint8_t type = H265NalType(nal.data);
+            if (type == kH265NalVps) {
+                changed = StoreParameterSet(vps_, nal) || changed;
+            } else if (type == kH265NalSps) {
+                changed = StoreParameterSet(sps_, nal) || changed;
+            } else if (type == kH265NalPps) {
+                changed = StoreParameterSet(pps_, nal) || changed;
+            }
+        } else {
+            const uint8_t type = nal.data[0] & 0x1F;
+            if (type == kH264NalSps) {
+                changed = StoreParameterSet(sps_, nal) || changed;
+            } else if (type == kH264NalPps) {
+                changed = StoreParameterSet(pps_, nal) || changed;
+            }
+        }
+    }
+    return changed;
+}
+
+bool MediaMuxer::HasParameterSets() const {
+    return !sps_.empty() && !pps_.empty() && (!IsHevc() || !vps_.empty());
+}
\ No newline at end of file
@@ -0,0 +1,106 @@
+﻿#pragma once
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "record_file_writer.h"
+
+enum MuxerVideoCodec {
+    kMuxerVideoH264 = 0,
+    kMuxerVideoH265 = 1,
+};
+
+struct MuxerConfig {
+    bool has_video{true};
+    MuxerVideoCodec video_codec{kMuxerVideoH264};
+    bool has_audio{true};
+    int sample_rate{48000};
+    int channels{2};
+    // Fragmented MP4: a fragment is closed at the first keyframe this long after it began,
+    // which bounds what a crash can lose.
+    uint32_t fragment_ms{1000};
+    // HLS: a segment is closed at the first keyframe this long after it began. With part_ms
+    // set, segments are also published in LL-HLS parts of at most that length.
+    uint32_t segment_ms{2000};
+    uint32_t part_ms{0};
+    // Segments the live playlist keeps; 0 keeps them all in an EVENT playlist.
+    uint32_t playlist_size{6};
+    // Disk space is reserved in steps this large; see RecordFileWriter.
+    uint64_t extent_bytes{32 * 1024 * 1024};
+    // Room for the disk to fall behind before the muxer starts dropping.
+    size_t max_buffered_bytes{8 * 1024 * 1024};
+};
+
+struct MediaMuxerStats {
+    uint64_t video_frames;   // frames that went into the file
+    uint64_t audio_frames;
+    uint64_t frames_skipped; // before the first keyframe, or until the next one after a drop
+    RecordFileWriterStats file;
+};
+
+// Base class of the recording muxers. Takes what the encoders produce, Annex-B H.264/H.265
+// and raw or ADTS AAC, stamped on one clock (e.g. by AvInterleaver), without B-frames, so
+// decode and presentation order are the same. Parameter sets are picked up from the
+// keyframes; the file begins at the first keyframe that carries them, and its timestamps
+// start there. Audio is expected in 1024-sample AAC frames. The file goes through a
+// RecordFileWriter, so writing never waits for the disk and what has been written stays
+// playable if the process dies. Calls may come from any thread; they are serialized.
+class MediaMuxer {
+public:
+    virtual ~MediaMuxer();
+
+    bool Open(const std::string& filename, const MuxerConfig& config);
+    bool WriteVideo(const uint8_t* data, size_t size, uint64_t pts_us, bool keyframe);
+    bool WriteAudio(const uint8_t* data, size_t size, uint64_t pts_us);
+    // Writes what is still held and closes the file.
+    void Close();
+    bool IsOpen();
+
+    MediaMuxerStats GetStats();
+
+protected:
+    MediaMuxer();
+
+    // All run with the muxer locked. pts_us is relative to the first keyframe. Returning
+    // false means the data was dropped.
+    virtual bool WriteHeader() = 0;
+    virtual bool MuxVideo(const uint8_t* data, size_t size, uint64_t pts_us, bool keyframe,
+                          bool parameter_sets_changed) = 0;
+    virtual bool MuxAudio(const uint8_t* aac, size_t size, uint64_t pts_us) = 0;
+    virtual void Finish() = 0;
+
+    // Where the output goes: by default the file at filename, through writer_.
+    virtual bool OpenOutput(const std::string& filename);
+    virtual void CloseOutput();
+    virtual RecordFileWriterStats GetOutputStats();
+
+    bool IsHevc() const;
+    // Coded picture size from the current SPS, 0 if it does not parse.
+    void GetVideoSize(uint32_t& width, uint32_t& height) const;
+    // Appends the 'avcC' or 'hvcC' record of the current parameter sets.
+    bool BuildVideoDecoderConfig(std::vector<uint8_t>& out) const;
+
+protected:
+    MuxerConfig config_{};
+    RecordFileWriter writer_{};
+
+private:
+    MediaMuxer(const MediaMuxer&) = delete;
+    MediaMuxer& operator=(const MediaMuxer&) = delete;
+
+    // Returns true if a parameter set differs from the one held.
+    bool UpdateParameterSets(const uint8_t* data, size_t size);
+    bool HasParameterSets() const;
+
+private:
+    std::mutex mutex_{};
+    bool open_{};
+    bool started_{};
+    bool wait_keyframe_{};
+    uint64_t base_us_{};
+    std::vector<uint8_t> vps_{};
+    std::vector<uint8_t> sps_{};
+    std::vector<uint8_t> pps_{};
+    MediaMuxerStats stats_{};
+};
\ No newline at end of file
@@ -0,0 +1,38 @@
+﻿#include "media_muxer_factory.h"
+
+#include "flv/flv_muxer.h"
+#include "fmp4/fmp4_muxer.h"
+#include "hls/hls_segmenter.h"
+
+MediaMuxerFactory& MediaMuxerFactory::Instance() {
+    static MediaMuxerFactory instance;
+    return instance;
+}
+
+std::shared_ptr<MediaMuxer> MediaMuxerFactory::CreateMuxer(MuxerType muxer_type) {
+    std::shared_ptr<MediaMuxer> muxer = nullptr;
+    switch (muxer_type)
+    {
+    case kMuxerTypeFlv:
+        muxer.reset(new FlvMuxer());
+        break;
+    case kMuxerTypeFmp4:
+        muxer.reset(new Fmp4Muxer());
+        break;
+    case kMuxerTypeHlsTs:
+        muxer.reset(new HlsSegmenter(kHlsSegmentTs));
+        break;
+    case kMuxerTypeHlsFmp4:
+        muxer.reset(new HlsSegmenter(kHlsSegmentFmp4));
+        break;
+    default:
+        break;
+    }
+    return muxer;
+}
+
+MediaMuxerFactory::MediaMuxerFactory() {
+}
+MediaMuxerFactory::~MediaMuxerFactory() {
+
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+﻿#pragma once
+#include <memory>
+#include "media_muxer.h"
+
+enum MuxerType {
+    kMuxerTypeFlv,
+    kMuxerTypeFmp4,
+    kMuxerTypeHlsTs,
+    kMuxerTypeHlsFmp4,
+};
+
+class MediaMuxerFactory {
+public:
+    static MediaMuxerFactory& Instance();
+    std::shared_ptr<MediaMuxer> CreateMuxer(MuxerType muxer_type);
+
+private:
+    MediaMuxerFactory();
+    ~MediaMuxerFactory();
+
+    MediaMuxerFactory(const MediaMuxerFactory&) = delete;
+    MediaMuxerFactory operator=(const MediaMuxerFactory&) = delete;
+};
\ No newline at end of file
@@ -0,0 +1,239 @@
+﻿#include "record_file_writer.h"
+
+#include <chrono>
+#include <cstring>
+
+#include "local_log.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char* kRecordFileWriterLogTag = "RecordFileWriter";
+// Big enough to keep the disk streaming, small enough to keep the tail of a crash short.
+const size_t kWriteChunkBytes = 256 * 1024;
+const auto kMaxWriteDelay = std::chrono::milliseconds(500);
+
+} // namespace
+
+RecordFileWriter::RecordFileWriter() {}
+
+RecordFileWriter::~RecordFileWriter() {
+    Close();
+}
+
+bool RecordFileWriter::Open(const std::string& filename, uint64_t extent_bytes,
+                            size_t max_buffered_bytes) {
+    Close();
+    if (!OpenFile(filename)) {
+        LOGE(kRecordFileWriterLogTag) << "[Open] cannot create " << filename;
+        return false;
+    }
+    extent_bytes_ = extent_bytes;
+    file_size_ = 0;
+    reserved_ = 0;
+    Reserve(extent_bytes_);
+    filling_.clear();
+    writing_.clear();
+    // Both buffers are allocated here; Write never allocates.
+    filling_.reserve(max_buffered_bytes);
+    writing_.reserve(max_buffered_bytes);
+    stats_ = RecordFileWriterStats{};
+    failed_ = false;
+    stopping_ = false;
+    flush_requested_ = false;
+    open_ = true;
+    thread_ = std::thread(&RecordFileWriter::WriteThread, this);
+    return true;
+}
+
+bool RecordFileWriter::Write(const uint8_t* data, size_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!open_ || stopping_) {
+        return false;
+    }
+    if (failed_.load() || filling_.size() + size > filling_.capacity()) {
+        stats_.bytes_dropped += size;
+        return false;
+    }
+    filling_.insert(filling_.end(), data, data + size);
+    stats_.bytes_queued += size;
+    if (filling_.size() >= kWriteChunkBytes) {
+        wake_.notify_one();
+    }
+    return true;
+}
+
+void RecordFileWriter::Flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flush_requested_ = true;
+    wake_.notify_one();
+}
+
+void RecordFileWriter::Close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!open_) {
+            return;
+        }
+        stopping_ = true;
+        wake_.notify_one();
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    CloseFile();
+    std::lock_guard<std::mutex> lock(mutex_);
+    open_ = false;
+}
+
+bool RecordFileWriter::IsOpen() const {
+    return open_;
+}
+
+RecordFileWriterStats RecordFileWriter::GetStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void RecordFileWriter::WriteThread() {
+    while (true) {
+        bool stop = false;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait_for(lock, kMaxWriteDelay, [this]() {
+                return stopping_ || flush_requested_ || filling_.size() >= kWriteChunkBytes;
+            });
+            filling_.swap(writing_);
+            flush_requested_ = false;
+            stop = stopping_;
+        }
+        if (!writing_.empty() && !failed_.load()) {
+            const bool ok = WriteFile(writing_.data(), writing_.size());
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (ok) {
+                stats_.bytes_written += writing_.size();
+            } else {
+                ++stats_.write_errors;
+                stats_.bytes_dropped += writing_.size();
+                failed_ = true;
+            }
+        }
+        writing_.clear();
+        if (stop) {
+            break;
+        }
+    }
+}
+
+void RecordFileWriter::Reserve(uint64_t end) {
+    if (extent_bytes_ == 0 || end <= reserved_) {
+        return;
+    }
+    uint64_t target = reserved_;
+    while (target < end) {
+        target += extent_bytes_;
+    }
+#ifdef _WIN32
+    // Allocates the clusters without touching the end of file or the valid data length, so
+    // nothing has to be zeroed and a reader never sees the reserved space.
+    FILE_ALLOCATION_INFO info;
+    info.AllocationSize.QuadPart = (LONGLONG)target;
+    if (!SetFileInformationByHandle((HANDLE)file_, FileAllocationInfo, &info, sizeof(info))) {
+        LOGW(kRecordFileWriterLogTag) << "[Reserve] failed, error=" << GetLastError();
+    }
+#elif defined(__linux__)
+    if (fallocate(fd_, FALLOC_FL_KEEP_SIZE, (off_t)reserved_, (off_t)(target - reserved_)) != 0) {
+        LOGW(kRecordFileWriterLogTag) << "[Reserve] fallocate failed";
+    }
+#endif
+    // Reserving is only an optimization; if it fails the file simply grows as it is written.
+    reserved_ = target;
+}
+
+#ifdef _WIN32
+
+bool RecordFileWriter::OpenFile(const std::string& filename) {
+    // Readers may open the file while it is being recorded, e.g. to preview it.
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_WRITE, FILE_SHARE_READ, NULL,
+                              CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                              NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    file_ = file;
+    return true;
+}
+
+bool RecordFileWriter::WriteFile(const uint8_t* data, size_t size) {
+    Reserve(file_size_ + size);
+    while (size > 0) {
+        const DWORD chunk = size > 0x40000000 ? 0x40000000 : (DWORD)size;
+        DWORD written = 0;
+        if (!::WriteFile((HANDLE)file_, data, chunk, &written, NULL) || written == 0) {
+            LOGE(kRecordFileWriterLogTag) << "[WriteFile] failed, error=" << GetLastError();
+            return false;
+        }
+        data += written;
+        size -= written;
+        file_size_ += written;
+    }
+    return true;
+}
+
+void RecordFileWriter::CloseFile() {
+    if (!file_) {
+        return;
+    }
+    // Gives back the reserved clusters past the end of the data.
+    FILE_ALLOCATION_INFO info;
+    info.AllocationSize.QuadPart = (LONGLONG)file_size_;
+    SetFileInformationByHandle((HANDLE)file_, FileAllocationInfo, &info, sizeof(info));
+    CloseHandle((HANDLE)file_);
+    file_ = nullptr;
+}
+
+#else
+
+bool RecordFileWriter::OpenFile(const std::string& filename) {
+    int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    fd_ = fd;
+    return true;
+}
+
+bool RecordFileWriter::WriteFile(const uint8_t* data, size_t size) {
+    Reserve(file_size_ + size);
+    while (size > 0) {
+        const ssize_t written = write(fd_, data, size);
+        if (written <= 0) {
+            LOGE(kRecordFileWriterLogTag) << "[WriteFile] write failed";
+            return false;
+        }
+        data += written;
+        size -= (size_t)written;
+        file_size_ += (uint64_t)written;
+    }
+    return true;
+}
+
+void RecordFileWriter::CloseFile() {
+    if (fd_ < 0) {
+        return;
+    }
+    // Gives back the blocks reserved past the end of the data.
+    if (ftruncate(fd_, (off_t)file_size_) != 0) {
+        LOGW(kRecordFileWriterLogTag) << "[CloseFile] ftruncate failed";
+    }
+    close(fd_);
+    fd_ = -1;
+}
+
+#endif
\ No newline at end of file
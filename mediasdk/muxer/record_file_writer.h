@@ -0,0 +1,72 @@
+﻿#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct RecordFileWriterStats {
+    uint64_t bytes_queued;  // accepted by Write
+    uint64_t bytes_written; // on disk, or at least in the OS cache
+    uint64_t bytes_dropped; // refused because the buffer was full or the file had failed
+    uint64_t write_errors;
+};
+
+// Appends to a recording file from a thread of its own, so the threads that produce the data
+// never wait for the disk. Write copies into one of two buffers allocated at Open; the I/O
+// thread swaps them and writes the full one once enough has gathered, on Flush, or every
+// half second. When the disk falls behind far enough to fill the buffer, whole writes are
+// refused and counted instead of blocking. Space is reserved ahead of the data in large
+// extents without moving the end of file, so the file does not fragment and what has been
+// written stays readable if the process dies; Close gives back what was not used.
+class RecordFileWriter {
+public:
+    RecordFileWriter();
+    ~RecordFileWriter();
+
+    bool Open(const std::string& filename, uint64_t extent_bytes, size_t max_buffered_bytes);
+    // Queues all of data or none of it, so a muxer can keep its units whole.
+    bool Write(const uint8_t* data, size_t size);
+    // Asks the I/O thread to write out what is queued now; does not wait for it.
+    void Flush();
+    // Writes everything queued, trims the reserved space and closes the file.
+    void Close();
+    bool IsOpen() const;
+
+    RecordFileWriterStats GetStats();
+
+private:
+    RecordFileWriter(const RecordFileWriter&) = delete;
+    RecordFileWriter& operator=(const RecordFileWriter&) = delete;
+
+    void WriteThread();
+    // Called on the I/O thread only.
+    bool OpenFile(const std::string& filename);
+    bool WriteFile(const uint8_t* data, size_t size);
+    void Reserve(uint64_t end);
+    void CloseFile();
+
+private:
+    std::mutex mutex_{};
+    std::condition_variable wake_{};
+    std::vector<uint8_t> filling_{};
+    std::vector<uint8_t> writing_{};
+    bool open_{};
+    bool stopping_{};
+    bool flush_requested_{};
+    std::thread thread_{};
+    std::atomic<bool> failed_{false};
+
+#ifdef _WIN32
+    void* file_{};
+#else
+    int fd_{-1};
+#endif
+    uint64_t extent_bytes_{};
+    uint64_t file_size_{};
+    uint64_t reserved_{};
+
+    RecordFileWriterStats stats_{};
+};
\ No newline at end of file
@@ -0,0 +1,242 @@
+﻿#include "ts_writer.h"
+
+#include <algorithm>
+
+#include "annexb_scanner.h"
+#include "codec_config.h"
+#include "h265_sps_parser.h"
+
+namespace {
+
+const size_t kTsPacketSize = 188;
+const uint16_t kPatPid = 0x0000;
+const uint16_t kPmtPid = 0x1000;
+const uint16_t kVideoPid = 0x0100;
+const uint16_t kAudioPid = 0x0101;
+const uint8_t kStreamTypeH264 = 0x1B;
+const uint8_t kStreamTypeH265 = 0x24;
+const uint8_t kStreamTypeAdtsAac = 0x0F;
+const uint8_t kVideoStreamId = 0xE0;
+const uint8_t kAudioStreamId = 0xC0;
+
+// Timestamps start one second in, so the PCR, which runs a little ahead of the first frame,
+// does not start below zero.
+const uint64_t kTimestampOffset = 90000;
+const uint64_t kPcrLead = 9000;
+const uint64_t kTimestampMask = 0x1FFFFFFFFull; // 33 bits
+
+const uint8_t kH264Aud[] = {0x00, 0x00, 0x00, 0x01, 0x09, 0xF0};
+const uint8_t kH265Aud[] = {0x00, 0x00, 0x00, 0x01, 0x46, 0x01, 0x50};
+
+// CRC-32/MPEG-2 of the PSI sections (ISO/IEC 13818-1 Annex A).
+uint32_t Crc32Mpeg(const uint8_t* data, size_t size) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < size; ++i) {
+        crc ^= (uint32_t)data[i] << 24;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+void PutBE16(std::vector<uint8_t>& out, uint16_t v) {
+    out.push_back((uint8_t)(v >> 8));
+    out.push_back((uint8_t)v);
+}
+
+void PutBE32(std::vector<uint8_t>& out, uint32_t v) {
+    PutBE16(out, (uint16_t)(v >> 16));
+    PutBE16(out, (uint16_t)v);
+}
+
+uint64_t To90kHz(uint64_t us) {
+    return (us / 1000000 * 90000 + us % 1000000 * 90000 / 1000000 + kTimestampOffset) &
+           kTimestampMask;
+}
+
+bool StartsWithAud(const uint8_t* data, size_t size, bool hevc) {
+    NalUnit nal;
+    AnnexBScanner scanner(data, size);
+    if (!scanner.Next(nal)) {
+        return false;
+    }
+    return hevc ? nal.size >= 2 && H265NalType(nal.data) == kH265NalAud
+                : (nal.data[0] & 0x1F) == 9;
+}
+
+} // namespace
+
+TsWriter::TsWriter() {}
+
+void TsWriter::Reset(const MuxerConfig& config) {
+    config_ = config;
+    pat_continuity_ = 0;
+    pmt_continuity_ = 0;
+    video_continuity_ = 0;
+    audio_continuity_ = 0;
+}
+
+void TsWriter::AppendTables(std::vector<uint8_t>& out) {
+    // program_association_section with one program
+    section_.clear();
+    section_.push_back(0x00); // table_id
+    PutBE16(section_, 0xB000 | 13);
+    PutBE16(section_, 0x0001); // transport_stream_id
+    section_.push_back(0xC1);  // version 0, current_next_indicator
+    section_.push_back(0x00);  // section_number
+    section_.push_back(0x00);  // last_section_number
+    PutBE16(section_, 0x0001); // program_number
+    PutBE16(section_, 0xE000 | kPmtPid);
+    PutBE32(section_, Crc32Mpeg(section_.data(), section_.size()));
+    AppendSection(kPatPid, pat_continuity_, section_, out);
+
+    // TS_program_map_section
+    const int streams = (config_.has_video ? 1 : 0) + (config_.has_audio ? 1 : 0);
+    section_.clear();
+    section_.push_back(0x02);
+    PutBE16(section_, (uint16_t)(0xB000 | (9 + 5 * streams + 4)));
+    PutBE16(section_, 0x0001); // program_number
+    section_.push_back(0xC1);
+    section_.push_back(0x00);
+    section_.push_back(0x00);
+    PutBE16(section_, 0xE000 | (config_.has_video ? kVideoPid : kAudioPid)); // PCR_PID
+    PutBE16(section_, 0xF000); // program_info_length
+    if (config_.has_video) {
+        section_.push_back(config_.video_codec == kMuxerVideoH265 ? kStreamTypeH265
+                                                                  : kStreamTypeH264);
+        PutBE16(section_, 0xE000 | kVideoPid);
+        PutBE16(section_, 0xF000); // ES_info_length
+    }
+    if (config_.has_audio) {
+        section_.push_back(kStreamTypeAdtsAac);
+        PutBE16(section_, 0xE000 | kAudioPid);
+        PutBE16(section_, 0xF000);
+    }
+    PutBE32(section_, Crc32Mpeg(section_.data(), section_.size()));
+    AppendSection(kPmtPid, pmt_continuity_, section_, out);
+}
+
+void TsWriter::AppendVideo(const uint8_t* data, size_t size, uint64_t pts_us, bool keyframe,
+                           std::vector<uint8_t>& out) {
+    const bool hevc = config_.video_codec == kMuxerVideoH265;
+    const uint64_t pts = To90kHz(pts_us);
+    BeginPes(kVideoStreamId, pts);
+    if (!StartsWithAud(data, size, hevc)) {
+        if (hevc) {
+            pes_.insert(pes_.end(), kH265Aud, kH265Aud + sizeof(kH265Aud));
+        } else {
+            pes_.insert(pes_.end(), kH264Aud, kH264Aud + sizeof(kH264Aud));
+        }
+    }
+    pes_.insert(pes_.end(), data, data + size);
+    // Video PES may exceed the 16-bit length field, which is allowed to be 0 for video.
+    EndPes(false);
+    AppendPes(kVideoPid, video_continuity_, true, (pts - kPcrLead) & kTimestampMask, keyframe,
+              out);
+}
+
+void TsWriter::AppendAudio(const uint8_t* aac, size_t size, uint64_t pts_us,
+                           std::vector<uint8_t>& out) {
+    const uint64_t pts = To90kHz(pts_us);
+    BeginPes(kAudioStreamId, pts);
+    if (AacAdtsHeaderSize(aac, size) == 0) {
+        BuildAacAdtsHeader(config_.sample_rate, config_.channels, size, pes_);
+    }
+    pes_.insert(pes_.end(), aac, aac + size);
+    EndPes(true);
+    AppendPes(kAudioPid, audio_continuity_, !config_.has_video, (pts - kPcrLead) & kTimestampMask,
+              !config_.has_video, out);
+}
+
+void TsWriter::AppendSection(uint16_t pid, uint8_t& continuity,
+                             const std::vector<uint8_t>& section, std::vector<uint8_t>& out) {
+    const size_t start = out.size();
+    out.resize(start + kTsPacketSize, 0xFF);
+    uint8_t* p = &out[start];
+    p[0] = 0x47;
+    p[1] = (uint8_t)(0x40 | (pid >> 8)); // payload_unit_start_indicator
+    p[2] = (uint8_t)pid;
+    p[3] = (uint8_t)(0x10 | (continuity++ & 0x0F));
+    p[4] = 0x00; // pointer_field
+    std::copy(section.begin(), section.end(), p + 5);
+}
+
+void TsWriter::BeginPes(uint8_t stream_id, uint64_t pts) {
+    pes_.clear();
+    pes_.push_back(0x00);
+    pes_.push_back(0x00);
+    pes_.push_back(0x01);
+    pes_.push_back(stream_id);
+    PutBE16(pes_, 0);    // PES_packet_length, set by EndPes
+    pes_.push_back(0x80); // '10', not scrambled
+    pes_.push_back(0x80); // PTS only
+    pes_.push_back(5);    // PES_header_data_length
+    pes_.push_back((uint8_t)(0x21 | ((pts >> 29) & 0x0E)));
+    PutBE16(pes_, (uint16_t)(((pts >> 14) & 0xFFFE) | 1));
+    PutBE16(pes_, (uint16_t)(((pts << 1) & 0xFFFE) | 1));
+}
+
+void TsWriter::EndPes(bool bounded) {
+    const size_t length = pes_.size() - 6;
+    if (bounded && length <= 0xFFFF) {
+        pes_[4] = (uint8_t)(length >> 8);
+        pes_[5] = (uint8_t)length;
+    }
+}
+
+void TsWriter::AppendPes(uint16_t pid, uint8_t& continuity, bool with_pcr, uint64_t pcr,
+                         bool random_access, std::vector<uint8_t>& out) {
+    size_t pos = 0;
+    bool first = true;
+    while (pos < pes_.size()) {
+        const size_t start = out.size();
+        out.resize(start + kTsPacketSize);
+        uint8_t* p = &out[start];
+        p[0] = 0x47;
+        p[1] = (uint8_t)((first ? 0x40 : 0) | (pid >> 8));
+        p[2] = (uint8_t)pid;
+
+        // adaptation_field: length byte, flags byte, optional PCR, then stuffing
+        const bool pcr_here = first && with_pcr;
+        bool adaptation = first && (pcr_here || random_access);
+        size_t adaptation_length = adaptation ? 1 + (pcr_here ? 6 : 0) : 0;
+        size_t room = kTsPacketSize - 4 - (adaptation ? 1 + adaptation_length : 0);
+        const size_t remaining = pes_.size() - pos;
+        if (remaining < room) {
+            // The last packet is filled up with stuffing in the adaptation field.
+            if (!adaptation) {
+                adaptation = true;
+                room -= 1;
+            }
+            adaptation_length += room - remaining;
+            room = remaining;
+        }
+        p[3] = (uint8_t)((adaptation ? 0x30 : 0x10) | (continuity++ & 0x0F));
+        size_t offset = 4;
+        if (adaptation) {
+            p[offset++] = (uint8_t)adaptation_length;
+            if (adaptation_length > 0) {
+                const size_t flags_at = offset++;
+                p[flags_at] = (uint8_t)((random_access && first ? 0x40 : 0) |
+                                        (pcr_here ? 0x10 : 0));
+                if (pcr_here) {
+                    // program_clock_reference_base(33), reserved(6), extension(9) = 0
+                    p[offset++] = (uint8_t)(pcr >> 25);
+                    p[offset++] = (uint8_t)(pcr >> 17);
+                    p[offset++] = (uint8_t)(pcr >> 9);
+                    p[offset++] = (uint8_t)(pcr >> 1);
+                    p[offset++] = (uint8_t)(((pcr & 1) << 7) | 0x7E);
+                    p[offset++] = 0x00;
+                }
+                const size_t end = 5 + adaptation_length;
+                while (offset < end) {
+                    p[offset++] = 0xFF;
+                }
+            }
+        }
+        std::copy(pes_.begin() + pos, pes_.begin() + pos + room, p + offset);
+        pos += room;
+        first = false;
+    }
+}
\ No newline at end of file
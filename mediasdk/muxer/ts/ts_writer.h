@@ -0,0 +1,42 @@
+﻿#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "media_muxer.h"
+
+// Packs encoded frames into an MPEG-2 transport stream (ISO/IEC 13818-1) as HLS carries it:
+// one program with H.264 or H.265 on PID 0x100 and ADTS AAC on PID 0x101, one PES per
+// access unit or AAC frame, and a PCR on the video PID, or the audio PID without video.
+// Access units get a delimiter if the encoder left it out, AAC frames an ADTS header. Frames
+// are expected as MediaMuxer takes them; keyframes must carry their parameter sets in-band,
+// which the encoders here always do. Continuity counters run on across calls, so the output
+// of several calls may be concatenated, e.g. the parts of an HLS segment.
+class TsWriter {
+public:
+    TsWriter();
+
+    void Reset(const MuxerConfig& config);
+    // PAT and PMT, which start every segment.
+    void AppendTables(std::vector<uint8_t>& out);
+    void AppendVideo(const uint8_t* data, size_t size, uint64_t pts_us, bool keyframe,
+                     std::vector<uint8_t>& out);
+    void AppendAudio(const uint8_t* aac, size_t size, uint64_t pts_us, std::vector<uint8_t>& out);
+
+private:
+    void AppendSection(uint16_t pid, uint8_t& continuity, const std::vector<uint8_t>& section,
+                       std::vector<uint8_t>& out);
+    // Splits pes_ into packets. The first one carries the PCR and random access flag if asked.
+    void AppendPes(uint16_t pid, uint8_t& continuity, bool with_pcr, uint64_t pcr,
+                   bool random_access, std::vector<uint8_t>& out);
+    void BeginPes(uint8_t stream_id, uint64_t pts);
+    void EndPes(bool bounded);
+
+private:
+    MuxerConfig config_{};
+    uint8_t pat_continuity_{};
+    uint8_t pmt_continuity_{};
+    uint8_t video_continuity_{};
+    uint8_t audio_continuity_{};
+    std::vector<uint8_t> pes_{}; // scratch, kept for its capacity
+    std::vector<uint8_t> section_{};
+};
\ No newline at end of file
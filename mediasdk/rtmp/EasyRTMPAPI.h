@@ -80,9 +80,36 @@ extern "C"
     /* ȡС */
     EasyRTMP_API Easy_I32 Easy_APICALL EasyRTMP_GetBufInfo(Easy_Handle handle, int* usedSize, int* totalSize);
 
+	/* Coalesce consecutive AAC frames for up to maxDelayMs into one RTMP aggregate message (0 = off, default) */
+	EasyRTMP_API Easy_I32 Easy_APICALL EasyRTMP_SetAudioCoalesce(Easy_Handle handle, Easy_U32 maxDelayMs);
+
 	/* ֹͣRTMPͣͷž */
 	EasyRTMP_API void Easy_APICALL EasyRTMP_Release(Easy_Handle handle);
 
+	/* Fan-out: push one encoded stream to several RTMP sessions.
+	   Each frame is converted to an FLV tag once and queued to a per-session I/O thread;
+	   a session that falls maxQueueFrames behind drops its backlog and resumes at the next I frame.
+	   maxQueueFrames == 0 uses the default (256). */
+	EasyRTMP_API Easy_Handle Easy_APICALL EasyRTMP_FanoutCreate(Easy_U32 maxQueueFrames);
+
+	/* Stream info applied to every attached session (sequence headers are resent) */
+	EasyRTMP_API Easy_I32 Easy_APICALL EasyRTMP_FanoutInitMetadata(Easy_Handle fanout, EASY_MEDIA_INFO_T* pstruStreamInfo);
+
+	/* handle comes from EasyRTMP_Create/EasyRTMP_Connect; remove it before EasyRTMP_Release.
+	   Removing waits for the frames still queued to the session to be sent, for up to 2 s;
+	   what is left after that is dropped. */
+	EasyRTMP_API Easy_I32 Easy_APICALL EasyRTMP_FanoutAddSession(Easy_Handle fanout, Easy_Handle handle);
+	EasyRTMP_API Easy_I32 Easy_APICALL EasyRTMP_FanoutRemoveSession(Easy_Handle fanout, Easy_Handle handle);
+
+	/* Same frame format as EasyRTMP_SendPacket; never blocks on the network */
+	EasyRTMP_API Easy_U32 Easy_APICALL EasyRTMP_FanoutSendPacket(Easy_Handle fanout, EASY_AV_Frame* frame);
+
+	EasyRTMP_API Easy_I32 Easy_APICALL EasyRTMP_FanoutGetSessionInfo(Easy_Handle fanout, Easy_Handle handle, Easy_U32* queuedFrames, Easy_U32* droppedFrames);
+
+	/* Stops the I/O threads after they send what is queued, as EasyRTMP_FanoutRemoveSession does;
+	   attached sessions stay connected and owned by the caller */
+	EasyRTMP_API void Easy_APICALL EasyRTMP_FanoutRelease(Easy_Handle fanout);
+
 #ifdef __cplusplus
 };
 #endif
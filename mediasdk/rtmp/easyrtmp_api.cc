@@ -1,12 +1,21 @@
 #include <rtmp/EasyRTMPAPI.h>
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
 #include <cstring>
+#include <deque>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 #include <cstdarg>
+#include "mediasdk/common/annexb_scanner.h"
+#include "mediasdk/common/codec_config.h"
+#include "mediasdk/common/h264_sps_parser.h"
+#include "mediasdk/common/h265_sps_parser.h"
 #include "mediasdk/local_log/local_log.h"
 #ifdef _WIN32
 #include <winsock2.h>
@@ -23,6 +32,18 @@ namespace {
 static const char* kEasyRtmpLogTag = "EasyRtmp";
 
 static void LibrtmpLogCb(int level, const char* fmt, va_list vl) {
+    LocalLogLevel log_level = kLocalLogLevelDebug;
+    if (level <= RTMP_LOGERROR) {
+        log_level = kLocalLogLevelError;
+    } else if (level == RTMP_LOGWARNING) {
+        log_level = kLocalLogLevelWarning;
+    } else if (level == RTMP_LOGINFO) {
+        log_level = kLocalLogLevelInfo;
+    }
+    // librtmp logs every chunk at DEBUG; skip the formatting unless it will be written.
+    if (!LocalLogEnabled(log_level)) {
+        return;
+    }
     char msg[2048] = {0};
 #if defined(_MSC_VER)
     _vsnprintf_s(msg, sizeof(msg), _TRUNCATE, fmt, vl);
@@ -30,46 +51,23 @@ static void LibrtmpLogCb(int level, const char* fmt, va_list vl) {
     vsnprintf(msg, sizeof(msg), fmt, vl);
 #endif
     // librtmp already formats without trailing newline sometimes
-    switch (level) {
-    case RTMP_LOGCRIT:
-    case RTMP_LOGERROR:
-        LOGE(kEasyRtmpLogTag) << "[librtmp] " << msg;
-        break;
-    case RTMP_LOGWARNING:
-        LOGW(kEasyRtmpLogTag) << "[librtmp] " << msg;
-        break;
-    default:
-        LOGI(kEasyRtmpLogTag) << "[librtmp] " << msg;
-        break;
-    }
+    LOCAL_LOG(log_level, kEasyRtmpLogTag) << "[librtmp] " << msg;
 }
 
 static inline uint32_t ToMs(uint32_t sec, uint32_t usec) {
     return sec * 1000u + (usec / 1000u);
 }
 
-static int SampleRateIndex(int sr) {
-    // ADTS sampling_frequency_index
-    static const int srs[] = {96000, 88200, 64000, 48000, 44100, 32000, 24000,
-                              22050, 16000, 12000, 11025, 8000,  7350};
-    for (int i = 0; i < (int)(sizeof(srs) / sizeof(srs[0])); ++i) {
-        if (srs[i] == sr)
-            return i;
-    }
-    // fallback to 44100
-    return 4;
-}
+// Enhanced RTMP (veovera enhanced-rtmp v1) video tag header:
+// IsExHeader(1) | FrameType(3) | PacketType(4), followed by the codec FourCC.
+static const uint32_t kFourCcHvc1 = ('h' << 24) | ('v' << 16) | ('c' << 8) | '1';
+static const uint8_t kExHeaderFlag = 0x80;
+static const uint8_t kExPacketSequenceStart = 0;
+static const uint8_t kExPacketCodedFramesX = 3; // coded frames, composition time implied 0
 
-static void BuildAudioSpecificConfig(int sample_rate, int channels, std::vector<uint8_t>& out) {
-    // AAC-LC
-    int profile = 2; // AAC LC (Audio Object Type)
-    int sr_idx = SampleRateIndex(sample_rate);
-    int ch = channels <= 0 ? 1 : channels;
-    uint16_t cfg = (uint16_t)((profile << 11) | (sr_idx << 7) | (ch << 3));
-    out.resize(2);
-    out[0] = (uint8_t)((cfg >> 8) & 0xFF);
-    out[1] = (uint8_t)(cfg & 0xFF);
-}
+static const uint8_t kFlvTagAggregate = 0x16;
+static const uint32_t kMaxCoalescedAudioFrames = 16;
+static const int kOutChunkSize = 4096;
 
 static void PutBE32(uint8_t* p, uint32_t v) {
     p[0] = (uint8_t)((v >> 24) & 0xFF);
@@ -78,110 +76,75 @@ static void PutBE32(uint8_t* p, uint32_t v) {
     p[3] = (uint8_t)(v & 0xFF);
 }
 
-// Simple SPS parser to extract width/height (simplified version)
-static bool ParseSpsForResolution(const uint8_t* sps, uint32_t sps_len, uint32_t* width, uint32_t* height) {
-    if (!sps || sps_len < 4 || width == nullptr || height == nullptr) {
-        return false;
-    }
-    
-    // Skip NAL header if present (0x67 or 0x00 0x00 0x00 0x01 0x67)
-    const uint8_t* data = sps;
-    uint32_t len = sps_len;
-    if (len > 4 && data[0] == 0 && data[1] == 0 && data[2] == 0 && data[3] == 1) {
-        data += 4;
-        len -= 4;
-    } else if (len > 3 && data[0] == 0 && data[1] == 0 && data[2] == 1) {
-        data += 3;
-        len -= 3;
-    }
-    
-    if (len < 5 || (data[0] & 0x1F) != 7) { // SPS NAL type = 7
-        return false;
-    }
-    
-    // Simplified parsing: try to extract mb_width and mb_height from SPS
-    // This is a very basic implementation - full SPS parsing is complex
-    // For now, we'll use a heuristic approach or return false and use defaults
-    
-    // Try to find common resolution patterns in SPS
-    // This is a simplified approach - for production, use a proper SPS parser
-    
-    // For simplicity, return false and let caller use defaults
-    // A proper implementation would use exponential-Golomb decoding
-    return false;
+// HEVC parameter sets travel in the HEVCDecoderConfigurationRecord ('hvc1'), not in-band.
+static bool IsHevcOutOfBandNal(const uint8_t* nal) {
+    uint8_t type = H265NalType(nal);
+    return type == kH265NalVps || type == kH265NalSps || type == kH265NalPps ||
+           type == kH265NalAud;
 }
 
-static bool IsStartCode3(const uint8_t* p) { return p[0] == 0 && p[1] == 0 && p[2] == 1; }
-static bool IsStartCode4(const uint8_t* p) { return p[0] == 0 && p[1] == 0 && p[2] == 0 && p[3] == 1; }
-
-static void AnnexBToAvcc(const uint8_t* in, size_t in_len, std::vector<uint8_t>& out) {
+static void AnnexBToAvcc(const uint8_t* in, size_t in_len, std::vector<uint8_t>& out,
+                         bool hevc = false) {
     out.clear();
     if (!in || in_len < 4) {
         return;
     }
-    size_t i = 0;
-    while (i + 3 < in_len) {
-        // find start code
-        size_t sc = (size_t)-1;
-        size_t sc_len = 0;
-        for (size_t j = i; j + 3 < in_len; ++j) {
-            if (j + 4 <= in_len && IsStartCode4(in + j)) {
-                sc = j;
-                sc_len = 4;
-                break;
-            }
-            if (IsStartCode3(in + j)) {
-                sc = j;
-                sc_len = 3;
-                break;
-            }
-        }
-        if (sc == (size_t)-1) {
-            break;
-        }
-        size_t nal_start = sc + sc_len;
-        size_t nal_end = in_len;
-        for (size_t j = nal_start; j + 3 < in_len; ++j) {
-            if ((j + 4 <= in_len && IsStartCode4(in + j)) || IsStartCode3(in + j)) {
-                nal_end = j;
-                break;
-            }
-        }
-        if (nal_end > nal_start) {
-            uint32_t nalsz = (uint32_t)(nal_end - nal_start);
-            size_t old = out.size();
-            out.resize(old + 4 + nalsz);
-            PutBE32(out.data() + old, nalsz);
-            memcpy(out.data() + old + 4, in + nal_start, nalsz);
+    AnnexBScanner scanner(in, in_len);
+    NalUnit unit;
+    while (scanner.Next(unit)) {
+        const uint8_t* nal = unit.data;
+        const size_t nalsz = unit.size;
+        if (hevc && (nalsz < 2 || IsHevcOutOfBandNal(nal))) {
+            continue;
         }
-        i = nal_end;
+        size_t old = out.size();
+        out.resize(old + 4 + nalsz);
+        PutBE32(out.data() + old, (uint32_t)nalsz);
+        memcpy(out.data() + old + 4, nal, nalsz);
     }
 }
 
-static void StripAdtsIfPresent(std::vector<uint8_t>& aac) {
-    if (aac.size() < 7) {
-        return;
+// Picks up in-band parameter sets (e.g. x264/x265 repeat headers on every IDR) so headers
+// can be built without the caller filling EASY_MEDIA_INFO_T. Returns true if any changed.
+static bool UpdateParameterSets(EASY_MEDIA_INFO_T& mi, const uint8_t* in, size_t in_len) {
+    if (mi.u32VideoCodec != EASY_SDK_VIDEO_CODEC_H264 &&
+        mi.u32VideoCodec != EASY_SDK_VIDEO_CODEC_H265) {
+        return false;
     }
-    // ADTS syncword 0xFFF (12 bits)
-    if (aac[0] == 0xFF && (aac[1] & 0xF0) == 0xF0) {
-        int protection_absent = aac[1] & 0x01;
-        int header_len = protection_absent ? 7 : 9;
-        if ((int)aac.size() > header_len) {
-            aac.erase(aac.begin(), aac.begin() + header_len);
+    const bool hevc = mi.u32VideoCodec == EASY_SDK_VIDEO_CODEC_H265;
+    bool changed = false;
+    auto store = [&changed](Easy_U8* dst, size_t cap, Easy_U32* dst_len, const uint8_t* nal,
+                            size_t n) {
+        if (n > cap || (*dst_len == n && memcmp(dst, nal, n) == 0)) {
+            return;
+        }
+        memcpy(dst, nal, n);
+        *dst_len = (Easy_U32)n;
+        changed = true;
+    };
+    AnnexBScanner scanner(in, in_len);
+    NalUnit unit;
+    while (scanner.Next(unit)) {
+        const uint8_t* nal = unit.data;
+        const size_t n = unit.size;
+        if (hevc) {
+            if (n < 2) continue;
+            uint8_t type = H265NalType(nal);
+            if (type == kH265NalVps) store(mi.u8Vps, sizeof(mi.u8Vps), &mi.u32VpsLength, nal, n);
+            else if (type == kH265NalSps) store(mi.u8Sps, sizeof(mi.u8Sps), &mi.u32SpsLength, nal, n);
+            else if (type == kH265NalPps) store(mi.u8Pps, sizeof(mi.u8Pps), &mi.u32PpsLength, nal, n);
+        } else {
+            uint8_t type = nal[0] & 0x1F;
+            if (type == 7) store(mi.u8Sps, sizeof(mi.u8Sps), &mi.u32SpsLength, nal, n);
+            else if (type == 8) store(mi.u8Pps, sizeof(mi.u8Pps), &mi.u32PpsLength, nal, n);
         }
     }
+    return changed;
 }
 
 // FLV tag write helpers
-static bool RtmpWriteFlvTag(RTMP* r, uint8_t tag_type, uint32_t ts_ms, const uint8_t* payload, uint32_t payload_len) {
+static void PutFlvTagHeader(uint8_t* p, uint8_t tag_type, uint32_t ts_ms, uint32_t payload_len) {
     // FLV tag header: TagType(1) DataSize(3) Timestamp(3) TimestampExt(1) StreamID(3=0)
-    // IMPORTANT: librtmp's RTMP_Write expects a complete FLV tag (11 + payload + 4) in a single stream.
-    // Splitting into multiple RTMP_Write calls breaks its internal FLV tag parsing/state machine.
-    const uint32_t total = 11u + payload_len + 4u;
-    std::vector<uint8_t> tag;
-    tag.resize(total);
-    uint8_t* p = tag.data();
-
     p[0] = tag_type;
     p[1] = (uint8_t)((payload_len >> 16) & 0xFF);
     p[2] = (uint8_t)((payload_len >> 8) & 0xFF);
@@ -191,30 +154,44 @@ static bool RtmpWriteFlvTag(RTMP* r, uint8_t tag_type, uint32_t ts_ms, const uin
     p[6] = (uint8_t)(ts_ms & 0xFF);
     p[7] = (uint8_t)((ts_ms >> 24) & 0xFF);
     p[8] = p[9] = p[10] = 0;
+}
 
-    if (payload_len > 0 && payload) {
-        memcpy(p + 11, payload, payload_len);
-    }
-
-    const uint32_t prev_size = payload_len + 11;
-    PutBE32(p + 11 + payload_len, prev_size);
-
-    int ret = RTMP_Write(r, (const char*)tag.data(), (int)tag.size());
-    if (ret != (int)tag.size()) {
-        LOGE(kEasyRtmpLogTag) << "[RTMP_Write] failed tag_type=" << (int)tag_type
+// Writes one complete FLV tag (11 + payload + 4).
+static bool RtmpWriteTag(RTMP* r, const uint8_t* tag, uint32_t tag_len) {
+    // IMPORTANT: librtmp's RTMP_Write expects a complete FLV tag (11 + payload + 4) in a single stream.
+    // Splitting into multiple RTMP_Write calls breaks its internal FLV tag parsing/state machine.
+    int ret = RTMP_Write(r, (const char*)tag, (int)tag_len);
+    if (ret != (int)tag_len) {
+        uint32_t ts_ms = ((uint32_t)tag[7] << 24) | ((uint32_t)tag[4] << 16) |
+                         ((uint32_t)tag[5] << 8) | (uint32_t)tag[6];
+        LOGE(kEasyRtmpLogTag) << "[RTMP_Write] failed tag_type=" << (int)tag[0]
                               << " ts_ms=" << ts_ms
-                              << " payload_len=" << payload_len
+                              << " payload_len=" << (tag_len - 15)
                               << " ret=" << ret;
         return false;
     }
     return true;
 }
 
+static bool RtmpWriteFlvTag(RTMP* r, uint8_t tag_type, uint32_t ts_ms, const uint8_t* payload, uint32_t payload_len) {
+    const uint32_t total = 11u + payload_len + 4u;
+    std::vector<uint8_t> tag;
+    tag.resize(total);
+    uint8_t* p = tag.data();
+    PutFlvTagHeader(p, tag_type, ts_ms, payload_len);
+    if (payload_len > 0 && payload) {
+        memcpy(p + 11, payload, payload_len);
+    }
+    PutBE32(p + 11 + payload_len, payload_len + 11);
+    return RtmpWriteTag(r, tag.data(), total);
+}
+
 static double FlvVideoCodecId(const EASY_MEDIA_INFO_T& mi) {
     // FLV VideoCodecID: AVC(H.264)=7.
     // EasyTypes.h uses its own codec constants; map to FLV ids for metadata.
     if (mi.u32VideoCodec == EASY_SDK_VIDEO_CODEC_H264) return 7.0;
-    // H.265 in FLV is non-standard; return 0 to avoid advertising an unknown value.
+    // Enhanced RTMP advertises the FourCC as the codec id.
+    if (mi.u32VideoCodec == EASY_SDK_VIDEO_CODEC_H265) return (double)kFourCcHvc1;
     return 0.0;
 }
 
@@ -225,6 +202,72 @@ static double FlvAudioCodecId(const EASY_MEDIA_INFO_T& mi) {
     return 0.0;
 }
 
+static uint8_t FlvAacSoundHeader(const EASY_MEDIA_INFO_T& mi) {
+    // FLV audio: SoundFormat(10=AAC)<<4 | SoundRate | SoundSize | SoundType
+    uint8_t sound_rate = 3; // 44kHz
+    if (mi.u32AudioSamplerate <= 11025) sound_rate = 1;
+    else if (mi.u32AudioSamplerate <= 22050) sound_rate = 2;
+    else sound_rate = 3;
+    uint8_t sound_size = 1; // 16-bit
+    uint8_t sound_type = (mi.u32AudioChannel >= 2) ? 1 : 0;
+    return (uint8_t)((10 << 4) | (sound_rate << 2) | (sound_size << 1) | (sound_type));
+}
+
+// Appends one AAC audio tag to out. The ADTS header (if any) is skipped in place and the raw
+// frame is copied exactly once, straight from the caller's buffer into the tag.
+static bool AppendFlvAacTag(uint8_t sound_header, const uint8_t* aac, size_t len, uint32_t ts_ms,
+                            std::vector<uint8_t>& out) {
+    size_t skip = AacAdtsHeaderSize(aac, len);
+    if (len <= skip) return false;
+    const uint32_t raw_len = (uint32_t)(len - skip);
+    const uint32_t payload_len = 2u + raw_len;
+    size_t old = out.size();
+    out.resize(old + 11u + payload_len + 4u);
+    uint8_t* p = out.data() + old;
+    PutFlvTagHeader(p, 0x08, ts_ms, payload_len);
+    p[11] = sound_header;
+    p[12] = 0x01; // AAC raw
+    memcpy(p + 13, aac + skip, raw_len);
+    PutBE32(p + 11 + payload_len, payload_len + 11);
+    return true;
+}
+
+// Builds a complete FLV tag (header + payload + PreviousTagSize) for one encoded frame.
+// Video is expected as AnnexB H264 and converted to AVCC; AAC may carry an ADTS header.
+static bool BuildFlvMediaTag(const EASY_MEDIA_INFO_T& mi, uint8_t sound_header,
+                             const EASY_AV_Frame* frame, uint32_t ts_ms,
+                             std::vector<uint8_t>& scratch, std::vector<uint8_t>& tag) {
+    const uint8_t* data = (const uint8_t*)frame->pBuffer;
+    uint32_t len = frame->u32AVFrameLen;
+    if (frame->u32AVFrameFlag == EASY_SDK_VIDEO_FRAME_FLAG) {
+        const bool hevc = mi.u32VideoCodec == EASY_SDK_VIDEO_CODEC_H265;
+        const bool key = frame->u32AVFrameType == EASY_SDK_VIDEO_FRAME_I;
+        AnnexBToAvcc(data, (size_t)len, scratch, hevc);
+        if (scratch.empty()) return false;
+
+        // Both layouts use a 5-byte video header.
+        uint32_t payload_len = 5u + (uint32_t)scratch.size();
+        tag.resize(11u + payload_len + 4u);
+        uint8_t* p = tag.data();
+        PutFlvTagHeader(p, 0x09, ts_ms, payload_len);
+        if (hevc) {
+            p[11] = (uint8_t)(kExHeaderFlag | (key ? 0x10 : 0x20) | kExPacketCodedFramesX);
+            PutBE32(p + 12, kFourCcHvc1);
+        } else {
+            p[11] = key ? 0x17 : 0x27;
+            p[12] = 0x01; // AVC NALU
+            p[13] = p[14] = p[15] = 0x00; // composition time
+        }
+        memcpy(p + 16, scratch.data(), scratch.size());
+        PutBE32(p + 11 + payload_len, payload_len + 11);
+        return true;
+    } else if (frame->u32AVFrameFlag == EASY_SDK_AUDIO_FRAME_FLAG) {
+        tag.clear();
+        return AppendFlvAacTag(sound_header, data, len, ts_ms, tag);
+    }
+    return false;
+}
+
 static bool SendOnMetaData(RTMP* r, const EASY_MEDIA_INFO_T& mi, uint32_t ts_ms) {
     // Script tag payload is AMF0 encoded
     uint8_t buf[2048]; // Increased buffer size for more fields
@@ -232,16 +275,27 @@ static bool SendOnMetaData(RTMP* r, const EASY_MEDIA_INFO_T& mi, uint32_t ts_ms)
     char* end = (char*)buf + sizeof(buf);
 
     AVal name = AVC("onMetaData");
-    // String "onMetaData"
-    *p++ = AMF_STRING;
+    // String "onMetaData" (AMF_EncodeString writes the AMF_STRING marker itself)
     p = AMF_EncodeString(p, end, &name);
     if (!p) return false;
 
-    // Try to parse width/height from SPS
-    uint32_t width = 0, height = 0;
-    if (mi.u32SpsLength > 0) {
-        ParseSpsForResolution(mi.u8Sps, mi.u32SpsLength, &width, &height);
+    // Advertise the real coded size/profile/level so players can skip probing the stream.
+    H264SpsInfo sps_info;
+    H265SpsInfo hevc_sps_info;
+    bool has_sps_info = false;
+    bool has_hevc_sps_info = false;
+    if (mi.u32SpsLength > 0 && mi.u32SpsLength <= sizeof(mi.u8Sps)) {
+        if (mi.u32VideoCodec == EASY_SDK_VIDEO_CODEC_H264) {
+            has_sps_info = ParseH264Sps(mi.u8Sps, mi.u32SpsLength, &sps_info);
+        } else if (mi.u32VideoCodec == EASY_SDK_VIDEO_CODEC_H265) {
+            has_hevc_sps_info = ParseH265Sps(mi.u8Sps, mi.u32SpsLength, &hevc_sps_info);
+        }
+        if (!has_sps_info && !has_hevc_sps_info) {
+            LOGW(kEasyRtmpLogTag) << "[onMetaData] failed to parse SPS, len=" << mi.u32SpsLength;
+        }
     }
+    uint32_t width = has_sps_info ? sps_info.width : (has_hevc_sps_info ? hevc_sps_info.width : 0);
+    uint32_t height = has_sps_info ? sps_info.height : (has_hevc_sps_info ? hevc_sps_info.height : 0);
 
     // ECMA array - count will be updated after adding all fields
     *p++ = AMF_ECMA_ARRAY;
@@ -260,19 +314,23 @@ static bool SendOnMetaData(RTMP* r, const EASY_MEDIA_INFO_T& mi, uint32_t ts_ms)
     // Video fields: only advertise video if SPS/PPS present (avoid servers expecting video on audio-only push)
     const bool has_video_cfg = (mi.u32SpsLength > 0 && mi.u32PpsLength > 0);
     if (has_video_cfg) {
-        if (width > 0 && height > 0) {
-            p = put_named_number("width", (double)width);
-            if (!p) return false;
-            p = put_named_number("height", (double)height);
-            if (!p) return false;
-        } else {
-            p = put_named_number("width", 0);
+        p = put_named_number("width", (double)width);
+        if (!p) return false;
+        p = put_named_number("height", (double)height);
+        if (!p) return false;
+        // Prefer the configured rate; fall back to the VUI timing info of the SPS.
+        double framerate = (double)mi.u32VideoFps;
+        if (framerate <= 0.0 && has_sps_info) {
+            framerate = sps_info.frame_rate;
+        }
+        p = put_named_number("framerate", framerate);
+        if (!p) return false;
+        if (has_sps_info) {
+            p = put_named_number("avcprofile", (double)sps_info.profile_idc);
             if (!p) return false;
-            p = put_named_number("height", 0);
+            p = put_named_number("avclevel", (double)sps_info.level_idc);
             if (!p) return false;
         }
-        p = put_named_number("framerate", (double)mi.u32VideoFps);
-        if (!p) return false;
         const double vcc = FlvVideoCodecId(mi);
         if (vcc > 0.0) {
             p = put_named_number("videocodecid", vcc);
@@ -323,6 +381,24 @@ static bool SendOnMetaData(RTMP* r, const EASY_MEDIA_INFO_T& mi, uint32_t ts_ms)
     return RtmpWriteFlvTag(r, 0x12 /*script*/, ts_ms, buf, payload_len);
 }
 
+// Larger chunks mean fewer chunk headers per message; librtmp defaults to 128 bytes.
+static bool SendSetChunkSize(RTMP* r, int chunk_size) {
+    char pbuf[RTMP_MAX_HEADER_SIZE + 4];
+    RTMPPacket packet;
+    memset(&packet, 0, sizeof(packet));
+    packet.m_nChannel = 0x02; // control channel
+    packet.m_headerType = RTMP_PACKET_SIZE_LARGE;
+    packet.m_packetType = RTMP_PACKET_TYPE_CHUNK_SIZE;
+    packet.m_body = pbuf + RTMP_MAX_HEADER_SIZE;
+    packet.m_nBodySize = 4;
+    AMF_EncodeInt32(packet.m_body, packet.m_body + 4, chunk_size);
+    if (!RTMP_SendPacket(r, &packet, FALSE)) {
+        return false;
+    }
+    r->m_outChunkSize = chunk_size;
+    return true;
+}
+
 struct EasyRtmpSession {
     EasyRtmpSession() = default;
     ~EasyRtmpSession() = default;
@@ -347,8 +423,27 @@ struct EasyRtmpSession {
     // so timestamps must be monotonic (non-decreasing) across ALL tags, not per-stream.
     // Use UINT32_MAX as "unset".
     uint32_t last_ts_ms{UINT32_MAX};
+
+    // FLV tag build buffers reused across EasyRTMP_SendPacket calls.
+    std::vector<uint8_t> scratch{};
+    std::vector<uint8_t> tag{};
+    // FLV AAC sound header byte, derived from mi whenever it is set.
+    uint8_t aac_sound_header{};
+
+    // Audio coalescing (EasyRTMP_SetAudioCoalesce): AAC tags collect in audio_batch behind an
+    // 11-byte aggregate header placeholder and go out as one RTMP aggregate message.
+    uint32_t audio_coalesce_ms{0};
+    std::vector<uint8_t> audio_batch{};
+    uint32_t audio_batch_frames{0};
+    uint32_t audio_batch_ts_ms{0};
 };
 
+static void SetMediaInfo(EasyRtmpSession* s, const EASY_MEDIA_INFO_T& mi) {
+    s->mi = mi;
+    s->mi_set = true;
+    s->aac_sound_header = FlvAacSoundHeader(mi);
+}
+
 static void Notify(EasyRtmpSession* s, EASY_RTMP_STATE_T st) {
     if (s && s->cb) {
         s->cb(EASY_SDK_EVENT_FRAME_FLAG, nullptr, st, s->cb_user);
@@ -364,11 +459,24 @@ static bool EnsureConnected(EasyRtmpSession* s) {
         Notify(s, EASY_RTMP_STATE_CONNECT_FAILED);
         return false;
     }
+    SendSetChunkSize(s->rtmp, kOutChunkSize);
     s->connected = true;
     Notify(s, EASY_RTMP_STATE_CONNECTED);
     return true;
 }
 
+// Enhanced RTMP SequenceStart tag body: ex-header + 'hvc1' + HEVCDecoderConfigurationRecord
+// (ISO/IEC 14496-15 8.3.3.1) built from the VPS/SPS/PPS in mi.
+static bool BuildHevcSequenceHeader(const EASY_MEDIA_INFO_T& mi, std::vector<uint8_t>& payload) {
+    payload.clear();
+    payload.reserve(5 + 23 + 3 * 5 + mi.u32VpsLength + mi.u32SpsLength + mi.u32PpsLength);
+    payload.push_back((uint8_t)(kExHeaderFlag | 0x10 | kExPacketSequenceStart));
+    payload.resize(5);
+    PutBE32(payload.data() + 1, kFourCcHvc1);
+    return BuildHevcDecoderConfig(mi.u8Vps, mi.u32VpsLength, mi.u8Sps, mi.u32SpsLength,
+                                  mi.u8Pps, mi.u32PpsLength, payload);
+}
+
 static bool SendHeadersIfNeeded(EasyRtmpSession* s) {
     if (!s || !s->rtmp) return false;
     if (s->sent_headers) return true;
@@ -384,8 +492,19 @@ static bool SendHeadersIfNeeded(EasyRtmpSession* s) {
     }
     if (s->last_ts_ms == UINT32_MAX || hdr_ts > s->last_ts_ms) s->last_ts_ms = hdr_ts;
 
-    // Build and send H264 AVC sequence header from SPS/PPS (AnnexB NAL units without start codes expected)
-    if (s->mi.u32SpsLength > 0 && s->mi.u32PpsLength > 0) {
+    if (s->mi.u32VideoCodec == EASY_SDK_VIDEO_CODEC_H265) {
+        if (s->mi.u32VpsLength > 0 && s->mi.u32SpsLength > 0 && s->mi.u32PpsLength > 0) {
+            std::vector<uint8_t> payload;
+            if (!BuildHevcSequenceHeader(s->mi, payload)) {
+                LOGE(kEasyRtmpLogTag) << "[hvc1] failed to parse SPS, len=" << s->mi.u32SpsLength;
+                return false;
+            }
+            if (!RtmpWriteFlvTag(s->rtmp, 0x09 /*video*/, hdr_ts, payload.data(), (uint32_t)payload.size())) {
+                return false;
+            }
+        }
+    } else if (s->mi.u32SpsLength > 0 && s->mi.u32PpsLength > 0) {
+        // Build and send H264 AVC sequence header from SPS/PPS (AnnexB NAL units without start codes expected)
         const uint8_t* sps = s->mi.u8Sps;
         const uint8_t* pps = s->mi.u8Pps;
         uint32_t sps_len = s->mi.u32SpsLength;
@@ -400,20 +519,10 @@ static bool SendHeadersIfNeeded(EasyRtmpSession* s) {
             payload.push_back(0x00);
             payload.push_back(0x00); // composition time
 
-            // AVCDecoderConfigurationRecord
-            payload.push_back(0x01); // configurationVersion
-            payload.push_back(sps[1]); // AVCProfileIndication
-            payload.push_back(sps[2]); // profile_compatibility
-            payload.push_back(sps[3]); // AVCLevelIndication
-            payload.push_back(0xFF);   // 6 bits reserved + 2 bits lengthSizeMinusOne (3 => 4 bytes)
-            payload.push_back(0xE1);   // 3 bits reserved + 5 bits numOfSPS (1)
-            payload.push_back((uint8_t)((sps_len >> 8) & 0xFF));
-            payload.push_back((uint8_t)(sps_len & 0xFF));
-            payload.insert(payload.end(), sps, sps + sps_len);
-            payload.push_back(0x01); // numOfPPS
-            payload.push_back((uint8_t)((pps_len >> 8) & 0xFF));
-            payload.push_back((uint8_t)(pps_len & 0xFF));
-            payload.insert(payload.end(), pps, pps + pps_len);
+            if (!BuildAvcDecoderConfig(sps, sps_len, pps, pps_len, payload)) {
+                LOGE(kEasyRtmpLogTag) << "[avcC] invalid SPS/PPS, sps_len=" << sps_len;
+                return false;
+            }
 
             if (!RtmpWriteFlvTag(s->rtmp, 0x09 /*video*/, hdr_ts, payload.data(), (uint32_t)payload.size())) {
                 return false;
@@ -424,17 +533,11 @@ static bool SendHeadersIfNeeded(EasyRtmpSession* s) {
 
     // AAC sequence header
     if (s->mi.u32AudioCodec == EASY_SDK_AUDIO_CODEC_AAC && s->mi.u32AudioSamplerate > 0) {
-        BuildAudioSpecificConfig((int)s->mi.u32AudioSamplerate, (int)s->mi.u32AudioChannel, s->aac_asc);
-        // FLV audio: SoundFormat(10=AAC)<<4 | SoundRate | SoundSize | SoundType
-        uint8_t sound_rate = 3; // 44kHz
-        if (s->mi.u32AudioSamplerate <= 11025) sound_rate = 1;
-        else if (s->mi.u32AudioSamplerate <= 22050) sound_rate = 2;
-        else sound_rate = 3;
-        uint8_t sound_size = 1; // 16-bit
-        uint8_t sound_type = (s->mi.u32AudioChannel >= 2) ? 1 : 0;
-        uint8_t hdr = (uint8_t)((10 << 4) | (sound_rate << 2) | (sound_size << 1) | (sound_type));
+        s->aac_asc.clear();
+        BuildAacAudioSpecificConfig((int)s->mi.u32AudioSamplerate, (int)s->mi.u32AudioChannel,
+                                    s->aac_asc);
         std::vector<uint8_t> payload;
-        payload.push_back(hdr);
+        payload.push_back(FlvAacSoundHeader(s->mi));
         payload.push_back(0x00); // AAC sequence header
         payload.insert(payload.end(), s->aac_asc.begin(), s->aac_asc.end());
         if (!RtmpWriteFlvTag(s->rtmp, 0x08 /*audio*/, hdr_ts, payload.data(), (uint32_t)payload.size())) {
@@ -448,6 +551,189 @@ static bool SendHeadersIfNeeded(EasyRtmpSession* s) {
     return true;
 }
 
+static void HandleWriteFailure(EasyRtmpSession* s) {
+    Notify(s, EASY_RTMP_STATE_ERROR);
+    // Stop further writes on a broken connection to avoid WSAENOTSOCK (10038)
+    RTMP_Close(s->rtmp);
+    s->connected = false;
+    // A reconnect starts a new stream on the server, which needs metadata/sequence headers again.
+    s->sent_headers = false;
+    s->audio_batch.clear();
+    s->audio_batch_frames = 0;
+}
+
+// Sends the pending AAC tags: a single tag as-is, several as one aggregate message
+// (RTMP message type 22) whose body is the FLV tags themselves.
+static bool FlushAudioBatch(EasyRtmpSession* s) {
+    if (s->audio_batch_frames == 0) {
+        return true;
+    }
+    bool ok;
+    if (s->audio_batch_frames == 1) {
+        ok = RtmpWriteTag(s->rtmp, s->audio_batch.data() + 11, (uint32_t)s->audio_batch.size() - 11);
+    } else {
+        uint32_t body_len = (uint32_t)s->audio_batch.size() - 11;
+        PutFlvTagHeader(s->audio_batch.data(), kFlvTagAggregate, s->audio_batch_ts_ms, body_len);
+        s->audio_batch.resize(s->audio_batch.size() + 4);
+        PutBE32(s->audio_batch.data() + 11 + body_len, body_len + 11);
+        ok = RtmpWriteTag(s->rtmp, s->audio_batch.data(), (uint32_t)s->audio_batch.size());
+    }
+    s->audio_batch.clear();
+    s->audio_batch_frames = 0;
+    if (!ok) {
+        HandleWriteFailure(s);
+    }
+    return ok;
+}
+
+
+// Fan-out: one encoded stream pushed to several sessions.
+// The FLV tag is built once on the caller thread and shared by reference with every sink;
+// each sink owns an I/O thread so a slow destination only backs up its own queue.
+static const uint32_t kDefaultFanoutQueueFrames = 256;
+// How long a removed sink keeps sending what was queued for it before the rest is dropped.
+static const std::chrono::milliseconds kFanoutDrainTime(2000);
+
+// One queue entry: an FLV tag, or a media-info change when mi is set. The change travels in
+// the queue so frames queued before it still go out after the old sequence headers.
+struct FanoutTag {
+    std::shared_ptr<const EASY_MEDIA_INFO_T> mi{};
+    std::shared_ptr<const std::vector<uint8_t>> tag{};
+    uint32_t ts_ms{};
+    bool video{false};
+    bool key{false};
+};
+
+struct FanoutSink {
+    EasyRtmpSession* session{nullptr};
+    std::thread thread{};
+
+    std::mutex mu;
+    std::condition_variable cv;
+    std::deque<FanoutTag> queue{};
+    bool stop{false};
+    std::chrono::steady_clock::time_point drain_deadline{};
+    // Set on start and after an overflow or write failure: video is skipped until the next
+    // key frame so the destination never receives P-frames without their reference.
+    bool wait_key{true};
+    uint32_t dropped{0};
+};
+
+struct EasyRtmpFanout {
+    std::mutex mu;
+    EASY_MEDIA_INFO_T mi{};
+    bool mi_set{false};
+    uint32_t max_queue{kDefaultFanoutQueueFrames};
+    uint32_t last_ts_ms{UINT32_MAX};
+    uint8_t aac_sound_header{};
+    std::vector<uint8_t> scratch{};
+    std::vector<std::unique_ptr<FanoutSink>> sinks{};
+};
+
+static void FanoutEnqueue(FanoutSink* sink, const FanoutTag& item, uint32_t max_queue) {
+    std::lock_guard<std::mutex> lock(sink->mu);
+    if (sink->queue.size() >= max_queue) {
+        // The destination can't keep up: drop its backlog and resync on the next key frame
+        // instead of blocking the caller and every other destination. The newest media-info
+        // change is kept, the frames after the backlog still need it.
+        FanoutTag change;
+        for (const auto& queued : sink->queue) {
+            if (queued.mi) {
+                change = queued;
+            } else {
+                ++sink->dropped;
+            }
+        }
+        sink->queue.clear();
+        if (change.mi) {
+            sink->queue.push_back(change);
+        }
+        sink->wait_key = !(item.video && item.key);
+    }
+    if (item.video && sink->wait_key) {
+        if (!item.key) {
+            ++sink->dropped;
+            return;
+        }
+        sink->wait_key = false;
+    }
+    sink->queue.push_back(item);
+    sink->cv.notify_one();
+}
+
+static void FanoutSinkLoop(FanoutSink* sink) {
+    EasyRtmpSession* s = sink->session;
+    while (true) {
+        FanoutTag item;
+        {
+            std::unique_lock<std::mutex> lock(sink->mu);
+            sink->cv.wait(lock, [sink] { return sink->stop || !sink->queue.empty(); });
+            if (sink->queue.empty()) {
+                return;
+            }
+            if (sink->stop && std::chrono::steady_clock::now() >= sink->drain_deadline) {
+                // Out of time: what is still queued is counted as dropped.
+                for (const auto& queued : sink->queue) {
+                    if (!queued.mi) {
+                        ++sink->dropped;
+                    }
+                }
+                sink->queue.clear();
+                return;
+            }
+            item = std::move(sink->queue.front());
+            sink->queue.pop_front();
+        }
+
+        if (item.mi) {
+            // New sequence headers go out in front of the next frame.
+            std::lock_guard<std::mutex> lock(s->mu);
+            SetMediaInfo(s, *item.mi);
+            s->sent_headers = false;
+            continue;
+        }
+
+        bool ok = false;
+        {
+            std::lock_guard<std::mutex> lock(s->mu);
+            if (s->rtmp && EnsureConnected(s) && SendHeadersIfNeeded(s)) {
+                const std::vector<uint8_t>& tag = *item.tag;
+                ok = RtmpWriteTag(s->rtmp, tag.data(), (uint32_t)tag.size());
+                if (ok) {
+                    s->last_ts_ms = item.ts_ms;
+                } else {
+                    HandleWriteFailure(s);
+                }
+            }
+        }
+        if (!ok) {
+            std::lock_guard<std::mutex> lock(sink->mu);
+            ++sink->dropped;
+            sink->wait_key = true;
+        }
+    }
+}
+
+// Nothing is queued to a sink once it is stopping; its thread sends the final frames and
+// media-info changes still queued, for up to kFanoutDrainTime, and then exits.
+static void SignalFanoutSinkStop(FanoutSink* sink) {
+    {
+        std::lock_guard<std::mutex> lock(sink->mu);
+        if (!sink->stop) {
+            sink->stop = true;
+            sink->drain_deadline = std::chrono::steady_clock::now() + kFanoutDrainTime;
+        }
+    }
+    sink->cv.notify_one();
+}
+
+static void StopFanoutSink(FanoutSink* sink) {
+    SignalFanoutSinkStop(sink);
+    if (sink->thread.joinable()) {
+        sink->thread.join();
+    }
+}
+
 } // namespace
 
 extern "C" {
@@ -456,8 +742,10 @@ extern "C" {
 static void EnsureWinsockInitialized() {
     static std::once_flag init_flag;
     std::call_once(init_flag, []() {
+#ifdef _WIN32
         WSADATA wsaData;
         WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
     });
 }
 
@@ -466,6 +754,7 @@ Easy_Handle Easy_APICALL EasyRTMP_Create(void) {
     // Route librtmp logs into local_log (helps diagnose WriteN/10054 issues).
     RTMP_LogSetCallback(LibrtmpLogCb);
     // Use DEBUG to capture server onStatus / publish rejection reasons when the server closes early (10054/10053).
+    // Those lines go to LOGD, so they cost a single level check unless debug logging is on.
     RTMP_LogSetLevel(RTMP_LOGDEBUG);
     EasyRtmpSession* s = new EasyRtmpSession();
     memset(&s->mi, 0, sizeof(s->mi));
@@ -490,8 +779,7 @@ Easy_I32 Easy_APICALL EasyRTMP_Init(Easy_Handle handle,
     std::lock_guard<std::mutex> lock(s->mu);
     s->url = url;
     if (pstruStreamInfo) {
-        s->mi = *pstruStreamInfo;
-        s->mi_set = true;
+        SetMediaInfo(s, *pstruStreamInfo);
     }
     return Easy_NoErr;
 }
@@ -500,8 +788,7 @@ Easy_I32 Easy_APICALL EasyRTMP_InitMetadata(Easy_Handle handle, EASY_MEDIA_INFO_
     auto s = (EasyRtmpSession*)handle;
     if (!s || !pstruStreamInfo) return Easy_BadArgument;
     std::lock_guard<std::mutex> lock(s->mu);
-    s->mi = *pstruStreamInfo;
-    s->mi_set = true;
+    SetMediaInfo(s, *pstruStreamInfo);
     // force resend headers (e.g., SPS/PPS updated)
     s->sent_headers = false;
     return Easy_NoErr;
@@ -548,6 +835,7 @@ Easy_Bool Easy_APICALL EasyRTMP_Connect(Easy_Handle handle, const char* url) {
         s->rtmp = nullptr;
         return 0;
     }
+    SendSetChunkSize(s->rtmp, kOutChunkSize);
     s->connected = true;
     Notify(s, EASY_RTMP_STATE_CONNECTED);
     return 1;
@@ -560,6 +848,15 @@ Easy_U32 Easy_APICALL EasyRTMP_SendPacket(Easy_Handle handle, EASY_AV_Frame* fra
     std::lock_guard<std::mutex> lock(s->mu);
     if (!s->rtmp) return 0;
     if (!EnsureConnected(s)) return 0;
+    const bool is_audio = frame->u32AVFrameFlag == EASY_SDK_AUDIO_FRAME_FLAG;
+    // Pending audio must go out ahead of anything that follows it on the wire.
+    if (!is_audio && !FlushAudioBatch(s)) return 0;
+    if (frame->u32AVFrameFlag == EASY_SDK_VIDEO_FRAME_FLAG &&
+        frame->u32AVFrameType == EASY_SDK_VIDEO_FRAME_I &&
+        UpdateParameterSets(s->mi, (const uint8_t*)frame->pBuffer, frame->u32AVFrameLen)) {
+        s->sent_headers = false;
+    }
+    if (!s->sent_headers && !FlushAudioBatch(s)) return 0;
     if (!SendHeadersIfNeeded(s)) return 0;
 
     uint32_t ts = ToMs(frame->u32TimestampSec, frame->u32TimestampUsec);
@@ -575,63 +872,34 @@ Easy_U32 Easy_APICALL EasyRTMP_SendPacket(Easy_Handle handle, EASY_AV_Frame* fra
         return out;
     };
 
-    if (frame->u32AVFrameFlag == EASY_SDK_VIDEO_FRAME_FLAG) {
-        ts = clamp_global_monotonic(ts);
-        // Input is expected AnnexB H264. Convert to AVCC for FLV.
-        std::vector<uint8_t> avcc;
-        AnnexBToAvcc((const uint8_t*)frame->pBuffer, (size_t)frame->u32AVFrameLen, avcc);
-        if (avcc.empty()) return 0;
-
-        std::vector<uint8_t> payload;
-        payload.reserve(5 + avcc.size());
-        uint8_t frametype_codec = (frame->u32AVFrameType == EASY_SDK_VIDEO_FRAME_I) ? 0x17 : 0x27;
-        payload.push_back(frametype_codec);
-        payload.push_back(0x01); // AVC NALU
-        payload.push_back(0x00);
-        payload.push_back(0x00);
-        payload.push_back(0x00); // composition time
-        payload.insert(payload.end(), avcc.begin(), avcc.end());
-
-        if (!RtmpWriteFlvTag(s->rtmp, 0x09, ts, payload.data(), (uint32_t)payload.size())) {
-            Notify(s, EASY_RTMP_STATE_ERROR);
-            // Stop further writes on a broken connection to avoid WSAENOTSOCK (10038)
-            RTMP_Close(s->rtmp);
-            s->connected = false;
-            return 0;
+    if (frame->u32AVFrameFlag != EASY_SDK_VIDEO_FRAME_FLAG &&
+        frame->u32AVFrameFlag != EASY_SDK_AUDIO_FRAME_FLAG) {
+        return 0;
+    }
+    ts = clamp_global_monotonic(ts);
+    if (is_audio && s->audio_coalesce_ms > 0 && s->mi.u32AudioCodec == EASY_SDK_AUDIO_CODEC_AAC) {
+        if (s->audio_batch_frames == 0) {
+            s->audio_batch.assign(11, 0); // aggregate tag header, filled in by FlushAudioBatch
+            s->audio_batch_ts_ms = ts;
         }
-        return frame->u32AVFrameLen;
-    } else if (frame->u32AVFrameFlag == EASY_SDK_AUDIO_FRAME_FLAG) {
-        ts = clamp_global_monotonic(ts);
-        // Expect AAC raw. If ADTS is present, strip it.
-        std::vector<uint8_t> aac((const uint8_t*)frame->pBuffer,
-                                 (const uint8_t*)frame->pBuffer + frame->u32AVFrameLen);
-        StripAdtsIfPresent(aac);
-        if (aac.empty()) return 0;
-
-        uint8_t sound_rate = 3;
-        if (s->mi.u32AudioSamplerate <= 11025) sound_rate = 1;
-        else if (s->mi.u32AudioSamplerate <= 22050) sound_rate = 2;
-        else sound_rate = 3;
-        uint8_t sound_size = 1;
-        uint8_t sound_type = (s->mi.u32AudioChannel >= 2) ? 1 : 0;
-        uint8_t hdr = (uint8_t)((10 << 4) | (sound_rate << 2) | (sound_size << 1) | (sound_type));
-
-        std::vector<uint8_t> payload;
-        payload.reserve(2 + aac.size());
-        payload.push_back(hdr);
-        payload.push_back(0x01); // AAC raw
-        payload.insert(payload.end(), aac.begin(), aac.end());
-
-        if (!RtmpWriteFlvTag(s->rtmp, 0x08, ts, payload.data(), (uint32_t)payload.size())) {
-            Notify(s, EASY_RTMP_STATE_ERROR);
-            RTMP_Close(s->rtmp);
-            s->connected = false;
+        if (!AppendFlvAacTag(s->aac_sound_header, (const uint8_t*)frame->pBuffer,
+                             frame->u32AVFrameLen, ts, s->audio_batch)) {
+            if (s->audio_batch_frames == 0) s->audio_batch.clear();
             return 0;
         }
+        ++s->audio_batch_frames;
+        if (ts - s->audio_batch_ts_ms >= s->audio_coalesce_ms ||
+            s->audio_batch_frames >= kMaxCoalescedAudioFrames) {
+            if (!FlushAudioBatch(s)) return 0;
+        }
         return frame->u32AVFrameLen;
     }
-
-    return 0;
+    if (!BuildFlvMediaTag(s->mi, s->aac_sound_header, frame, ts, s->scratch, s->tag)) return 0;
+    if (!RtmpWriteTag(s->rtmp, s->tag.data(), (uint32_t)s->tag.size())) {
+        HandleWriteFailure(s);
+        return 0;
+    }
+    return frame->u32AVFrameLen;
 }
 
 Easy_I32 Easy_APICALL EasyRTMP_GetBufInfo(Easy_Handle /*handle*/, int* usedSize, int* totalSize) {
@@ -646,6 +914,9 @@ void Easy_APICALL EasyRTMP_Release(Easy_Handle handle) {
     {
         std::lock_guard<std::mutex> lock(s->mu);
         if (s->rtmp) {
+            if (s->connected) {
+                FlushAudioBatch(s);
+            }
             RTMP_Close(s->rtmp);
             RTMP_Free(s->rtmp);
             s->rtmp = nullptr;
@@ -655,6 +926,155 @@ void Easy_APICALL EasyRTMP_Release(Easy_Handle handle) {
     delete s;
 }
 
+Easy_I32 Easy_APICALL EasyRTMP_SetAudioCoalesce(Easy_Handle handle, Easy_U32 maxDelayMs) {
+    auto s = (EasyRtmpSession*)handle;
+    if (!s) return Easy_BadArgument;
+    std::lock_guard<std::mutex> lock(s->mu);
+    s->audio_coalesce_ms = maxDelayMs;
+    if (maxDelayMs == 0 && s->connected && !FlushAudioBatch(s)) {
+        return Easy_SendError;
+    }
+    return Easy_NoErr;
+}
+
+Easy_Handle Easy_APICALL EasyRTMP_FanoutCreate(Easy_U32 maxQueueFrames) {
+    EasyRtmpFanout* f = new EasyRtmpFanout();
+    memset(&f->mi, 0, sizeof(f->mi));
+    if (maxQueueFrames > 0) {
+        f->max_queue = maxQueueFrames;
+    }
+    return (Easy_Handle)f;
+}
+
+Easy_I32 Easy_APICALL EasyRTMP_FanoutInitMetadata(Easy_Handle fanout, EASY_MEDIA_INFO_T* pstruStreamInfo) {
+    auto f = (EasyRtmpFanout*)fanout;
+    if (!f || !pstruStreamInfo) return Easy_BadArgument;
+    std::lock_guard<std::mutex> lock(f->mu);
+    f->mi = *pstruStreamInfo;
+    f->mi_set = true;
+    f->aac_sound_header = FlvAacSoundHeader(f->mi);
+    FanoutTag change;
+    change.mi = std::make_shared<EASY_MEDIA_INFO_T>(f->mi);
+    for (auto& sink : f->sinks) {
+        FanoutEnqueue(sink.get(), change, f->max_queue);
+    }
+    return Easy_NoErr;
+}
+
+Easy_I32 Easy_APICALL EasyRTMP_FanoutAddSession(Easy_Handle fanout, Easy_Handle handle) {
+    auto f = (EasyRtmpFanout*)fanout;
+    auto s = (EasyRtmpSession*)handle;
+    if (!f || !s) return Easy_BadArgument;
+    std::lock_guard<std::mutex> lock(f->mu);
+    for (auto& sink : f->sinks) {
+        if (sink->session == s) return Easy_AttrNameExists;
+    }
+    std::unique_ptr<FanoutSink> sink(new FanoutSink());
+    sink->session = s;
+    if (f->mi_set) {
+        FanoutTag change;
+        change.mi = std::make_shared<EASY_MEDIA_INFO_T>(f->mi);
+        sink->queue.push_back(change);
+    }
+    FanoutSink* raw = sink.get();
+    raw->thread = std::thread([raw]() { FanoutSinkLoop(raw); });
+    f->sinks.push_back(std::move(sink));
+    return Easy_NoErr;
+}
+
+Easy_I32 Easy_APICALL EasyRTMP_FanoutRemoveSession(Easy_Handle fanout, Easy_Handle handle) {
+    auto f = (EasyRtmpFanout*)fanout;
+    if (!f || !handle) return Easy_BadArgument;
+    std::unique_ptr<FanoutSink> removed;
+    {
+        std::lock_guard<std::mutex> lock(f->mu);
+        for (auto it = f->sinks.begin(); it != f->sinks.end(); ++it) {
+            if ((*it)->session == (EasyRtmpSession*)handle) {
+                removed = std::move(*it);
+                f->sinks.erase(it);
+                break;
+            }
+        }
+    }
+    if (!removed) return Easy_ValueNotFound;
+    StopFanoutSink(removed.get());
+    return Easy_NoErr;
+}
+
+Easy_U32 Easy_APICALL EasyRTMP_FanoutSendPacket(Easy_Handle fanout, EASY_AV_Frame* frame) {
+    auto f = (EasyRtmpFanout*)fanout;
+    if (!f || !frame || !frame->pBuffer || frame->u32AVFrameLen == 0) return 0;
+    if (frame->u32AVFrameFlag != EASY_SDK_VIDEO_FRAME_FLAG &&
+        frame->u32AVFrameFlag != EASY_SDK_AUDIO_FRAME_FLAG) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(f->mu);
+    // Every sink shares one timeline, so the monotonic clamp is applied once here.
+    uint32_t ts = ToMs(frame->u32TimestampSec, frame->u32TimestampUsec);
+    if (f->last_ts_ms != UINT32_MAX && ts < f->last_ts_ms) {
+        ts = f->last_ts_ms;
+    }
+    f->last_ts_ms = ts;
+
+    if (frame->u32AVFrameFlag == EASY_SDK_VIDEO_FRAME_FLAG &&
+        frame->u32AVFrameType == EASY_SDK_VIDEO_FRAME_I &&
+        UpdateParameterSets(f->mi, (const uint8_t*)frame->pBuffer, frame->u32AVFrameLen)) {
+        FanoutTag change;
+        change.mi = std::make_shared<EASY_MEDIA_INFO_T>(f->mi);
+        for (auto& sink : f->sinks) {
+            FanoutEnqueue(sink.get(), change, f->max_queue);
+        }
+    }
+
+    std::shared_ptr<std::vector<uint8_t>> tag = std::make_shared<std::vector<uint8_t>>();
+    if (!BuildFlvMediaTag(f->mi, f->aac_sound_header, frame, ts, f->scratch, *tag)) return 0;
+
+    FanoutTag item;
+    item.tag = tag;
+    item.ts_ms = ts;
+    item.video = frame->u32AVFrameFlag == EASY_SDK_VIDEO_FRAME_FLAG;
+    item.key = item.video && frame->u32AVFrameType == EASY_SDK_VIDEO_FRAME_I;
+    for (auto& sink : f->sinks) {
+        FanoutEnqueue(sink.get(), item, f->max_queue);
+    }
+    return frame->u32AVFrameLen;
+}
+
+Easy_I32 Easy_APICALL EasyRTMP_FanoutGetSessionInfo(Easy_Handle fanout, Easy_Handle handle,
+                                                   Easy_U32* queuedFrames, Easy_U32* droppedFrames) {
+    auto f = (EasyRtmpFanout*)fanout;
+    if (!f || !handle) return Easy_BadArgument;
+    std::lock_guard<std::mutex> lock(f->mu);
+    for (auto& sink : f->sinks) {
+        if (sink->session == (EasyRtmpSession*)handle) {
+            std::lock_guard<std::mutex> sink_lock(sink->mu);
+            if (queuedFrames) *queuedFrames = (Easy_U32)sink->queue.size();
+            if (droppedFrames) *droppedFrames = sink->dropped;
+            return Easy_NoErr;
+        }
+    }
+    return Easy_ValueNotFound;
+}
+
+void Easy_APICALL EasyRTMP_FanoutRelease(Easy_Handle fanout) {
+    auto f = (EasyRtmpFanout*)fanout;
+    if (!f) return;
+    std::vector<std::unique_ptr<FanoutSink>> sinks;
+    {
+        std::lock_guard<std::mutex> lock(f->mu);
+        sinks.swap(f->sinks);
+    }
+    // All sinks drain at the same time, so releasing takes one drain time at most.
+    for (auto& sink : sinks) {
+        SignalFanoutSinkStop(sink.get());
+    }
+    for (auto& sink : sinks) {
+        StopFanoutSink(sink.get());
+    }
+    delete f;
+}
+
 } // extern "C"
 
 
@@ -0,0 +1,549 @@
+#include <rtmp/rtmp_ingest_server.h>
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+#include "mediasdk/local_log/local_log.h"
+
+extern "C" {
+#include "amf.h"
+#include "log.h"
+#include "rtmp_sys.h"
+}
+
+#ifdef _WIN32
+#pragma comment(lib, "Ws2_32.lib")
+#define INGEST_SHUT_BOTH SD_BOTH
+#else
+#define INGEST_SHUT_BOTH SHUT_RDWR
+#endif
+
+namespace {
+static const char* kIngestLogTag = "RtmpIngest";
+
+// Invoke/status channels used by common RTMP servers for their replies.
+static const int kInvokeChannel = 0x03;
+static const int kStatusChannel = 0x05;
+static const int kPublishStreamId = 1;
+
+#define INGEST_SAVC(x) static const AVal av_##x = AVC(#x)
+INGEST_SAVC(connect);
+INGEST_SAVC(createStream);
+INGEST_SAVC(publish);
+INGEST_SAVC(deleteStream);
+INGEST_SAVC(FCUnpublish);
+INGEST_SAVC(app);
+INGEST_SAVC(_result);
+INGEST_SAVC(onStatus);
+INGEST_SAVC(fmsVer);
+INGEST_SAVC(capabilities);
+INGEST_SAVC(level);
+INGEST_SAVC(code);
+INGEST_SAVC(description);
+INGEST_SAVC(objectEncoding);
+#undef INGEST_SAVC
+static const AVal av_setDataFrame = AVC("@setDataFrame");
+
+uint64_t NowUs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+bool SendInvokeBody(RTMP* r, int channel, int stream_id, char* body, char* end) {
+    RTMPPacket packet;
+    memset(&packet, 0, sizeof(packet));
+    packet.m_nChannel = channel;
+    packet.m_headerType = RTMP_PACKET_SIZE_MEDIUM;
+    packet.m_packetType = RTMP_PACKET_TYPE_INVOKE;
+    packet.m_nInfoField2 = stream_id;
+    packet.m_body = body;
+    packet.m_nBodySize = (uint32_t)(end - body);
+    return RTMP_SendPacket(r, &packet, FALSE) != 0;
+}
+
+char* EncodeStatusObject(char* p, char* pend, const char* code, const char* description) {
+    AVal status = AVC("status");
+    AVal code_val = {(char*)code, (int)strlen(code)};
+    AVal desc_val = {(char*)description, (int)strlen(description)};
+    *p++ = AMF_OBJECT;
+    p = AMF_EncodeNamedString(p, pend, &av_level, &status);
+    if (!p) {
+        return nullptr;
+    }
+    p = AMF_EncodeNamedString(p, pend, &av_code, &code_val);
+    p = p ? AMF_EncodeNamedString(p, pend, &av_description, &desc_val) : nullptr;
+    if (!p || p + 3 > pend) {
+        return nullptr;
+    }
+    *p++ = 0;
+    *p++ = 0;
+    *p++ = AMF_OBJECT_END;
+    return p;
+}
+
+bool SendConnectResult(RTMP* r, double txn) {
+    char pbuf[512];
+    char* pend = pbuf + sizeof(pbuf);
+    char* body = pbuf + RTMP_MAX_HEADER_SIZE;
+    AVal fms_ver = AVC("FMS/3,5,7,7009");
+    AVal success = AVC("NetConnection.Connect.Success");
+    AVal status = AVC("status");
+    AVal desc = AVC("Connection succeeded.");
+
+    char* p = AMF_EncodeString(body, pend, &av__result);
+    p = p ? AMF_EncodeNumber(p, pend, txn) : nullptr;
+    if (!p) {
+        return false;
+    }
+    *p++ = AMF_OBJECT;
+    p = AMF_EncodeNamedString(p, pend, &av_fmsVer, &fms_ver);
+    p = p ? AMF_EncodeNamedNumber(p, pend, &av_capabilities, 31.0) : nullptr;
+    if (!p || p + 4 > pend) {
+        return false;
+    }
+    *p++ = 0;
+    *p++ = 0;
+    *p++ = AMF_OBJECT_END;
+    *p++ = AMF_OBJECT;
+    p = AMF_EncodeNamedString(p, pend, &av_level, &status);
+    p = p ? AMF_EncodeNamedString(p, pend, &av_code, &success) : nullptr;
+    p = p ? AMF_EncodeNamedString(p, pend, &av_description, &desc) : nullptr;
+    p = p ? AMF_EncodeNamedNumber(p, pend, &av_objectEncoding, 0.0) : nullptr;
+    if (!p || p + 3 > pend) {
+        return false;
+    }
+    *p++ = 0;
+    *p++ = 0;
+    *p++ = AMF_OBJECT_END;
+    return SendInvokeBody(r, kInvokeChannel, 0, body, p);
+}
+
+bool SendCreateStreamResult(RTMP* r, double txn) {
+    char pbuf[256];
+    char* pend = pbuf + sizeof(pbuf);
+    char* body = pbuf + RTMP_MAX_HEADER_SIZE;
+    char* p = AMF_EncodeString(body, pend, &av__result);
+    p = p ? AMF_EncodeNumber(p, pend, txn) : nullptr;
+    if (!p) {
+        return false;
+    }
+    *p++ = AMF_NULL;
+    p = AMF_EncodeNumber(p, pend, (double)kPublishStreamId);
+    if (!p) {
+        return false;
+    }
+    return SendInvokeBody(r, kInvokeChannel, 0, body, p);
+}
+
+bool SendPublishStart(RTMP* r) {
+    char pbuf[512];
+    char* pend = pbuf + sizeof(pbuf);
+    char* body = pbuf + RTMP_MAX_HEADER_SIZE;
+    char* p = AMF_EncodeString(body, pend, &av_onStatus);
+    p = p ? AMF_EncodeNumber(p, pend, 0.0) : nullptr;
+    if (!p) {
+        return false;
+    }
+    *p++ = AMF_NULL;
+    p = EncodeStatusObject(p, pend, "NetStream.Publish.Start", "Start publishing");
+    if (!p) {
+        return false;
+    }
+    return SendInvokeBody(r, kStatusChannel, kPublishStreamId, body, p);
+}
+
+void WriteBE24(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)((v >> 16) & 0xFF);
+    p[1] = (uint8_t)((v >> 8) & 0xFF);
+    p[2] = (uint8_t)(v & 0xFF);
+}
+
+void WriteBE32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)((v >> 24) & 0xFF);
+    p[1] = (uint8_t)((v >> 16) & 0xFF);
+    p[2] = (uint8_t)((v >> 8) & 0xFF);
+    p[3] = (uint8_t)(v & 0xFF);
+}
+
+void WriteFlvFileHeader(std::ofstream& fout) {
+    // "FLV", version 1, audio+video, header size 9, PreviousTagSize0
+    static const uint8_t kHeader[13] = {'F', 'L', 'V', 0x01, 0x05, 0x00, 0x00,
+                                        0x00, 0x09, 0x00, 0x00, 0x00, 0x00};
+    fout.write((const char*)kHeader, sizeof(kHeader));
+}
+
+void WriteFlvTag(std::ofstream& fout, uint8_t tag_type, uint32_t ts_ms, const uint8_t* data,
+                 uint32_t len) {
+    uint8_t header[11];
+    header[0] = tag_type;
+    WriteBE24(header + 1, len);
+    WriteBE24(header + 4, ts_ms & 0xFFFFFF);
+    header[7] = (uint8_t)((ts_ms >> 24) & 0xFF);
+    header[8] = header[9] = header[10] = 0;
+    uint8_t prev_size[4];
+    WriteBE32(prev_size, len + 11);
+    fout.write((const char*)header, sizeof(header));
+    fout.write((const char*)data, len);
+    fout.write((const char*)prev_size, sizeof(prev_size));
+}
+
+} // namespace
+
+struct RtmpIngestServer::Connection {
+    uint32_t id{};
+    int socket{-1};
+    std::thread thread{};
+    std::mutex mtx{};
+    RtmpIngestStreamStats stats{};
+    std::ofstream fout{};
+    // last thing the connection thread does, so joining it afterwards never blocks
+    std::atomic<bool> finished{false};
+};
+
+RtmpIngestServer::RtmpIngestServer() {
+#ifdef _WIN32
+    WSADATA wsa_data;
+    WSAStartup(MAKEWORD(2, 2), &wsa_data);
+#endif
+}
+
+RtmpIngestServer::~RtmpIngestServer() {
+    Stop();
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+void RtmpIngestServer::SetRecordDir(const std::string& record_dir) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    record_dir_ = record_dir;
+}
+
+void RtmpIngestServer::SetPacketCallback(PacketCallback callback) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    callback_ = callback;
+}
+
+bool RtmpIngestServer::Start(uint16_t port) {
+    if (running_) {
+        return true;
+    }
+    int sock = (int)socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (sock < 0) {
+        LOGE(kIngestLogTag) << "socket failed, err=" << GetSockError();
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(sock, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(sock, 16) != 0) {
+        LOGE(kIngestLogTag) << "bind/listen failed, port=" << port << " err=" << GetSockError();
+        closesocket(sock);
+        return false;
+    }
+    socklen_t addr_len = sizeof(addr);
+    if (getsockname(sock, (sockaddr*)&addr, &addr_len) == 0) {
+        port_ = ntohs(addr.sin_port);
+    } else {
+        port_ = port;
+    }
+    listen_socket_ = sock;
+    running_ = true;
+    accept_thread_ = std::thread([this]() { AcceptLoop(); });
+    LOGI(kIngestLogTag) << "listening on port " << port_;
+    return true;
+}
+
+void RtmpIngestServer::Stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    if (accept_thread_.joinable()) {
+        accept_thread_.join();
+    }
+    if (listen_socket_ >= 0) {
+        closesocket(listen_socket_);
+        listen_socket_ = -1;
+    }
+    std::vector<Connection*> conns;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        for (auto& conn : connections_) {
+            conns.push_back(conn.get());
+        }
+    }
+    // Unblock RTMP_ReadPacket on every live connection, then wait for the threads.
+    for (auto conn : conns) {
+        std::lock_guard<std::mutex> lock(conn->mtx);
+        if (conn->socket >= 0) {
+            shutdown(conn->socket, INGEST_SHUT_BOTH);
+        }
+    }
+    for (auto conn : conns) {
+        if (conn->thread.joinable()) {
+            conn->thread.join();
+        }
+    }
+    ReapConnections(true);
+    LOGI(kIngestLogTag) << "stopped, connections=" << conns.size();
+}
+
+uint16_t RtmpIngestServer::GetPort() const {
+    return port_;
+}
+
+std::vector<RtmpIngestStreamStats> RtmpIngestServer::GetStreamStats() {
+    std::vector<RtmpIngestStreamStats> result;
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (auto& conn : connections_) {
+        std::lock_guard<std::mutex> conn_lock(conn->mtx);
+        result.push_back(conn->stats);
+    }
+    result.insert(result.end(), closed_stats_.begin(), closed_stats_.end());
+    return result;
+}
+
+void RtmpIngestServer::AcceptLoop() {
+    while (running_) {
+        ReapConnections(false);
+        fd_set read_set;
+        FD_ZERO(&read_set);
+        FD_SET(listen_socket_, &read_set);
+        struct timeval timeout = {0, 100 * 1000};
+        int n = select(listen_socket_ + 1, &read_set, NULL, NULL, &timeout);
+        if (n <= 0) {
+            continue;
+        }
+        sockaddr_in client_addr;
+        socklen_t size = sizeof(client_addr);
+        int client = (int)accept(listen_socket_, (sockaddr*)&client_addr, &size);
+        if (client < 0) {
+            continue;
+        }
+        int on = 1;
+        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+        std::lock_guard<std::mutex> lock(mtx_);
+        std::unique_ptr<Connection> conn(new Connection());
+        conn->id = next_conn_id_++;
+        conn->socket = client;
+        conn->stats.conn_id = conn->id;
+        Connection* raw = conn.get();
+        connections_.push_back(std::move(conn));
+        raw->thread = std::thread([this, raw]() { ServeConnection(raw); });
+    }
+}
+
+void RtmpIngestServer::ReapConnections(bool all) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (auto it = connections_.begin(); it != connections_.end();) {
+        Connection* conn = it->get();
+        if (!all && !conn->finished) {
+            ++it;
+            continue;
+        }
+        if (conn->thread.joinable()) {
+            conn->thread.join();
+        }
+        closed_stats_.push_back(conn->stats);
+        if (closed_stats_.size() > kMaxClosedStats) {
+            closed_stats_.pop_front();
+        }
+        it = connections_.erase(it);
+    }
+}
+
+void RtmpIngestServer::HandleMediaTag(Connection* conn, const PacketCallback& callback,
+                                      uint8_t tag_type, uint32_t ts_ms, const uint8_t* body,
+                                      uint32_t body_size) {
+    uint64_t now_us = NowUs();
+    {
+        std::lock_guard<std::mutex> lock(conn->mtx);
+        RtmpIngestStreamStats& stats = conn->stats;
+        if (stats.video_tags + stats.audio_tags == 0) {
+            stats.first_ts_ms = ts_ms;
+            stats.first_recv_us = now_us;
+        }
+        if (tag_type == RTMP_PACKET_TYPE_VIDEO) {
+            stats.video_tags++;
+            stats.video_bytes += body_size;
+        } else if (tag_type == RTMP_PACKET_TYPE_AUDIO) {
+            stats.audio_tags++;
+            stats.audio_bytes += body_size;
+        } else {
+            stats.script_tags++;
+        }
+        if (tag_type != RTMP_PACKET_TYPE_INFO) {
+            stats.last_ts_ms = ts_ms;
+            stats.last_recv_us = now_us;
+        }
+        if (conn->fout.is_open()) {
+            WriteFlvTag(conn->fout, tag_type, ts_ms, body, body_size);
+        }
+    }
+    if (callback) {
+        callback(conn->id, tag_type, ts_ms, body, body_size);
+    }
+}
+
+void RtmpIngestServer::ServeConnection(Connection* conn) {
+    std::string record_dir;
+    PacketCallback callback;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        record_dir = record_dir_;
+        callback = callback_;
+    }
+
+    RTMP* r = RTMP_Alloc();
+    RTMP_Init(r);
+    r->m_sb.sb_socket = conn->socket;
+    if (!RTMP_Serve(r)) {
+        LOGW(kIngestLogTag) << "[" << conn->id << "] handshake failed";
+    } else {
+        RTMPPacket packet;
+        memset(&packet, 0, sizeof(packet));
+        while (running_ && RTMP_IsConnected(r) && RTMP_ReadPacket(r, &packet)) {
+            if (!RTMPPacket_IsReady(&packet)) {
+                continue;
+            }
+            const uint8_t* body = (const uint8_t*)packet.m_body;
+            uint32_t body_size = packet.m_nBodySize;
+            switch (packet.m_packetType) {
+            case RTMP_PACKET_TYPE_CHUNK_SIZE:
+                if (body_size >= 4) {
+                    r->m_inChunkSize = AMF_DecodeInt32((const char*)body);
+                }
+                break;
+            case RTMP_PACKET_TYPE_INVOKE: {
+                if (body_size == 0 || body[0] != AMF_STRING) {
+                    break;
+                }
+                AMFObject obj;
+                if (AMF_Decode(&obj, (const char*)body, (int)body_size, FALSE) < 0) {
+                    break;
+                }
+                AVal method = {0};
+                AMFProp_GetString(AMF_GetProp(&obj, NULL, 0), &method);
+                double txn = AMFProp_GetNumber(AMF_GetProp(&obj, NULL, 1));
+                if (AVMATCH(&method, &av_connect)) {
+                    AMFObject cmd;
+                    AVal app = {0};
+                    AMFProp_GetObject(AMF_GetProp(&obj, NULL, 2), &cmd);
+                    AMFProp_GetString(AMF_GetProp(&cmd, &av_app, -1), &app);
+                    {
+                        std::lock_guard<std::mutex> lock(conn->mtx);
+                        conn->stats.app.assign(app.av_val ? app.av_val : "", app.av_len);
+                    }
+                    r->m_nServerBW = 2500000;
+                    r->m_nClientBW = 2500000;
+                    r->m_nClientBW2 = 2;
+                    RTMP_SendServerBW(r);
+                    RTMP_SendClientBW(r);
+                    SendConnectResult(r, txn);
+                } else if (AVMATCH(&method, &av_createStream)) {
+                    SendCreateStreamResult(r, txn);
+                } else if (AVMATCH(&method, &av_publish)) {
+                    AVal name = {0};
+                    AMFProp_GetString(AMF_GetProp(&obj, NULL, 3), &name);
+                    {
+                        std::lock_guard<std::mutex> lock(conn->mtx);
+                        conn->stats.stream_name.assign(name.av_val ? name.av_val : "",
+                                                       name.av_len);
+                        conn->stats.publishing = true;
+                        if (!record_dir.empty()) {
+                            std::string filename = record_dir + "/" + conn->stats.stream_name +
+                                                   "_" + std::to_string(conn->id) + ".flv";
+                            conn->fout.open(filename, std::ios::binary | std::ios::out);
+                            if (conn->fout.is_open()) {
+                                WriteFlvFileHeader(conn->fout);
+                            } else {
+                                LOGW(kIngestLogTag) << "open record file failed: " << filename;
+                            }
+                        }
+                    }
+                    LOGI(kIngestLogTag) << "[" << conn->id << "] publish " << conn->stats.app
+                                        << "/" << conn->stats.stream_name;
+                    SendPublishStart(r);
+                } else if (AVMATCH(&method, &av_deleteStream) ||
+                           AVMATCH(&method, &av_FCUnpublish)) {
+                    std::lock_guard<std::mutex> lock(conn->mtx);
+                    conn->stats.publishing = false;
+                }
+                AMF_Reset(&obj);
+                break;
+            }
+            case RTMP_PACKET_TYPE_AUDIO:
+            case RTMP_PACKET_TYPE_VIDEO:
+            case RTMP_PACKET_TYPE_INFO: {
+                uint32_t ts_ms = packet.m_nTimeStamp;
+                if (packet.m_packetType == RTMP_PACKET_TYPE_INFO) {
+                    // Publishers wrap onMetaData in @setDataFrame; FLV files store it bare.
+                    AVal name = {0};
+                    if (body_size > 3 && body[0] == AMF_STRING) {
+                        AMF_DecodeString((const char*)body + 1, &name);
+                        if (AVMATCH(&name, &av_setDataFrame) &&
+                            body_size > 3u + (uint32_t)name.av_len) {
+                            body += 3 + name.av_len;
+                            body_size -= 3 + name.av_len;
+                        }
+                    }
+                }
+                HandleMediaTag(conn, callback, packet.m_packetType, ts_ms, body, body_size);
+                break;
+            }
+            case RTMP_PACKET_TYPE_FLASH_VIDEO: {
+                // Aggregate message: a run of FLV tags. Sub-tag timestamps are rebased so the
+                // first one matches the aggregate's own timestamp.
+                uint32_t offset = 0;
+                bool first = true;
+                int64_t delta = 0;
+                while (offset + 11 <= body_size) {
+                    const uint8_t* tag = body + offset;
+                    uint32_t size = ((uint32_t)tag[1] << 16) | ((uint32_t)tag[2] << 8) | tag[3];
+                    uint32_t ts = ((uint32_t)tag[7] << 24) | ((uint32_t)tag[4] << 16) |
+                                  ((uint32_t)tag[5] << 8) | tag[6];
+                    if (offset + 11 + size > body_size) {
+                        break;
+                    }
+                    if (first) {
+                        delta = (int64_t)packet.m_nTimeStamp - ts;
+                        first = false;
+                    }
+                    if (tag[0] == RTMP_PACKET_TYPE_AUDIO || tag[0] == RTMP_PACKET_TYPE_VIDEO) {
+                        HandleMediaTag(conn, callback, tag[0], (uint32_t)(ts + delta), tag + 11,
+                                       size);
+                    }
+                    offset += 11 + size + 4; // + PreviousTagSize
+                }
+                break;
+            }
+            default:
+                // acks, user control and peer bandwidth messages need no reply
+                break;
+            }
+            RTMPPacket_Free(&packet);
+        }
+        RTMPPacket_Free(&packet);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(conn->mtx);
+        conn->stats.publishing = false;
+        conn->socket = -1;
+        if (conn->fout.is_open()) {
+            conn->fout.close();
+        }
+    }
+    RTMP_Close(r);
+    RTMP_Free(r);
+    LOGI(kIngestLogTag) << "[" << conn->id << "] closed";
+    conn->finished = true;
+}
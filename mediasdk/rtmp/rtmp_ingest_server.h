@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Minimal in-process RTMP ingest server built on the bundled librtmp.
+// It accepts connect/createStream/publish, parses the incoming FLV tags and keeps
+// per-stream counters, and can optionally remux every publish into an .flv file.
+// Intended for loopback testing and throughput benchmarks of the EasyRTMP publisher.
+
+struct RtmpIngestStreamStats {
+    uint32_t conn_id{};
+    std::string app{};
+    std::string stream_name{};
+    bool publishing{};
+    uint64_t video_tags{};
+    uint64_t audio_tags{};
+    uint64_t script_tags{};
+    uint64_t video_bytes{};
+    uint64_t audio_bytes{};
+    uint32_t first_ts_ms{};
+    uint32_t last_ts_ms{};
+    // steady_clock time (us) of the first/last media tag received
+    uint64_t first_recv_us{};
+    uint64_t last_recv_us{};
+};
+
+class RtmpIngestServer {
+public:
+    // Called on the connection thread for every audio(8)/video(9)/script(18) tag; aggregate
+    // messages are unpacked into their sub-tags first.
+    // data points to the FLV tag body and is only valid during the call.
+    using PacketCallback = std::function<void(uint32_t conn_id, uint8_t tag_type, uint32_t ts_ms,
+                                              const uint8_t* data, uint32_t len)>;
+
+public:
+    RtmpIngestServer();
+    ~RtmpIngestServer();
+    RtmpIngestServer(const RtmpIngestServer&) = delete;
+    RtmpIngestServer& operator=(const RtmpIngestServer&) = delete;
+
+    // Remux each published stream to <record_dir>/<stream>_<conn_id>.flv. Empty disables it.
+    void SetRecordDir(const std::string& record_dir);
+    void SetPacketCallback(PacketCallback callback);
+
+    bool Start(uint16_t port);
+    void Stop();
+
+    uint16_t GetPort() const;
+    // Live connections first, then the last kMaxClosedStats connections that have closed.
+    std::vector<RtmpIngestStreamStats> GetStreamStats();
+
+private:
+    struct Connection;
+
+    static const size_t kMaxClosedStats = 256;
+
+    void AcceptLoop();
+    // Joins and removes closed connections, or with all every connection (threads already
+    // joined), keeping their final stats.
+    void ReapConnections(bool all);
+    void ServeConnection(Connection* conn);
+    void HandleMediaTag(Connection* conn, const PacketCallback& callback, uint8_t tag_type,
+                        uint32_t ts_ms, const uint8_t* body, uint32_t body_size);
+
+private:
+    std::atomic<bool> running_{false};
+    int listen_socket_{-1};
+    uint16_t port_{};
+    std::thread accept_thread_{};
+
+    std::mutex mtx_{};
+    std::vector<std::unique_ptr<Connection>> connections_{};
+    // final stats of reaped connections, oldest first
+    std::deque<RtmpIngestStreamStats> closed_stats_{};
+    uint32_t next_conn_id_{1};
+    std::string record_dir_{};
+    PacketCallback callback_{};
+};
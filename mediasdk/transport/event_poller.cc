@@ -0,0 +1,151 @@
+﻿#include "event_poller.h"
+
+#if defined(__linux__) && !defined(MEDIASDK_USE_POLL)
+#define EVENT_POLLER_EPOLL
+#include <sys/epoll.h>
+#include <unistd.h>
+#else
+#include <chrono>
+#include <thread>
+#include <unordered_map>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#else
+#include <poll.h>
+#endif
+#endif
+
+#ifdef EVENT_POLLER_EPOLL
+
+struct EventPoller::Backend {
+    int epoll_fd{-1};
+    std::vector<epoll_event> events{};
+};
+
+EventPoller::EventPoller() : backend_(new Backend()) {
+    backend_->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    backend_->events.resize(256);
+}
+
+EventPoller::~EventPoller() {
+    if (backend_->epoll_fd >= 0) {
+        close(backend_->epoll_fd);
+    }
+}
+
+bool EventPoller::IsValid() const {
+    return backend_->epoll_fd >= 0;
+}
+
+const char* EventPoller::GetBackendName() const {
+    return "epoll";
+}
+
+bool EventPoller::Add(SocketHandle socket, uint32_t token) {
+    epoll_event event = {};
+    event.events = EPOLLIN | EPOLLRDHUP;
+    event.data.u32 = token;
+    return epoll_ctl(backend_->epoll_fd, EPOLL_CTL_ADD, socket, &event) == 0;
+}
+
+void EventPoller::Remove(SocketHandle socket) {
+    epoll_event event = {};
+    epoll_ctl(backend_->epoll_fd, EPOLL_CTL_DEL, socket, &event);
+}
+
+bool EventPoller::Wait(int timeout_ms, std::vector<uint32_t>& ready) {
+    ready.clear();
+    int n = epoll_wait(backend_->epoll_fd, backend_->events.data(),
+                       (int)backend_->events.size(), timeout_ms);
+    if (n < 0) {
+        return IsSocketRetryError(LastSocketError());
+    }
+    for (int i = 0; i < n; ++i) {
+        ready.push_back(backend_->events[i].data.u32);
+    }
+    if (n == (int)backend_->events.size()) {
+        backend_->events.resize(backend_->events.size() * 2);
+    }
+    return true;
+}
+
+#else
+
+#ifdef _WIN32
+typedef WSAPOLLFD PollEntry;
+#define poll WSAPoll
+#else
+typedef struct pollfd PollEntry;
+#endif
+
+struct EventPoller::Backend {
+    std::vector<PollEntry> fds{};
+    std::vector<uint32_t> tokens{};
+    std::unordered_map<SocketHandle, size_t> index{};
+};
+
+EventPoller::EventPoller() : backend_(new Backend()) {}
+
+EventPoller::~EventPoller() {}
+
+bool EventPoller::IsValid() const {
+    return true;
+}
+
+const char* EventPoller::GetBackendName() const {
+    return "poll";
+}
+
+bool EventPoller::Add(SocketHandle socket, uint32_t token) {
+    if (backend_->index.count(socket)) {
+        return false;
+    }
+    PollEntry entry = {};
+    entry.fd = socket;
+    entry.events = POLLIN;
+    backend_->index[socket] = backend_->fds.size();
+    backend_->fds.push_back(entry);
+    backend_->tokens.push_back(token);
+    return true;
+}
+
+void EventPoller::Remove(SocketHandle socket) {
+    auto it = backend_->index.find(socket);
+    if (it == backend_->index.end()) {
+        return;
+    }
+    // Move the last entry into the hole so the arrays stay dense.
+    const size_t pos = it->second;
+    const size_t last = backend_->fds.size() - 1;
+    if (pos != last) {
+        backend_->fds[pos] = backend_->fds[last];
+        backend_->tokens[pos] = backend_->tokens[last];
+        backend_->index[(SocketHandle)backend_->fds[pos].fd] = pos;
+    }
+    backend_->fds.pop_back();
+    backend_->tokens.pop_back();
+    backend_->index.erase(it);
+}
+
+bool EventPoller::Wait(int timeout_ms, std::vector<uint32_t>& ready) {
+    ready.clear();
+    if (backend_->fds.empty()) {
+        // WSAPoll rejects an empty set.
+        std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms < 0 ? 100 : timeout_ms));
+        return true;
+    }
+    int n = poll(backend_->fds.data(), (unsigned long)backend_->fds.size(), timeout_ms);
+    if (n < 0) {
+        return IsSocketRetryError(LastSocketError());
+    }
+    for (size_t i = 0; i < backend_->fds.size() && n > 0; ++i) {
+        if (backend_->fds[i].revents != 0) {
+            ready.push_back(backend_->tokens[i]);
+            --n;
+        }
+    }
+    return true;
+}
+
+#endif
\ No newline at end of file
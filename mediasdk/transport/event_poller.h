@@ -0,0 +1,35 @@
+﻿#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "socket_utils.h"
+
+// Readiness notification for many sockets on one thread: epoll on Linux, poll()/WSAPoll()
+// everywhere else (or on Linux when built with MEDIASDK_USE_POLL). Sockets are only watched
+// for readability; a hang-up or error is reported as readable so that the following recv
+// sees it. Not thread safe, Add/Remove/Wait belong to the loop thread.
+class EventPoller {
+public:
+    EventPoller();
+    ~EventPoller();
+
+    bool IsValid() const;
+    const char* GetBackendName() const;
+
+    // token comes back from Wait when the socket becomes readable.
+    bool Add(SocketHandle socket, uint32_t token);
+    void Remove(SocketHandle socket);
+
+    // Waits up to timeout_ms (-1 waits forever) and replaces ready with the tokens of the
+    // readable sockets. Returns false on a poller error.
+    bool Wait(int timeout_ms, std::vector<uint32_t>& ready);
+
+private:
+    EventPoller(const EventPoller&) = delete;
+    EventPoller& operator=(const EventPoller&) = delete;
+
+private:
+    struct Backend;
+    std::unique_ptr<Backend> backend_{};
+};
\ No newline at end of file
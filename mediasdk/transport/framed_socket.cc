@@ -0,0 +1,340 @@
+﻿#include "framed_socket.h"
+
+#include <cstring>
+
+#include "common/buffer_pool.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#else
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
+namespace {
+
+const uint32_t kReadAheadSize = 64 * 1024;
+const uint32_t kMinPacketCapacity = 4 * 1024;
+const uint32_t kRecvFramesBudget = 1024 * 1024;
+
+#if defined(_WIN32)
+typedef WSABUF IoSlice;
+void SetIoSlice(IoSlice& slice, const uint8_t* data, uint32_t size) {
+    slice.buf = (CHAR*)data;
+    slice.len = size;
+}
+uint8_t* IoSliceData(const IoSlice& slice) {
+    return (uint8_t*)slice.buf;
+}
+uint32_t IoSliceSize(const IoSlice& slice) {
+    return slice.len;
+}
+#else
+typedef struct iovec IoSlice;
+void SetIoSlice(IoSlice& slice, const uint8_t* data, uint32_t size) {
+    slice.iov_base = (void*)data;
+    slice.iov_len = size;
+}
+uint8_t* IoSliceData(const IoSlice& slice) {
+    return (uint8_t*)slice.iov_base;
+}
+uint32_t IoSliceSize(const IoSlice& slice) {
+    return (uint32_t)slice.iov_len;
+}
+#endif
+
+// Gathers count slices into one send call. Returns the number of bytes written, or -1.
+int64_t SendSlices(SocketHandle socket, IoSlice* slices, size_t count) {
+#ifdef _WIN32
+    DWORD sent = 0;
+    if (WSASend(socket, slices, (DWORD)count, &sent, 0, nullptr, nullptr) != 0) {
+        return -1;
+    }
+    return sent;
+#else
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = slices;
+    msg.msg_iovlen = count;
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL;
+#else
+    const int flags = 0;
+#endif
+    return sendmsg(socket, &msg, flags);
+#endif
+}
+
+int64_t RecvSome(SocketHandle socket, uint8_t* data, uint32_t size) {
+    return recv(socket, (char*)data, (int)size, 0);
+}
+
+uint32_t PacketCapacity(uint32_t size) {
+    uint32_t capacity = kMinPacketCapacity;
+    while (capacity < size) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+} // namespace
+
+FramePacket::FramePacket(uint32_t size) : capacity_(PacketCapacity(size)), size_(size) {
+    BufferPool::GetInstance().GetBufferPool(capacity_).try_dequeue(buffer_);
+    if (!buffer_ || buffer_->GetSize() != capacity_) {
+        buffer_.reset(new Buffer(capacity_));
+    }
+}
+
+FramePacket::~FramePacket() {
+    BufferPool::GetInstance().GetBufferPool(capacity_).enqueue(buffer_);
+}
+
+uint8_t* FramePacket::GetData() {
+    return buffer_->GetData();
+}
+
+uint32_t FramePacket::GetSize() {
+    return size_;
+}
+
+FramedSocket::FramedSocket() : read_ahead_(kReadAheadSize) {}
+
+FramedSocket::FramedSocket(SocketHandle socket) : socket_(socket), read_ahead_(kReadAheadSize) {}
+
+FramedSocket::~FramedSocket() {
+    Close();
+}
+
+void FramedSocket::Attach(SocketHandle socket) {
+    Close();
+    socket_ = socket;
+}
+
+SocketHandle FramedSocket::Detach() {
+    SocketHandle socket = socket_;
+    socket_ = kInvalidSocket;
+    read_pos_ = read_end_ = 0;
+    header_got_ = 0;
+    pending_.reset();
+    pending_got_ = 0;
+    return socket;
+}
+
+SocketHandle FramedSocket::GetSocket() const {
+    return socket_;
+}
+
+bool FramedSocket::IsOpen() const {
+    return socket_ != kInvalidSocket;
+}
+
+void FramedSocket::Close() {
+    CloseSocket(Detach());
+}
+
+bool FramedSocket::Tune(bool no_delay, int send_buffer_size, int recv_buffer_size) {
+    bool ok = SetTcpNoDelay(socket_, no_delay);
+    if (send_buffer_size > 0) {
+        ok = SetSendBufferSize(socket_, send_buffer_size) && ok;
+    }
+    if (recv_buffer_size > 0) {
+        ok = SetRecvBufferSize(socket_, recv_buffer_size) && ok;
+    }
+    return ok;
+}
+
+void FramedSocket::SetMaxFrameSize(uint32_t size) {
+    max_frame_size_ = size;
+}
+
+bool FramedSocket::SendFrame(const uint8_t* data, uint32_t size) {
+    FrameSlice slice = {data, size};
+    return SendFrame(&slice, 1);
+}
+
+bool FramedSocket::SendFrame(const FrameSlice* slices, size_t count) {
+    if (socket_ == kInvalidSocket || count > kMaxSlices) {
+        return false;
+    }
+    uint64_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        total += slices[i].size;
+    }
+    if (total > max_frame_size_) {
+        return false;
+    }
+
+    const uint32_t header = htonl((uint32_t)total);
+    IoSlice io[kMaxSlices + 1];
+    size_t io_count = 0;
+    SetIoSlice(io[io_count++], (const uint8_t*)&header, sizeof(header));
+    for (size_t i = 0; i < count; ++i) {
+        if (slices[i].size > 0) {
+            SetIoSlice(io[io_count++], slices[i].data, slices[i].size);
+        }
+    }
+
+    IoSlice* pending = io;
+    size_t pending_count = io_count;
+    while (pending_count > 0) {
+        int64_t sent = SendSlices(socket_, pending, pending_count);
+        if (sent < 0) {
+            if (IsSocketRetryError(LastSocketError())) {
+                continue;
+            }
+            return false;
+        }
+        // Drop the slices that went out completely and trim the one cut short.
+        while (pending_count > 0 && (uint64_t)sent >= IoSliceSize(*pending)) {
+            sent -= IoSliceSize(*pending);
+            ++pending;
+            --pending_count;
+        }
+        if (pending_count > 0 && sent > 0) {
+            SetIoSlice(*pending, IoSliceData(*pending) + sent,
+                       IoSliceSize(*pending) - (uint32_t)sent);
+        }
+    }
+    return true;
+}
+
+std::shared_ptr<FramePacket> FramedSocket::RecvFrame() {
+    uint32_t header = 0;
+    if (!RecvExact((uint8_t*)&header, sizeof(header))) {
+        return nullptr;
+    }
+    const uint32_t size = ntohl(header);
+    if (size > max_frame_size_) {
+        return nullptr;
+    }
+    std::shared_ptr<FramePacket> packet = std::make_shared<FramePacket>(size);
+    if (!RecvExact(packet->GetData(), size)) {
+        return nullptr;
+    }
+    return packet;
+}
+
+bool FramedSocket::RecvExact(uint8_t* data, uint32_t size) {
+    while (size > 0) {
+        if (read_pos_ < read_end_) {
+            uint32_t n = read_end_ - read_pos_;
+            n = n < size ? n : size;
+            memcpy(data, read_ahead_.data() + read_pos_, n);
+            read_pos_ += n;
+            data += n;
+            size -= n;
+            continue;
+        }
+        // Large remainders bypass the read-ahead buffer to avoid a second copy.
+        if (size >= read_ahead_.size()) {
+            int64_t n = RecvSome(socket_, data, size);
+            if (n <= 0) {
+                if (n < 0 && IsSocketRetryError(LastSocketError())) {
+                    continue;
+                }
+                return false;
+            }
+            data += n;
+            size -= (uint32_t)n;
+            continue;
+        }
+        if (!FillReadAhead()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FramedSocket::FillReadAhead() {
+    if (socket_ == kInvalidSocket) {
+        return false;
+    }
+    while (true) {
+        int64_t n = RecvSome(socket_, read_ahead_.data(), (uint32_t)read_ahead_.size());
+        if (n > 0) {
+            read_pos_ = 0;
+            read_end_ = (uint32_t)n;
+            return true;
+        }
+        if (n < 0 && IsSocketRetryError(LastSocketError())) {
+            continue;
+        }
+        return false;
+    }
+}
+
+bool FramedSocket::RecvFrames(const FrameCallback& on_frame) {
+    uint32_t received = 0;
+    while (received < kRecvFramesBudget) {
+        // The rest of a large payload is read straight into its packet.
+        const bool direct =
+            pending_ && pending_->GetSize() - pending_got_ >= read_ahead_.size();
+        uint8_t* data = direct ? pending_->GetData() + pending_got_ : read_ahead_.data();
+        const uint32_t size =
+            direct ? pending_->GetSize() - pending_got_ : (uint32_t)read_ahead_.size();
+        int64_t n = RecvSome(socket_, data, size);
+        if (n == 0) {
+            return false;
+        }
+        if (n < 0) {
+            const int error = LastSocketError();
+            if (IsSocketRetryError(error)) {
+                continue;
+            }
+            return IsSocketWouldBlockError(error);
+        }
+        received += (uint32_t)n;
+        if (direct) {
+            pending_got_ += (uint32_t)n;
+            if (pending_got_ == pending_->GetSize()) {
+                pending_got_ = 0;
+                on_frame(std::move(pending_));
+                pending_.reset();
+            }
+            continue;
+        }
+        read_pos_ = 0;
+        read_end_ = (uint32_t)n;
+        if (!ConsumeReadAhead(on_frame)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FramedSocket::ConsumeReadAhead(const FrameCallback& on_frame) {
+    while (read_pos_ < read_end_) {
+        if (!pending_) {
+            while (header_got_ < sizeof(header_) && read_pos_ < read_end_) {
+                header_[header_got_++] = read_ahead_[read_pos_++];
+            }
+            if (header_got_ < sizeof(header_)) {
+                return true;
+            }
+            header_got_ = 0;
+            uint32_t size = 0;
+            memcpy(&size, header_, sizeof(size));
+            size = ntohl(size);
+            if (size > max_frame_size_) {
+                return false;
+            }
+            pending_ = std::make_shared<FramePacket>(size);
+            pending_got_ = 0;
+        }
+        uint32_t n = read_end_ - read_pos_;
+        const uint32_t left = pending_->GetSize() - pending_got_;
+        n = n < left ? n : left;
+        memcpy(pending_->GetData() + pending_got_, read_ahead_.data() + read_pos_, n);
+        read_pos_ += n;
+        pending_got_ += n;
+        if (pending_got_ == pending_->GetSize()) {
+            pending_got_ = 0;
+            on_frame(std::move(pending_));
+            pending_.reset();
+        }
+    }
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+﻿#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "socket_utils.h"
+
+class Buffer;
+
+// Payload of one received frame. The backing storage comes from BufferPool, rounded up to a
+// power-of-two size class, and goes back to the pool when the packet is destroyed.
+class FramePacket {
+public:
+    explicit FramePacket(uint32_t size);
+    ~FramePacket();
+
+    uint8_t* GetData();
+    uint32_t GetSize();
+
+private:
+    FramePacket(const FramePacket&) = delete;
+    FramePacket& operator=(const FramePacket&) = delete;
+
+    std::shared_ptr<Buffer> buffer_{};
+    uint32_t capacity_{};
+    uint32_t size_{};
+};
+
+// One piece of a frame for SendFrame; the pieces are sent back to back as a single frame.
+struct FrameSlice {
+    const uint8_t* data;
+    uint32_t size;
+};
+
+using FrameCallback = std::function<void(std::shared_ptr<FramePacket> frame)>;
+
+// Blocking TCP stream carrying length-prefixed frames: a 4-byte big-endian payload size
+// followed by the payload. Sending gathers the header and payload slices into one writev/
+// WSASend call and resumes after partial writes; receiving reads the header through a small
+// read-ahead buffer and the payload straight into a pooled FramePacket.
+// One thread may send while another receives; each direction is not thread safe on its own.
+class FramedSocket {
+public:
+    FramedSocket();
+    explicit FramedSocket(SocketHandle socket);
+    ~FramedSocket();
+
+    // Takes ownership of socket, closing any previous one.
+    void Attach(SocketHandle socket);
+    SocketHandle Detach();
+    SocketHandle GetSocket() const;
+    bool IsOpen() const;
+    void Close();
+
+    // Applies TCP_NODELAY and, when non-zero, SO_SNDBUF/SO_RCVBUF.
+    bool Tune(bool no_delay, int send_buffer_size, int recv_buffer_size);
+
+    // Frames larger than this are rejected by both directions. Defaults to 16 MB.
+    void SetMaxFrameSize(uint32_t size);
+
+    // A failed send may leave part of a frame on the wire; close the connection afterwards.
+    bool SendFrame(const uint8_t* data, uint32_t size);
+    bool SendFrame(const FrameSlice* slices, size_t count);
+
+    // Returns nullptr when the peer closed the connection, on a socket error or when the
+    // announced frame is larger than the maximum frame size.
+    std::shared_ptr<FramePacket> RecvFrame();
+
+    // Non-blocking counterpart of RecvFrame for event loops. Reads what the socket has, at most
+    // about 1 MB per call so that one busy sender cannot starve the others, and hands every
+    // completed frame to on_frame; a frame split across calls is resumed by the next one.
+    // Returns false when the peer closed the connection or on an error. Do not mix RecvFrame
+    // and RecvFrames on one socket.
+    bool RecvFrames(const FrameCallback& on_frame);
+
+private:
+    FramedSocket(const FramedSocket&) = delete;
+    FramedSocket& operator=(const FramedSocket&) = delete;
+
+    bool RecvExact(uint8_t* data, uint32_t size);
+    bool FillReadAhead();
+    bool ConsumeReadAhead(const FrameCallback& on_frame);
+
+private:
+    static const uint32_t kMaxSlices = 15;
+
+    SocketHandle socket_{kInvalidSocket};
+    uint32_t max_frame_size_{16 * 1024 * 1024};
+    std::vector<uint8_t> read_ahead_{};
+    uint32_t read_pos_{};
+    uint32_t read_end_{};
+
+    // Partially received frame of RecvFrames.
+    uint8_t header_[4]{};
+    uint32_t header_got_{};
+    std::shared_ptr<FramePacket> pending_{};
+    uint32_t pending_got_{};
+};
\ No newline at end of file
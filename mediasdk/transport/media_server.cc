@@ -0,0 +1,259 @@
+﻿#include "media_server.h"
+
+#include "common/annexb_scanner.h"
+#include "common/readerwriterqueue.h"
+#include "local_log.h"
+
+namespace {
+
+const uint32_t kListenToken = 0;
+const int kLoopTimeoutMs = 100;
+const int64_t kWorkerWaitUs = 100 * 1000;
+const uint32_t kKeyFrameScanBytes = 1024;
+
+// True when the Annex-B frame carries an SPS or an IDR slice near its start, which is where
+// encoders put them.
+bool IsH264KeyFrame(const uint8_t* data, uint32_t size) {
+    AnnexBScanner scanner(data, size < kKeyFrameScanBytes ? size : kKeyFrameScanBytes);
+    NalUnit nal;
+    while (scanner.Next(nal)) {
+        const uint8_t nal_type = nal.data[0] & 0x1F;
+        if (nal_type == 5 || nal_type == 7) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+struct MediaConnection {
+    MediaConnection(uint32_t connection_id, SocketHandle socket, uint32_t queue_size)
+        : id(connection_id), socket(socket), queue(queue_size) {}
+
+    uint32_t id;
+    FramedSocket socket;
+    moodycamel::BlockingReaderWriterQueue<std::shared_ptr<FramePacket>> queue;
+    std::thread worker{};
+    bool waiting_key_frame{false}; // loop thread only
+    std::atomic<bool> closed{false};
+    std::atomic<bool> finished{false};
+};
+
+MediaServer::MediaServer() {}
+
+MediaServer::~MediaServer() {
+    Stop();
+}
+
+void MediaServer::SetFrameHandler(FrameHandler handler) {
+    frame_handler_ = handler;
+}
+
+void MediaServer::SetConnectionHandler(ConnectionHandler handler) {
+    connection_handler_ = handler;
+}
+
+void MediaServer::SetQueueSize(uint32_t frames) {
+    queue_size_ = frames > 0 ? frames : 1;
+}
+
+bool MediaServer::Start(const std::string& ip, uint16_t port) {
+    if (running_) {
+        return true;
+    }
+    if (!poller_.IsValid()) {
+        LOGE("MediaServer") << "event poller unavailable";
+        return false;
+    }
+    listen_socket_ = ListenTcp(ip, port, 64);
+    if (listen_socket_ == kInvalidSocket) {
+        LOGE("MediaServer") << "listen " << ip << ":" << port << " failed " << LastSocketError();
+        return false;
+    }
+    SetNonBlocking(listen_socket_, true);
+    poller_.Add(listen_socket_, kListenToken);
+    port_ = GetLocalPort(listen_socket_);
+    stopping_ = false;
+    running_ = true;
+    loop_thread_ = std::thread(&MediaServer::LoopThread, this);
+    LOGI("MediaServer") << "listening on " << ip << ":" << port_ << " with "
+                        << poller_.GetBackendName();
+    return true;
+}
+
+void MediaServer::Stop() {
+    if (!running_) {
+        return;
+    }
+    running_ = false;
+    if (loop_thread_.joinable()) {
+        loop_thread_.join();
+    }
+    stopping_ = true;
+    {
+        std::lock_guard<std::mutex> lock(connections_mtx_);
+        for (auto& item : connections_) {
+            item.second->closed = true;
+            poller_.Remove(item.second->socket.GetSocket());
+            closing_.push_back(item.second);
+        }
+        connections_.clear();
+    }
+    ReapConnections(true);
+    poller_.Remove(listen_socket_);
+    CloseSocket(listen_socket_);
+    listen_socket_ = kInvalidSocket;
+    LOGI("MediaServer") << "stopped";
+}
+
+uint16_t MediaServer::GetPort() const {
+    return port_;
+}
+
+const char* MediaServer::GetPollerName() const {
+    return poller_.GetBackendName();
+}
+
+MediaServerStats MediaServer::GetStats() const {
+    MediaServerStats stats;
+    {
+        std::lock_guard<std::mutex> lock(connections_mtx_);
+        stats.connections = (uint32_t)connections_.size();
+    }
+    stats.frames_received = frames_received_;
+    stats.bytes_received = bytes_received_;
+    stats.frames_handled = frames_handled_;
+    stats.frames_dropped = frames_dropped_;
+    return stats;
+}
+
+void MediaServer::LoopThread() {
+    std::vector<uint32_t> ready;
+    while (running_) {
+        if (!poller_.Wait(kLoopTimeoutMs, ready)) {
+            LOGE("MediaServer") << "poll failed " << LastSocketError();
+            break;
+        }
+        for (uint32_t token : ready) {
+            if (token == kListenToken) {
+                AcceptConnections();
+                continue;
+            }
+            std::shared_ptr<MediaConnection> connection;
+            {
+                std::lock_guard<std::mutex> lock(connections_mtx_);
+                auto it = connections_.find(token);
+                if (it != connections_.end()) {
+                    connection = it->second;
+                }
+            }
+            if (connection) {
+                ReadConnection(connection);
+            }
+        }
+        ReapConnections(false);
+    }
+}
+
+void MediaServer::AcceptConnections() {
+    while (true) {
+        SocketHandle socket = AcceptTcp(listen_socket_);
+        if (socket == kInvalidSocket) {
+            return;
+        }
+        SetNonBlocking(socket, true);
+        std::shared_ptr<MediaConnection> connection(
+            new MediaConnection(next_connection_id_++, socket, queue_size_));
+        if (next_connection_id_ == kListenToken) {
+            ++next_connection_id_;
+        }
+        connection->socket.Tune(true, 0, 1024 * 1024);
+        if (!poller_.Add(socket, connection->id)) {
+            LOGE("MediaServer") << "poller add failed " << LastSocketError();
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(connections_mtx_);
+            connections_[connection->id] = connection;
+        }
+        connection->worker = std::thread(&MediaServer::WorkerThread, this, connection.get());
+        LOGI("MediaServer") << "connection " << connection->id << " accepted";
+    }
+}
+
+void MediaServer::ReadConnection(const std::shared_ptr<MediaConnection>& connection) {
+    MediaConnection* conn = connection.get();
+    bool ok = conn->socket.RecvFrames([&](std::shared_ptr<FramePacket> frame) {
+        ++frames_received_;
+        bytes_received_ += frame->GetSize();
+        if (conn->waiting_key_frame && !IsH264KeyFrame(frame->GetData(), frame->GetSize())) {
+            ++frames_dropped_;
+            return;
+        }
+        if (!conn->queue.try_enqueue(std::move(frame))) {
+            // The decoder fell behind; resume at the next key frame so it never sees a
+            // reference chain with holes in it.
+            ++frames_dropped_;
+            conn->waiting_key_frame = true;
+            return;
+        }
+        conn->waiting_key_frame = false;
+    });
+    if (!ok) {
+        CloseConnection(connection);
+    }
+}
+
+void MediaServer::CloseConnection(const std::shared_ptr<MediaConnection>& connection) {
+    poller_.Remove(connection->socket.GetSocket());
+    connection->socket.Close();
+    connection->closed = true;
+    {
+        std::lock_guard<std::mutex> lock(connections_mtx_);
+        connections_.erase(connection->id);
+    }
+    closing_.push_back(connection);
+    LOGI("MediaServer") << "connection " << connection->id << " closed";
+}
+
+void MediaServer::ReapConnections(bool wait) {
+    for (auto it = closing_.begin(); it != closing_.end();) {
+        if (wait || (*it)->finished) {
+            if ((*it)->worker.joinable()) {
+                (*it)->worker.join();
+            }
+            it = closing_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void MediaServer::WorkerThread(MediaConnection* connection) {
+    if (connection_handler_) {
+        connection_handler_(connection->id, true);
+    }
+    std::shared_ptr<FramePacket> frame;
+    while (!stopping_) {
+        if (connection->queue.wait_dequeue_timed(frame, kWorkerWaitUs)) {
+            if (frame_handler_) {
+                frame_handler_(connection->id, frame);
+            }
+            ++frames_handled_;
+            frame.reset();
+            continue;
+        }
+        // Everything was enqueued before closed was set, so an empty queue seen after it is
+        // final.
+        if (connection->closed) {
+            if (connection->queue.size_approx() == 0) {
+                break;
+            }
+        }
+    }
+    if (connection_handler_) {
+        connection_handler_(connection->id, false);
+    }
+    connection->finished = true;
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+﻿#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "event_poller.h"
+#include "framed_socket.h"
+
+struct MediaConnection;
+
+struct MediaServerStats {
+    uint32_t connections;
+    uint64_t frames_received;
+    uint64_t bytes_received;
+    uint64_t frames_handled;
+    uint64_t frames_dropped;
+};
+
+// Accepts any number of senders of length-prefixed H.264 frames (see FramedSocket). One event
+// loop thread reads every connection through an EventPoller; each connection then has a
+// worker thread of its own that hands the frames to the frame handler, so a slow decoder only
+// holds up its own stream. The loop and a worker meet in a bounded per-connection queue: when
+// it is full the frame is dropped and so is everything after it up to the next key frame.
+class MediaServer {
+public:
+    // Both run on the connection's worker thread: the connection handler first with
+    // connected=true, then the frame handler for every frame, and finally the connection
+    // handler with connected=false.
+    using FrameHandler =
+        std::function<void(uint32_t connection_id, const std::shared_ptr<FramePacket>& frame)>;
+    using ConnectionHandler = std::function<void(uint32_t connection_id, bool connected)>;
+
+    MediaServer();
+    ~MediaServer();
+
+    // Must be set before Start.
+    void SetFrameHandler(FrameHandler handler);
+    void SetConnectionHandler(ConnectionHandler handler);
+    void SetQueueSize(uint32_t frames);
+
+    // Port 0 picks a free port, see GetPort.
+    bool Start(const std::string& ip, uint16_t port);
+    // Stops accepting, closes every connection and joins all threads. Frames still queued are
+    // discarded.
+    void Stop();
+
+    uint16_t GetPort() const;
+    const char* GetPollerName() const;
+    MediaServerStats GetStats() const;
+
+private:
+    MediaServer(const MediaServer&) = delete;
+    MediaServer& operator=(const MediaServer&) = delete;
+
+    void LoopThread();
+    void AcceptConnections();
+    void ReadConnection(const std::shared_ptr<MediaConnection>& connection);
+    void CloseConnection(const std::shared_ptr<MediaConnection>& connection);
+    void ReapConnections(bool wait);
+    void WorkerThread(MediaConnection* connection);
+
+private:
+    FrameHandler frame_handler_{};
+    ConnectionHandler connection_handler_{};
+    uint32_t queue_size_{30};
+
+    EventPoller poller_{};
+    SocketHandle listen_socket_{kInvalidSocket};
+    uint16_t port_{};
+    std::thread loop_thread_{};
+    std::atomic<bool> running_{false};
+    std::atomic<bool> stopping_{false};
+
+    // Owned by the loop thread; the mutex only guards the reads made by GetStats.
+    mutable std::mutex connections_mtx_{};
+    std::map<uint32_t, std::shared_ptr<MediaConnection>> connections_{};
+    std::vector<std::shared_ptr<MediaConnection>> closing_{};
+    uint32_t next_connection_id_{1};
+
+    std::atomic<uint64_t> frames_received_{0};
+    std::atomic<uint64_t> bytes_received_{0};
+    std::atomic<uint64_t> frames_handled_{0};
+    std::atomic<uint64_t> frames_dropped_{0};
+};
\ No newline at end of file
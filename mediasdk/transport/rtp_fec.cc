@@ -0,0 +1,340 @@
+﻿#include "rtp_fec.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Media packets the decoder keeps for repairs, and how far back a parity group may start.
+const int64_t kHistoryPackets = 1024;
+
+// Adaptive delta protection is this many parity packets per lost packet, roughly one loss per
+// four groups, which leaves few groups with two losses.
+const double kParityPerLoss = 4.0;
+
+const uint32_t kParameterSetNalTypes = (1u << 7) | (1u << 8);
+const uint32_t kIdrNalType = 1u << 5;
+
+uint16_t Read16(const uint8_t* p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+uint32_t Read32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+void Write16(uint8_t* p, uint16_t value) {
+    p[0] = (uint8_t)(value >> 8);
+    p[1] = (uint8_t)value;
+}
+
+void Write32(uint8_t* p, uint32_t value) {
+    p[0] = (uint8_t)(value >> 24);
+    p[1] = (uint8_t)(value >> 16);
+    p[2] = (uint8_t)(value >> 8);
+    p[3] = (uint8_t)value;
+}
+
+void XorBytes(uint8_t* dst, const uint8_t* src, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        dst[i] ^= src[i];
+    }
+}
+
+uint32_t PacketNalTypes(const std::vector<uint8_t>& packet) {
+    RtpHeader header;
+    if (!ParseRtpHeader(packet.data(), (uint32_t)packet.size(), header)) {
+        return 0;
+    }
+    return GetRtpH264NalTypes(packet.data() + header.header_size, header.payload_size);
+}
+
+} // namespace
+
+RtpFecEncoder::RtpFecEncoder(uint32_t ssrc, uint8_t payload_type, uint16_t first_sequence)
+    : ssrc_(ssrc), payload_type_(payload_type), sequence_(first_sequence) {}
+
+void RtpFecEncoder::SetConfig(const RtpFecConfig& config) {
+    config_ = config;
+    OnLossReport(0);
+}
+
+void RtpFecEncoder::OnLossReport(uint8_t fraction_lost) {
+    const double loss = fraction_lost / 256.0;
+    // Follow a rise at once and a fall slowly; losses come in bursts.
+    loss_ = loss > loss_ ? loss : loss_ * 0.8 + loss * 0.2;
+    delta_percent_ = config_.delta_percent;
+    key_percent_ = config_.key_percent;
+    if (config_.adaptive) {
+        uint32_t delta = (uint32_t)std::ceil(loss_ * kParityPerLoss * 100);
+        delta = delta < config_.max_percent ? delta : config_.max_percent;
+        delta_percent_ = delta > delta_percent_ ? delta : delta_percent_;
+        const uint32_t key = delta_percent_ * 2 < 100 ? delta_percent_ * 2 : 100;
+        key_percent_ = key > key_percent_ ? key : key_percent_;
+    }
+}
+
+uint32_t RtpFecEncoder::GetDeltaPercent() const {
+    return delta_percent_;
+}
+
+uint32_t RtpFecEncoder::GetKeyPercent() const {
+    return key_percent_;
+}
+
+void RtpFecEncoder::AddPacket(const uint8_t* packet, uint32_t size) {
+    if (!config_.enabled || size < kRtpHeaderSize) {
+        return;
+    }
+    if (count_ == packets_.size()) {
+        packets_.emplace_back();
+    }
+    packets_[count_++].assign(packet, packet + size);
+}
+
+void RtpFecEncoder::Flush(const RtpPacketizer::PacketCallback& on_packet) {
+    const size_t count = count_;
+    count_ = 0;
+    if (!config_.enabled || count == 0) {
+        return;
+    }
+    bool key_frame = false;
+    for (size_t i = 0; i < count && !key_frame; ++i) {
+        key_frame = (PacketNalTypes(packets_[i]) & kIdrNalType) != 0;
+    }
+    const uint32_t percent = key_frame ? key_percent_ : delta_percent_;
+
+    const size_t blocks = (count + kRtpFecMaxGroupSpan - 1) / kRtpFecMaxGroupSpan;
+    size_t begin = 0;
+    for (size_t b = 0; b < blocks; ++b) {
+        const size_t end = count * (b + 1) / blocks;
+        const size_t size = end - begin;
+        size_t groups = (size * percent + 99) / 100;
+        groups = groups < size ? groups : size;
+        for (size_t g = 0; g < groups; ++g) {
+            members_.clear();
+            for (size_t i = begin + g; i < end; i += groups) {
+                members_.push_back(i);
+            }
+            EmitParity(members_.data(), members_.size(), on_packet);
+        }
+        begin = end;
+    }
+    if (percent < 100) {
+        // A parity packet over a single member is a copy.
+        for (size_t i = 0; i < count; ++i) {
+            if (PacketNalTypes(packets_[i]) & kParameterSetNalTypes) {
+                EmitParity(&i, 1, on_packet);
+            }
+        }
+    }
+}
+
+void RtpFecEncoder::EmitParity(const size_t* members, size_t count,
+                               const RtpPacketizer::PacketCallback& on_packet) {
+    const uint32_t offset = kRtpHeaderSize + kRtpFecHeaderSize;
+    parity_.assign(offset, 0);
+    const uint8_t* first = packets_[members[0]].data();
+    const uint16_t base = Read16(first + 2);
+    uint32_t mask = 0;
+    uint16_t length = 0;
+    uint8_t byte0 = 0;
+    uint8_t byte1 = 0;
+    uint32_t timestamp = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const std::vector<uint8_t>& packet = packets_[members[i]];
+        const uint32_t payload = (uint32_t)packet.size() - kRtpHeaderSize;
+        mask |= 1u << (31 - (uint16_t)(Read16(packet.data() + 2) - base));
+        length ^= (uint16_t)payload;
+        byte0 ^= packet[0];
+        byte1 ^= packet[1];
+        timestamp ^= Read32(packet.data() + 4);
+        if (parity_.size() < offset + payload) {
+            parity_.resize(offset + payload, 0);
+        }
+        XorBytes(parity_.data() + offset, packet.data() + kRtpHeaderSize, payload);
+    }
+    WriteRtpHeader(parity_.data(), false, payload_type_, sequence_++, Read32(first + 4), ssrc_);
+    uint8_t* header = parity_.data() + kRtpHeaderSize;
+    Write16(header, base);
+    Write32(header + 2, mask);
+    Write16(header + 6, length);
+    header[8] = byte0;
+    header[9] = byte1;
+    Write32(header + 10, timestamp);
+    on_packet(parity_.data(), (uint32_t)parity_.size());
+}
+
+RtpFecDecoder::RtpFecDecoder(uint8_t payload_type) : payload_type_(payload_type) {}
+
+void RtpFecDecoder::InsertPacket(const uint8_t* data, uint32_t size,
+                                 const RtpPacketizer::PacketCallback& on_packet) {
+    RtpHeader header;
+    if (!ParseRtpHeader(data, size, header)) {
+        return;
+    }
+    if (header.payload_type == payload_type_) {
+        if (header.payload_size < kRtpFecHeaderSize || !has_highest_) {
+            return;
+        }
+        ++stats_.parity_received;
+        const uint8_t* payload = data + header.header_size;
+        Parity parity;
+        parity.base = highest_ + (int16_t)(Read16(payload) - (uint16_t)highest_);
+        parity.mask = Read32(payload + 2);
+        parity.ssrc = header.ssrc;
+        parity.payload.assign(payload, payload + header.payload_size);
+        if (parity.mask == 0 || parity.base < highest_ - kHistoryPackets) {
+            return;
+        }
+        parities_.push_back(std::move(parity));
+        Recover(on_packet);
+        return;
+    }
+
+    const int64_t sequence = UnwrapSequence(header.sequence);
+    if (media_.count(sequence)) {
+        // Jitter let the parity overtake this packet and it was rebuilt already. It still
+        // counts as received, or the loss report would drive protection up for no reason.
+        if (rebuilt_sequences_.erase(sequence)) {
+            ++stats_.media_received;
+            ++unique_received_;
+            --stats_.recovered;
+        }
+        return;
+    }
+    ++stats_.media_received;
+    ++unique_received_;
+    if (sequence >= highest_ - kHistoryPackets) {
+        media_[sequence].assign(data, data + size);
+    }
+    on_packet(data, size);
+    Recover(on_packet);
+    Prune();
+}
+
+uint8_t RtpFecDecoder::TakeFractionLost() {
+    const int64_t expected = highest_ - report_highest_;
+    const int64_t received = (int64_t)(unique_received_ - report_received_);
+    report_highest_ = highest_;
+    report_received_ = unique_received_;
+    if (expected <= 0 || received >= expected) {
+        return 0;
+    }
+    const int64_t fraction = (expected - received) * 256 / expected;
+    return (uint8_t)(fraction < 255 ? fraction : 255);
+}
+
+uint32_t RtpFecDecoder::GetCumulativeLost() const {
+    const int64_t lost = has_highest_ ? highest_ - first_sequence_ + 1 - (int64_t)unique_received_
+                                      : 0;
+    return lost > 0 ? (uint32_t)lost : 0;
+}
+
+uint32_t RtpFecDecoder::GetHighestSequence() const {
+    return (uint32_t)highest_;
+}
+
+RtpFecStats RtpFecDecoder::GetStats() const {
+    return stats_;
+}
+
+int64_t RtpFecDecoder::UnwrapSequence(uint16_t sequence) {
+    if (!has_highest_) {
+        has_highest_ = true;
+        highest_ = sequence;
+        first_sequence_ = sequence;
+        report_highest_ = sequence - 1;
+        return highest_;
+    }
+    const int64_t unwrapped = highest_ + (int16_t)(sequence - (uint16_t)highest_);
+    if (unwrapped > highest_) {
+        highest_ = unwrapped;
+    }
+    return unwrapped;
+}
+
+void RtpFecDecoder::Recover(const RtpPacketizer::PacketCallback& on_packet) {
+    // A rebuilt packet may complete another group, so go round until nothing changes.
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        for (auto it = parities_.begin(); it != parities_.end();) {
+            int64_t missing = 0;
+            uint32_t missing_count = 0;
+            for (uint32_t bit = 0; bit < kRtpFecMaxGroupSpan; ++bit) {
+                if ((it->mask & (1u << (31 - bit))) && !media_.count(it->base + bit)) {
+                    missing = it->base + bit;
+                    ++missing_count;
+                }
+            }
+            if (missing_count > 1) {
+                ++it;
+                continue;
+            }
+            if (missing_count == 1 && Rebuild(*it, missing, on_packet)) {
+                progress = true;
+            }
+            it = parities_.erase(it);
+        }
+    }
+}
+
+bool RtpFecDecoder::Rebuild(const Parity& parity, int64_t missing,
+                            const RtpPacketizer::PacketCallback& on_packet) {
+    const uint8_t* header = parity.payload.data();
+    uint16_t length = Read16(header + 6);
+    uint8_t byte0 = header[8];
+    uint8_t byte1 = header[9];
+    uint32_t timestamp = Read32(header + 10);
+    for (uint32_t bit = 0; bit < kRtpFecMaxGroupSpan; ++bit) {
+        const int64_t sequence = parity.base + bit;
+        if (!(parity.mask & (1u << (31 - bit))) || sequence == missing) {
+            continue;
+        }
+        const std::vector<uint8_t>& packet = media_[sequence];
+        length ^= (uint16_t)(packet.size() - kRtpHeaderSize);
+        byte0 ^= packet[0];
+        byte1 ^= packet[1];
+        timestamp ^= Read32(packet.data() + 4);
+    }
+    if (kRtpFecHeaderSize + length > parity.payload.size()) {
+        return false;
+    }
+    rebuilt_.assign(kRtpHeaderSize + length, 0);
+    rebuilt_[0] = byte0;
+    rebuilt_[1] = byte1;
+    Write16(rebuilt_.data() + 2, (uint16_t)missing);
+    Write32(rebuilt_.data() + 4, timestamp);
+    Write32(rebuilt_.data() + 8, parity.ssrc);
+    uint8_t* payload = rebuilt_.data() + kRtpHeaderSize;
+    memcpy(payload, header + kRtpFecHeaderSize, length);
+    for (uint32_t bit = 0; bit < kRtpFecMaxGroupSpan; ++bit) {
+        const int64_t sequence = parity.base + bit;
+        if (!(parity.mask & (1u << (31 - bit))) || sequence == missing) {
+            continue;
+        }
+        const std::vector<uint8_t>& packet = media_[sequence];
+        const size_t size = packet.size() - kRtpHeaderSize;
+        XorBytes(payload, packet.data() + kRtpHeaderSize, size < length ? size : length);
+    }
+    ++stats_.recovered;
+    media_[missing] = rebuilt_;
+    rebuilt_sequences_.insert(missing);
+    on_packet(rebuilt_.data(), (uint32_t)rebuilt_.size());
+    return true;
+}
+
+void RtpFecDecoder::Prune() {
+    const int64_t floor = highest_ - kHistoryPackets;
+    media_.erase(media_.begin(), media_.lower_bound(floor));
+    rebuilt_sequences_.erase(rebuilt_sequences_.begin(), rebuilt_sequences_.lower_bound(floor));
+    for (auto it = parities_.begin(); it != parities_.end();) {
+        if (it->base < floor) {
+            ++stats_.unrecoverable;
+            it = parities_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,123 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "rtp_packetizer.h"
+
+// XOR parity for RTP media packets, after RFC 5109 (ULPFEC) without RED: a parity packet
+// travels in the media SSRC under its own payload type and sequence space, and carries the
+// XOR of the headers and payloads of up to 32 media packets named by a sequence base and a
+// mask. One missing packet per parity group can be rebuilt without waiting a round trip.
+const uint8_t kRtpFecPayloadType = 97;
+const uint32_t kRtpFecHeaderSize = 14;
+const uint32_t kRtpFecMaxGroupSpan = 32;
+
+// Protection is given as parity packets per 100 media packets and is unequal: key frames get
+// key_percent, other frames delta_percent, and packets carrying SPS/PPS are always sent twice,
+// since nothing decodes without them. With adaptive set both ratios follow the loss reported
+// by the receiver and the configured values become the floor.
+struct RtpFecConfig {
+    bool enabled;
+    bool adaptive;
+    uint32_t delta_percent;
+    uint32_t key_percent;
+    uint32_t max_percent; // cap for adaptive delta_percent; key_percent may go up to 100
+};
+
+// Collects the packets of one access unit as they are sent and emits its parity packets on
+// Flush, so that protection never waits for the next frame. Inside a frame, packets are split
+// into blocks of at most kRtpFecMaxGroupSpan and interleaved across the parity groups of each
+// block: packet i goes to group i % groups, which turns a burst into single losses in
+// distinct groups. Not thread safe.
+class RtpFecEncoder {
+public:
+    RtpFecEncoder(uint32_t ssrc, uint8_t payload_type, uint16_t first_sequence);
+
+    void SetConfig(const RtpFecConfig& config);
+
+    // fraction_lost from an RTCP receiver report.
+    void OnLossReport(uint8_t fraction_lost);
+
+    uint32_t GetDeltaPercent() const;
+    uint32_t GetKeyPercent() const;
+
+    void AddPacket(const uint8_t* packet, uint32_t size);
+    void Flush(const RtpPacketizer::PacketCallback& on_packet);
+
+private:
+    void EmitParity(const size_t* members, size_t count,
+                    const RtpPacketizer::PacketCallback& on_packet);
+
+private:
+    uint32_t ssrc_{};
+    uint8_t payload_type_{};
+    uint16_t sequence_{};
+    RtpFecConfig config_{};
+    double loss_{};
+    uint32_t delta_percent_{};
+    uint32_t key_percent_{};
+
+    std::vector<std::vector<uint8_t>> packets_{}; // reused across frames
+    size_t count_{};
+    std::vector<uint8_t> parity_{};
+    std::vector<size_t> members_{};
+};
+
+struct RtpFecStats {
+    uint64_t media_received;
+    uint64_t parity_received;
+    uint64_t recovered;     // rebuilt packets whose original has not turned up since
+    uint64_t unrecoverable; // parity groups that lost more than one packet
+};
+
+// Receive side counterpart of RtpFecEncoder, in front of the jitter buffer. Media packets are
+// passed on at once; parity packets are held until their group is complete or can be repaired,
+// and each rebuilt media packet is passed on as soon as it is. Not thread safe.
+class RtpFecDecoder {
+public:
+    explicit RtpFecDecoder(uint8_t payload_type);
+
+    void InsertPacket(const uint8_t* data, uint32_t size,
+                      const RtpPacketizer::PacketCallback& on_packet);
+
+    // Media packet loss on the wire, before repair, since the previous call, in RTCP
+    // fraction-lost units.
+    uint8_t TakeFractionLost();
+    uint32_t GetCumulativeLost() const;
+    uint32_t GetHighestSequence() const;
+
+    RtpFecStats GetStats() const;
+
+private:
+    struct Parity {
+        int64_t base;
+        uint32_t mask;
+        uint32_t ssrc;
+        std::vector<uint8_t> payload; // FEC header and parity bytes
+    };
+
+    int64_t UnwrapSequence(uint16_t sequence);
+    void Recover(const RtpPacketizer::PacketCallback& on_packet);
+    bool Rebuild(const Parity& parity, int64_t missing,
+                 const RtpPacketizer::PacketCallback& on_packet);
+    void Prune();
+
+private:
+    uint8_t payload_type_{};
+    bool has_highest_{false};
+    int64_t highest_{};                              // highest unwrapped media sequence
+    std::map<int64_t, std::vector<uint8_t>> media_{}; // recent media packets
+    std::set<int64_t> rebuilt_sequences_{};           // entries of media_ rebuilt from parity
+    std::list<Parity> parities_{};
+    std::vector<uint8_t> rebuilt_{};
+
+    int64_t first_sequence_{};
+    uint64_t unique_received_{};
+    int64_t report_highest_{};
+    uint64_t report_received_{};
+    RtpFecStats stats_{};
+};
\ No newline at end of file
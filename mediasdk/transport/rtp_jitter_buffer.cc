@@ -0,0 +1,160 @@
+﻿#include "rtp_jitter_buffer.h"
+
+#include "rtp_packetizer.h"
+
+namespace {
+
+// Bound on buffered packets, about 1.5 s of a 8 Mbit/s stream; beyond it the oldest frame is
+// given up regardless of the latency budget.
+const size_t kMaxPackets = 1500;
+
+// IDR slices and SPS.
+const uint32_t kKeyNalTypes = (1u << 5) | (1u << 7);
+// After a gap the packets in front may have been part of the same access unit, so reassembly
+// only restarts where an access unit visibly begins: an access unit delimiter or an SPS.
+const uint32_t kAccessUnitStartNalTypes = (1u << 9) | (1u << 7);
+
+} // namespace
+
+RtpJitterBuffer::RtpJitterBuffer(uint32_t latency_ms) : latency_ms_(latency_ms) {}
+
+void RtpJitterBuffer::SetLatency(uint32_t latency_ms) {
+    latency_ms_ = latency_ms;
+}
+
+bool RtpJitterBuffer::InsertPacket(const uint8_t* data, uint32_t size, int64_t now_ms) {
+    RtpHeader header;
+    if (!ParseRtpHeader(data, size, header) || header.payload_size == 0) {
+        ++stats_.packets_discarded;
+        return false;
+    }
+    ++stats_.packets_received;
+    const int64_t sequence = UnwrapSequence(header.sequence);
+    if ((has_erased_ && sequence <= erased_through_) || packets_.count(sequence)) {
+        ++stats_.packets_discarded;
+        return false;
+    }
+    const uint8_t* payload = data + header.header_size;
+    Packet& packet = packets_[sequence];
+    packet.timestamp = header.timestamp;
+    packet.marker = header.marker;
+    packet.access_unit_start =
+        IsRtpH264NalStart(payload, header.payload_size) &&
+        (GetRtpH264NalTypes(payload, header.payload_size) & kAccessUnitStartNalTypes) != 0;
+    packet.arrival_ms = now_ms;
+    packet.payload.assign(payload, payload + header.payload_size);
+
+    if (packets_.size() > kMaxPackets) {
+        // Force the head frame out on the next PopFrame.
+        packets_.begin()->second.arrival_ms = now_ms - latency_ms_;
+    }
+    return true;
+}
+
+bool RtpJitterBuffer::PopFrame(int64_t now_ms, RtpFrame& frame) {
+    while (!packets_.empty()) {
+        auto head = packets_.begin();
+        const uint32_t timestamp = head->second.timestamp;
+        const bool starts_frame = has_next_sequence_ ? head->first == next_sequence_
+                                                     : head->second.access_unit_start;
+        int64_t last = -1;
+        if (starts_frame) {
+            int64_t sequence = head->first;
+            for (auto it = head; it != packets_.end() && it->first == sequence &&
+                                 it->second.timestamp == timestamp;
+                 ++it, ++sequence) {
+                if (it->second.marker) {
+                    last = it->first;
+                    break;
+                }
+            }
+        }
+        if (last >= 0) {
+            const bool ok = BuildFrame(head->first, last, frame);
+            EraseThrough(last);
+            next_sequence_ = last + 1;
+            has_next_sequence_ = true;
+            if (!ok || (waiting_key_frame_ && !frame.key_frame)) {
+                ++stats_.frames_dropped;
+                continue;
+            }
+            waiting_key_frame_ = false;
+            ++stats_.frames_output;
+            return true;
+        }
+
+        if (now_ms - head->second.arrival_ms < (int64_t)latency_ms_) {
+            return false;
+        }
+        if (has_next_sequence_ && head->first != next_sequence_) {
+            // The packets in front of the head never came. The head frame may still be whole
+            // if it starts an access unit, so look at it again without continuity.
+            stats_.packets_lost += head->first - next_sequence_;
+            has_next_sequence_ = false;
+            waiting_key_frame_ = true;
+            continue;
+        }
+        // The head frame has holes: drop every packet of it.
+        int64_t expected = head->first;
+        int64_t dropped_through = head->first;
+        for (auto it = head; it != packets_.end() && it->second.timestamp == timestamp; ++it) {
+            stats_.packets_lost += it->first - expected;
+            expected = it->first + 1;
+            dropped_through = it->first;
+        }
+        EraseThrough(dropped_through);
+        ++stats_.frames_dropped;
+        has_next_sequence_ = false;
+        waiting_key_frame_ = true;
+    }
+    return false;
+}
+
+bool RtpJitterBuffer::IsWaitingForKeyFrame() const {
+    return waiting_key_frame_;
+}
+
+RtpJitterStats RtpJitterBuffer::GetStats() const {
+    return stats_;
+}
+
+int64_t RtpJitterBuffer::UnwrapSequence(uint16_t sequence) {
+    if (!has_last_sequence_) {
+        has_last_sequence_ = true;
+        last_sequence_ = sequence;
+        return last_sequence_;
+    }
+    const int64_t unwrapped = last_sequence_ + (int16_t)(sequence - (uint16_t)last_sequence_);
+    if (unwrapped > last_sequence_) {
+        last_sequence_ = unwrapped;
+    }
+    return unwrapped;
+}
+
+bool RtpJitterBuffer::BuildFrame(int64_t first, int64_t last, RtpFrame& frame) {
+    frame.data.clear();
+    frame.key_frame = false;
+    frame.timestamp = packets_[first].timestamp;
+    frame.first_arrival_ms = packets_[first].arrival_ms;
+    bool ok = true;
+    for (auto it = packets_.find(first); it != packets_.end() && it->first <= last; ++it) {
+        const Packet& packet = it->second;
+        ok = AppendRtpH264Payload(packet.payload.data(), (uint32_t)packet.payload.size(),
+                                  frame.data) &&
+             ok;
+        frame.key_frame =
+            frame.key_frame ||
+            (GetRtpH264NalTypes(packet.payload.data(), (uint32_t)packet.payload.size()) &
+             kKeyNalTypes) != 0;
+        if (packet.arrival_ms < frame.first_arrival_ms) {
+            frame.first_arrival_ms = packet.arrival_ms;
+        }
+    }
+    return ok;
+}
+
+void RtpJitterBuffer::EraseThrough(int64_t last) {
+    packets_.erase(packets_.begin(), packets_.upper_bound(last));
+    has_erased_ = true;
+    erased_through_ = last;
+}
\ No newline at end of file
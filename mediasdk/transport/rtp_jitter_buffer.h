@@ -0,0 +1,68 @@
+﻿#pragma once
+#include <cstdint>
+#include <map>
+#include <vector>
+
+struct RtpFrame {
+    std::vector<uint8_t> data; // Annex-B access unit
+    uint32_t timestamp;        // 90 kHz RTP clock
+    bool key_frame;
+    int64_t first_arrival_ms;  // arrival of the earliest packet of the frame
+};
+
+struct RtpJitterStats {
+    uint64_t packets_received;
+    uint64_t packets_lost;      // sequence numbers never seen before their frame was given up
+    uint64_t packets_discarded; // duplicates, late arrivals and unparsable packets
+    uint64_t frames_output;
+    uint64_t frames_dropped;    // incomplete, or waiting for a key frame after a loss
+};
+
+// Reorders H.264 RTP packets by sequence number and reassembles access units. A frame is
+// released as soon as every packet from the end of the previous frame up to its marker bit is
+// present; a frame that stays incomplete for longer than the latency budget is given up, and
+// after that only a key frame that starts with an AUD or SPS is released, so the decoder never
+// sees a broken reference chain or a frame missing its leading NAL units.
+// Not thread safe.
+class RtpJitterBuffer {
+public:
+    explicit RtpJitterBuffer(uint32_t latency_ms);
+
+    void SetLatency(uint32_t latency_ms);
+
+    // Returns false when the packet was discarded.
+    bool InsertPacket(const uint8_t* data, uint32_t size, int64_t now_ms);
+
+    // Pops the next frame in decoding order if it can be released at now_ms.
+    bool PopFrame(int64_t now_ms, RtpFrame& frame);
+
+    // True once a frame has been given up and no key frame has been released since.
+    bool IsWaitingForKeyFrame() const;
+
+    RtpJitterStats GetStats() const;
+
+private:
+    struct Packet {
+        uint32_t timestamp;
+        bool marker;
+        bool access_unit_start; // begins with an AUD or SPS
+        int64_t arrival_ms;
+        std::vector<uint8_t> payload;
+    };
+
+    int64_t UnwrapSequence(uint16_t sequence);
+    bool BuildFrame(int64_t first, int64_t last, RtpFrame& frame);
+    void EraseThrough(int64_t last);
+
+private:
+    uint32_t latency_ms_{};
+    std::map<int64_t, Packet> packets_{}; // keyed by unwrapped sequence number
+    bool has_last_sequence_{false};
+    int64_t last_sequence_{};             // highest unwrapped sequence seen
+    bool has_erased_{false};
+    int64_t erased_through_{};            // packets up to here are gone; later copies are late
+    bool has_next_sequence_{false};
+    int64_t next_sequence_{};             // first sequence of the next frame to release
+    bool waiting_key_frame_{true};
+    RtpJitterStats stats_{};
+};
\ No newline at end of file
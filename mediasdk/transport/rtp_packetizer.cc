@@ -0,0 +1,276 @@
+﻿#include "rtp_packetizer.h"
+
+#include <cstring>
+
+#include "annexb_scanner.h"
+
+namespace {
+
+const uint8_t kNalTypeStapA = 24;
+const uint8_t kNalTypeFuA = 28;
+const uint8_t kStartCode[] = {0, 0, 0, 1};
+
+} // namespace
+
+bool ParseRtpHeader(const uint8_t* data, uint32_t size, RtpHeader& header) {
+    if (size < kRtpHeaderSize || (data[0] >> 6) != 2) {
+        return false;
+    }
+    uint32_t offset = kRtpHeaderSize + (data[0] & 0x0F) * 4;
+    if (data[0] & 0x10) {
+        if (offset + 4 > size) {
+            return false;
+        }
+        offset += 4 + ((data[offset + 2] << 8) | data[offset + 3]) * 4;
+    }
+    uint32_t padding = 0;
+    if (data[0] & 0x20) {
+        padding = data[size - 1];
+    }
+    if (offset + padding > size) {
+        return false;
+    }
+    header.marker = (data[1] & 0x80) != 0;
+    header.payload_type = data[1] & 0x7F;
+    header.sequence = (uint16_t)((data[2] << 8) | data[3]);
+    header.timestamp = ((uint32_t)data[4] << 24) | (data[5] << 16) | (data[6] << 8) | data[7];
+    header.ssrc = ((uint32_t)data[8] << 24) | (data[9] << 16) | (data[10] << 8) | data[11];
+    header.header_size = offset;
+    header.payload_size = size - offset - padding;
+    return true;
+}
+
+void WriteRtpHeader(uint8_t* data, bool marker, uint8_t payload_type, uint16_t sequence,
+                    uint32_t timestamp, uint32_t ssrc) {
+    data[0] = 0x80;
+    data[1] = (uint8_t)((marker ? 0x80 : 0) | (payload_type & 0x7F));
+    data[2] = (uint8_t)(sequence >> 8);
+    data[3] = (uint8_t)sequence;
+    data[4] = (uint8_t)(timestamp >> 24);
+    data[5] = (uint8_t)(timestamp >> 16);
+    data[6] = (uint8_t)(timestamp >> 8);
+    data[7] = (uint8_t)timestamp;
+    data[8] = (uint8_t)(ssrc >> 24);
+    data[9] = (uint8_t)(ssrc >> 16);
+    data[10] = (uint8_t)(ssrc >> 8);
+    data[11] = (uint8_t)ssrc;
+}
+
+void WriteRtcpPli(uint8_t* data, uint32_t sender_ssrc, uint32_t media_ssrc) {
+    data[0] = 0x81; // version 2, FMT 1 (PLI)
+    data[1] = 206;  // payload-specific feedback
+    data[2] = 0;
+    data[3] = 2;    // length in 32-bit words minus one
+    for (int i = 0; i < 4; ++i) {
+        data[4 + i] = (uint8_t)(sender_ssrc >> (24 - 8 * i));
+        data[8 + i] = (uint8_t)(media_ssrc >> (24 - 8 * i));
+    }
+}
+
+bool ParseRtcpPli(const uint8_t* data, uint32_t size, uint32_t& media_ssrc) {
+    if (size < kRtcpPliSize || data[0] != 0x81 || data[1] != 206) {
+        return false;
+    }
+    media_ssrc = ((uint32_t)data[8] << 24) | (data[9] << 16) | (data[10] << 8) | data[11];
+    return true;
+}
+
+void WriteRtcpReceiverReport(uint8_t* data, uint32_t sender_ssrc, uint32_t media_ssrc,
+                             uint8_t fraction_lost, uint32_t cumulative_lost,
+                             uint32_t highest_sequence) {
+    memset(data, 0, kRtcpReceiverReportSize);
+    data[0] = 0x81; // version 2, one report block
+    data[1] = 201;  // receiver report
+    data[3] = 7;    // length in 32-bit words minus one
+    for (int i = 0; i < 4; ++i) {
+        data[4 + i] = (uint8_t)(sender_ssrc >> (24 - 8 * i));
+        data[8 + i] = (uint8_t)(media_ssrc >> (24 - 8 * i));
+        data[16 + i] = (uint8_t)(highest_sequence >> (24 - 8 * i));
+    }
+    data[12] = fraction_lost;
+    // Cumulative lost is a signed 24-bit field.
+    const uint32_t lost = cumulative_lost < 0x7FFFFF ? cumulative_lost : 0x7FFFFF;
+    data[13] = (uint8_t)(lost >> 16);
+    data[14] = (uint8_t)(lost >> 8);
+    data[15] = (uint8_t)lost;
+    // Jitter, LSR and DLSR stay zero.
+}
+
+bool ParseRtcpReceiverReport(const uint8_t* data, uint32_t size, uint32_t& media_ssrc,
+                             uint8_t& fraction_lost) {
+    if (size < kRtcpReceiverReportSize || (data[0] >> 6) != 2 || (data[0] & 0x1F) < 1 ||
+        data[1] != 201) {
+        return false;
+    }
+    media_ssrc = ((uint32_t)data[8] << 24) | (data[9] << 16) | (data[10] << 8) | data[11];
+    fraction_lost = data[12];
+    return true;
+}
+
+RtpPacketizer::RtpPacketizer(uint32_t ssrc, uint8_t payload_type, uint16_t first_sequence)
+    : ssrc_(ssrc), payload_type_(payload_type), sequence_(first_sequence) {
+    packet_.resize(max_packet_size_);
+}
+
+void RtpPacketizer::SetMaxPacketSize(uint32_t size) {
+    // Leaves room for at least the FU indicator, FU header and one byte of payload.
+    max_packet_size_ = size > kRtpHeaderSize + 3 ? size : kRtpHeaderSize + 3;
+    packet_.resize(max_packet_size_);
+}
+
+void RtpPacketizer::Packetize(const uint8_t* data, uint32_t size, uint32_t timestamp,
+                              const PacketCallback& on_packet) {
+    nals_.clear();
+    AnnexBScanner scanner(data, size);
+    NalUnit unit;
+    while (scanner.Next(unit)) {
+        Nal nal = {unit.data, (uint32_t)unit.size};
+        nals_.push_back(nal);
+    }
+
+    const uint32_t max_payload = max_packet_size_ - kRtpHeaderSize;
+    size_t i = 0;
+    while (i < nals_.size()) {
+        if (nals_[i].size > max_payload) {
+            EmitFuA(nals_[i], i + 1 == nals_.size(), timestamp, on_packet);
+            ++i;
+            continue;
+        }
+        // Aggregate as many of the following NAL units as fit into one STAP-A.
+        uint32_t stap_size = 1 + 2 + nals_[i].size;
+        size_t count = 1;
+        while (i + count < nals_.size() && stap_size + 2 + nals_[i + count].size <= max_payload) {
+            stap_size += 2 + nals_[i + count].size;
+            ++count;
+        }
+        const bool marker = i + count == nals_.size();
+        if (count == 1) {
+            EmitSingle(nals_[i], marker, timestamp, on_packet);
+        } else {
+            EmitStapA(&nals_[i], count, marker, timestamp, on_packet);
+        }
+        i += count;
+    }
+}
+
+uint16_t RtpPacketizer::GetNextSequence() const {
+    return sequence_;
+}
+
+void RtpPacketizer::EmitSingle(const Nal& nal, bool marker, uint32_t timestamp,
+                               const PacketCallback& cb) {
+    WriteRtpHeader(packet_.data(), marker, payload_type_, sequence_++, timestamp, ssrc_);
+    memcpy(packet_.data() + kRtpHeaderSize, nal.data, nal.size);
+    cb(packet_.data(), kRtpHeaderSize + nal.size);
+}
+
+void RtpPacketizer::EmitStapA(const Nal* nals, size_t count, bool marker, uint32_t timestamp,
+                              const PacketCallback& cb) {
+    WriteRtpHeader(packet_.data(), marker, payload_type_, sequence_++, timestamp, ssrc_);
+    uint8_t* p = packet_.data() + kRtpHeaderSize;
+    uint8_t forbidden = 0;
+    uint8_t nri = 0;
+    uint8_t* stap_header = p++;
+    for (size_t i = 0; i < count; ++i) {
+        forbidden |= nals[i].data[0] & 0x80;
+        nri = (nals[i].data[0] & 0x60) > nri ? (nals[i].data[0] & 0x60) : nri;
+        *p++ = (uint8_t)(nals[i].size >> 8);
+        *p++ = (uint8_t)nals[i].size;
+        memcpy(p, nals[i].data, nals[i].size);
+        p += nals[i].size;
+    }
+    *stap_header = (uint8_t)(forbidden | nri | kNalTypeStapA);
+    cb(packet_.data(), (uint32_t)(p - packet_.data()));
+}
+
+void RtpPacketizer::EmitFuA(const Nal& nal, bool marker, uint32_t timestamp,
+                            const PacketCallback& cb) {
+    const uint8_t nal_header = nal.data[0];
+    const uint32_t max_fragment = max_packet_size_ - kRtpHeaderSize - 2;
+    // Spread the payload evenly so that the last fragment is not a runt.
+    const uint32_t payload = nal.size - 1;
+    const uint32_t fragments = (payload + max_fragment - 1) / max_fragment;
+    const uint32_t fragment_size = (payload + fragments - 1) / fragments;
+    uint32_t offset = 1;
+    for (uint32_t i = 0; i < fragments; ++i) {
+        const uint32_t n = nal.size - offset < fragment_size ? nal.size - offset : fragment_size;
+        const bool last = i + 1 == fragments;
+        WriteRtpHeader(packet_.data(), marker && last, payload_type_, sequence_++, timestamp,
+                       ssrc_);
+        uint8_t* p = packet_.data() + kRtpHeaderSize;
+        p[0] = (uint8_t)((nal_header & 0xE0) | kNalTypeFuA);
+        p[1] = (uint8_t)((i == 0 ? 0x80 : 0) | (last ? 0x40 : 0) | (nal_header & 0x1F));
+        memcpy(p + 2, nal.data + offset, n);
+        offset += n;
+        cb(packet_.data(), kRtpHeaderSize + 2 + n);
+    }
+}
+
+bool AppendRtpH264Payload(const uint8_t* payload, uint32_t size, std::vector<uint8_t>& out) {
+    if (size < 1) {
+        return false;
+    }
+    const uint8_t type = payload[0] & 0x1F;
+    if (type >= 1 && type <= 23) {
+        out.insert(out.end(), kStartCode, kStartCode + sizeof(kStartCode));
+        out.insert(out.end(), payload, payload + size);
+        return true;
+    }
+    if (type == kNalTypeStapA) {
+        uint32_t pos = 1;
+        while (pos + 2 <= size) {
+            const uint32_t n = (payload[pos] << 8) | payload[pos + 1];
+            pos += 2;
+            if (n == 0 || pos + n > size) {
+                return false;
+            }
+            out.insert(out.end(), kStartCode, kStartCode + sizeof(kStartCode));
+            out.insert(out.end(), payload + pos, payload + pos + n);
+            pos += n;
+        }
+        return true;
+    }
+    if (type == kNalTypeFuA) {
+        if (size < 2) {
+            return false;
+        }
+        if (payload[1] & 0x80) {
+            out.insert(out.end(), kStartCode, kStartCode + sizeof(kStartCode));
+            out.push_back((uint8_t)((payload[0] & 0xE0) | (payload[1] & 0x1F)));
+        }
+        out.insert(out.end(), payload + 2, payload + size);
+        return true;
+    }
+    return false;
+}
+
+bool IsRtpH264NalStart(const uint8_t* payload, uint32_t size) {
+    if (size < 1) {
+        return false;
+    }
+    if ((payload[0] & 0x1F) == kNalTypeFuA) {
+        return size >= 2 && (payload[1] & 0x80) != 0;
+    }
+    return true;
+}
+
+uint32_t GetRtpH264NalTypes(const uint8_t* payload, uint32_t size) {
+    if (size < 1) {
+        return 0;
+    }
+    const uint8_t type = payload[0] & 0x1F;
+    if (type == kNalTypeStapA) {
+        uint32_t types = 0;
+        uint32_t pos = 1;
+        while (pos + 3 <= size) {
+            const uint32_t n = (payload[pos] << 8) | payload[pos + 1];
+            types |= 1u << (payload[pos + 2] & 0x1F);
+            pos += 2 + n;
+        }
+        return types;
+    }
+    if (type == kNalTypeFuA) {
+        return size >= 2 ? 1u << (payload[1] & 0x1F) : 0;
+    }
+    return 1u << type;
+}
\ No newline at end of file
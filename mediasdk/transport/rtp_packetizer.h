@@ -0,0 +1,89 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+const uint32_t kRtpHeaderSize = 12;
+const uint32_t kRtpVideoClockRate = 90000;
+
+// Fixed RTP header (RFC 3550); CSRCs and extensions are skipped by ParseRtpHeader.
+struct RtpHeader {
+    bool marker;
+    uint8_t payload_type;
+    uint16_t sequence;
+    uint32_t timestamp;
+    uint32_t ssrc;
+    uint32_t header_size; // payload starts here
+    uint32_t payload_size;
+};
+
+bool ParseRtpHeader(const uint8_t* data, uint32_t size, RtpHeader& header);
+void WriteRtpHeader(uint8_t* data, bool marker, uint8_t payload_type, uint16_t sequence,
+                    uint32_t timestamp, uint32_t ssrc);
+
+// RTCP picture loss indication (RFC 4585), sent by a receiver that needs a key frame.
+const uint32_t kRtcpPliSize = 12;
+void WriteRtcpPli(uint8_t* data, uint32_t sender_ssrc, uint32_t media_ssrc);
+bool ParseRtcpPli(const uint8_t* data, uint32_t size, uint32_t& media_ssrc);
+
+// RTCP receiver report (RFC 3550) with a single report block. fraction_lost is the share of
+// media packets lost since the previous report in 1/256 units, as seen before any repair.
+const uint32_t kRtcpReceiverReportSize = 32;
+void WriteRtcpReceiverReport(uint8_t* data, uint32_t sender_ssrc, uint32_t media_ssrc,
+                             uint8_t fraction_lost, uint32_t cumulative_lost,
+                             uint32_t highest_sequence);
+bool ParseRtcpReceiverReport(const uint8_t* data, uint32_t size, uint32_t& media_ssrc,
+                             uint8_t& fraction_lost);
+
+// Packetizes H.264 access units in Annex-B form into RTP per RFC 6184, packetization mode 1:
+// NAL units that fit go out alone or, when several small ones fit together (SPS/PPS/SEI in
+// front of an IDR), as one STAP-A; larger ones are cut into FU-A fragments. The last packet of
+// an access unit carries the marker bit. Sequence numbers continue across calls.
+class RtpPacketizer {
+public:
+    using PacketCallback = std::function<void(const uint8_t* packet, uint32_t size)>;
+
+    RtpPacketizer(uint32_t ssrc, uint8_t payload_type, uint16_t first_sequence);
+
+    // Packets, RTP header included, never exceed size bytes. Defaults to 1200 so that they
+    // pass through tunnels without IP fragmentation.
+    void SetMaxPacketSize(uint32_t size);
+
+    // timestamp is in the 90 kHz RTP clock. on_packet sees a buffer that is reused for the
+    // next packet.
+    void Packetize(const uint8_t* data, uint32_t size, uint32_t timestamp,
+                   const PacketCallback& on_packet);
+
+    uint16_t GetNextSequence() const;
+
+private:
+    struct Nal {
+        const uint8_t* data;
+        uint32_t size;
+    };
+
+    void EmitSingle(const Nal& nal, bool marker, uint32_t timestamp, const PacketCallback& cb);
+    void EmitStapA(const Nal* nals, size_t count, bool marker, uint32_t timestamp,
+                   const PacketCallback& cb);
+    void EmitFuA(const Nal& nal, bool marker, uint32_t timestamp, const PacketCallback& cb);
+
+private:
+    uint32_t ssrc_{};
+    uint8_t payload_type_{};
+    uint16_t sequence_{};
+    uint32_t max_packet_size_{1200};
+    std::vector<uint8_t> packet_{};
+    std::vector<Nal> nals_{};
+};
+
+// Appends the NAL units carried by one RTP payload to out as Annex-B. FU-A fragments are
+// appended as they come, with the start code and rebuilt NAL header written for the first
+// one. Returns false for payload types it does not understand (STAP-B, MTAP, FU-B).
+bool AppendRtpH264Payload(const uint8_t* payload, uint32_t size, std::vector<uint8_t>& out);
+
+// True when the payload starts a NAL unit, i.e. it is not an FU-A continuation.
+bool IsRtpH264NalStart(const uint8_t* payload, uint32_t size);
+
+// Bit 1 << nal_unit_type is set for every NAL unit the payload carries a part of.
+uint32_t GetRtpH264NalTypes(const uint8_t* payload, uint32_t size);
\ No newline at end of file
@@ -0,0 +1,176 @@
+﻿#include "rtp_receiver.h"
+
+#include <chrono>
+#include <queue>
+#include <random>
+#include <vector>
+
+#include "local_log.h"
+#include "rtp_packetizer.h"
+
+namespace {
+
+const uint32_t kMaxDatagramSize = 2048;
+const uint32_t kPollIntervalMs = 5;
+const int64_t kPliIntervalMs = 200;
+const int64_t kReportIntervalMs = 500;
+const int kUdpRecvBufferSize = 4 * 1024 * 1024;
+
+int64_t NowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+struct DelayedPacket {
+    int64_t due_ms;
+    uint64_t order;
+    std::vector<uint8_t> data;
+
+    bool operator>(const DelayedPacket& other) const {
+        return due_ms != other.due_ms ? due_ms > other.due_ms : order > other.order;
+    }
+};
+
+} // namespace
+
+RtpReceiver::RtpReceiver() {}
+
+RtpReceiver::~RtpReceiver() {
+    Stop();
+}
+
+void RtpReceiver::SetFrameCallback(FrameCallback callback) {
+    frame_callback_ = callback;
+}
+
+void RtpReceiver::SetLatency(uint32_t latency_ms) {
+    latency_ms_ = latency_ms;
+}
+
+void RtpReceiver::SetNetworkSimulation(const RtpNetworkSimulation& simulation) {
+    simulation_ = simulation;
+}
+
+bool RtpReceiver::Start(const std::string& ip, uint16_t port) {
+    if (running_) {
+        return true;
+    }
+    socket_ = BindUdp(ip, port);
+    if (socket_ == kInvalidSocket) {
+        LOGE("RtpReceiver") << "bind " << ip << ":" << port << " failed " << LastSocketError();
+        return false;
+    }
+    SetRecvBufferSize(socket_, kUdpRecvBufferSize);
+    SetRecvTimeout(socket_, kPollIntervalMs);
+    port_ = GetLocalPort(socket_);
+    running_ = true;
+    receive_thread_ = std::thread(&RtpReceiver::ReceiveThread, this);
+    LOGI("RtpReceiver") << "receiving on " << ip << ":" << port_ << ", latency " << latency_ms_
+                        << " ms";
+    return true;
+}
+
+void RtpReceiver::Stop() {
+    if (!running_) {
+        return;
+    }
+    running_ = false;
+    if (receive_thread_.joinable()) {
+        receive_thread_.join();
+    }
+    CloseSocket(socket_);
+    socket_ = kInvalidSocket;
+}
+
+uint16_t RtpReceiver::GetPort() const {
+    return port_;
+}
+
+RtpJitterStats RtpReceiver::GetStats() const {
+    std::lock_guard<std::mutex> lock(stats_mtx_);
+    return stats_;
+}
+
+RtpFecStats RtpReceiver::GetFecStats() const {
+    std::lock_guard<std::mutex> lock(stats_mtx_);
+    return fec_stats_;
+}
+
+void RtpReceiver::ReceiveThread() {
+    RtpJitterBuffer jitter_buffer(latency_ms_);
+    RtpFecDecoder fec_decoder(kRtpFecPayloadType);
+    int64_t now = 0;
+    const RtpPacketizer::PacketCallback to_jitter_buffer = [&](const uint8_t* packet,
+                                                               uint32_t len) {
+        jitter_buffer.InsertPacket(packet, len, now);
+    };
+    std::vector<uint8_t> datagram(kMaxDatagramSize);
+    std::priority_queue<DelayedPacket, std::vector<DelayedPacket>, std::greater<DelayedPacket>>
+        delayed;
+    const bool simulate =
+        simulation_.loss_percent > 0 || simulation_.delay_ms > 0 || simulation_.jitter_ms > 0;
+    std::mt19937 random(12345);
+    uint64_t order = 0;
+    RtpFrame frame;
+    SocketAddress sender = {};
+    bool has_sender = false;
+    uint32_t sender_ssrc = 0;
+    int64_t last_pli_ms = 0;
+    int64_t last_report_ms = NowMs();
+
+    while (running_) {
+        SocketAddress from;
+        int64_t n = RecvFrom(socket_, datagram.data(), (uint32_t)datagram.size(), &from);
+        now = NowMs();
+        if (n > 0) {
+            RtpHeader header;
+            if (ParseRtpHeader(datagram.data(), (uint32_t)n, header)) {
+                sender = from;
+                sender_ssrc = header.ssrc;
+                has_sender = true;
+            }
+            if (!simulate) {
+                fec_decoder.InsertPacket(datagram.data(), (uint32_t)n, to_jitter_buffer);
+            } else if (random() % 100 >= simulation_.loss_percent) {
+                DelayedPacket packet;
+                packet.due_ms = now + simulation_.delay_ms +
+                                (simulation_.jitter_ms ? random() % (simulation_.jitter_ms + 1) : 0);
+                packet.order = order++;
+                packet.data.assign(datagram.begin(), datagram.begin() + (size_t)n);
+                delayed.push(std::move(packet));
+            }
+        }
+        while (!delayed.empty() && delayed.top().due_ms <= now) {
+            const DelayedPacket& packet = delayed.top();
+            fec_decoder.InsertPacket(packet.data.data(), (uint32_t)packet.data.size(),
+                                     to_jitter_buffer);
+            delayed.pop();
+        }
+        while (jitter_buffer.PopFrame(now, frame)) {
+            if (frame_callback_) {
+                frame_callback_(frame);
+            }
+        }
+        if (has_sender && jitter_buffer.IsWaitingForKeyFrame() &&
+            now - last_pli_ms >= kPliIntervalMs) {
+            uint8_t pli[kRtcpPliSize];
+            WriteRtcpPli(pli, 0, sender_ssrc);
+            SendTo(socket_, pli, sizeof(pli), sender);
+            last_pli_ms = now;
+        }
+        if (has_sender && now - last_report_ms >= kReportIntervalMs) {
+            uint8_t report[kRtcpReceiverReportSize];
+            WriteRtcpReceiverReport(report, 0, sender_ssrc, fec_decoder.TakeFractionLost(),
+                                    fec_decoder.GetCumulativeLost(),
+                                    fec_decoder.GetHighestSequence());
+            SendTo(socket_, report, sizeof(report), sender);
+            last_report_ms = now;
+        }
+        {
+            std::lock_guard<std::mutex> lock(stats_mtx_);
+            stats_ = jitter_buffer.GetStats();
+            fec_stats_ = fec_decoder.GetStats();
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,67 @@
+﻿#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "rtp_fec.h"
+#include "rtp_jitter_buffer.h"
+#include "socket_utils.h"
+
+// Impairments applied to incoming packets before they reach the jitter buffer, to exercise
+// the receive path over loopback. Each packet is dropped with probability loss_percent, and
+// the rest are held for delay_ms plus a uniform random 0..jitter_ms, which also reorders them.
+struct RtpNetworkSimulation {
+    uint32_t loss_percent;
+    uint32_t delay_ms;
+    uint32_t jitter_ms;
+};
+
+// Receives one H.264 RTP stream on a UDP port and hands reassembled Annex-B access units, in
+// decoding order, to the frame callback (typically VideoDecoder::Decode) on its own thread.
+// Parity packets from an FEC-enabled RtpSender repair losses in front of the jitter buffer.
+// While the jitter buffer waits for a key frame after a loss it asks the sender for one with
+// RTCP PLI, at most every 200 ms, and every 500 ms it reports the loss seen on the wire in an
+// RTCP receiver report, which the sender's adaptive FEC follows.
+class RtpReceiver {
+public:
+    using FrameCallback = std::function<void(const RtpFrame& frame)>;
+
+    RtpReceiver();
+    ~RtpReceiver();
+
+    // Must be set before Start.
+    void SetFrameCallback(FrameCallback callback);
+    void SetLatency(uint32_t latency_ms);
+    void SetNetworkSimulation(const RtpNetworkSimulation& simulation);
+
+    // Port 0 picks a free port, see GetPort.
+    bool Start(const std::string& ip, uint16_t port);
+    void Stop();
+
+    uint16_t GetPort() const;
+    RtpJitterStats GetStats() const;
+    RtpFecStats GetFecStats() const;
+
+private:
+    RtpReceiver(const RtpReceiver&) = delete;
+    RtpReceiver& operator=(const RtpReceiver&) = delete;
+
+    void ReceiveThread();
+
+private:
+    FrameCallback frame_callback_{};
+    uint32_t latency_ms_{100};
+    RtpNetworkSimulation simulation_{};
+
+    SocketHandle socket_{kInvalidSocket};
+    uint16_t port_{};
+    std::thread receive_thread_{};
+    std::atomic<bool> running_{false};
+
+    mutable std::mutex stats_mtx_{};
+    RtpJitterStats stats_{};
+    RtpFecStats fec_stats_{};
+};
\ No newline at end of file
@@ -0,0 +1,139 @@
+﻿#include "rtp_sender.h"
+
+#include <random>
+
+#include "local_log.h"
+
+namespace {
+
+const uint8_t kH264PayloadType = 96;
+const int kUdpSendBufferSize = 2 * 1024 * 1024;
+
+} // namespace
+
+RtpSender::RtpSender() {
+    std::random_device random;
+    ssrc_ = random();
+    feedback_.resize(1500);
+}
+
+RtpSender::~RtpSender() {
+    Close();
+}
+
+bool RtpSender::Open(const std::string& ip, uint16_t port) {
+    Close();
+    if (!ParseSocketAddress(ip, port, remote_)) {
+        LOGE("RtpSender") << "bad address " << ip;
+        return false;
+    }
+    socket_ = BindUdp("0.0.0.0", 0);
+    if (socket_ == kInvalidSocket) {
+        LOGE("RtpSender") << "udp socket failed " << LastSocketError();
+        return false;
+    }
+    SetNonBlocking(socket_, true);
+    // A key frame leaves as a burst of packets; let the kernel absorb it.
+    SetSendBufferSize(socket_, kUdpSendBufferSize);
+    std::random_device random;
+    packetizer_.reset(new RtpPacketizer(ssrc_, kH264PayloadType, (uint16_t)random()));
+    fec_encoder_.reset(new RtpFecEncoder(ssrc_, kRtpFecPayloadType, (uint16_t)random()));
+    fec_encoder_->SetConfig(fec_config_);
+    SetMaxPacketSize(max_packet_size_);
+    LOGI("RtpSender") << "sending to " << ip << ":" << port << " ssrc " << ssrc_;
+    return true;
+}
+
+void RtpSender::Close() {
+    CloseSocket(socket_);
+    socket_ = kInvalidSocket;
+    packetizer_.reset();
+    fec_encoder_.reset();
+}
+
+void RtpSender::SetMaxPacketSize(uint32_t size) {
+    max_packet_size_ = size;
+    if (packetizer_) {
+        packetizer_->SetMaxPacketSize(fec_config_.enabled ? size - kRtpFecHeaderSize : size);
+    }
+}
+
+void RtpSender::SetFecConfig(const RtpFecConfig& config) {
+    fec_config_ = config;
+}
+
+void RtpSender::SetKeyFrameRequestCallback(KeyFrameRequestCallback callback) {
+    key_frame_request_callback_ = callback;
+}
+
+bool RtpSender::SendFrame(const uint8_t* data, uint32_t size, int64_t timestamp_us) {
+    if (socket_ == kInvalidSocket) {
+        return false;
+    }
+    PollFeedback();
+    const uint32_t timestamp = (uint32_t)(timestamp_us * (kRtpVideoClockRate / 1000) / 1000);
+    bool ok = true;
+    packetizer_->Packetize(data, size, timestamp, [&](const uint8_t* packet, uint32_t len) {
+        if (SendTo(socket_, packet, len, remote_) < 0) {
+            // Lost like any other datagram; the receiver recovers through a key frame.
+            ++stats_.send_errors;
+            ok = false;
+            return;
+        }
+        ++stats_.packets_sent;
+        stats_.bytes_sent += len;
+        fec_encoder_->AddPacket(packet, len);
+    });
+    fec_encoder_->Flush([&](const uint8_t* packet, uint32_t len) {
+        if (SendTo(socket_, packet, len, remote_) < 0) {
+            ++stats_.send_errors;
+            return;
+        }
+        ++stats_.fec_packets_sent;
+        stats_.fec_bytes_sent += len;
+    });
+    ++stats_.frames_sent;
+    return ok;
+}
+
+uint32_t RtpSender::GetSsrc() const {
+    return ssrc_;
+}
+
+RtpSenderStats RtpSender::GetStats() const {
+    return stats_;
+}
+
+uint32_t RtpSender::GetFecDeltaPercent() const {
+    return fec_encoder_ ? fec_encoder_->GetDeltaPercent() : 0;
+}
+
+uint32_t RtpSender::GetFecKeyPercent() const {
+    return fec_encoder_ ? fec_encoder_->GetKeyPercent() : 0;
+}
+
+void RtpSender::PollFeedback() {
+    bool requested = false;
+    while (true) {
+        int64_t n = RecvFrom(socket_, feedback_.data(), (uint32_t)feedback_.size(), nullptr);
+        if (n < 0) {
+            // Would-block ends the loop; so do ICMP errors reported through the socket.
+            break;
+        }
+        uint32_t media_ssrc = 0;
+        uint8_t fraction_lost = 0;
+        if (ParseRtcpPli(feedback_.data(), (uint32_t)n, media_ssrc) && media_ssrc == ssrc_) {
+            requested = true;
+        } else if (ParseRtcpReceiverReport(feedback_.data(), (uint32_t)n, media_ssrc,
+                                           fraction_lost) &&
+                   media_ssrc == ssrc_) {
+            fec_encoder_->OnLossReport(fraction_lost);
+        }
+    }
+    if (requested) {
+        ++stats_.key_frame_requests;
+        if (key_frame_request_callback_) {
+            key_frame_request_callback_();
+        }
+    }
+}
\ No newline at end of file
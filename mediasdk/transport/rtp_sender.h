@@ -0,0 +1,71 @@
+﻿#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rtp_fec.h"
+#include "rtp_packetizer.h"
+#include "socket_utils.h"
+
+struct RtpSenderStats {
+    uint64_t frames_sent;
+    uint64_t packets_sent;
+    uint64_t bytes_sent;
+    uint64_t send_errors;
+    uint64_t key_frame_requests;
+    uint64_t fec_packets_sent;
+    uint64_t fec_bytes_sent;
+};
+
+// Sends H.264 access units in Annex-B form as RTP over UDP. The receiving RtpReceiver answers
+// losses with RTCP PLI packets on the same socket; they are picked up without blocking on
+// every SendFrame and reported through the key frame request callback, which is where the
+// caller should ask its encoder for an IDR. With FEC enabled each frame is followed by its
+// parity packets, and the receiver reports of the same socket drive the adaptive ratio.
+// Single threaded.
+class RtpSender {
+public:
+    using KeyFrameRequestCallback = std::function<void()>;
+
+    RtpSender();
+    ~RtpSender();
+
+    // Destination of the stream; binds an ephemeral local port.
+    bool Open(const std::string& ip, uint16_t port);
+    void Close();
+
+    void SetMaxPacketSize(uint32_t size);
+    void SetKeyFrameRequestCallback(KeyFrameRequestCallback callback);
+    // Disabled by default. Media packets shrink by kRtpFecHeaderSize when enabled, so that
+    // parity packets stay within the maximum packet size too. Must be set before Open.
+    void SetFecConfig(const RtpFecConfig& config);
+
+    // timestamp_us is the capture time; it is converted to the 90 kHz RTP clock.
+    bool SendFrame(const uint8_t* data, uint32_t size, int64_t timestamp_us);
+
+    uint32_t GetSsrc() const;
+    RtpSenderStats GetStats() const;
+    // Current protection in parity packets per 100 media packets.
+    uint32_t GetFecDeltaPercent() const;
+    uint32_t GetFecKeyPercent() const;
+
+private:
+    RtpSender(const RtpSender&) = delete;
+    RtpSender& operator=(const RtpSender&) = delete;
+
+    void PollFeedback();
+
+private:
+    SocketHandle socket_{kInvalidSocket};
+    SocketAddress remote_{};
+    uint32_t ssrc_{};
+    uint32_t max_packet_size_{1200};
+    std::unique_ptr<RtpPacketizer> packetizer_{};
+    RtpFecConfig fec_config_{};
+    std::unique_ptr<RtpFecEncoder> fec_encoder_{};
+    KeyFrameRequestCallback key_frame_request_callback_{};
+    std::vector<uint8_t> feedback_{};
+    RtpSenderStats stats_{};
+};
\ No newline at end of file
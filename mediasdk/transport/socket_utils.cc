@@ -0,0 +1,253 @@
+﻿#include "socket_utils.h"
+
+#include <cstring>
+#include <mutex>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef _WIN32
+typedef int socklen_t;
+#endif
+
+bool SetOption(SocketHandle socket, int level, int name, const void* value, socklen_t len) {
+    return setsockopt(socket, level, name, (const char*)value, len) == 0;
+}
+
+bool SetTimeoutOption(SocketHandle socket, int name, uint32_t timeout_ms) {
+#ifdef _WIN32
+    DWORD value = timeout_ms;
+#else
+    struct timeval value;
+    value.tv_sec = timeout_ms / 1000;
+    value.tv_usec = (timeout_ms % 1000) * 1000;
+#endif
+    return SetOption(socket, SOL_SOCKET, name, &value, sizeof(value));
+}
+
+sockaddr_in MakeAddress(const std::string& ip, uint16_t port) {
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, ip.empty() ? "0.0.0.0" : ip.c_str(), &addr.sin_addr);
+    return addr;
+}
+
+sockaddr_in ToSockAddr(const SocketAddress& address) {
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(address.ip);
+    addr.sin_port = htons(address.port);
+    return addr;
+}
+
+} // namespace
+
+bool InitSocketLibrary() {
+#ifdef _WIN32
+    static std::once_flag once;
+    static bool ok = false;
+    std::call_once(once, []() {
+        WSADATA wsa_data;
+        ok = WSAStartup(MAKEWORD(2, 2), &wsa_data) == 0;
+    });
+    return ok;
+#else
+    return true;
+#endif
+}
+
+int LastSocketError() {
+#ifdef _WIN32
+    return WSAGetLastError();
+#else
+    return errno;
+#endif
+}
+
+bool IsSocketRetryError(int error) {
+#ifdef _WIN32
+    return error == WSAEINTR;
+#else
+    return error == EINTR;
+#endif
+}
+
+bool IsSocketWouldBlockError(int error) {
+#ifdef _WIN32
+    return error == WSAEWOULDBLOCK;
+#else
+    return error == EAGAIN || error == EWOULDBLOCK;
+#endif
+}
+
+void CloseSocket(SocketHandle socket) {
+    if (socket == kInvalidSocket) {
+        return;
+    }
+#ifdef _WIN32
+    closesocket(socket);
+#else
+    close(socket);
+#endif
+}
+
+void ShutdownSocketSend(SocketHandle socket) {
+    if (socket == kInvalidSocket) {
+        return;
+    }
+#ifdef _WIN32
+    shutdown(socket, SD_SEND);
+#else
+    shutdown(socket, SHUT_WR);
+#endif
+}
+
+bool SetNonBlocking(SocketHandle socket, bool enable) {
+#ifdef _WIN32
+    u_long value = enable ? 1 : 0;
+    return ioctlsocket(socket, FIONBIO, &value) == 0;
+#else
+    int flags = fcntl(socket, F_GETFL, 0);
+    if (flags < 0) {
+        return false;
+    }
+    flags = enable ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+    return fcntl(socket, F_SETFL, flags) == 0;
+#endif
+}
+
+bool SetTcpNoDelay(SocketHandle socket, bool enable) {
+    int value = enable ? 1 : 0;
+    return SetOption(socket, IPPROTO_TCP, TCP_NODELAY, &value, sizeof(value));
+}
+
+bool SetSendBufferSize(SocketHandle socket, int size) {
+    return SetOption(socket, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+}
+
+bool SetRecvBufferSize(SocketHandle socket, int size) {
+    return SetOption(socket, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+}
+
+bool SetSendTimeout(SocketHandle socket, uint32_t timeout_ms) {
+    return SetTimeoutOption(socket, SO_SNDTIMEO, timeout_ms);
+}
+
+bool SetRecvTimeout(SocketHandle socket, uint32_t timeout_ms) {
+    return SetTimeoutOption(socket, SO_RCVTIMEO, timeout_ms);
+}
+
+SocketHandle ConnectTcp(const std::string& ip, uint16_t port) {
+    if (!InitSocketLibrary()) {
+        return kInvalidSocket;
+    }
+    SocketHandle s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == kInvalidSocket) {
+        return kInvalidSocket;
+    }
+    sockaddr_in addr = MakeAddress(ip, port);
+    if (connect(s, (const sockaddr*)&addr, sizeof(addr)) != 0) {
+        CloseSocket(s);
+        return kInvalidSocket;
+    }
+    return s;
+}
+
+SocketHandle ListenTcp(const std::string& ip, uint16_t port, int backlog) {
+    if (!InitSocketLibrary()) {
+        return kInvalidSocket;
+    }
+    SocketHandle s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == kInvalidSocket) {
+        return kInvalidSocket;
+    }
+#ifndef _WIN32
+    int reuse = 1;
+    SetOption(s, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+#endif
+    sockaddr_in addr = MakeAddress(ip, port);
+    if (bind(s, (const sockaddr*)&addr, sizeof(addr)) != 0 || listen(s, backlog) != 0) {
+        CloseSocket(s);
+        return kInvalidSocket;
+    }
+    return s;
+}
+
+SocketHandle AcceptTcp(SocketHandle listen_socket) {
+    while (true) {
+        SocketHandle s = accept(listen_socket, nullptr, nullptr);
+        if (s != kInvalidSocket || !IsSocketRetryError(LastSocketError())) {
+            return s;
+        }
+    }
+}
+
+uint16_t GetLocalPort(SocketHandle socket) {
+    sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    if (getsockname(socket, (sockaddr*)&addr, &len) != 0) {
+        return 0;
+    }
+    return ntohs(addr.sin_port);
+}
+
+SocketHandle BindUdp(const std::string& ip, uint16_t port) {
+    if (!InitSocketLibrary()) {
+        return kInvalidSocket;
+    }
+    SocketHandle s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s == kInvalidSocket) {
+        return kInvalidSocket;
+    }
+    sockaddr_in addr = MakeAddress(ip, port);
+    if (bind(s, (const sockaddr*)&addr, sizeof(addr)) != 0) {
+        CloseSocket(s);
+        return kInvalidSocket;
+    }
+    return s;
+}
+
+bool ParseSocketAddress(const std::string& ip, uint16_t port, SocketAddress& address) {
+    in_addr addr;
+    if (inet_pton(AF_INET, ip.c_str(), &addr) != 1) {
+        return false;
+    }
+    address.ip = ntohl(addr.s_addr);
+    address.port = port;
+    return true;
+}
+
+int64_t SendTo(SocketHandle socket, const uint8_t* data, uint32_t size,
+               const SocketAddress& address) {
+    sockaddr_in addr = ToSockAddr(address);
+    return sendto(socket, (const char*)data, (int)size, 0, (const sockaddr*)&addr, sizeof(addr));
+}
+
+int64_t RecvFrom(SocketHandle socket, uint8_t* data, uint32_t size, SocketAddress* address) {
+    sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    int64_t n = recvfrom(socket, (char*)data, (int)size, 0, (sockaddr*)&addr, &len);
+    if (n >= 0 && address) {
+        address->ip = ntohl(addr.sin_addr.s_addr);
+        address->port = ntohs(addr.sin_port);
+    }
+    return n;
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Portable socket handle; SOCKET on Windows, a file descriptor elsewhere. Kept as a plain
+// integer here so that callers do not have to include winsock2.h before windows.h.
+#ifdef _WIN32
+typedef uintptr_t SocketHandle;
+const SocketHandle kInvalidSocket = ~(uintptr_t)0;
+#else
+typedef int SocketHandle;
+const SocketHandle kInvalidSocket = -1;
+#endif
+
+// IPv4 endpoint in host byte order.
+struct SocketAddress {
+    uint32_t ip;
+    uint16_t port;
+};
+
+// Calls WSAStartup once per process on Windows; a no-op elsewhere.
+bool InitSocketLibrary();
+
+int LastSocketError();
+// True for errors that only mean "try again" (EINTR, and EAGAIN on non-blocking sockets).
+bool IsSocketRetryError(int error);
+// True when a non-blocking socket has nothing to read or no room to write right now.
+bool IsSocketWouldBlockError(int error);
+
+void CloseSocket(SocketHandle socket);
+void ShutdownSocketSend(SocketHandle socket);
+
+bool SetNonBlocking(SocketHandle socket, bool enable);
+bool SetTcpNoDelay(SocketHandle socket, bool enable);
+bool SetSendBufferSize(SocketHandle socket, int size);
+bool SetRecvBufferSize(SocketHandle socket, int size);
+bool SetSendTimeout(SocketHandle socket, uint32_t timeout_ms);
+bool SetRecvTimeout(SocketHandle socket, uint32_t timeout_ms);
+
+// Blocking IPv4 TCP helpers. ConnectTcp/ListenTcp return kInvalidSocket on failure.
+SocketHandle ConnectTcp(const std::string& ip, uint16_t port);
+SocketHandle ListenTcp(const std::string& ip, uint16_t port, int backlog);
+SocketHandle AcceptTcp(SocketHandle listen_socket);
+// Port actually bound, useful after ListenTcp(ip, 0, ...).
+uint16_t GetLocalPort(SocketHandle socket);
+
+// UDP helpers. BindUdp returns kInvalidSocket on failure; SendTo/RecvFrom return the datagram
+// size or -1 (see LastSocketError).
+SocketHandle BindUdp(const std::string& ip, uint16_t port);
+bool ParseSocketAddress(const std::string& ip, uint16_t port, SocketAddress& address);
+int64_t SendTo(SocketHandle socket, const uint8_t* data, uint32_t size,
+               const SocketAddress& address);
+int64_t RecvFrom(SocketHandle socket, uint8_t* data, uint32_t size, SocketAddress* address);
\ No newline at end of file
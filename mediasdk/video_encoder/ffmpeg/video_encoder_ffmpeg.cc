@@ -2,6 +2,7 @@
 
 #include "yuv/libyuv.h"
 
+#include <cstring>
 #include <iostream>
 
 VideoEncoderFFmpeg::VideoEncoderFFmpeg() {}
@@ -23,6 +24,8 @@ void VideoEncoderFFmpeg::EncodeFrame(std::shared_ptr<VideoFrame> video_frame, bo
                       (uint8_t*)frame_->data[1], frame_->linesize[1], (uint8_t*)frame_->data[2],
                       frame_->linesize[2], output_width_, output_height_,
                       libyuv::FilterMode::kFilterBox);
+    frame_->pict_type =
+        NextFrameIsIdr(video_frame, keyframe) ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE;
     AVPacket packet;
     packet.data = NULL; // packet data will be allocated by the encoder
     packet.size = 0;
@@ -60,7 +63,7 @@ bool VideoEncoderFFmpeg::Init() {
     // codec_context_->framerate.num = 25;
     // codec_context_->framerate.den = 1;
 
-    codec_context_->gop_size = INT32_MAX; /* emit one intra frame every ten frames */
+    codec_context_->gop_size = INT32_MAX; /* keyframes are forced by GopController */
     codec_context_->max_b_frames = 0;
     codec_context_->pix_fmt = (enum AVPixelFormat)AV_PIX_FMT_YUV420P;
     codec_context_->qmax = 2;
@@ -71,6 +74,16 @@ bool VideoEncoderFFmpeg::Init() {
     av_dict_set(&options, "preset", "medium", 0);
     av_dict_set(&options, "tune", "zerolatency", 0);
     av_dict_set(&options, "profile", "baseline", 0);
+    // A forced I frame must be an IDR frame, and the codec must not add keyframes of its own.
+    av_dict_set(&options, "forced-idr", "1", 0);
+    av_dict_set(&options, "sc_threshold", "0", 0);
+    const GopConfig gop = gop_.GetConfig();
+    if (gop.intra_refresh && strcmp(av_codec_->name, "libx264") == 0) {
+        // Only libx264 does intra refresh; the refresh cycle takes the place of the GOP.
+        av_dict_set(&options, "intra-refresh", "1", 0);
+        codec_context_->gop_size = (int)gop_.GetIntervalFrames(frame_rate_);
+        intra_refresh_ = true;
+    }
     avcodec_open2(codec_context_, av_codec_, &options);
 
     frame_ = av_frame_alloc();
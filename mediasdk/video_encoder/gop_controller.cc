@@ -0,0 +1,95 @@
+﻿#include "gop_controller.h"
+
+namespace {
+
+// Refresh cycle when intra refresh is on without an interval.
+const uint32_t kDefaultRefreshMs = 2000;
+
+} // namespace
+
+GopController::GopController() {}
+
+void GopController::SetConfig(const GopConfig& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+}
+
+GopConfig GopController::GetConfig() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return config_;
+}
+
+void GopController::RequestKeyframe() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++pending_requests_;
+}
+
+void GopController::HintSceneCut() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    scene_cut_ = true;
+}
+
+void GopController::Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    started_ = false;
+    pending_requests_ = 0;
+    scene_cut_ = false;
+}
+
+bool GopController::NextFrame(uint64_t timestamp_us, uint32_t frame_rate, bool intra_refresh) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t now = timestamp_us;
+    if (started_ && now <= last_us_) {
+        now = last_us_ + 1000000 / (frame_rate > 0 ? frame_rate : 30);
+    }
+    last_us_ = now;
+    ++stats_.frames;
+    const bool scene_cut = scene_cut_;
+    scene_cut_ = false;
+
+    bool idr = false;
+    if (!started_) {
+        started_ = true;
+        idr = true;
+    } else {
+        const uint64_t since_us = now - last_idr_us_;
+        const bool gap_passed = since_us >= (uint64_t)config_.min_keyframe_gap_ms * 1000;
+        const bool periodic_due = !intra_refresh && config_.keyframe_interval_ms > 0 &&
+                                  since_us >= (uint64_t)config_.keyframe_interval_ms * 1000;
+        if (pending_requests_ > 0 && gap_passed) {
+            ++stats_.requested;
+            --pending_requests_;
+            idr = true;
+        } else if (scene_cut && config_.scene_cut && gap_passed) {
+            ++stats_.scene_cuts;
+            idr = true;
+        } else if (periodic_due) {
+            ++stats_.periodic;
+            idr = true;
+        } else if (scene_cut && config_.scene_cut) {
+            ++stats_.scene_cuts_ignored;
+        }
+    }
+    if (!idr) {
+        return false;
+    }
+    // Whatever else was waiting is answered by this frame too.
+    stats_.requests_coalesced += pending_requests_;
+    pending_requests_ = 0;
+    ++stats_.idr_frames;
+    last_idr_us_ = now;
+    return true;
+}
+
+uint32_t GopController::GetIntervalFrames(uint32_t frame_rate) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const uint32_t interval_ms =
+        config_.keyframe_interval_ms > 0 ? config_.keyframe_interval_ms : kDefaultRefreshMs;
+    const uint64_t frames = (uint64_t)interval_ms * frame_rate / 1000;
+    return frames > 1 ? (uint32_t)frames : 1;
+}
+
+GopStats GopController::GetStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
\ No newline at end of file
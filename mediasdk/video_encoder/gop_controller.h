@@ -0,0 +1,65 @@
+﻿#pragma once
+#include <cstdint>
+#include <mutex>
+
+struct GopConfig {
+    // An IDR frame at least this often; 0 leaves keyframes to requests and scene cuts. With
+    // intra refresh this is the length of a refresh cycle instead.
+    uint32_t keyframe_interval_ms{2000};
+    // Requests that come sooner than this after the last IDR frame are held back and answered
+    // together by one IDR frame once the gap has passed, so a burst costs a single keyframe.
+    uint32_t min_keyframe_gap_ms{1000};
+    // Starts a new GOP on HintSceneCut, unless the last IDR frame is more recent than the gap.
+    bool scene_cut{true};
+    // Replaces periodic IDR frames with a column of intra blocks that sweeps the picture once
+    // per cycle, which spreads the keyframe cost over the cycle instead of one large frame.
+    // Encoders without it keep periodic IDR frames. Requests still get IDR frames.
+    bool intra_refresh{false};
+};
+
+struct GopStats {
+    uint64_t frames;
+    uint64_t idr_frames;
+    uint64_t periodic;            // IDR frames due to keyframe_interval_ms
+    uint64_t requested;           // IDR frames that answered requests
+    uint64_t scene_cuts;          // IDR frames started by scene-cut hints
+    uint64_t requests_coalesced;  // requests answered by an IDR frame made for another one
+    uint64_t scene_cuts_ignored;  // hints within the minimum gap
+};
+
+// Decides which frames are coded as IDR frames, the same way for every encoder backend:
+// the first frame, one every keyframe_interval_ms, on request, and at scene cuts, with
+// requests rate limited and coalesced. Backends open their codecs with an infinite GOP and
+// scene-cut detection off, and force the frames this picks. Time comes from the capture
+// timestamps; frames without one are spaced by the frame rate.
+class GopController {
+public:
+    GopController();
+
+    void SetConfig(const GopConfig& config);
+    GopConfig GetConfig();
+    // Both may be called from any thread.
+    void RequestKeyframe();
+    void HintSceneCut();
+    // Starts over, so the next frame is an IDR frame.
+    void Reset();
+
+    // Called on the encoder thread once per frame before it is coded. intra_refresh tells
+    // whether the encoder refreshes on its own, which turns periodic IDR frames off. True if
+    // the frame must be an IDR frame.
+    bool NextFrame(uint64_t timestamp_us, uint32_t frame_rate, bool intra_refresh);
+    // keyframe_interval_ms in frames, for codecs that take the refresh cycle that way.
+    uint32_t GetIntervalFrames(uint32_t frame_rate);
+
+    GopStats GetStats();
+
+private:
+    std::mutex mutex_{};
+    GopConfig config_{};
+    uint32_t pending_requests_{};
+    bool scene_cut_{};
+    bool started_{};
+    uint64_t last_us_{};
+    uint64_t last_idr_us_{};
+    GopStats stats_{};
+};
\ No newline at end of file
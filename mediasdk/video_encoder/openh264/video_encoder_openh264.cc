@@ -6,36 +6,52 @@
 
 VideoEncoderOpenH264::VideoEncoderOpenH264() {
     encode_param_ = new SEncParamExt;
-    picture_ = new SSourcePicture;
 }
 
 VideoEncoderOpenH264::~VideoEncoderOpenH264() {
+    StopPipeline();
     Uninit();
     if (encode_param_) {
         delete encode_param_;
         encode_param_ = nullptr;
     }
-    if (picture_) {
-        delete picture_;
-        picture_ = nullptr;
-    }
 }
 
 void VideoEncoderOpenH264::EncodeFrame(std::shared_ptr<VideoFrame> video_frame, bool keyframe) {
+    EncodeFrameStaged(video_frame, keyframe);
+}
+
+bool VideoEncoderOpenH264::PrepareInput(const std::shared_ptr<VideoFrame>& video_frame,
+                                        bool keyframe, uint32_t slot) {
     int width = video_frame->GetWidth();
     int height = video_frame->GetHeight();
     if (!init_) {
         Init();
     }
-    SFrameBSInfo encoded_frame_info;
-    bool need_scale = (width != output_width_) || (height != output_height_);
+    // OpenH264 has no intra refresh, so it keeps periodic IDR frames.
+    const bool idr = NextFrameIsIdr(video_frame, keyframe);
+    SSourcePicture* picture = pictures_[slot];
     uint8_t* src = video_frame->GetData();
     libyuv::I420Scale(src, width, src + width * height, width >> 1, src + width * height * 5 / 4,
-                      width >> 1, width, height, (uint8_t*)picture_->pData[0], picture_->iStride[0],
-                      (uint8_t*)picture_->pData[1], picture_->iStride[1],
-                      (uint8_t*)picture_->pData[2], picture_->iStride[2], output_width_,
+                      width >> 1, width, height, (uint8_t*)picture->pData[0], picture->iStride[0],
+                      (uint8_t*)picture->pData[1], picture->iStride[1],
+                      (uint8_t*)picture->pData[2], picture->iStride[2], output_width_,
                       output_height_, libyuv::FilterMode::kFilterBox);
-    int err = encoder_->EncodeFrame(picture_, &encoded_frame_info);
+    // OpenH264 takes no QP map; its screen-content mode finds the static macroblocks itself,
+    // so only unchanged screens are dropped here.
+    if (screen_content_ && !KeepScreenFrame(video_frame, picture->pData[0], idr)) {
+        return false;
+    }
+    force_idr_[slot] = idr;
+    return true;
+}
+
+void VideoEncoderOpenH264::EncodeInput(uint32_t slot) {
+    if (force_idr_[slot]) {
+        encoder_->ForceIntraFrame(true);
+    }
+    SFrameBSInfo encoded_frame_info;
+    int err = encoder_->EncodeFrame(pictures_[slot], &encoded_frame_info);
     if (encoded_frame_info.eFrameType == videoFrameTypeInvalid) {
         return;
     }
@@ -83,25 +99,39 @@ bool VideoEncoderOpenH264::Init() {
     encode_param_->iEntropyCodingModeFlag = 0; // 1;
     // encode_param_->bEnablePsnr = false;
     encode_param_->bEnableSSEI = true;
-    encode_param_->bEnableSceneChangeDetect = true;
+    // Keyframes are GopController's; its scene-cut hints replace OpenH264's detection.
+    encode_param_->bEnableSceneChangeDetect = false;
     // 设置QP，可以根据自己的需要来，QP越大码率越小（图像的质量越差）
     encode_param_->iMaxQp = 40;
     encode_param_->iMinQp = 30;
     encode_param_->uiIntraPeriod = UINT32_MAX;
     encode_param_->bEnableFrameSkip = false;
+    screen_content_ = screen_.GetConfig().enabled;
+    if (screen_content_) {
+        encode_param_->iUsageType = SCREEN_CONTENT_REAL_TIME;
+        encode_param_->bEnableBackgroundDetection = true;
+    }
     encoder_->InitializeExt(encode_param_);
 
-    memset(picture_, 0, sizeof(SSourcePicture));
-    picture_->iPicWidth = output_width_;
-    picture_->iPicHeight = output_height_;
+    const int picture_size = output_width_ * output_height_ * 3 / 2;
+    pictures_.resize(GetInputSlots());
+    force_idr_.assign(pictures_.size(), 0);
+    picture_buffer_ = new uint8_t[picture_size * pictures_.size()];
+    for (size_t slot = 0; slot < pictures_.size(); ++slot) {
+        SSourcePicture* picture = new SSourcePicture;
+        memset(picture, 0, sizeof(SSourcePicture));
+        picture->iPicWidth = output_width_;
+        picture->iPicHeight = output_height_;
 
-    picture_->iColorFormat = videoFormatI420;
-    picture_->iStride[0] = picture_->iPicWidth;
-    picture_->iStride[1] = picture_->iStride[2] = picture_->iPicWidth >> 1;
-    picture_buffer_ = new uint8_t[picture_->iPicWidth * picture_->iPicHeight * 3 / 2];
-    picture_->pData[0] = (unsigned char*)picture_buffer_;
-    picture_->pData[1] = picture_buffer_ + picture_->iPicWidth * picture_->iPicHeight;
-    picture_->pData[2] = picture_buffer_ + (picture_->iPicWidth * picture_->iPicHeight * 5 / 4);
+        picture->iColorFormat = videoFormatI420;
+        picture->iStride[0] = picture->iPicWidth;
+        picture->iStride[1] = picture->iStride[2] = picture->iPicWidth >> 1;
+        uint8_t* buffer = picture_buffer_ + picture_size * slot;
+        picture->pData[0] = (unsigned char*)buffer;
+        picture->pData[1] = buffer + picture->iPicWidth * picture->iPicHeight;
+        picture->pData[2] = buffer + (picture->iPicWidth * picture->iPicHeight * 5 / 4);
+        pictures_[slot] = picture;
+    }
 
     init_ = true;
     return true;
@@ -114,6 +144,10 @@ bool VideoEncoderOpenH264::Uninit() {
         WelsDestroySVCEncoder(encoder_);
         encoder_ = NULL;
     }
+    for (SSourcePicture* picture : pictures_) {
+        delete picture;
+    }
+    pictures_.clear();
     if (picture_buffer_) {
         delete[] picture_buffer_;
         picture_buffer_ = nullptr;
@@ -14,17 +14,25 @@ public:
 
     void EncodeFrame(std::shared_ptr<VideoFrame> video_frame, bool keyframe) override;
 
+protected:
+    bool PrepareInput(const std::shared_ptr<VideoFrame>& video_frame, bool keyframe,
+                      uint32_t slot) override;
+    void EncodeInput(uint32_t slot) override;
+
 private:
     bool Init();
     bool Uninit();
 
 private:
     bool init_{};
+    bool screen_content_{};
     std::vector<uint8_t> buffer_{};
     uint32_t buffer_size_{};
 
     ISVCEncoder* encoder_{};
     TagEncParamExt* encode_param_{};
-    Source_Picture_s* picture_{};
+    // One picture per pipeline slot, all in picture_buffer_, and whether it is an IDR frame.
+    std::vector<Source_Picture_s*> pictures_{};
+    std::vector<uint8_t> force_idr_{};
     uint8_t* picture_buffer_{};
 };
\ No newline at end of file
@@ -1,5 +1,7 @@
 ﻿#include "video_encoder_qsv.h"
 
+#include <algorithm>
+
 #include "yuv/libyuv.h"
 
 VideoEncoderQSV::VideoEncoderQSV() {}
@@ -82,7 +84,7 @@ void VideoEncoderQSV::EncodeFrame(std::shared_ptr<VideoFrame> video_frame, bool
         status = mfx_frame_allocator_->Unlock(mfx_frame_allocator_->pthis, surface.Data.MemId,
                                               &(surface.Data));
     }
-    if (keyframe) {
+    if (NextFrameIsIdr(video_frame, keyframe)) {
         encode_ctrl_.FrameType = MFX_FRAMETYPE_I | MFX_FRAMETYPE_IDR | MFX_FRAMETYPE_REF;
     } else {
         encode_ctrl_.FrameType = MFX_FRAMETYPE_UNKNOWN;
@@ -200,7 +202,7 @@ mfxStatus VideoEncoderQSV::InitEnocdeParams() {
     encode_param_.mfx.RateControlMethod = MFX_RATECONTROL_CBR; // CBR for more consistent bitrate and lower latency
     encode_param_.AsyncDepth = 1;
     encode_param_.mfx.GopPicSize = UINT16_MAX;
-    static mfxExtBuffer* extendedBuffers[1];
+    static mfxExtBuffer* extendedBuffers[2];
     encode_param_.mfx.NumRefFrame = 1;
     encode_param_.mfx.GopRefDist = 1;
     memset(&coding_opt_, 0, sizeof(mfxExtCodingOption));
@@ -210,6 +212,20 @@ mfxStatus VideoEncoderQSV::InitEnocdeParams() {
     extendedBuffers[0] = (mfxExtBuffer*)&coding_opt_;
     encode_param_.ExtParam = extendedBuffers;
     encode_param_.NumExtParam = 1;
+    // Keyframes are forced by GopController; with intra refresh a vertical refresh column
+    // sweeps the picture once per cycle instead.
+    const GopConfig gop = gop_.GetConfig();
+    if (gop.intra_refresh) {
+        memset(&coding_opt2_, 0, sizeof(mfxExtCodingOption2));
+        coding_opt2_.Header.BufferId = MFX_EXTBUFF_CODING_OPTION2;
+        coding_opt2_.Header.BufferSz = sizeof(mfxExtCodingOption2);
+        coding_opt2_.IntRefType = MFX_REFRESH_VERTICAL;
+        coding_opt2_.IntRefCycleSize = (mfxU16)std::min<uint32_t>(
+            gop_.GetIntervalFrames(frame_rate_), UINT16_MAX);
+        extendedBuffers[1] = (mfxExtBuffer*)&coding_opt2_;
+        encode_param_.NumExtParam = 2;
+    }
+    intra_refresh_ = gop.intra_refresh;
     encode_param_.mfx.FrameInfo.Width = MSDK_ALIGN16(output_width_);
     encode_param_.mfx.FrameInfo.Height = MSDK_ALIGN16(output_height_);
     if (mem_type_ == kMemTypeSystem) {
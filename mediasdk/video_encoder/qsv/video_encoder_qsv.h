@@ -50,6 +50,7 @@ private:
     mfxVideoParam encode_param_{};
     uint32_t surface_nums_{};
     mfxExtCodingOption coding_opt_{};
+    mfxExtCodingOption2 coding_opt2_{};
     mfxBitstream output_bitstream_{};
     mfxSyncPoint sync_point_{};
     mfxEncodeCtrl encode_ctrl_{};
@@ -0,0 +1,164 @@
+﻿#include "screen_content_analyzer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const uint32_t kMbSize = 16;
+
+inline bool ChunkDiffers(const uint8_t* a, const uint8_t* b, uint32_t size) {
+    if (size == 16) {
+        uint64_t x[2];
+        uint64_t y[2];
+        memcpy(x, a, 16);
+        memcpy(y, b, 16);
+        return ((x[0] ^ y[0]) | (x[1] ^ y[1])) != 0;
+    }
+    if (size == 8) {
+        uint64_t x;
+        uint64_t y;
+        memcpy(&x, a, 8);
+        memcpy(&y, b, 8);
+        return x != y;
+    }
+    return memcmp(a, b, size) != 0;
+}
+
+} // namespace
+
+ScreenContentAnalyzer::ScreenContentAnalyzer() {}
+
+void ScreenContentAnalyzer::SetConfig(const ScreenContentConfig& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+    has_previous_ = false;
+}
+
+ScreenContentConfig ScreenContentAnalyzer::GetConfig() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return config_;
+}
+
+void ScreenContentAnalyzer::Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    has_previous_ = false;
+}
+
+bool ScreenContentAnalyzer::Analyze(const uint8_t* y, int stride_y, const uint8_t* u,
+                                    int stride_u, const uint8_t* v, int stride_v,
+                                    uint32_t width, uint32_t height, uint64_t timestamp_us,
+                                    uint32_t frame_rate, bool keep) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t now = timestamp_us;
+    if (has_previous_ && now <= last_us_) {
+        now = last_us_ + 1000000 / (frame_rate > 0 ? frame_rate : 30);
+    }
+    last_us_ = now;
+    ++stats_.frames;
+
+    const uint32_t chroma_width = (width + 1) / 2;
+    const uint32_t chroma_height = (height + 1) / 2;
+    const size_t luma_size = (size_t)width * height;
+    const size_t chroma_size = (size_t)chroma_width * chroma_height;
+    if (width != width_ || height != height_) {
+        width_ = width;
+        height_ = height;
+        mb_width_ = (width + kMbSize - 1) / kMbSize;
+        mb_height_ = (height + kMbSize - 1) / kMbSize;
+        previous_.assign(luma_size + 2 * chroma_size, 0);
+        changed_.assign((size_t)mb_width_ * mb_height_, 1);
+        quant_offsets_.assign(changed_.size(), 0.0f);
+        has_previous_ = false;
+    }
+    uint8_t* prev_y = previous_.data();
+    uint8_t* prev_u = prev_y + luma_size;
+    uint8_t* prev_v = prev_u + chroma_size;
+    if (!has_previous_) {
+        for (uint32_t row = 0; row < height; ++row) {
+            memcpy(prev_y + (size_t)row * width, y + (size_t)row * stride_y, width);
+        }
+        for (uint32_t row = 0; row < chroma_height; ++row) {
+            memcpy(prev_u + (size_t)row * chroma_width, u + (size_t)row * stride_u, chroma_width);
+            memcpy(prev_v + (size_t)row * chroma_width, v + (size_t)row * stride_v, chroma_width);
+        }
+        std::fill(changed_.begin(), changed_.end(), 1);
+        has_previous_ = true;
+    } else {
+        std::fill(changed_.begin(), changed_.end(), 0);
+        DiffPlane(y, stride_y, prev_y, width, height, kMbSize);
+        DiffPlane(u, stride_u, prev_u, chroma_width, chroma_height, kMbSize / 2);
+        DiffPlane(v, stride_v, prev_v, chroma_width, chroma_height, kMbSize / 2);
+    }
+
+    // Macroblocks next to a change keep their QP too, so edges of the change do not show.
+    uint64_t changed_count = 0;
+    std::fill(quant_offsets_.begin(), quant_offsets_.end(), config_.static_qp_offset);
+    for (uint32_t my = 0; my < mb_height_; ++my) {
+        for (uint32_t mx = 0; mx < mb_width_; ++mx) {
+            if (!changed_[(size_t)my * mb_width_ + mx]) {
+                continue;
+            }
+            ++changed_count;
+            for (uint32_t ny = my > 0 ? my - 1 : 0; ny <= my + 1 && ny < mb_height_; ++ny) {
+                for (uint32_t nx = mx > 0 ? mx - 1 : 0; nx <= mx + 1 && nx < mb_width_; ++nx) {
+                    quant_offsets_[(size_t)ny * mb_width_ + nx] = 0.0f;
+                }
+            }
+        }
+    }
+    stats_.macroblocks += changed_.size();
+    stats_.changed_macroblocks += changed_count;
+
+    if (changed_count > 0 || keep) {
+        last_sent_us_ = now;
+        return true;
+    }
+    if (now - last_sent_us_ >= (uint64_t)config_.repeat_interval_ms * 1000) {
+        ++stats_.repeat_frames;
+        last_sent_us_ = now;
+        return true;
+    }
+    ++stats_.frames_dropped;
+    return false;
+}
+
+uint32_t ScreenContentAnalyzer::GetMbWidth() const {
+    return mb_width_;
+}
+
+uint32_t ScreenContentAnalyzer::GetMbHeight() const {
+    return mb_height_;
+}
+
+const std::vector<uint8_t>& ScreenContentAnalyzer::GetChangeMap() const {
+    return changed_;
+}
+
+float* ScreenContentAnalyzer::GetQuantOffsets() {
+    return quant_offsets_.data();
+}
+
+ScreenContentStats ScreenContentAnalyzer::GetStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void ScreenContentAnalyzer::DiffPlane(const uint8_t* cur, int stride, uint8_t* prev,
+                                      uint32_t width, uint32_t height, uint32_t block) {
+    for (uint32_t row = 0; row < height; ++row) {
+        const uint8_t* a = cur + (size_t)row * stride;
+        uint8_t* b = prev + (size_t)row * width;
+        if (memcmp(a, b, width) == 0) {
+            continue;
+        }
+        uint8_t* mb_row = &changed_[(size_t)(row / block) * mb_width_];
+        for (uint32_t x = 0, mx = 0; x < width; x += block, ++mx) {
+            const uint32_t size = width - x < block ? width - x : block;
+            if (!mb_row[mx] && ChunkDiffers(a + x, b + x, size)) {
+                mb_row[mx] = 1;
+            }
+        }
+        memcpy(b, a, width);
+    }
+}
\ No newline at end of file
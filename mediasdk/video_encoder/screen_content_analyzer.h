@@ -0,0 +1,74 @@
+﻿#pragma once
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+struct ScreenContentConfig {
+    bool enabled{false};
+    // Frames identical to the last one are dropped, but one still goes out this often so
+    // servers and players see the stream alive; being unchanged it codes to skips.
+    uint32_t repeat_interval_ms{1000};
+    // Added to the QP of macroblocks that did not change, nor did their neighbours, so the
+    // encoder skips them instead of refining what it sent before.
+    float static_qp_offset{8.0f};
+};
+
+struct ScreenContentStats {
+    uint64_t frames;
+    uint64_t frames_dropped; // unchanged, not sent
+    uint64_t repeat_frames;  // unchanged, sent to keep the stream alive
+    uint64_t macroblocks;
+    uint64_t changed_macroblocks;
+};
+
+// Screen-content mode of the video encoders. Screen captures are mostly unchanged from one
+// frame to the next, so each I420 frame, at coded size, is compared with the last one per
+// 16x16 macroblock. The result is a change map with QP offsets for the encoders that take
+// them (x264 quant_offsets), and whether the frame may be dropped because nothing changed.
+// Rows that did not change are found with one memcmp each, and only changed rows are kept
+// for the next comparison, so a static screen costs about a read of the frame.
+class ScreenContentAnalyzer {
+public:
+    ScreenContentAnalyzer();
+
+    void SetConfig(const ScreenContentConfig& config);
+    ScreenContentConfig GetConfig();
+    // The next frame counts as changed everywhere.
+    void Reset();
+
+    // Called on the encoder thread once per frame. keep is set when the frame must be coded
+    // anyway, e.g. it is an IDR frame. Returns false if the frame may be dropped. Frames
+    // without timestamps are spaced by frame_rate.
+    bool Analyze(const uint8_t* y, int stride_y, const uint8_t* u, int stride_u,
+                 const uint8_t* v, int stride_v, uint32_t width, uint32_t height,
+                 uint64_t timestamp_us, uint32_t frame_rate, bool keep);
+
+    // Of the last frame analyzed, one entry per macroblock in raster order.
+    uint32_t GetMbWidth() const;
+    uint32_t GetMbHeight() const;
+    const std::vector<uint8_t>& GetChangeMap() const; // 1 where the macroblock changed
+    float* GetQuantOffsets();
+
+    ScreenContentStats GetStats();
+
+private:
+    // Marks the macroblocks whose block x block piece of the plane differs from prev and
+    // copies the rows that differ into prev.
+    void DiffPlane(const uint8_t* cur, int stride, uint8_t* prev, uint32_t width,
+                   uint32_t height, uint32_t block);
+
+private:
+    std::mutex mutex_{};
+    ScreenContentConfig config_{};
+    uint32_t width_{};
+    uint32_t height_{};
+    uint32_t mb_width_{};
+    uint32_t mb_height_{};
+    std::vector<uint8_t> previous_{}; // last frame, tightly packed I420
+    std::vector<uint8_t> changed_{};
+    std::vector<float> quant_offsets_{};
+    bool has_previous_{};
+    uint64_t last_us_{};
+    uint64_t last_sent_us_{};
+    ScreenContentStats stats_{};
+};
\ No newline at end of file
@@ -0,0 +1,123 @@
+﻿#include "video_encode_pipeline.h"
+
+#include <chrono>
+
+namespace {
+
+const int64_t kQueueWaitUs = 20 * 1000;
+
+} // namespace
+
+VideoEncodePipeline::VideoEncodePipeline()
+    : work_queue_(kVideoEncodePipelineMaxDepth), free_queue_(kVideoEncodePipelineMaxDepth) {}
+
+VideoEncodePipeline::~VideoEncodePipeline() {
+    Stop();
+}
+
+bool VideoEncodePipeline::Start(uint32_t depth, EncodeStage encode) {
+    if (depth_ > 0 || depth == 0 || depth > kVideoEncodePipelineMaxDepth || !encode) {
+        return false;
+    }
+    depth_ = depth;
+    encode_ = encode;
+    has_spare_ = false;
+    if (depth_ == 1) {
+        return true;
+    }
+    for (uint32_t slot = 0; slot < depth_; ++slot) {
+        free_queue_.enqueue(slot);
+    }
+    running_ = true;
+    thread_ = std::thread(&VideoEncodePipeline::EncodeThread, this);
+    return true;
+}
+
+void VideoEncodePipeline::Stop() {
+    if (running_.exchange(false) && thread_.joinable()) {
+        thread_.join();
+    }
+    // Start over with every slot free.
+    uint32_t slot = 0;
+    while (free_queue_.try_dequeue(slot)) {
+    }
+    depth_ = 0;
+}
+
+bool VideoEncodePipeline::IsStarted() const {
+    return depth_ > 0;
+}
+
+uint32_t VideoEncodePipeline::GetDepth() const {
+    return depth_;
+}
+
+bool VideoEncodePipeline::AcquireSlot(uint32_t& slot) {
+    if (depth_ == 0) {
+        return false;
+    }
+    if (depth_ == 1) {
+        slot = 0;
+        return true;
+    }
+    if (has_spare_) {
+        has_spare_ = false;
+        slot = spare_slot_;
+        return true;
+    }
+    if (free_queue_.try_dequeue(slot)) {
+        return true;
+    }
+    ++stalls_;
+    const auto start = std::chrono::steady_clock::now();
+    bool acquired = false;
+    while (!acquired && running_.load()) {
+        acquired = free_queue_.wait_dequeue_timed(slot, kQueueWaitUs);
+    }
+    stall_us_ += (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+    return acquired;
+}
+
+void VideoEncodePipeline::SubmitSlot(uint32_t slot) {
+    ++frames_submitted_;
+    if (depth_ == 1) {
+        encode_(slot);
+        ++frames_encoded_;
+        return;
+    }
+    // Cannot fail: the queue holds as many entries as there are slots.
+    work_queue_.try_enqueue(slot);
+}
+
+void VideoEncodePipeline::ReleaseSlot(uint32_t slot) {
+    if (depth_ > 1) {
+        has_spare_ = true;
+        spare_slot_ = slot;
+    }
+}
+
+VideoEncodePipelineStats VideoEncodePipeline::GetStats() const {
+    VideoEncodePipelineStats stats;
+    stats.frames_submitted = frames_submitted_.load();
+    stats.frames_encoded = frames_encoded_.load();
+    stats.stalls = stalls_.load();
+    stats.stall_us = stall_us_.load();
+    return stats;
+}
+
+void VideoEncodePipeline::EncodeThread() {
+    uint32_t slot = 0;
+    while (true) {
+        if (!work_queue_.wait_dequeue_timed(slot, kQueueWaitUs)) {
+            if (!running_.load()) {
+                break;
+            }
+            continue;
+        }
+        encode_(slot);
+        ++frames_encoded_;
+        free_queue_.enqueue(slot);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+﻿#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+#include "readerwriterqueue.h"
+
+// More slots than this only add latency.
+const uint32_t kVideoEncodePipelineMaxDepth = 8;
+
+struct VideoEncodePipelineStats {
+    uint64_t frames_submitted;
+    uint64_t frames_encoded;
+    uint64_t stalls;   // AcquireSlot found every slot in flight and waited
+    uint64_t stall_us; // time spent waiting for a slot
+};
+
+// Overlaps the two halves of encoding a frame: scaling and converting it into an input
+// picture of the codec, and coding that picture. The backend owns depth input pictures,
+// called slots. The caller's thread prepares a frame into a free slot while the pipeline's
+// own thread encodes the slots submitted before it, in order. Slots travel over two lock-free
+// single producer, single consumer queues, so a slot is only ever touched by one thread.
+// With every slot in flight the caller waits for the oldest to be encoded, which bounds the
+// latency added to one frame per extra slot. With depth 1 nothing is overlapped: the slot is
+// encoded on the caller's thread when submitted. AcquireSlot, SubmitSlot and ReleaseSlot
+// must always be called from the same thread.
+class VideoEncodePipeline {
+public:
+    using EncodeStage = std::function<void(uint32_t slot)>;
+
+public:
+    VideoEncodePipeline();
+    ~VideoEncodePipeline();
+
+    // encode runs once per submitted slot, on the pipeline's thread when depth is above 1.
+    bool Start(uint32_t depth, EncodeStage encode);
+    // Encodes what was submitted and joins the thread.
+    void Stop();
+    bool IsStarted() const;
+    uint32_t GetDepth() const;
+
+    // A slot to prepare the next frame in, waiting while all of them are in flight.
+    bool AcquireSlot(uint32_t& slot);
+    // Hands a prepared slot to the encode stage.
+    void SubmitSlot(uint32_t slot);
+    // Gives back a slot that was not used, e.g. because the frame was dropped.
+    void ReleaseSlot(uint32_t slot);
+
+    VideoEncodePipelineStats GetStats() const;
+
+private:
+    VideoEncodePipeline(const VideoEncodePipeline&) = delete;
+    VideoEncodePipeline& operator=(const VideoEncodePipeline&) = delete;
+
+    void EncodeThread();
+
+private:
+    std::atomic<bool> running_{false};
+    uint32_t depth_{};
+    EncodeStage encode_{};
+    std::thread thread_{};
+    moodycamel::BlockingReaderWriterQueue<uint32_t> work_queue_;
+    moodycamel::BlockingReaderWriterQueue<uint32_t> free_queue_;
+    // A released slot stays with the caller's thread, which keeps each queue single producer.
+    bool has_spare_{};
+    uint32_t spare_slot_{};
+
+    std::atomic<uint64_t> frames_submitted_{0};
+    std::atomic<uint64_t> frames_encoded_{0};
+    std::atomic<uint64_t> stalls_{0};
+    std::atomic<uint64_t> stall_us_{0};
+};
\ No newline at end of file
@@ -21,4 +21,89 @@ void VideoEncoder::SetOutputSize(uint32_t width, uint32_t height) {
     output_height_ = height % 16 == 0 ? height : height + (16 - height % 16);*/
     output_width_ = width;
     output_height_ = height;
+}
+
+void VideoEncoder::SetGopConfig(const GopConfig& config) {
+    gop_.SetConfig(config);
+    gop_.Reset();
+}
+
+void VideoEncoder::RequestKeyframe() {
+    gop_.RequestKeyframe();
+}
+
+void VideoEncoder::HintSceneCut() {
+    gop_.HintSceneCut();
+}
+
+GopStats VideoEncoder::GetGopStats() {
+    return gop_.GetStats();
+}
+
+void VideoEncoder::SetScreenContent(const ScreenContentConfig& config) {
+    screen_.SetConfig(config);
+}
+
+ScreenContentStats VideoEncoder::GetScreenContentStats() {
+    return screen_.GetStats();
+}
+
+void VideoEncoder::SetPipelineDepth(uint32_t depth) {
+    if (!pipeline_.IsStarted() && depth > 0) {
+        pipeline_depth_ = depth < kVideoEncodePipelineMaxDepth ? depth
+                                                               : kVideoEncodePipelineMaxDepth;
+    }
+}
+
+VideoEncodePipelineStats VideoEncoder::GetPipelineStats() const {
+    return pipeline_.GetStats();
+}
+
+bool VideoEncoder::PrepareInput(const std::shared_ptr<VideoFrame>& /*video_frame*/,
+                                bool /*keyframe*/, uint32_t /*slot*/) {
+    return false;
+}
+
+void VideoEncoder::EncodeInput(uint32_t /*slot*/) {}
+
+void VideoEncoder::EncodeFrameStaged(const std::shared_ptr<VideoFrame>& video_frame,
+                                     bool keyframe) {
+    if (!pipeline_.IsStarted() &&
+        !pipeline_.Start(pipeline_depth_, [this](uint32_t slot) { EncodeInput(slot); })) {
+        return;
+    }
+    uint32_t slot = 0;
+    if (!pipeline_.AcquireSlot(slot)) {
+        return;
+    }
+    if (PrepareInput(video_frame, keyframe, slot)) {
+        pipeline_.SubmitSlot(slot);
+    } else {
+        pipeline_.ReleaseSlot(slot);
+    }
+}
+
+uint32_t VideoEncoder::GetInputSlots() const {
+    return pipeline_depth_;
+}
+
+void VideoEncoder::StopPipeline() {
+    pipeline_.Stop();
+}
+
+bool VideoEncoder::NextFrameIsIdr(const std::shared_ptr<VideoFrame>& video_frame, bool keyframe) {
+    if (keyframe) {
+        gop_.RequestKeyframe();
+    }
+    return gop_.NextFrame(video_frame->GetTimestamp(), frame_rate_, intra_refresh_);
+}
+
+bool VideoEncoder::KeepScreenFrame(const std::shared_ptr<VideoFrame>& video_frame,
+                                   const uint8_t* i420, bool idr) {
+    const uint32_t luma_size = output_width_ * output_height_;
+    const uint32_t chroma_width = (output_width_ + 1) / 2;
+    const uint32_t chroma_size = chroma_width * ((output_height_ + 1) / 2);
+    return screen_.Analyze(i420, output_width_, i420 + luma_size, chroma_width,
+                           i420 + luma_size + chroma_size, chroma_width, output_width_,
+                           output_height_, video_frame->GetTimestamp(), frame_rate_, idr);
 }
\ No newline at end of file
@@ -2,6 +2,9 @@
 #include <functional>
 #include <fstream>
 #include <vector>
+#include "gop_controller.h"
+#include "screen_content_analyzer.h"
+#include "video_encode_pipeline.h"
 #include "video_frame.h"
 
 class VideoEncoder {
@@ -11,12 +14,59 @@ public:
     VideoEncoder();
     virtual ~VideoEncoder();
 
+    // keyframe asks for an IDR frame like RequestKeyframe; the GOP controller decides.
     virtual void EncodeFrame(std::shared_ptr<VideoFrame> video_frame, bool keyframe);
 
     void RegisterEncodeCalback(EncodeFrameCallback callback);
     void SetOutputSize(uint32_t width, uint32_t height);
 
+    // Keyframe policy, see GopController. Starts over, so the next frame is an IDR frame.
+    // Intra refresh and the refresh cycle are read when the codec opens on the first frame.
+    void SetGopConfig(const GopConfig& config);
+    void RequestKeyframe();
+    void HintSceneCut();
+    GopStats GetGopStats();
+
+    // Screen-content mode, see ScreenContentAnalyzer. Taken by the x264 and OpenH264
+    // backends; read when the codec opens on the first frame.
+    void SetScreenContent(const ScreenContentConfig& config);
+    ScreenContentStats GetScreenContentStats();
+
+    // With a depth above 1 the x264, x265 and OpenH264 backends convert a frame on the
+    // caller's thread while the frames before it, up to depth - 1 of them, are encoded on a
+    // thread of their own, and the encode callback runs there. See VideoEncodePipeline. Set
+    // before the first frame; 1, the default, does both on the caller's thread.
+    void SetPipelineDepth(uint32_t depth);
+    VideoEncodePipelineStats GetPipelineStats() const;
+
+protected:
+    // Backends that split a frame in two stages implement these and call EncodeFrameStaged from
+    // EncodeFrame. PrepareInput scales and converts the frame into input picture slot on the
+    // caller's thread and returns false to drop it; EncodeInput codes the slot.
+    virtual bool PrepareInput(const std::shared_ptr<VideoFrame>& video_frame, bool keyframe,
+                              uint32_t slot);
+    virtual void EncodeInput(uint32_t slot);
+    void EncodeFrameStaged(const std::shared_ptr<VideoFrame>& video_frame, bool keyframe);
+    // How many input pictures those backends allocate when the codec opens.
+    uint32_t GetInputSlots() const;
+    // Encodes what is in flight and joins the pipeline thread. Backends call it in their
+    // destructor, before they free their input pictures.
+    void StopPipeline();
+
+    // Called by the backends once per frame before coding it: true if it must be an IDR frame.
+    bool NextFrameIsIdr(const std::shared_ptr<VideoFrame>& video_frame, bool keyframe);
+    // Called by the backends in screen-content mode with the frame as it will be coded, I420
+    // at output size: false if nothing changed and it is to be dropped. IDR frames are kept.
+    bool KeepScreenFrame(const std::shared_ptr<VideoFrame>& video_frame, const uint8_t* i420,
+                         bool idr);
+
 protected:
+    GopController gop_{};
+    ScreenContentAnalyzer screen_{};
+    VideoEncodePipeline pipeline_{};
+    uint32_t pipeline_depth_{1};
+    // Set by backends that opened their codec with intra refresh.
+    bool intra_refresh_{};
     EncodeFrameCallback callback_{};
     uint32_t output_width_{1920};
     uint32_t output_height_{1080};
@@ -7,20 +7,25 @@
 VideoEncoderX264::VideoEncoderX264() {}
 
 VideoEncoderX264::~VideoEncoderX264() {
+    StopPipeline();
     Uninit();
 }
 
 void VideoEncoderX264::EncodeFrame(std::shared_ptr<VideoFrame> video_frame, bool keyframe) {
+    EncodeFrameStaged(video_frame, keyframe);
+}
+
+bool VideoEncoderX264::PrepareInput(const std::shared_ptr<VideoFrame>& video_frame,
+                                    bool keyframe, uint32_t slot) {
     uint32_t width = video_frame->GetWidth();
     uint32_t height = video_frame->GetHeight();
     if (!init_) {
         Init();
     }
     // x264 默认第一帧编码成关键帧
-    x264_nal_t* nal;
-    x264_picture_t pic_out;
-    int i_nal;
-    input_picture_.i_type = keyframe ? X264_TYPE_IDR : X264_TYPE_AUTO;
+    x264_picture_t& picture = input_pictures_[slot];
+    const bool idr = NextFrameIsIdr(video_frame, keyframe);
+    picture.i_type = idr ? X264_TYPE_IDR : X264_TYPE_AUTO;
     bool need_scale = (width != output_width_) || (height != output_height_);
     uint8_t* src = video_frame->GetData();
     if (need_scale) {
@@ -34,19 +39,34 @@ void VideoEncoderX264::EncodeFrame(std::shared_ptr<VideoFrame> video_frame, bool
                           output_width_, dst + output_width_ * output_height_, output_width_ >> 1,
                           dst + output_width_ * output_height_ * 5 / 4, output_width_ >> 1,
                           output_width_, output_height_, libyuv::FilterMode::kFilterBox);
-        libyuv::I420ToNV12(dst, output_width_, dst + output_width_ * output_height_,
-                           output_width_ >> 1, dst + output_width_ * output_height_ * 5 / 4,
-                           output_width_ >> 1, input_picture_.img.plane[0],
-                           input_picture_.img.i_stride[0], input_picture_.img.plane[1],
-                           input_picture_.img.i_stride[1], output_width_, output_height_);
-    } else {
-        libyuv::I420ToNV12(src, output_width_, src + output_width_ * output_height_,
-                           output_width_ >> 1, src + output_width_ * output_height_ * 5 / 4,
-                           output_width_ >> 1, input_picture_.img.plane[0],
-                           input_picture_.img.i_stride[0], input_picture_.img.plane[1],
-                           input_picture_.img.i_stride[1], output_width_, output_height_);
+        src = dst;
+    }
+    // An unchanged screen is dropped before it costs a conversion, and what did not change
+    // in the rest gets a higher QP, so x264 skips it.
+    if (screen_content_ && !KeepScreenFrame(video_frame, src, idr)) {
+        return false;
     }
-    int i_framesize = x264_encoder_encode(x264_encoder_, &nal, &i_nal, &input_picture_, &pic_out);
+    // The analyzer moves on to the next frame while this one waits to be encoded.
+    picture.prop.quant_offsets = nullptr;
+    if (screen_content_ && !idr) {
+        const float* offsets = screen_.GetQuantOffsets();
+        quant_offsets_[slot].assign(offsets, offsets + quant_offsets_[slot].size());
+        picture.prop.quant_offsets = quant_offsets_[slot].data();
+    }
+    libyuv::I420ToNV12(src, output_width_, src + output_width_ * output_height_,
+                       output_width_ >> 1, src + output_width_ * output_height_ * 5 / 4,
+                       output_width_ >> 1, picture.img.plane[0], picture.img.i_stride[0],
+                       picture.img.plane[1], picture.img.i_stride[1], output_width_,
+                       output_height_);
+    return true;
+}
+
+void VideoEncoderX264::EncodeInput(uint32_t slot) {
+    x264_nal_t* nal;
+    x264_picture_t pic_out;
+    int i_nal;
+    int i_framesize =
+        x264_encoder_encode(x264_encoder_, &nal, &i_nal, &input_pictures_[slot], &pic_out);
     if (callback_ && i_framesize > 0) {
         callback_(nal[0].p_payload, i_framesize);
     }
@@ -56,7 +76,10 @@ bool VideoEncoderX264::Uninit() {
     if (init_) {
         x264_encoder_close(x264_encoder_);
         x264_encoder_ = nullptr;
-        x264_picture_clean(&input_picture_);
+        for (x264_picture_t& picture : input_pictures_) {
+            x264_picture_clean(&picture);
+        }
+        input_pictures_.clear();
         init_ = false;
     }
     return true;
@@ -79,7 +102,21 @@ bool VideoEncoderX264::Init() {
     x264_param.i_fps_num = frame_rate_;
     x264_param.i_csp = X264_CSP_NV12;
     x264_param.i_threads = 1;
+    // Keyframes are GopController's: none of x264's own, periodic or at scene cuts.
+    const GopConfig gop = gop_.GetConfig();
     x264_param.i_keyint_max = X264_KEYINT_MAX_INFINITE;
+    x264_param.i_scenecut_threshold = 0;
+    if (gop.intra_refresh) {
+        // The refresh cycle takes the place of the GOP.
+        x264_param.b_intra_refresh = 1;
+        x264_param.i_keyint_max = (int)gop_.GetIntervalFrames(frame_rate_);
+    }
+    intra_refresh_ = gop.intra_refresh;
+    // quant_offsets are applied by adaptive quantization, which the ultrafast preset turns off.
+    screen_content_ = screen_.GetConfig().enabled;
+    if (screen_content_ && x264_param.rc.i_aq_mode == X264_AQ_NONE) {
+        x264_param.rc.i_aq_mode = X264_AQ_VARIANCE;
+    }
     x264_param.i_log_level = X264_LOG_WARNING;
     x264_param.rc.i_rc_method = X264_RC_ABR;
     x264_param.rc.b_filler = 0;
@@ -94,7 +131,12 @@ bool VideoEncoderX264::Init() {
     }
     x264_param.b_opencl = 0;
     x264_encoder_ = x264_encoder_open(&x264_param);
-    x264_picture_alloc(&input_picture_, X264_CSP_NV12, output_width_, output_height_);
+    input_pictures_.resize(GetInputSlots());
+    for (x264_picture_t& picture : input_pictures_) {
+        x264_picture_alloc(&picture, X264_CSP_NV12, output_width_, output_height_);
+    }
+    const size_t mb_count = (size_t)((output_width_ + 15) / 16) * ((output_height_ + 15) / 16);
+    quant_offsets_.assign(input_pictures_.size(), std::vector<float>(mb_count));
     init_ = true;
     return true;
 }
\ No newline at end of file
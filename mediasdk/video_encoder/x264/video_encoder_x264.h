@@ -11,14 +11,22 @@ public:
 
     void EncodeFrame(std::shared_ptr<VideoFrame> video_frame, bool keyframe) override;
 
+protected:
+    bool PrepareInput(const std::shared_ptr<VideoFrame>& video_frame, bool keyframe,
+                      uint32_t slot) override;
+    void EncodeInput(uint32_t slot) override;
+
 private:
     bool Init();
     bool Uninit();
 
 private:
     x264_t* x264_encoder_{};
-    x264_picture_t input_picture_;
+    // One per pipeline slot, each with the QP offsets it was prepared with.
+    std::vector<x264_picture_t> input_pictures_{};
+    std::vector<std::vector<float>> quant_offsets_{};
     bool init_{};
+    bool screen_content_{};
     std::vector<uint8_t> buffer_{};
     uint32_t buffer_size_{};
 };
\ No newline at end of file
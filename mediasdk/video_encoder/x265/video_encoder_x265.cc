@@ -4,29 +4,39 @@
 
 VideoEncoderX265::VideoEncoderX265() {}
 
-VideoEncoderX265::~VideoEncoderX265() {}
+VideoEncoderX265::~VideoEncoderX265() {
+    StopPipeline();
+}
 
 void VideoEncoderX265::EncodeFrame(std::shared_ptr<VideoFrame> video_frame, bool keyframe) {
+    EncodeFrameStaged(video_frame, keyframe);
+}
+
+bool VideoEncoderX265::PrepareInput(const std::shared_ptr<VideoFrame>& video_frame,
+                                    bool keyframe, uint32_t slot) {
     uint32_t width = video_frame->GetWidth();
     uint32_t height = video_frame->GetHeight();
     if (!init_) {
         if (!Init()) {
-            return;
+            return false;
         }
     }
-    x265_nal* nal = nullptr;
-    x265_picture pic_out;
-    uint32_t i_nal = 0;
-    input_picture_->sliceType = keyframe ? X265_TYPE_IDR : X265_TYPE_AUTO;
-    bool need_scale = (width != output_width_) || (height != output_height_);
+    x265_picture* picture = input_pictures_[slot];
+    picture->sliceType = NextFrameIsIdr(video_frame, keyframe) ? X265_TYPE_IDR : X265_TYPE_AUTO;
     uint8_t* src = video_frame->GetData();
     libyuv::I420Scale(src, width, src + width * height, width >> 1, src + width * height * 5 / 4,
-                      width >> 1, width, height, (uint8_t*)input_picture_->planes[0],
-                      input_picture_->stride[0], (uint8_t*)input_picture_->planes[1],
-                      input_picture_->stride[1], (uint8_t*)input_picture_->planes[2],
-                      input_picture_->stride[2], output_width_, output_height_,
-                      libyuv::FilterMode::kFilterBox);
-    int framesize = x265_encoder_encode(x265_encoder_, &nal, &i_nal, input_picture_, NULL);
+                      width >> 1, width, height, (uint8_t*)picture->planes[0],
+                      picture->stride[0], (uint8_t*)picture->planes[1], picture->stride[1],
+                      (uint8_t*)picture->planes[2], picture->stride[2], output_width_,
+                      output_height_, libyuv::FilterMode::kFilterBox);
+    return true;
+}
+
+void VideoEncoderX265::EncodeInput(uint32_t slot) {
+    x265_nal* nal = nullptr;
+    uint32_t i_nal = 0;
+    int framesize =
+        x265_encoder_encode(x265_encoder_, &nal, &i_nal, input_pictures_[slot], NULL);
     if (callback_ && framesize > 0) {
         for (int i = 0; i < i_nal; ++i) {
             callback_(nal[i].payload, nal[i].sizeBytes);
@@ -54,7 +64,16 @@ bool VideoEncoderX265::Init() {
     param.internalCsp = X265_CSP_I420;
     param.internalBitDepth = 8;
     param.bframes = 0;
+    // Keyframes are GopController's: none of x265's own, periodic or at scene cuts.
+    const GopConfig gop = gop_.GetConfig();
     param.keyframeMax = -1;
+    param.scenecutThreshold = 0;
+    if (gop.intra_refresh) {
+        // The refresh cycle takes the place of the GOP.
+        param.bIntraRefresh = 1;
+        param.keyframeMax = (int)gop_.GetIntervalFrames(frame_rate_);
+    }
+    intra_refresh_ = gop.intra_refresh;
 
     param.rc.rateControlMode = X265_RC_ABR;
     param.rc.bitrate = (int)bitrate;
@@ -67,19 +86,20 @@ bool VideoEncoderX265::Init() {
         param.rc.qpMax = 39;
     }
 
-    input_picture_ = x265_picture_alloc();
-    x265_picture_init(&param, input_picture_);
-    input_picture_->bitDepth = 8;
-    input_picture_->colorSpace = X265_CSP_I420;
-    input_picture_->stride[0] = param.sourceWidth;
-    input_picture_->stride[1] =
-        input_picture_->stride[0] >> x265_cli_csps[input_picture_->colorSpace].width[1];
-    input_picture_->stride[2] =
-        input_picture_->stride[0] >> x265_cli_csps[input_picture_->colorSpace].width[2];
     int y_size = param.sourceWidth * param.sourceHeight;
-    input_picture_->planes[0] = (char*)malloc(y_size);
-    input_picture_->planes[1] = (char*)malloc(y_size / 4);
-    input_picture_->planes[2] = (char*)malloc(y_size / 4);
+    input_pictures_.resize(GetInputSlots());
+    for (x265_picture*& picture : input_pictures_) {
+        picture = x265_picture_alloc();
+        x265_picture_init(&param, picture);
+        picture->bitDepth = 8;
+        picture->colorSpace = X265_CSP_I420;
+        picture->stride[0] = param.sourceWidth;
+        picture->stride[1] = picture->stride[0] >> x265_cli_csps[picture->colorSpace].width[1];
+        picture->stride[2] = picture->stride[0] >> x265_cli_csps[picture->colorSpace].width[2];
+        picture->planes[0] = (char*)malloc(y_size);
+        picture->planes[1] = (char*)malloc(y_size / 4);
+        picture->planes[2] = (char*)malloc(y_size / 4);
+    }
 
     x265_encoder_ = x265_encoder_open(&param);
     init_ = true;
@@ -88,16 +108,19 @@ bool VideoEncoderX265::Init() {
 
 bool VideoEncoderX265::Uninit() {
     if (init_) {
-        if (input_picture_->planes[0]) {
-            free(input_picture_->planes[0]);
-        }
-        if (input_picture_->planes[1]) {
-            free(input_picture_->planes[1]);
-        }
-        if (input_picture_->planes[2]) {
-            free(input_picture_->planes[2]);
+        for (x265_picture* picture : input_pictures_) {
+            if (picture->planes[0]) {
+                free(picture->planes[0]);
+            }
+            if (picture->planes[1]) {
+                free(picture->planes[1]);
+            }
+            if (picture->planes[2]) {
+                free(picture->planes[2]);
+            }
+            x265_picture_free(picture);
         }
-        x265_picture_free(input_picture_);
+        input_pictures_.clear();
         x265_encoder_close(x265_encoder_);
         x265_encoder_ = nullptr;
         x265_cleanup();
@@ -11,6 +11,11 @@ public:
 
     void EncodeFrame(std::shared_ptr<VideoFrame> video_frame, bool keyframe) override;
 
+protected:
+    bool PrepareInput(const std::shared_ptr<VideoFrame>& video_frame, bool keyframe,
+                      uint32_t slot) override;
+    void EncodeInput(uint32_t slot) override;
+
 private:
     bool Init();
     bool Uninit();
@@ -21,5 +26,6 @@ private:
     uint32_t buffer_size_{};
 
     x265_encoder* x265_encoder_{};
-    x265_picture* input_picture_{};
+    // One per pipeline slot.
+    std::vector<x265_picture*> input_pictures_{};
 };
\ No newline at end of file